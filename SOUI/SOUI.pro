@@ -111,6 +111,8 @@ HEADERS += include/SApp.h \
            include/helper/SResID.h \
            include/helper/STime.h \
            include/helper/STimerEx.h \
+           include/helper/STimerWheel.h \
+           include/helper/SFrameClock.h \
            include/helper/SScriptTimer.h \
            include/helper/SToolTip.h \
            include/helper/swndspy.h \
@@ -152,7 +154,11 @@ HEADERS += include/SApp.h \
            include/res.mgr/SObjDefAttr.h \
            include/res.mgr/SResProvider.h \
            include/res.mgr/SResProviderMgr.h \
+           include/res.mgr/SAsyncImageLoader.h \
+           include/res.mgr/SResWarmup.h \
            include/res.mgr/SSkinPool.h \
+           include/res.mgr/SSkinDiskCache.h \
+           include/res.mgr/SSkinAtlas.h \
            include/res.mgr/SStylePool.h \
            include/res.mgr/SNamedValue.h \
            include/res.mgr/SDpiAwareFont.h \
@@ -161,7 +167,8 @@ HEADERS += include/SApp.h \
            src/updatelayeredwindow/SUpdateLayeredWindow.h \
            include/activex/flash10t.tlh \
            include/activex/flash10t.tli \
-           include/animator/SInterpolatorImpl.h
+           include/animator/SInterpolatorImpl.h \
+           include/animator/SAnimationEngine.h
            
 SOURCES += src/SApp.cpp \
            src/activex/SAxContainer.cpp \
@@ -221,6 +228,8 @@ SOURCES += src/SApp.cpp \
            src/helper/MenuWndHook.cpp \
            src/helper/SMenu.cpp \
            src/helper/STimerEx.cpp \
+           src/helper/STimerWheel.cpp \
+           src/helper/SFrameClock.cpp \
            src/helper/SScriptTimer.cpp \
            src/helper/stooltip.cpp \
            src/helper/AppDir.cpp \
@@ -236,10 +245,15 @@ SOURCES += src/SApp.cpp \
            src/res.mgr/SObjDefAttr.cpp \
            src/res.mgr/SResProvider.cpp \
            src/res.mgr/SResProviderMgr.cpp \
+           src/res.mgr/SAsyncImageLoader.cpp \
+           src/res.mgr/SResWarmup.cpp \
            src/res.mgr/SSkinPool.cpp \
+           src/res.mgr/SSkinDiskCache.cpp \
+           src/res.mgr/SSkinAtlas.cpp \
            src/res.mgr/SStylePool.cpp \
            src/res.mgr/SNamedValue.cpp \
            src/res.mgr/SDpiAwareFont.cpp \
            src/updatelayeredwindow/SUpdateLayeredWindow.cpp \
-           src/animator/SInterpolatorImpl.cpp
+           src/animator/SInterpolatorImpl.cpp \
+           src/animator/SAnimationEngine.cpp
 
@@ -0,0 +1,173 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       SAnimationEngine.h
+* @brief      属性动画引擎
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    一个容器内的所有属性动画由一个引擎在同一个帧回调中计算. 插值使用IInterpolator,
+*             同一个目标在一帧内的多个属性变化只刷新一次, 动画结束或者被取消时回调通知
+*/
+
+#pragma once
+
+#include "interface/sinterpolator-i.h"
+#include "core/SwndContainer-i.h"
+
+namespace SOUI
+{
+    class SWindow;
+    struct AnimationNode;
+    struct AnimationTargetNode;
+
+    //窗口属性, 位置和大小使用宿主坐标, 与SWindow::Move一致
+    enum
+    {
+        ANIPROP_LEFT = 0,
+        ANIPROP_TOP,
+        ANIPROP_WIDTH,
+        ANIPROP_HEIGHT,
+        ANIPROP_ALPHA,      //0~255
+        ANIPROP_USER = 100, //自定义目标的属性从这里开始
+    };
+
+    /**
+    * @struct     IAnimationTarget
+    * @brief      动画目标
+    *
+    * Describe    引擎只通过这个接口访问目标. 窗口属性由引擎内部的目标实现, 其它对象自己实现这个接口
+    */
+    struct IAnimationTarget
+    {
+        //读取属性的当前值, 用于从当前值开始的动画
+        virtual BOOL GetAnimatedValue(int nProp,float & fValue) = 0;
+
+        //保存属性的新值, 返回FALSE表示目标已经失效, 它的所有动画都被取消
+        virtual BOOL SetAnimatedValue(int nProp,float fValue) = 0;
+
+        //本帧的属性都已经更新, 每帧每个目标只调用一次, 在这里统一刷新
+        virtual void OnAnimationFrame() = 0;
+    };
+
+    /**
+     * FunAnimationEnd
+     * @brief    动画结束的回调
+     * @param    UINT uAniID --  动画ID
+     * @param    BOOL bCanceled --  被取消(包括被同一个属性的新动画代替)时为TRUE
+     * @param    LPARAM lParam --  用户数据
+     */
+    typedef void (*FunAnimationEnd)(UINT uAniID,BOOL bCanceled,LPARAM lParam);
+
+    typedef struct tagANIMATIONSTATS
+    {
+        UINT nFrames;           //计算过动画的帧数
+        UINT nValues;           //设置属性值的次数
+        UINT nTargetUpdates;    //目标刷新的次数
+    } ANIMATIONSTATS;
+
+    /**
+    * @class      SAnimationEngine
+    * @brief      属性动画引擎
+    *
+    * Describe    不依赖系统时钟, Tick的时间由调用者传入, 方便用虚拟时钟测试.
+    *             指定了容器时引擎作为ITimelineHandler注册到容器, 只在有动画时需要帧回调.
+    *             动画结束和取消的回调在一帧的计算完成后调用, 回调中可以启动和取消动画
+    */
+    class SOUI_EXP SAnimationEngine : public ITimelineHandler
+    {
+    public:
+        SAnimationEngine(ISwndContainer *pContainer = NULL);
+        ~SAnimationEngine();
+
+        /**
+         * Animate
+         * @brief    启动一个属性动画
+         * @param    IAnimationTarget * pTarget --  目标, 销毁前需要调用CancelTarget
+         * @param    int nProp --  属性, 同一个属性已经有动画时先取消原来的动画
+         * @param    float fFrom --  起始值
+         * @param    float fTo --  结束值
+         * @param    DWORD dwDuration --  时长(ms)
+         * @param    IInterpolator * pInterpolator --  插值器, NULL为线性
+         * @param    DWORD dwDelay --  延迟启动的时间(ms)
+         * @param    FunAnimationEnd funEnd --  结束回调
+         * @param    LPARAM lParam --  结束回调的用户数据
+         * @return   UINT -- 动画ID, 从1开始
+         */
+        UINT Animate(IAnimationTarget *pTarget,int nProp,float fFrom,float fTo,DWORD dwDuration,
+            IInterpolator *pInterpolator = NULL,DWORD dwDelay = 0,FunAnimationEnd funEnd = NULL,LPARAM lParam = 0);
+
+        //从属性的当前值开始动画, 目标不能读取当前值时返回0
+        UINT AnimateTo(IAnimationTarget *pTarget,int nProp,float fTo,DWORD dwDuration,
+            IInterpolator *pInterpolator = NULL,DWORD dwDelay = 0,FunAnimationEnd funEnd = NULL,LPARAM lParam = 0);
+
+        //窗口属性动画, 从当前值开始. 窗口销毁后动画自动取消
+        UINT AnimateWindow(SWindow *pWnd,int nProp,float fTo,DWORD dwDuration,
+            IInterpolator *pInterpolator = NULL,DWORD dwDelay = 0,FunAnimationEnd funEnd = NULL,LPARAM lParam = 0);
+
+        BOOL Cancel(UINT uAniID);
+
+        //取消目标的所有动画, 返回取消的个数
+        int CancelTarget(IAnimationTarget *pTarget);
+
+        int CancelWindow(SWND swnd);
+
+        BOOL IsRunning(UINT uAniID) const;
+
+        int GetCount() const {return m_nCount;}
+
+        /**
+         * Tick
+         * @brief    计算所有动画在dwNow的值
+         * @param    DWORD dwNow --  当前时间(ms), 新启动的动画从它的第一次Tick开始计时
+         * @return   DWORD -- 到下一次需要Tick的时间(ms), 没有动画时返回INFINITE
+         */
+        DWORD Tick(DWORD dwNow);
+
+        DWORD GetNextDelay(DWORD dwNow) const;
+
+        const ANIMATIONSTATS & GetStats() const {return m_stats;}
+        void ResetStats();
+
+    public://ITimelineHandler
+        virtual void OnNextFrame();
+        virtual DWORD OnFrame(DWORD dwElapsed);
+
+    protected:
+        struct ENDEDINFO
+        {
+            UINT            uAniID;
+            BOOL            bCanceled;
+            FunAnimationEnd funEnd;
+            LPARAM          lParam;
+        };
+
+        AnimationTargetNode * _GetTarget(IAnimationTarget *pTarget,SWND swnd);
+        void _EndNode(AnimationNode *pNode,BOOL bCanceled);
+        void _Compact();
+        void _FireEnded();
+        void _Schedule();
+
+        ISwndContainer *                        m_pContainer;
+        BOOL                                    m_bRegistered;
+        BOOL                                    m_bFrameRequested;  //下一帧会被调用
+
+        SArray<AnimationNode*>                  m_arrNodes;     //按启动顺序计算, 结束的在Tick后删除
+        SMap<UINT,AnimationNode*>               m_mapNodes;     //进行中的动画
+        SMap<IAnimationTarget*,AnimationTargetNode*> m_mapTargets;
+        SMap<SWND,IAnimationTarget*>            m_mapWndTargets;//引擎创建的窗口目标
+        SArray<AnimationTargetNode*>            m_arrUpdated;   //本帧需要刷新的目标
+        SArray<ENDEDINFO>                       m_arrEnded;     //计算过程中结束的动画, 等待回调
+
+        UINT    m_uNextID;
+        UINT    m_uFrame;
+        int     m_nCount;
+        int     m_nDispatching;
+        BOOL    m_bDirty;
+
+        ANIMATIONSTATS m_stats;
+    };
+
+}//namespace SOUI
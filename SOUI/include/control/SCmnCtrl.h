@@ -14,6 +14,7 @@
 #pragma once
 #include "core/SWnd.h"
 #include "core/Accelerator.h"
+#include "res.mgr/SAsyncImageLoader.h"
 
 namespace SOUI
 {
@@ -282,10 +283,10 @@ public:
  * @class      SImageWnd
  * @brief      图片控件类
  * 
- * Describe    Image Control 图片控件类
- * Usage       Usage: <img skin="skin" sub="0"/>
+ * Describe    Image Control 图片控件类, 指定asyncSrc时在后台解码图片, 解码完成前显示skin
+ * Usage       Usage: <img skin="skin" sub="0" asyncSrc="png:avatar"/>
  */
-class SOUI_EXP SImageWnd : public SWindow
+class SOUI_EXP SImageWnd : public SWindow, protected IAsyncImageCallback
 {
     SOUI_CLASS_NAME(SImageWnd, L"img")
 public:
@@ -339,6 +340,16 @@ public:
      */
     BOOL SetIcon(int nSubID);
 
+    /**
+     * SImageWnd::SetImageAsync
+     * @param    const SStringW & strImgID -- type:name形式的图片ID
+     * @param    FilterLevel fl -- FilterLevel
+     * @return   BOOL 成功提交请求--TRUE
+     *
+     * Describe  在后台解码图片, 完成后调用SetImage, 解码过程中仍然显示当前的图片或skin
+     */
+    BOOL SetImageAsync(const SStringW & strImgID,FilterLevel fl=kNone_FilterLevel);
+
     /**
      * SImageWnd::GetSkin
      * @brief    获取资源
@@ -351,6 +362,12 @@ protected:
     virtual void OnColorize(COLORREF cr);
     
 	virtual void OnScaleChanged(int scale);
+
+    virtual void OnAsyncImageLoaded(DWORD dwReqID,const SStringW & strImgID,IBitmap * pImg);
+
+    HRESULT OnAttrAsyncSrc(const SStringW & strValue,BOOL bLoading);
+
+    void CancelAsyncImage();
     /**
      * SImageWnd::GetDesiredSize
      * @brief    获取预期大小
@@ -367,10 +384,12 @@ protected:
     ISkinObj *m_pSkin;  /**< ISkinObj对象 */
     CAutoRefPtr<IBitmap>    m_pImg;//使用代码设定的图片
     FilterLevel             m_fl;
+    DWORD                   m_dwAsyncReq;//正在加载的异步图片请求
     SOUI_ATTRS_BEGIN()
         ATTR_SKIN(L"skin", m_pSkin, TRUE)
         ATTR_INT(L"iconIndex", m_iFrame, FALSE)
 		ATTR_INT(L"tile", m_iTile, TRUE)
+        ATTR_CUSTOM(L"asyncSrc", OnAttrAsyncSrc)
     SOUI_ATTRS_END()
 
     SOUI_MSG_MAP_BEGIN()
@@ -438,6 +457,13 @@ protected:
      */
     virtual CSize GetDesiredSize(LPCRECT pRcContainer);
     virtual void OnNextFrame();
+    /**
+     * SAnimateImgWnd::OnFrame
+     * @brief    按实际经过的时间切换帧
+     * @param    DWORD dwElapsed  --  距离上一次调用的时间(ms)
+     * @return   到下一帧的时间(ms), 两帧之间不需要回调
+     */
+    virtual DWORD OnFrame(DWORD dwElapsed);
     virtual void OnColorize(COLORREF cr);
     
     void OnPaint(IRenderTarget *pRT);
@@ -460,11 +486,11 @@ protected:
 
 protected:
     ISkinObj     *m_pSkin;        /**< 动画图片 */
-    int           m_nSpeed;       /**< 速度 */
+    int           m_nSpeed;       /**< 每帧的时间(ms) */
     int           m_iCurFrame;    /**< 当前帧 */
     BOOL          m_bAutoStart;   /**< 是否自动启动 */
     BOOL          m_bPlaying;     /**< 是否运行中 */
-    int           m_iTimeFrame;   /**< OnNextFrame的执行次数 */
+    int           m_iTimeFrame;   /**< 到下一帧的时间(ms) */
 	int			  m_nRepeat;	  /**< 播放循环次数,-1代表无限循环 */
 	int			  m_iRepeat;	  /**< 当前播放循环轮次 */
 };
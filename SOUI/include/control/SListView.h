@@ -6,7 +6,8 @@
 #include "interface/LvItemLocator-i.h"
 namespace SOUI
 {
-    
+    class SListViewHeightWorker;
+
     class SOUI_EXP SListView : public SPanel
         , protected IItemContainer
     {
@@ -67,6 +68,11 @@ namespace SOUI
         SItemPanel * GetItemPanel(int iItem);
         
         void UpdateVisibleItems();
+
+        //在工作线程中通过ILvAdapter::measureItemHeight计算表项高度
+        void StartMeasureItems();
+        void StopMeasureItems();
+        void OnTimer(char cTimerID);
         
         void OnPaint(IRenderTarget *pRT);
         void OnSize(UINT nType, CSize size);
@@ -89,6 +95,7 @@ namespace SOUI
             MSG_WM_PAINT_EX(OnPaint)
             MSG_WM_SIZE(OnSize)
             MSG_WM_DESTROY(OnDestroy)
+            MSG_WM_TIMER_EX(OnTimer)
             MSG_WM_MOUSEWHEEL(OnMouseWheel)
             MSG_WM_MOUSELEAVE(OnMouseLeave)
             MSG_WM_KEYDOWN(OnKeyDown)
@@ -128,5 +135,9 @@ namespace SOUI
         ISkinObj*                       m_pSkinDivider;
         SLayoutSize                     m_nDividerSize;
         BOOL                            m_bWantTab;
+
+        SListViewHeightWorker*          m_pHeightWorker;//后台计算表项高度
+        int                             m_nMeasureWidth;//后台计算使用的表项宽度
+        int                             m_nMeasureSupport;//adapter是否支持后台计算: -1未知, 0不支持, 1支持
     };
 }
\ No newline at end of file
@@ -138,6 +138,9 @@ protected:
     BOOL                    m_bCaretActive;     /**<模拟插入符正在显示标志*/
     CPoint                  m_ptCaret;          /**<插入符位置*/
 
+    BOOL                    m_bFrameTimerArmed; /**<驱动帧时钟的定时器已经设置*/
+    DWORD                   m_dwFrameTimerDue;  /**<帧定时器下一次触发的时间*/
+
     BOOL                    m_bNeedRepaint;     /**<缓存脏标志*/
     BOOL                    m_bNeedAllRepaint;  /**<缓存全部更新标志*/
 
@@ -199,6 +202,8 @@ protected://辅助函数
     void _Redraw();
     void _UpdateNonBkgndBlendSwnd();
     void _DrawCaret(CPoint pt,BOOL bErase);
+    //按帧时钟中最早到期的handler设置帧定时器, bForce为FALSE时只会提前
+    void _ArmFrameTimer(BOOL bForce);
     void _RestoreClickState();
 	bool _IsRootWrapContent();
 protected:
@@ -310,9 +315,7 @@ protected:// IContainer
 
 	virtual void UpdateTooltip();
 
-    virtual BOOL RegisterTimelineHandler(ITimelineHandler *pHandler);
-
-    virtual BOOL UnregisterTimelineHandler(ITimelineHandler *pHandler);
+    virtual void OnFrameScheduleChanged();
 
     virtual SMessageLoop * GetMsgLoop();
 
@@ -72,6 +72,8 @@ public://SwndContainerImpl
     virtual IScriptModule * GetScriptModule();
 
 	virtual int GetScale() const;
+protected://SwndContainerImpl
+    virtual void OnFrameScheduleChanged();
 public://SWindow
     virtual void ModifyItemState(DWORD dwStateAdd, DWORD dwStateRemove);
 
@@ -53,7 +53,7 @@ public:
         m_mapNamedObj->RemoveKey(key);
         return true;
     }
-    void RemoveAll()
+    virtual void RemoveAll()
     {
         if(m_pFunOnKeyRemoved)
         {
@@ -66,7 +66,7 @@ public:
         }
         m_mapNamedObj->RemoveAll();
     }
-    size_t GetCount()
+    virtual size_t GetCount()
     {
         return m_mapNamedObj->GetCount();
     }
@@ -28,6 +28,8 @@ enum
 
 //////////////////////////////////////////////////////////////////////////
 
+class SSkinAtlas;
+class SResProviderMgr;
 
 class SOUI_EXP SSkinImgList: public SSkinObjBase
 {
@@ -50,14 +52,30 @@ public:
     virtual bool SetImage(IBitmap *pImg)
     {
         m_pImg=pImg;
+        m_rcImg.SetRectEmpty();
+        m_imgColorized=NULL;
         return true;
     }
 
+    //合并到大图后返回大图, 使用GetImageRect获得skin使用的区域
     virtual IBitmap * GetImage()
     {
         return m_pImg;
     }
 
+    //skin在GetImage中使用的区域
+    CRect GetImageRect() const;
+
+    /**
+     * PackToAtlas
+     * @brief    把图片合并到大图中
+     * @param    SSkinAtlas * pAtlas --  合并器
+     * @param    SResProviderMgr * pImgCache --  加载图片的资源管理器, 合并后从它的图片缓存中删除原来的图片
+     * @return   BOOL -- 合并成功返回TRUE
+     * Describe  只合并内置的imglist,imgframe,imgframe2,scrollbar, 派生类可能直接访问整张图片
+     */
+    BOOL PackToAtlas(SSkinAtlas *pAtlas,SResProviderMgr *pImgCache = NULL);
+
     virtual void SetTile(BOOL bTile){m_bTile=bTile;}
     virtual BOOL IsTile(){return m_bTile;}
 
@@ -66,18 +84,27 @@ public:
     
     virtual void OnColorize(COLORREF cr);
 
+    using SSkinObjBase::Draw;
+    //着色由RenderTarget在绘制时完成, 不修改位图数据
+    virtual void Draw(IRenderTarget *pRT, LPCRECT rcDraw, DWORD dwState,BYTE byAlpha);
+
 protected:
 	virtual void _Scale(ISkinObj *skinObj, int nScale);
     virtual void _Draw(IRenderTarget *pRT, LPCRECT rcDraw, DWORD dwState,BYTE byAlpha);
 
     virtual UINT GetExpandMode();
+
+    //复制skin使用的区域
+    HRESULT _GetSubImage(IBitmap **ppImg);
     
     CAutoRefPtr<IBitmap> m_pImg;
+    CRect m_rcImg;  //m_pImg中使用的区域, 为空时使用整张图片
     int  m_nStates;
     BOOL m_bTile;
     BOOL m_bAutoFit;
     BOOL m_bVertical;
-    CAutoRefPtr<IBitmap> m_imgBackup;   //色调调整前的备分
+    CAutoRefPtr<IBitmap> m_imgColorized;    //渲染引擎不支持绘制时着色时使用的着色副本
+    COLORREF             m_crImgColorized;  //m_imgColorized对应的着色颜色
 
     FilterLevel m_filterLevel;
     
@@ -21,21 +21,33 @@ namespace SOUI
 {
 
     struct IAcceleratorMgr;
+    class SAnimationEngine;
     
     enum{
     ZORDER_MIN  = 0,
     ZORDER_MAX  = (UINT)-1,
     };
     
+    const UINT KFrameInterval = 10;     //默认帧间隔(ms), 与原来的NEXTFRAME定时器一致
+
     /**
     * @struct     ITimelineHandler
     * @brief      时间轴处理接口
     * 
-    * Describe    
+    * Describe    容器按帧时钟调用OnFrame. 只实现OnNextFrame的handler每帧调用一次;
+    *             按时间驱动的handler重载OnFrame, 用实际经过的时间计算状态, 并返回下一次需要调用的时间
     */
     struct ITimelineHandler
     {
         virtual void OnNextFrame()=0;
+
+        /**
+         * OnFrame
+         * @brief    帧回调
+         * @param    DWORD dwElapsed --  距离上一次调用(或注册)的实际时间(ms)
+         * @return   DWORD -- 到下一次调用的时间(ms), 0表示下一帧, INFINITE表示等待RequestNextFrame唤醒
+         */
+        virtual DWORD OnFrame(DWORD dwElapsed){ OnNextFrame(); return 0;}
     };
 
     /**
@@ -99,6 +111,12 @@ namespace SOUI
 
         virtual BOOL UnregisterTimelineHandler(ITimelineHandler *pHandler)=0;
 
+        //重新设置已注册的handler下一次被调用的时间, 用于唤醒等待中的handler
+        virtual BOOL RequestNextFrame(ITimelineHandler *pHandler,DWORD dwDelay=0)=0;
+
+        //容器内所有窗口共用的属性动画引擎
+        virtual SAnimationEngine * GetAnimationEngine()=0;
+
         virtual BOOL RegisterTrackMouseEvent(SWND swnd)=0;
 
         virtual BOOL UnregisterTrackMouseEvent(SWND swnd)=0;
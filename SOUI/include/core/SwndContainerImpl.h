@@ -15,6 +15,8 @@
 
 #include "SDropTargetDispatcher.h"
 #include "FocusManager.h"
+#include "helper/SFrameClock.h"
+#include "animator/SAnimationEngine.h"
 
 namespace SOUI
 {
@@ -54,6 +56,10 @@ namespace SOUI
 
         virtual BOOL UnregisterTimelineHandler(ITimelineHandler *pHandler);
 
+        virtual BOOL RequestNextFrame(ITimelineHandler *pHandler,DWORD dwDelay=0);
+
+        virtual SAnimationEngine * GetAnimationEngine(){return &m_aniEngine;}
+
         virtual BOOL RegisterTrackMouseEvent(SWND swnd);
 
         virtual BOOL UnregisterTrackMouseEvent(SWND swnd);
@@ -66,7 +72,11 @@ namespace SOUI
 
     public://ITimelineHandler
         virtual void OnNextFrame();
+
+        virtual DWORD OnFrame(DWORD dwElapsed);
     protected:
+        //handler注册, 注销或者请求唤醒后调用, 由派生类重新安排驱动帧时钟的定时器
+        virtual void OnFrameScheduleChanged(){}
 
         void OnFrameMouseMove(UINT uFlag,CPoint pt);
 
@@ -100,7 +110,8 @@ namespace SOUI
 
         BOOL        m_bZorderDirty;
 
-        SList<ITimelineHandler*>    m_lstTimelineHandler;
+        SFrameClock                 m_frameClock;
+        SAnimationEngine            m_aniEngine;        //先于m_frameClock析构
         SList<SWND>                 m_lstTrackMouseEvtWnd;
     };
 
@@ -144,6 +144,13 @@ namespace SOUI
 			(pItem);
             return pItem->GetDesiredSize(prcContainer);
         }
+
+        virtual int measureItemHeight(int position,int nWidth)
+        {
+			(position);
+			(nWidth);
+            return -1;
+        }
     protected:
         SLvObserverMgr    m_obzMgr;
     };
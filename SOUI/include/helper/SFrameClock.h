@@ -0,0 +1,106 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       SFrameClock.h
+* @brief      动画帧时钟
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    管理一个容器内注册的ITimelineHandler. 每个handler可以通过OnFrame的返回值指定下一次
+*             被调用的时间, 只有到期的handler才会被调用, 所有handler都在等待时时钟不需要跳动
+*/
+
+#pragma once
+
+#include "core/SwndContainer-i.h"
+
+namespace SOUI
+{
+    typedef struct tagFRAMECLOCKSTATS
+    {
+        UINT nTicks;        //Tick的次数
+        UINT nIdleTicks;    //没有handler到期的Tick次数
+        UINT nDispatches;   //调用handler的次数
+    } FRAMECLOCKSTATS;
+
+    /**
+    * @class      SFrameClock
+    * @brief      动画帧时钟
+    *
+    * Describe    不依赖系统时钟, 时间由调用者传入(GetTickCount的值, 可以回绕), 方便用虚拟时钟测试.
+    *             派发时直接遍历handler表, 不复制列表; handler的回调中可以注册和注销任何handler
+    */
+    class SOUI_EXP SFrameClock
+    {
+    public:
+        SFrameClock(UINT nFrameInterval = KFrameInterval);
+
+        void SetFrameInterval(UINT nFrameInterval);
+        UINT GetFrameInterval() const {return m_nFrameInterval;}
+
+        /**
+         * Add
+         * @brief    注册handler, 从下一帧开始调用
+         * @param    ITimelineHandler * pHandler --  handler
+         * @param    DWORD dwNow --  当前时间(ms)
+         * @return   BOOL -- 已经注册过时返回FALSE
+         */
+        BOOL Add(ITimelineHandler *pHandler,DWORD dwNow);
+
+        BOOL Remove(ITimelineHandler *pHandler);
+
+        /**
+         * Wake
+         * @brief    重新设置handler下一次被调用的时间
+         * Describe  在handler自己的OnFrame中调用时, 与OnFrame的返回值比较, 取较早的时间
+         * @param    ITimelineHandler * pHandler --  handler
+         * @param    DWORD dwDelay --  延时(ms), 0表示下一帧, INFINITE表示一直等待
+         * @param    DWORD dwNow --  当前时间(ms)
+         * @return   BOOL -- handler没有注册时返回FALSE
+         */
+        BOOL Wake(ITimelineHandler *pHandler,DWORD dwDelay,DWORD dwNow);
+
+        int GetCount() const {return m_nCount;}
+
+        /**
+         * Tick
+         * @brief    调用所有到期的handler
+         * @param    DWORD dwNow --  当前时间(ms)
+         * @return   DWORD -- 到下一次需要Tick的时间(ms), 没有需要调用的handler时返回INFINITE
+         * Describe  handler收到的是距离它上一次被调用(或注册)的实际时间, 提前半帧以内调用时按它请求的时间计算.
+         *           在回调中注册的handler从下一帧开始调用; 回调中Wake请求的时间比返回值早时按Wake的时间调用
+         */
+        DWORD Tick(DWORD dwNow);
+
+        DWORD GetNextDelay(DWORD dwNow) const;
+
+        const FRAMECLOCKSTATS & GetStats() const {return m_stats;}
+        void ResetStats();
+
+    protected:
+        struct FRAMEENTRY
+        {
+            ITimelineHandler * pHandler;    //派发过程中注销时置为NULL, 派发结束后再删除
+            DWORD   dwLast;                 //上一次调用的时间
+            DWORD   dwWake;                 //下一次调用的时间
+            BOOL    bSleeping;              //等待Wake
+            BOOL    bWoken;                 //OnFrame中调用过Wake
+        };
+
+        int  _Find(ITimelineHandler *pHandler) const;
+        BOOL _IsDue(const FRAMEENTRY & entry,DWORD dwNow) const;
+        void _Schedule(FRAMEENTRY & entry,DWORD dwDelay,DWORD dwNow);
+        void _Compact();
+
+        SArray<FRAMEENTRY>  m_arrEntries;
+        UINT    m_nFrameInterval;
+        int     m_nCount;           //有效的handler数量
+        int     m_nDispatching;     //Tick的嵌套深度
+        BOOL    m_bDirty;           //有等待删除的项
+
+        FRAMECLOCKSTATS m_stats;
+    };
+
+}//namespace SOUI
@@ -1,20 +1,20 @@
 ﻿#pragma once
 
-#include "core/SSingletonMap.h"
+#include "core/SSingleton.h"
+#include "helper/STimerWheel.h"
+#include "helper/SCriticalSection.h"
 
 namespace SOUI
 {
 
-typedef struct tagTIMERINFO
-{
-    SWND Swnd;
-    UINT_PTR uTimerID;
-} TIMERINFO;
-
-
-class SOUI_EXP STimer2:public SSingletonMap<STimer2,TIMERINFO,UINT_PTR>
+//每个UI线程的SOUI定时器由该线程的一个时间轮管理, 时间轮由该线程的一个线程定时器驱动,
+//定时器消息总是在设置定时器的线程中派发. 同一个窗口的定时器必须在窗口所在的线程中设置和删除
+class SOUI_EXP STimer2:public SSingleton<STimer2>
 {
 public:
+    STimer2();
+    ~STimer2();
+
     static BOOL SetTimer(SWND swnd,UINT_PTR uTimerID,UINT nElapse)
     {
         return getSingleton()._SetTimer(swnd,uTimerID,nElapse);
@@ -30,17 +30,39 @@ public:
         getSingleton()._KillTimer(swnd);
     }
 protected:
+    //一个线程的时间轮及驱动它的线程定时器
+    struct ThreadTimer
+    {
+        STimerWheel wheel;
+        UINT_PTR    uHostTimer;     //驱动时间轮的系统定时器
+        DWORD       dwHostDue;      //系统定时器下一次触发的时间
+
+        ThreadTimer():wheel(GetTickCount()),uHostTimer(0),dwHostDue(0){}
+    };
+
     BOOL _SetTimer(SWND swnd,UINT_PTR uTimerID,UINT nElapse);
 
     void _KillTimer(SWND swnd,UINT_PTR uTimerID);
 
     void _KillTimer(SWND swnd);
 
+    //当前线程的时间轮, bCreate为FALSE时可能返回NULL
+    ThreadTimer * _GetThreadTimer(BOOL bCreate);
+
+    //按时间轮中最早的到期时间设置系统定时器, bForce为FALSE时只会提前
+    BOOL _ArmHostTimer(ThreadTimer *pTimer,BOOL bForce);
+
+    //派发一个到期的定时器, 默认发送WM_TIMER2
+    virtual void _OnTimer(SWND swnd,UINT_PTR uTimerID);
+
     static VOID CALLBACK _TimerProc(HWND hwnd,
                                     UINT uMsg,
                                     UINT_PTR idEvent,
                                     DWORD dwTime
                                    );
+
+    SMap<DWORD,ThreadTimer*> m_mapThreads;  //线程ID到时间轮
+    SCriticalSection         m_cs;          //保护m_mapThreads, 时间轮只由所属线程访问
 };
 
-}//namespace SOUI
\ No newline at end of file
+}//namespace SOUI
@@ -0,0 +1,121 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       STimerWheel.h
+* @brief      分层时间轮
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    STimer2在每个UI线程中用一个时间轮管理该线程的所有定时器, 只使用一个系统定时器驱动.
+*             第0层256个槽, 第1到3层各64个槽, 插入和删除都是O(1), 到期时间按tick向上取整,
+*             同一个tick内到期的定时器在一次回调中处理
+*/
+
+#pragma once
+
+namespace SOUI
+{
+    typedef struct tagTIMERINFO
+    {
+        SWND Swnd;
+        UINT_PTR uTimerID;
+    } TIMERINFO;
+
+    const UINT KTimerTickMs = 10;   //默认tick, 与USER_TIMER_MINIMUM一致
+
+    struct TimerNode;
+
+    /**
+    * @class      STimerWheel
+    * @brief      分层时间轮
+    *
+    * Describe    不依赖系统时钟, 所有时间由调用者传入(GetTickCount的值, 可以回绕), 方便用虚拟时钟测试.
+    *             定时器是周期性的, 与SetTimer相同; 同一个窗口的定时器串在一起, 销毁窗口时只访问它自己的定时器
+    */
+    class SOUI_EXP STimerWheel
+    {
+    public:
+        STimerWheel(DWORD dwNow,UINT nTickMs = KTimerTickMs);
+        ~STimerWheel();
+
+        /**
+         * SetTimer
+         * @brief    设置定时器
+         * @param    SWND swnd --  所属窗口
+         * @param    UINT_PTR uTimerID --  定时器ID, 已经存在时重新计时
+         * @param    UINT nElapse --  周期(ms)
+         * @param    DWORD dwNow --  当前时间(ms)
+         * @return   void
+         */
+        void SetTimer(SWND swnd,UINT_PTR uTimerID,UINT nElapse,DWORD dwNow);
+
+        BOOL KillTimer(SWND swnd,UINT_PTR uTimerID);
+
+        //删除窗口的所有定时器, 返回删除的个数
+        int KillTimer(SWND swnd);
+
+        BOOL HasTimer(SWND swnd,UINT_PTR uTimerID) const;
+
+        int GetCount() const {return m_nCount;}
+
+        /**
+         * Advance
+         * @brief    推进到dwNow, 取出到期的定时器
+         * @param    DWORD dwNow --  当前时间(ms)
+         * @param    SArray<TIMERINFO> & lstFired --  追加到期的定时器, 按到期的tick排序
+         * @return   int -- 到期的个数
+         * Describe  到期的定时器已经按dwNow重新计时. 调用者派发时前面的回调可能删除后面的定时器,
+         *           派发前需要用HasTimer检查
+         */
+        int Advance(DWORD dwNow,SArray<TIMERINFO> & lstFired);
+
+        /**
+         * GetNextDelay
+         * @brief    到下一次需要调用Advance的时间
+         * @param    DWORD dwNow --  当前时间(ms)
+         * @return   DWORD -- 延时(ms), 没有定时器时返回INFINITE
+         * Describe  只有长周期定时器时返回下一次需要把高层槽下放的时间, 不会晚于真正的到期时间
+         */
+        DWORD GetNextDelay(DWORD dwNow);
+
+    protected:
+        enum
+        {
+            KLevel0Bits = 8,
+            KLevelNBits = 6,
+            KLevels     = 4,
+            KLevel0Size = 1<<KLevel0Bits,
+            KLevelNSize = 1<<KLevelNBits,
+        };
+
+        void _SyncClock(DWORD dwNow);
+        ULONGLONG _NowTick() const;
+
+        void _Schedule(TimerNode *pNode);
+        void _Unschedule(TimerNode *pNode);
+        void _Cascade(int iLevel,int iSlot);
+        void _FreeNode(TimerNode *pNode);
+
+        TimerNode * _FindNode(SWND swnd,UINT_PTR uTimerID) const;
+
+        TimerNode ** _GetSlot(int iLevel,int iSlot)
+        {
+            return iLevel==0?&m_level0[iSlot]:&m_levelN[iLevel-1][iSlot];
+        }
+
+        UINT        m_nTickMs;
+        DWORD       m_dwLastNow;
+        ULONGLONG   m_llNowMs;      //64位的当前时间, 不回绕
+        ULONGLONG   m_llCurTick;    //下一个要处理的tick
+        int         m_nCount;
+        int         m_nLevelCount[KLevels];
+
+        TimerNode * m_level0[KLevel0Size];
+        TimerNode * m_levelN[KLevels-1][KLevelNSize];
+
+        SMap<SWND,TimerNode*> m_mapOwners;   //窗口的第一个定时器
+    };
+
+}//namespace SOUI
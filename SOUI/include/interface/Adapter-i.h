@@ -99,6 +99,18 @@ namespace SOUI
 
         virtual SIZE getViewDesiredSize(int position,SWindow *pItem, LPCRECT prcContainer) PURE;
 
+        /**
+        * Measure the height of the specified item without creating a view. It is called from a
+        * worker thread by SListView to fill the item locator of variable-height lists in the
+        * background, so it must not touch any window and must only read thread-safe data.
+        * Text can be measured with {@link IRenderFactory#MeasureText}.
+        *
+        * @param position The position of the item within the adapter's data set.
+        * @param nWidth The width of the item.
+        * @return the height of the item, or -1 if background measurement is not supported.
+        */
+        virtual int measureItemHeight(int position,int nWidth) PURE;
+
         /**
         * @return true if this adapter doesn't contain any data.  This is used to determine
         * whether the empty view should be displayed.  A typical implementation will return
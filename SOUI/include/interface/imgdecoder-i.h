@@ -60,6 +60,13 @@ namespace SOUI
         virtual int GetDelay() = 0;
     };
 
+    /**
+    * total bytes of all decoded frames (32bpp) above which an animated image is
+    * decoded frame by frame on demand instead of all at once; consumers such as
+    * the APNG skin then keep only the most recently used frame bitmaps
+    */
+    const size_t KImgXStreamFrameBytes = 16*1024*1024;
+
     /**
     * @struct     IImgX
     * @brief      image data
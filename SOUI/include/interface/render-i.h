@@ -37,6 +37,20 @@ namespace SOUI
 		sweep		/*<扫描渐变*/
 	};
 
+    /**
+    * @struct     RTPOOLSTAT
+    * @brief      RenderTarget缓存池统计信息
+    * 
+    * Describe    nReused即缓存池避免的RenderTarget构造次数
+    */
+    struct RTPOOLSTAT
+    {
+        UINT nCreated;  //新构造的RenderTarget数量
+        UINT nReused;   //从缓存池中复用的次数
+        UINT nResized;  //复用时需要重新分配位图的次数
+        UINT nPooled;   //当前缓存池中的RenderTarget数量
+    };
+
     /**
     * @struct     IRenderFactory
     * @brief      RenderFactory对象
@@ -70,6 +84,30 @@ namespace SOUI
 		virtual BOOL CreatePathEffect(REFGUID guidEffect,IPathEffect ** ppPathEffect) = 0;
 
 		virtual BOOL CreatePathMeasure(IPathMeasure ** ppPathMeasure) = 0;
+
+        /**
+        * GetRenderTargetPoolStat
+        * @brief    获取RenderTarget缓存池的统计信息
+        * @param [out] RTPOOLSTAT * pStat -- 统计信息
+        * @return   BOOL -- FALSE:渲染引擎不支持RenderTarget缓存
+        *
+        * Describe  
+        */
+        virtual BOOL GetRenderTargetPoolStat(RTPOOLSTAT *pStat) = 0;
+
+        /**
+        * MeasureText
+        * @brief    不依赖RenderTarget计算文本占用的矩形
+        * @param [in] IFont * pFont -- 字体
+        * @param [in] LPCTSTR pszText -- 文本
+        * @param [in] int cchLen -- 文本长度，-1代表自动计算
+        * @param [in,out] LPRECT pRc -- 输入时限定宽度，输出文本占用的矩形
+        * @param [in] UINT uFormat -- 同DrawText的格式，总是按DT_CALCRECT处理
+        * @return   BOOL -- TRUE:SUCCEED, FASLE:FAILED 
+        *
+        * Describe  线程安全，可以在工作线程中调用，如为列表项预先计算高度
+        */
+        virtual BOOL MeasureText(IFont *pFont,LPCTSTR pszText,int cchLen,LPRECT pRc,UINT uFormat) = 0;
     };
 
     enum OBJTYPE
@@ -1124,6 +1162,25 @@ namespace SOUI
 		*/
 		virtual HRESULT DrawPath(const IPath * path,IPathEffect * pathEffect=NULL) = 0;
 
+        /**
+         * SetColorize
+         * @brief    设置绘制位图时使用的着色颜色
+         * @param    COLORREF cr -- 着色颜色, 0表示不着色
+         * @return   HRESULT -- 成功返回S_OK, 渲染引擎不支持绘制时着色返回E_NOTIMPL
+         *
+         * Describe  作用于DrawBitmap, DrawBitmapEx及DrawBitmap9Patch, 效果和SDIBHelper::Colorize一致,
+         *           不需要修改位图数据
+         */
+        virtual HRESULT SetColorize(COLORREF cr) = 0;
+
+        /**
+         * GetColorize
+         * @brief    获取当前的着色颜色
+         * @return   COLORREF -- 着色颜色, 0表示不着色
+         *
+         * Describe  
+         */
+        virtual COLORREF GetColorize() const = 0;
 	};
 
 
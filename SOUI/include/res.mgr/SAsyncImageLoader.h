@@ -0,0 +1,126 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       SAsyncImageLoader.h
+* @brief      后台图片解码
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    在工作线程中读取资源并使用IImgX解码, 解码完成后在UI线程中创建IBitmap并回调
+*/
+
+#pragma once
+#include "core/SSingleton.h"
+#include "helper/SCriticalSection.h"
+#include "interface/imgdecoder-i.h"
+
+namespace SOUI
+{
+    /**
+    * @struct     IAsyncImageCallback
+    * @brief      异步图片加载完成回调
+    *
+    * Describe    回调总是在UI线程中执行
+    */
+    struct IAsyncImageCallback
+    {
+        /**
+         * OnAsyncImageLoaded
+         * @brief    图片加载完成
+         * @param    DWORD dwReqID --  LoadImage返回的请求ID
+         * @param    const SStringW & strImgID --  type:name形式的图片ID
+         * @param    IBitmap * pImg --  加载的图片, 失败时为NULL
+         * @return   void
+         */
+        virtual void OnAsyncImageLoaded(DWORD dwReqID,const SStringW & strImgID,IBitmap * pImg) = 0;
+    };
+
+    struct AsyncImageReq
+    {
+        DWORD dwReqID;
+        IAsyncImageCallback * pCallback;
+    };
+
+    class SAsyncImageReceiver;
+    struct AsyncImageJob;
+
+    /**
+    * @class      SAsyncImageLoader
+    * @brief      后台图片解码队列
+    *
+    * Describe    同一个图片的多个请求只解码一次, 所有请求都取消后丢弃解码结果
+    */
+    class SOUI_EXP SAsyncImageLoader : public SSingleton<SAsyncImageLoader>
+    {
+        friend class SAsyncImageReceiver;
+    public:
+        SAsyncImageLoader(int nThreads = 2);
+        ~SAsyncImageLoader();
+
+        /**
+         * SetThreadCount
+         * @brief    设置解码线程数
+         * @param    int nThreads --  线程数[1-16]
+         * @return   int -- 生效的线程数
+         * Describe  线程在第一次请求时创建, 之后只能增加线程数
+         */
+        int SetThreadCount(int nThreads);
+
+        int GetThreadCount() const {return m_nThreads;}
+
+        /**
+         * LoadImage
+         * @brief    请求异步加载图片
+         * @param    const SStringW & strImgID --  type:name形式的图片ID, 同LoadImage2
+         * @param    IAsyncImageCallback * pCallback --  完成回调
+         * @return   DWORD -- 请求ID, 0表示失败
+         * Describe  只能在UI线程中调用
+         */
+        DWORD LoadImage(const SStringW & strImgID,IAsyncImageCallback * pCallback);
+
+        /**
+         * Cancel
+         * @brief    取消一个请求
+         * @param    DWORD dwReqID --  请求ID
+         * @return   BOOL -- 请求还没有完成时返回TRUE
+         * Describe  取消后不会再回调
+         */
+        BOOL Cancel(DWORD dwReqID);
+
+        /**
+         * CancelAll
+         * @brief    取消指定回调对象的所有请求
+         * @param    IAsyncImageCallback * pCallback --  回调对象
+         * @return   int -- 取消的请求数
+         * Describe  回调对象销毁前必须调用
+         */
+        int CancelAll(IAsyncImageCallback * pCallback);
+
+        //还没有完成的图片数量
+        int GetPendingCount();
+
+    protected:
+        void OnJobDone(AsyncImageJob *pJob);
+
+        void _StartThreads();
+        void _RemoveJob(AsyncImageJob *pJob);
+        void _DecodeJob(AsyncImageJob *pJob);
+
+        static unsigned int __stdcall WorkThread(void *pParam);
+
+        int                 m_nThreads;
+        SArray<HANDLE>      m_lstThreads;
+        HANDLE              m_hSemJob;      //等待解码的任务数
+        volatile LONG       m_bExit;
+        DWORD               m_dwNextReqID;
+
+        SCriticalSection    m_cs;
+        SMap<SStringW,AsyncImageJob*> m_mapJobs;  //所有未完成任务, 用于合并同一图片的请求
+        SList<AsyncImageJob*> m_lstQueue;         //等待解码的任务
+        SList<AsyncImageReq> m_lstDelivering;     //正在回调的请求
+
+        SAsyncImageReceiver * m_pReceiver;
+    };
+}
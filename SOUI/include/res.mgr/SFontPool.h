@@ -96,6 +96,74 @@ namespace SOUI
 
     typedef IFont * IFontPtr;
 
+    /**
+    * @class      FontDescKey
+    * @brief      字体描述字符串+缩放比例
+    * 
+    * Describe    用于缓存字体描述字符串的解析结果
+    */
+    struct FontDescKey
+    {
+        SStringW strDesc;
+        int      nScale;
+    };
+
+    template<>
+    class CElementTraits< FontDescKey > :
+        public CElementTraitsBase<FontDescKey >
+    {
+    public:
+        static ULONG Hash( INARGTYPE descKey )
+        {
+            ULONG uRet=SOUI::CElementTraits<SStringW>::Hash(descKey.strDesc);
+            uRet = (uRet<<5) + (UINT)descKey.nScale;
+            return uRet;
+        }
+
+        static bool CompareElements( INARGTYPE element1, INARGTYPE element2 )
+        {
+            return element1.nScale==element2.nScale
+                && element1.strDesc==element2.strDesc;
+        }
+
+        static int CompareElementsOrdered( INARGTYPE element1, INARGTYPE element2 )
+        {
+            int nRet= element1.strDesc.Compare(element2.strDesc);
+            if(nRet == 0)
+                nRet = element1.nScale-element2.nScale;
+            return nRet;
+        }
+    };
+
+    /**
+    * @struct     FontDescInfo
+    * @brief      字体描述字符串的解析结果
+    * 
+    * Describe    info为解析后的字体风格，pFont为对应的字体对象(由字体池持有)
+    */
+    struct FontDescInfo
+    {
+        FontInfo info;
+        IFontPtr pFont;
+    };
+
+    /**
+    * @struct     FONTPOOLSTAT
+    * @brief      字体池统计信息
+    * 
+    * Describe    命中率 = nHit/(nHit+nMiss)
+    *             nBytes按每个字体的实际key字符串长度统计字体池的表项和字体对象的LOGFONT,
+    *             不包括渲染引擎内部的HFONT及共享的typeface
+    */
+    struct FONTPOOLSTAT
+    {
+        UINT nFonts;    //当前字体数量
+        UINT nBytes;    //字体池持有的字节数
+        UINT nHit;      //从池中命中的次数
+        UINT nMiss;     //新建字体的次数
+        UINT nEvicted;  //被淘汰的字体数量
+    };
+
     /**
     * @class      SFontPool
     * @brief      font pool
@@ -107,6 +175,8 @@ namespace SOUI
     public:
         SFontPool(IRenderFactory *pRendFactory);
 
+        ~SFontPool();
+
         
         /**
          * GetFont
@@ -115,6 +185,7 @@ namespace SOUI
          * @return   IFontPtr -- font对象
          *
          * Describe  描述字符串格式如：face:宋体,bold:0,italic:1,underline:1,strike:1,adding:10
+         *           同一描述字符串及缩放比例的解析结果会被缓存，再次获取只需要一次查表
          */
         IFontPtr GetFont(const SStringW & strFont,int scale);
 
@@ -128,6 +199,36 @@ namespace SOUI
          */    
 		IFontPtr GetFont(FONTSTYLE style,const SStringW& strFaceName = SStringW(),pugi::xml_node xmlExProp = pugi::xml_node());
 
+        /**
+         * SetMaxFonts
+         * @brief    设置字体池容量
+         * @param    UINT nMaxFonts --  最大字体数量，0表示不限制
+         * @return   void
+         * Describe  新建字体时如果超出容量，按LRU淘汰引用计数为1(只被字体池持有)的字体。
+         *           设置了容量后，GetFont返回的指针只保证在下一次GetFont之前有效，
+         *           需要持有更久的字体必须AddRef，例如使用CAutoRefPtr保存
+         */
+        void SetMaxFonts(UINT nMaxFonts);
+
+        UINT GetMaxFonts() const {return m_nMaxFonts;}
+
+        /**
+         * Trim
+         * @brief    按LRU释放没有被外部引用的字体
+         * @param    UINT nMaxFonts --  字体数量上限
+         * @return   UINT -- 释放的字体数量
+         * Describe  被外部引用的字体不会释放，因此结果可能仍然超出上限
+         */
+        UINT Trim(UINT nMaxFonts);
+
+        /**
+         * GetStat
+         * @brief    获取字体池统计信息
+         * @param    FONTPOOLSTAT * pStat --  统计信息
+         * @return   void
+         */
+        void GetStat(FONTPOOLSTAT *pStat) const;
+
 
     protected:
 
@@ -135,14 +236,48 @@ namespace SOUI
 
         static void OnKeyRemoved(const IFontPtr & obj)
         {
+            if(ms_Singleton) ms_Singleton->_OnFontRemoved(obj);
             obj->Release();
         }
 
+        void _OnFontRemoved(IFontPtr pFont);
+
+        void _TouchFont(IFontPtr pFont);
+
+        static bool _IsFontIdle(IFontPtr pFont);
+
+        static UINT _MeasureFont(const FontInfo & info);
+
+        UINT _Trim(UINT nMaxFonts,IFontPtr pKeep);
+
+        IFontPtr _GetFont(const FontInfo & info,pugi::xml_node xmlExProp);
+
+        void _ParseFontDesc(const SStringW & strFont,int scale,FontInfo & info,pugi::xml_node nodePropEx) const;
+
+        void _ValidateDescCache();
+
 		IFontPtr _CreateFont(const LOGFONT &lf);
         
         IFontPtr _CreateFont(FONTSTYLE style,const SStringT & strFaceName,pugi::xml_node xmlExProp);
 
         CAutoRefPtr<IRenderFactory> m_RenderFactory;
+
+        SMap<FontDescKey,FontDescInfo> m_mapDescCache; //字体描述字符串解析结果缓存
+        FontInfo                       m_descCacheDefFont; //解析缓存所依赖的默认字体
+
+        struct FontUsage
+        {
+            FontInfo  key;      //字体池中的key
+            ULONGLONG uLastUse; //最后一次使用的序号
+            UINT      cbSize;   //表项和字体对象LOGFONT的字节数
+        };
+        SMap<IFontPtr,FontUsage> m_mapUsage;  //字体使用记录，用于LRU淘汰
+        ULONGLONG   m_uUseSeq;
+        UINT        m_nMaxFonts;
+        UINT        m_nBytes;
+        UINT        m_nHit;
+        UINT        m_nMiss;
+        UINT        m_nEvicted;
     };
 
 }//namespace SOUI
@@ -7,6 +7,18 @@
 
 namespace SOUI
 {
+    //图片缓存统计
+    struct IMAGECACHESTATS
+    {
+        DWORD  dwHits;      //命中次数
+        DWORD  dwMisses;    //未命中次数
+        DWORD  dwEvicts;    //因为超出预算被淘汰的图片数
+        int    nCount;      //当前缓存的图片数
+        size_t szBytes;     //当前缓存的图片字节数
+        size_t szBudget;    //缓存预算
+    };
+
+    class SResWarmup;
 
     class SOUI_EXP SResProviderMgr
     {
@@ -39,6 +51,27 @@ namespace SOUI
         size_t GetRawBufferSize(LPCTSTR pszType,LPCTSTR pszResName);
 
         BOOL GetRawBuffer(LPCTSTR pszType,LPCTSTR pszResName,LPVOID pBuf,size_t size);
+
+    public://图片缓存
+        //LoadImage加载的图片按(type,name,scale)缓存, 返回的图片是共享的, 需要修改像素时先Clone. 整数ID的图片不缓存
+        
+        //设置缓存预算(字节), 超出时淘汰最久没有使用的图片, 0表示不缓存
+        void SetImageCacheBudget(size_t szBudget);
+
+        size_t GetImageCacheBudget() const {return m_szImgCacheBudget;}
+
+        void GetImageCacheStats(IMAGECACHESTATS *pStats);
+
+        void ClearImageCache();
+
+        //查找缓存的图片, 找到后增加引用计数
+        IBitmap * FindCachedImage(LPCTSTR pszType,LPCTSTR pszResName,int nScale);
+
+        //把按nScale缩放后的图片加入缓存
+        void AddCachedImage(LPCTSTR pszType,LPCTSTR pszResName,int nScale,IBitmap *pImg);
+
+        //从缓存中删除引用pImg的所有项, 返回删除的项数
+        int RemoveCachedImage(IBitmap *pImg);
         
     public:
         //从字符串返回颜色值，字符串可以是：@color/red (red是在资源包中的颜色表定义的颜色名)，也可以是rgba(r,g,b,a)，也可以是rgb(r,g,b)，还可以是#ff0000(ff)这样的格式
@@ -51,8 +84,15 @@ namespace SOUI
         //获取资源包中的字符串表中固定索引号的字符串，只支持从第一个资源包中查询
         SStringW GetString(int idx);
         
+    public://预加载
+        //由SResWarmup在构造和析构时设置, 设置后GetRawBuffer和LoadImage优先使用预加载的结果
+        void SetResWarmup(SResWarmup *pWarmup);
+
+        SResWarmup * GetResWarmup() const {return m_pWarmup;}
+
     public://helper
         //find the match resprovider from tail to head, which contains the specified resource type and name
+        //查找结果按(type,name)索引, 命中索引时不加锁; 整数ID不进索引
         IResProvider * GetMatchResProvider(LPCTSTR pszType,LPCTSTR pszResName);
 
         //使用type:name形式的字符串加载图片
@@ -73,10 +113,58 @@ namespace SOUI
         typedef SMap<SStringT,HCURSOR> CURSORMAP;
         CURSORMAP  m_mapCachedCursor;
 
+        //保护资源包列表, 索引更新, 图片和光标缓存. 加载资源时不加锁, 资源包需要线程安全,
+        //增删资源包不能与加载资源同时进行
         SCriticalSection    m_cs;
+
+        struct CachedImage
+        {
+            SStringT strKey;
+            CAutoRefPtr<IBitmap> pImg;
+            size_t szBytes;
+        };
+        SStringT _ImageCacheKey(LPCTSTR pszType,LPCTSTR pszResName,int nScale);
+        IBitmap * _FindCachedImage(const SStringT & strKey);
+        void _AddCachedImage(const SStringT & strKey,IBitmap *pImg);
+        void _TrimImageCache(size_t szBudget);
+
+        SList<CachedImage*>  m_lruImgCache;    //头部为最近使用的图片
+        SMap<SStringT,SPOSITION> m_mapImgCache;
+        size_t              m_szImgCacheBudget;
+        IMAGECACHESTATS     m_imgCacheStats;
+
+        SResWarmup *        m_pWarmup;
         
+        //资源查找索引: (type,name)到资源包的映射, 第一次查找时建立
+        //读取不加锁; 插入, 扩容及增删资源包时在m_cs保护下更新, 表项只在RemoveAll时释放
+        struct ResIndexEntry
+        {
+            ULONG    uHash;
+            SStringT strType;       //小写
+            SStringT strName;       //小写
+            IResProvider * volatile pResProvider;  //NULL表示所有资源包都没有该资源
+        };
+        struct ResIndexTable
+        {
+            UINT nMask;     //槽位数-1, 槽位数为2的幂
+            UINT nCount;    //已使用的槽位数
+            ResIndexEntry * volatile * pSlots;
+        };
+        static ULONG _HashResKey(LPCTSTR pszType,LPCTSTR pszResName);
+        static ResIndexTable * _NewResIndexTable(UINT nSlots);
+        static ResIndexEntry * _LookupResIndex(const ResIndexTable *pTable,ULONG uHash,LPCTSTR pszType,LPCTSTR pszResName);
+        static void _PutResIndexSlot(ResIndexTable *pTable,ResIndexEntry *pEntry);
+        IResProvider * _FindResProvider(LPCTSTR pszType,LPCTSTR pszResName);
+        IResProvider * _UpdateResIndex(LPCTSTR pszType,LPCTSTR pszResName,ULONG uHash);
+        void _ClearResIndex();
+
+        ResIndexTable * volatile m_pResIndex;
+        SList<ResIndexTable*>    m_lstRetiredIndex;    //扩容后替换下来的表, 可能还有线程在读
+        UINT                     m_nResIndexMisses;    //索引中找不到的资源数
+
         #ifdef _DEBUG
         //资源使用计数
+        void _CountResUsage(LPCTSTR pszType,LPCTSTR pszResName);
         SMap<SStringT,int> m_mapResUsageCount;
         #endif
     };
@@ -0,0 +1,141 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       SResWarmup.h
+* @brief      按清单预加载资源
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    录制上一次启动到第一帧完成时请求的资源, 下一次启动时在创建窗口前由工作线程并行读取和解码,
+*             UI线程请求这些资源时直接取走结果
+*/
+
+#pragma once
+#include "helper/SCriticalSection.h"
+#include "interface/render-i.h"
+
+namespace SOUI
+{
+    class SResProviderMgr;
+
+    enum WARMUPKIND
+    {
+        WARMUP_RAW = 0,     //GetRawBuffer读取的数据, 如xml
+        WARMUP_IMAGE,       //LoadImage加载的图片
+    };
+
+    struct WARMUPSTATS
+    {
+        int nEntries;       //回放清单中的资源数
+        int nReady;         //已经预加载完成的资源数
+        int nHits;          //从预加载结果中取走的次数
+        int nMisses;        //请求时预加载还没有完成的次数
+        int nRecorded;      //已经录制的资源数
+    };
+
+    struct WarmupJob;
+
+    /**
+    * @class      SResWarmup
+    * @brief      资源预加载
+    *
+    * Describe    构造时挂接到SResProviderMgr, 析构时解除. 录制和回放可以同时进行.
+    *             工作线程直接调用资源包的GetRawBuffer, 资源包需要支持多线程读取
+    */
+    class SOUI_EXP SResWarmup
+    {
+    public:
+        SResWarmup(SResProviderMgr *pResMgr);
+        ~SResWarmup();
+
+        /**
+         * StartRecord
+         * @brief    开始录制
+         * @param    LPCTSTR pszManifest --  清单文件
+         * @return   BOOL
+         * Describe  第一个SHostWnd完成第一帧后自动停止并保存
+         */
+        BOOL StartRecord(LPCTSTR pszManifest);
+
+        /**
+         * StopRecord
+         * @brief    停止录制并保存清单
+         * @return   BOOL -- 保存成功返回TRUE
+         */
+        BOOL StopRecord();
+
+        BOOL IsRecording() const {return m_bRecording;}
+
+        /**
+         * Replay
+         * @brief    按清单启动预加载
+         * @param    LPCTSTR pszManifest --  清单文件
+         * @param    IRenderFactory * pRenderFactory --  用于解码图片, NULL时只预读数据
+         * @param    int nThreads --  工作线程数, 0表示CPU核数
+         * @return   int -- 预加载的资源数
+         * Describe  立即返回, 线程完成所有资源后退出
+         */
+        int Replay(LPCTSTR pszManifest,IRenderFactory *pRenderFactory,int nThreads = 0);
+
+        /**
+         * Wait
+         * @brief    等待预加载完成
+         * @param    DWORD dwTimeout --  超时(ms)
+         * @return   BOOL -- 全部完成返回TRUE
+         */
+        BOOL Wait(DWORD dwTimeout = INFINITE);
+
+        //停止预加载, 丢弃还没有取走的结果
+        void Stop();
+
+        void GetStats(WARMUPSTATS *pStats);
+
+    public://由SResProviderMgr调用, 可以在任意线程中调用
+        void OnResRequest(WARMUPKIND kind,LPCTSTR pszType,LPCTSTR pszResName);
+
+        //预加载的数据大小, 没有完成时返回0
+        size_t GetRawBufferSize(LPCTSTR pszType,LPCTSTR pszResName);
+
+        //取走预加载的数据, 成功后该资源不再保留
+        BOOL TakeRawBuffer(LPCTSTR pszType,LPCTSTR pszResName,LPVOID pBuf,size_t size);
+
+        //取走预解码的图片, 在调用线程中创建IBitmap
+        IBitmap * TakeImage(LPCTSTR pszType,LPCTSTR pszResName);
+
+    protected:
+        struct RecordItem
+        {
+            WARMUPKIND kind;
+            SStringT   strType;
+            SStringT   strName;
+        };
+
+        static SStringT _MakeKey(WARMUPKIND kind,LPCTSTR pszType,LPCTSTR pszResName);
+        WarmupJob * _FindJob(WARMUPKIND kind,LPCTSTR pszType,LPCTSTR pszResName);
+        BOOL _TakeJob(WarmupJob *pJob);
+        BOOL _RunJob(WarmupJob *pJob);
+
+        static unsigned int __stdcall WorkThread(void *pParam);
+
+        SResProviderMgr *   m_pResMgr;
+        CAutoRefPtr<IRenderFactory> m_pRenderFactory;
+
+        //回放, 任务表在线程启动前建好, 之后只读
+        SArray<WarmupJob*>  m_lstJobs;
+        SMap<SStringT,WarmupJob*> m_mapJobs;
+        volatile LONG       m_iNextJob;
+        SArray<HANDLE>      m_lstThreads;
+        volatile LONG       m_nReady;
+        volatile LONG       m_nHits;
+        volatile LONG       m_nMisses;
+
+        //录制
+        SCriticalSection    m_csRecord;
+        BOOL                m_bRecording;
+        SStringT            m_strManifest;
+        SArray<RecordItem>  m_lstRecord;    //按请求顺序保存
+        SMap<SStringT,BOOL> m_mapRecord;
+    };
+}
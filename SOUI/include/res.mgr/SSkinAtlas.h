@@ -0,0 +1,98 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       SSkinAtlas.h
+* @brief      小图片合并
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    把小的skin图片合并到共享的大图中, skin只保存大图中的子区域
+*/
+
+#pragma once
+
+namespace SOUI
+{
+    class SResProviderMgr;
+
+    //合并统计
+    struct SKINATLASSTATS
+    {
+        int     nPages;         //大图数量
+        int     nImages;        //合并的图片数量
+        float   fFillRatio;     //大图中被图片(含边框)占用的比例
+        size_t  szPageBytes;    //大图像素字节数
+        size_t  szImageBytes;   //合并前的图片像素字节数
+        size_t  szReleasedBytes;//合并后实际释放的源图片像素字节数, 源图片还有其它引用时不计入
+        int     nBitmapsSaved;  //减少的位图对象数量
+        INT64   nBytesSaved;    //szReleasedBytes-szPageBytes, 大图没有填满或源图片没有释放时为负
+    };
+
+    /**
+    * @class      SSkinAtlas
+    * @brief      小图片合并器
+    *
+    * Describe    使用按行(shelf)分配的方式把图片放入固定大小的大图, 每张图片四周复制1像素的边缘,
+    *             防止拉伸时采样到相邻的图片
+    */
+    class SOUI_EXP SSkinAtlas
+    {
+    public:
+        /**
+         * SSkinAtlas
+         * @param    int nPageSize --  大图边长
+         * @param    int nMaxImageSize --  可以合并的图片的最大边长
+         */
+        SSkinAtlas(int nPageSize = 512,int nMaxImageSize = 128);
+        ~SSkinAtlas();
+
+        /**
+         * Add
+         * @brief    把图片合并到大图中
+         * @param    IBitmap * pImg --  源图片
+         * @param    IBitmap * * ppPage --  输出图片所在的大图, 增加引用计数
+         * @param    RECT * prcImg --  输出图片在大图中的位置
+         * @return   BOOL -- 图片太大或者分配失败时返回FALSE
+         */
+        BOOL Add(IBitmap *pImg,IBitmap **ppPage,RECT *prcImg);
+
+        /**
+         * ReleaseSource
+         * @brief    释放已经合并的源图片
+         * @param    IBitmap * pImg --  Add成功的源图片, 释放调用者持有的一个引用
+         * @param    SResProviderMgr * pImgCache --  加载源图片的资源管理器, 先从它的图片缓存中删除, 可以为NULL
+         * Describe  源图片没有其它引用时计入szReleasedBytes
+         */
+        void ReleaseSource(IBitmap *pImg,SResProviderMgr *pImgCache);
+
+        void GetStats(SKINATLASSTATS *pStats) const;
+
+    protected:
+        struct SHELF
+        {
+            int y;      //行的顶部
+            int nHei;   //行高
+            int x;      //已经使用的宽度
+        };
+
+        struct ATLASPAGE
+        {
+            CAutoRefPtr<IBitmap> pImg;
+            SArray<SHELF> lstShelf;
+            int     nBottom;    //最后一行的底部
+            size_t  szUsed;     //已经占用的像素数
+        };
+
+        BOOL _Alloc(ATLASPAGE *pPage,int nWid,int nHei,POINT *pt);
+        void _CopyImage(ATLASPAGE *pPage,POINT pt,IBitmap *pImg);
+
+        int     m_nPageSize;
+        int     m_nMaxImageSize;
+        SArray<ATLASPAGE*> m_lstPages;
+        int     m_nImages;
+        size_t  m_szImageBytes;
+        size_t  m_szReleasedBytes;
+    };
+}
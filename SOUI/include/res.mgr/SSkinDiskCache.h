@@ -0,0 +1,78 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       SSkinDiskCache.h
+* @brief      缩放后的skin图片的磁盘缓存
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    高DPI下skin第一次使用时需要对图片重采样, 缓存重采样结果, 下次启动时直接映射文件加载
+*/
+
+#pragma once
+#include "core/SSingleton.h"
+#include "helper/SCriticalSection.h"
+
+namespace SOUI
+{
+    /**
+    * @class      SSkinDiskCache
+    * @brief      缩放后的skin图片的磁盘缓存
+    *
+    * Describe    缓存文件由源图片像素的hash, 目标大小及过滤等级确定, 加载时校验源图片.
+    *             默认不启用, 调用SetCacheDir后生效
+    */
+    class SOUI_EXP SSkinDiskCache : public SSingleton<SSkinDiskCache>
+    {
+    public:
+        SSkinDiskCache();
+        ~SSkinDiskCache();
+
+        /**
+         * SetCacheDir
+         * @brief    设置缓存目录
+         * @param    LPCTSTR pszDir --  缓存目录, 为NULL或者空时禁用缓存
+         * @return   BOOL -- 目录可用时返回TRUE
+         * Describe  目录不存在时自动创建
+         */
+        BOOL SetCacheDir(LPCTSTR pszDir);
+
+        SStringT GetCacheDir() const {return m_strDir;}
+
+        BOOL IsEnabled() const {return !m_strDir.IsEmpty();}
+
+        /**
+         * LoadScaledImage
+         * @brief    从缓存中加载pSrc缩放到szDest的图片
+         * @param    IBitmap * pSrc --  源图片
+         * @param    SIZE szDest --  目标大小
+         * @param    FilterLevel fl --  缩放使用的过滤等级
+         * @param    IBitmap * * ppDest --  输出图片
+         * @return   BOOL -- 缓存命中时返回TRUE
+         */
+        BOOL LoadScaledImage(IBitmap *pSrc,SIZE szDest,FilterLevel fl,IBitmap **ppDest);
+
+        /**
+         * SaveScaledImage
+         * @brief    保存pSrc缩放后的图片
+         * @param    IBitmap * pSrc --  源图片
+         * @param    FilterLevel fl --  缩放使用的过滤等级
+         * @param    IBitmap * pDest --  缩放后的图片
+         * @return   BOOL
+         */
+        BOOL SaveScaledImage(IBitmap *pSrc,FilterLevel fl,IBitmap *pDest);
+
+        //删除缓存目录中的所有缓存文件
+        void Clear();
+
+    protected:
+        SStringT _GetCacheFile(ULONGLONG ullSrcHash,SIZE szDest,FilterLevel fl) const;
+
+        static ULONGLONG HashPixels(IBitmap *pImg);
+
+        SStringT            m_strDir;
+        SCriticalSection    m_cs;
+    };
+}
@@ -15,6 +15,7 @@
 #include "core/SSingletonMap.h"
 #include "interface/Sskinobj-i.h"
 #include <unknown/obj-ref-impl.hpp>
+#include "res.mgr/SSkinAtlas.h"
 
 #define GETSKIN(p1,scale) SSkinPoolMgr::getSingleton().GetSkin(p1,scale)
 #define GETBUILTINSKIN(p1) SSkinPoolMgr::getSingleton().GetBuiltinSkin(p1,100)
@@ -103,7 +104,8 @@ public:
 * @class      SSkinPool
 * @brief      name和ISkinObj的映射表
 * 
-* Describe    
+* Describe    LoadSkins只保存skin的XML描述, 在第一次GetSkin时才创建SkinObj并解码图片,
+*             需要在首次绘制前就绪的skin可以在XML中指定preload="1"或者调用WarmUp
 */
 class SOUI_EXP SSkinPool :public SCmnMap<SSkinPtr,SkinKey>, public TObjRefImpl2<IObjRef,SSkinPool>
 {
@@ -129,12 +131,69 @@ public:
      * Describe  
      */    
     int LoadSkins(pugi::xml_node xmlNode);
+
+    /**
+     * WarmUp
+     * @brief    立即创建指定的延迟加载Skin
+     * @param    const SStringW & strSkinNames --  以","分隔的Skin名称列表
+     * @param    int nScale --  缩放比例
+     * @return   int -- 本次新创建的SkinObj数量
+     * Describe  用于在首次绘制前准备好启动界面需要的Skin
+     */    
+    int WarmUp(const SStringW & strSkinNames,int nScale=100);
+
+    /**
+     * GetUnusedSkins
+     * @brief    获得从来没有被GetSkin使用过的Skin
+     * @param    SArray<SkinKey> & lstSkins --  输出Skin列表
+     * @return   size_t -- 列表中的Skin数量
+     * Describe  包含还没有创建的Skin及创建后没有通过GetSkin获取过的Skin
+     */    
+    size_t GetUnusedSkins(SArray<SkinKey> & lstSkins) const;
+
+    /**
+     * GetPendingCount
+     * @brief    获得还没有创建的Skin数量
+     * @return   size_t
+     */    
+    size_t GetPendingCount() const {return m_mapPending.GetCount();}
+
+    /**
+     * EnableAtlas
+     * @brief    创建skin时把小图片合并到共享的大图中
+     * @param    BOOL bEnable --  是否合并
+     * @return   void
+     * Describe  只影响之后创建的skin, XML中的skin根节点也可以指定atlas="1"
+     */    
+    void EnableAtlas(BOOL bEnable);
+
+    /**
+     * GetAtlasStats
+     * @brief    获得合并统计
+     * @param    SKINATLASSTATS * pStats --  输出统计
+     * @return   BOOL -- 没有启用合并时返回FALSE
+     */    
+    BOOL GetAtlasStats(SKINATLASSTATS *pStats) const;
+
+    //包含还没有创建的Skin
+    virtual size_t GetCount();
+
+    virtual void RemoveAll();
 protected:
     static void OnKeyRemoved(const SSkinPtr & obj);
-    
-#ifdef _DEBUG
-    SMap<SkinKey,int> m_mapSkinUseCount;   //皮肤使用计数
-#endif
+
+    //已经创建或者等待创建
+    bool _HasSkin(const SkinKey & key) const;
+
+    //获得SkinObj, 等待创建的Skin在这里创建
+    ISkinObj * _GetSkin(const SkinKey & key);
+
+    ISkinObj * _CreatePendingSkin(const SkinKey & key);
+
+    pugi::xml_document          m_xmlPending;   //保存等待创建的skin描述
+    SMap<SkinKey,pugi::xml_node> m_mapPending;  //等待创建的skin
+    SMap<SkinKey,int> m_mapSkinUseCount;        //皮肤使用计数
+    SSkinAtlas *                m_pAtlas;       //小图片合并器, 为NULL时不合并
 };
 
 /**
@@ -48,6 +48,7 @@
 
 #include <trace.h>
 #include <utilities.h>
+#include <sprofiler.h>
 
 #include <core/SDefine.h>
 
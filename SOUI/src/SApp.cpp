@@ -17,6 +17,8 @@
 #include "updatelayeredwindow/SUpdateLayeredWindow.h"
 #include "helper/splitstring.h"
 #include "res.mgr/SObjDefAttr.h"
+#include "res.mgr/SAsyncImageLoader.h"
+#include "res.mgr/SSkinDiskCache.h"
 
 #include "core/SSkin.h"
 #include "control/souictrls.h"
@@ -100,6 +102,7 @@ SApplication::SApplication(IRenderFactory *pRendFactory,HINSTANCE hInst,LPCTSTR
     ,m_RenderFactory(pRendFactory)
     ,m_hMainWnd(NULL)
 {
+    SPROFILE_SCOPE("SApplication::SApplication");
     SWndSurface::Init();
     _CreateSingletons();
 
@@ -143,11 +146,16 @@ void SApplication::_CreateSingletons()
     new SSkinPoolMgr();
     new SStylePoolMgr();
     new SWindowFinder();
+    new SAsyncImageLoader();
+    new SSkinDiskCache();
 }
 
 void SApplication::_DestroySingletons()
 {
+    //先停止解码线程, 解码线程需要访问资源包
+    delete SAsyncImageLoader::getSingletonPtr();
     SResProviderMgr::RemoveAll();
+    delete SSkinDiskCache::getSingletonPtr();
     delete SWindowFinder::getSingletonPtr();
     delete SStylePoolMgr::getSingletonPtr();
     delete SSkinPoolMgr::getSingletonPtr();
@@ -160,6 +168,8 @@ void SApplication::_DestroySingletons()
 
 BOOL SApplication::_LoadXmlDocment( LPCTSTR pszXmlName ,LPCTSTR pszType ,pugi::xml_document & xmlDoc,IResProvider *pResProvider/* = NULL*/)
 {
+    SPROFILE_SCOPE_DETAIL("SApplication::LoadXml",S_CT2W(pszXmlName));
+    CMyBuffer<char> strXml;
     if(!pResProvider) 
     {
         if(IsFileType(pszType))
@@ -168,19 +178,21 @@ BOOL SApplication::_LoadXmlDocment( LPCTSTR pszXmlName ,LPCTSTR pszType ,pugi::x
             SASSERT_FMTW(result,L"parse xml error! xmlName=%s,desc=%s,offset=%d",pszXmlName,result.description(),result.offset);
             return result;
         }else
-        {
-            pResProvider = GetMatchResProvider(pszType,pszXmlName);
+        {//通过SResProviderMgr读取, 可以使用预加载的数据
+            size_t dwSize=GetRawBufferSize(pszType,pszXmlName);
+            if(dwSize==0) return FALSE;
+            strXml.Allocate(dwSize);
+            if(!GetRawBuffer(pszType,pszXmlName,strXml,dwSize)) return FALSE;
         }
+    }else
+    {
+        size_t dwSize=pResProvider->GetRawBufferSize(pszType,pszXmlName);
+        if(dwSize==0) return FALSE;
+        strXml.Allocate(dwSize);
+        pResProvider->GetRawBuffer(pszType,pszXmlName,strXml,dwSize);
     }
-    if(!pResProvider) return FALSE;
-    
-    size_t dwSize=pResProvider->GetRawBufferSize(pszType,pszXmlName);
-    if(dwSize==0) return FALSE;
-
-    CMyBuffer<char> strXml;
-    strXml.Allocate(dwSize);
-    pResProvider->GetRawBuffer(pszType,pszXmlName,strXml,dwSize);
 
+    SPROFILE_COUNT(0,strXml.size());
     pugi::xml_parse_result result= xmlDoc.load_buffer(strXml,strXml.size(),pugi::parse_default,pugi::encoding_utf8);
     SASSERT_FMTW(result,L"parse xml error! xmlName=%s,desc=%s,offset=%d",pszXmlName,result.description(),result.offset);
     return result;
@@ -200,6 +212,7 @@ BOOL SApplication::LoadXmlDocment(pugi::xml_document & xmlDoc, const SStringT &
 
 UINT SApplication::LoadSystemNamedResource( IResProvider *pResProvider )
 {
+    SPROFILE_SCOPE("SApplication::LoadSystemNamedResource");
     UINT uRet=0;
     AddResProvider(pResProvider,NULL);
     //load system skins
@@ -208,6 +221,7 @@ UINT SApplication::LoadSystemNamedResource( IResProvider *pResProvider )
         if(_LoadXmlDocment(_T("SYS_XML_SKIN"),_T("XML"),xmlDoc,pResProvider))
         {
             SSkinPool * p= SSkinPoolMgr::getSingletonPtr()->GetBuiltinSkinPool();
+            p->EnableAtlas(TRUE);//系统skin都是小图片
             p->LoadSkins(xmlDoc.child(L"skin"));
         }else
         {
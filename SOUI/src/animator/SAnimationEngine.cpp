@@ -0,0 +1,435 @@
+﻿#include "souistd.h"
+#include "animator/SAnimationEngine.h"
+#include "core/SWnd.h"
+#include "core/SWindowMgr.h"
+#include <math.h>
+
+namespace SOUI
+{
+    struct AnimationTargetNode
+    {
+        IAnimationTarget *          pTarget;
+        SWND                        swnd;       //引擎创建的窗口目标, 删除时一起释放
+        UINT                        uFrame;     //最后一次更新的帧
+        BOOL                        bValid;     //失效或者被取消后本帧不再刷新
+        SArray<AnimationNode*>      arrNodes;   //进行中的动画, 一般只有几个
+    };
+
+    struct AnimationNode
+    {
+        UINT                        uID;
+        AnimationTargetNode *       pTarget;
+        int                         nProp;
+        float                       fFrom;
+        float                       fTo;
+        DWORD                       dwDuration;
+        DWORD                       dwDelay;
+        DWORD                       dwStart;
+        BOOL                        bStarted;   //第一次Tick时确定开始时间
+        BOOL                        bEnded;
+        CAutoRefPtr<IInterpolator>  pInterpolator;
+        FunAnimationEnd             funEnd;
+        LPARAM                      lParam;
+    };
+
+    //窗口属性. 一帧内的位置和大小合并为一次Move, Move刷新新旧两个区域
+    class SWindowAnimationTarget : public IAnimationTarget
+    {
+    public:
+        SWindowAnimationTarget(SWND swnd):m_swnd(swnd),m_dwChanged(0)
+        {
+            memset(m_nValues,0,sizeof(m_nValues));
+        }
+
+        virtual BOOL GetAnimatedValue(int nProp,float & fValue)
+        {
+            SWindow *pWnd = SWindowMgr::GetWindow(m_swnd);
+            if(!pWnd) return FALSE;
+            CRect rcWnd = pWnd->GetWindowRect();
+            switch(nProp)
+            {
+            case ANIPROP_LEFT: fValue = (float)rcWnd.left; break;
+            case ANIPROP_TOP: fValue = (float)rcWnd.top; break;
+            case ANIPROP_WIDTH: fValue = (float)rcWnd.Width(); break;
+            case ANIPROP_HEIGHT: fValue = (float)rcWnd.Height(); break;
+            case ANIPROP_ALPHA: fValue = (float)pWnd->GetStyle().m_byAlpha; break;
+            default: return FALSE;
+            }
+            return TRUE;
+        }
+
+        virtual BOOL SetAnimatedValue(int nProp,float fValue)
+        {
+            if(!SWindowMgr::GetWindow(m_swnd)) return FALSE;
+            if(nProp < ANIPROP_LEFT || nProp > ANIPROP_ALPHA) return TRUE;
+            m_nValues[nProp] = (int)floor(fValue + 0.5f);
+            m_dwChanged |= 1<<nProp;
+            return TRUE;
+        }
+
+        virtual void OnAnimationFrame()
+        {
+            DWORD dwChanged = m_dwChanged;
+            m_dwChanged = 0;
+            SWindow *pWnd = SWindowMgr::GetWindow(m_swnd);
+            if(!pWnd) return;
+
+            CRect rcWnd = pWnd->GetWindowRect();
+            CRect rcNew = rcWnd;
+            if(dwChanged & (1<<ANIPROP_LEFT)) rcNew.OffsetRect(m_nValues[ANIPROP_LEFT] - rcNew.left,0);
+            if(dwChanged & (1<<ANIPROP_TOP)) rcNew.OffsetRect(0,m_nValues[ANIPROP_TOP] - rcNew.top);
+            if(dwChanged & (1<<ANIPROP_WIDTH)) rcNew.right = rcNew.left + smax(m_nValues[ANIPROP_WIDTH],0);
+            if(dwChanged & (1<<ANIPROP_HEIGHT)) rcNew.bottom = rcNew.top + smax(m_nValues[ANIPROP_HEIGHT],0);
+            if(rcNew != rcWnd) pWnd->Move(rcNew);
+
+            if(dwChanged & (1<<ANIPROP_ALPHA))
+            {
+                //回弹类插值器会超出范围
+                int nAlpha = smin(smax(m_nValues[ANIPROP_ALPHA],0),255);
+                if(nAlpha != pWnd->GetStyle().m_byAlpha)
+                {
+                    SStringW strAlpha;
+                    strAlpha.Format(L"%d",nAlpha);
+                    pWnd->SetAttribute(L"alpha",strAlpha,FALSE);
+                }
+            }
+        }
+
+    protected:
+        SWND    m_swnd;
+        DWORD   m_dwChanged;
+        int     m_nValues[ANIPROP_ALPHA+1];
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    SAnimationEngine::SAnimationEngine(ISwndContainer *pContainer)
+        :m_pContainer(pContainer)
+        ,m_bRegistered(FALSE)
+        ,m_bFrameRequested(FALSE)
+        ,m_uNextID(0)
+        ,m_uFrame(0)
+        ,m_nCount(0)
+        ,m_nDispatching(0)
+        ,m_bDirty(FALSE)
+    {
+        ResetStats();
+    }
+
+    SAnimationEngine::~SAnimationEngine()
+    {
+        if(m_bRegistered) m_pContainer->UnregisterTimelineHandler(this);
+        for(size_t i=0;i<m_arrNodes.GetCount();i++)
+        {
+            delete m_arrNodes[i];
+        }
+        SPOSITION pos = m_mapTargets.GetStartPosition();
+        while(pos)
+        {
+            AnimationTargetNode *pTarget = m_mapTargets.GetNextValue(pos);
+            if(pTarget->swnd) delete static_cast<SWindowAnimationTarget*>(pTarget->pTarget);
+            delete pTarget;
+        }
+    }
+
+    void SAnimationEngine::ResetStats()
+    {
+        memset(&m_stats,0,sizeof(m_stats));
+    }
+
+    AnimationTargetNode * SAnimationEngine::_GetTarget(IAnimationTarget *pTarget,SWND swnd)
+    {
+        SMap<IAnimationTarget*,AnimationTargetNode*>::CPair *p = m_mapTargets.Lookup(pTarget);
+        if(p)
+        {
+            p->m_value->bValid = TRUE;
+            return p->m_value;
+        }
+        AnimationTargetNode *pNode = new AnimationTargetNode;
+        pNode->pTarget = pTarget;
+        pNode->swnd = swnd;
+        pNode->uFrame = 0;
+        pNode->bValid = TRUE;
+        m_mapTargets[pTarget] = pNode;
+        return pNode;
+    }
+
+    UINT SAnimationEngine::Animate(IAnimationTarget *pTarget,int nProp,float fFrom,float fTo,DWORD dwDuration,
+        IInterpolator *pInterpolator,DWORD dwDelay,FunAnimationEnd funEnd,LPARAM lParam)
+    {
+        SASSERT(pTarget);
+        SMap<IAnimationTarget*,AnimationTargetNode*>::CPair *p = m_mapTargets.Lookup(pTarget);
+        if(p)
+        {//同一个属性只保留最新的动画
+            SArray<AnimationNode*> & arrNodes = p->m_value->arrNodes;
+            for(size_t i=0;i<arrNodes.GetCount();i++)
+            {
+                if(arrNodes[i]->nProp == nProp)
+                {
+                    _EndNode(arrNodes[i],TRUE);
+                    break;
+                }
+            }
+        }
+        AnimationNode *pNode = new AnimationNode;
+        pNode->uID = ++m_uNextID;
+        if(pNode->uID == 0) pNode->uID = ++m_uNextID;
+        pNode->pTarget = _GetTarget(pTarget,0);
+        pNode->nProp = nProp;
+        pNode->fFrom = fFrom;
+        pNode->fTo = fTo;
+        pNode->dwDuration = dwDuration;
+        pNode->dwDelay = dwDelay;
+        pNode->dwStart = 0;
+        pNode->bStarted = FALSE;
+        pNode->bEnded = FALSE;
+        pNode->pInterpolator = pInterpolator;
+        pNode->funEnd = funEnd;
+        pNode->lParam = lParam;
+
+        pNode->pTarget->arrNodes.Add(pNode);
+        m_arrNodes.Add(pNode);
+        m_mapNodes[pNode->uID] = pNode;
+        m_nCount++;
+        _Schedule();
+        return pNode->uID;
+    }
+
+    UINT SAnimationEngine::AnimateTo(IAnimationTarget *pTarget,int nProp,float fTo,DWORD dwDuration,
+        IInterpolator *pInterpolator,DWORD dwDelay,FunAnimationEnd funEnd,LPARAM lParam)
+    {
+        float fFrom = 0.0f;
+        if(!pTarget->GetAnimatedValue(nProp,fFrom)) return 0;
+        return Animate(pTarget,nProp,fFrom,fTo,dwDuration,pInterpolator,dwDelay,funEnd,lParam);
+    }
+
+    UINT SAnimationEngine::AnimateWindow(SWindow *pWnd,int nProp,float fTo,DWORD dwDuration,
+        IInterpolator *pInterpolator,DWORD dwDelay,FunAnimationEnd funEnd,LPARAM lParam)
+    {
+        SASSERT(pWnd);
+        if(nProp < ANIPROP_LEFT || nProp > ANIPROP_ALPHA) return 0;
+        SWND swnd = pWnd->GetSwnd();
+        IAnimationTarget *pTarget = NULL;
+        SMap<SWND,IAnimationTarget*>::CPair *p = m_mapWndTargets.Lookup(swnd);
+        if(p)
+        {
+            pTarget = p->m_value;
+        }else
+        {
+            pTarget = new SWindowAnimationTarget(swnd);
+            m_mapWndTargets[swnd] = pTarget;
+            _GetTarget(pTarget,swnd);
+        }
+        float fFrom = 0.0f;
+        pTarget->GetAnimatedValue(nProp,fFrom);
+        return Animate(pTarget,nProp,fFrom,fTo,dwDuration,pInterpolator,dwDelay,funEnd,lParam);
+    }
+
+    void SAnimationEngine::_EndNode(AnimationNode *pNode,BOOL bCanceled)
+    {
+        if(pNode->bEnded) return;
+        pNode->bEnded = TRUE;
+        m_mapNodes.RemoveKey(pNode->uID);
+        SArray<AnimationNode*> & arrNodes = pNode->pTarget->arrNodes;
+        for(size_t i=0;i<arrNodes.GetCount();i++)
+        {
+            if(arrNodes[i] == pNode)
+            {
+                arrNodes.RemoveAt(i);
+                break;
+            }
+        }
+        m_nCount--;
+        //节点在下一次Tick后删除, 不影响正在进行的遍历
+        m_bDirty = TRUE;
+
+        if(!pNode->funEnd) return;
+        ENDEDINFO info = {pNode->uID,bCanceled,pNode->funEnd,pNode->lParam};
+        if(m_nDispatching) m_arrEnded.Add(info);
+        else info.funEnd(info.uAniID,info.bCanceled,info.lParam);
+    }
+
+    BOOL SAnimationEngine::Cancel(UINT uAniID)
+    {
+        SMap<UINT,AnimationNode*>::CPair *p = m_mapNodes.Lookup(uAniID);
+        if(!p) return FALSE;
+        _EndNode(p->m_value,TRUE);
+        _Schedule();
+        return TRUE;
+    }
+
+    int SAnimationEngine::CancelTarget(IAnimationTarget *pTarget)
+    {
+        SMap<IAnimationTarget*,AnimationTargetNode*>::CPair *p = m_mapTargets.Lookup(pTarget);
+        if(!p) return 0;
+        AnimationTargetNode *pTargetNode = p->m_value;
+        //目标可能马上销毁, 本帧不再刷新它
+        pTargetNode->bValid = FALSE;
+        int nCanceled = 0;
+        while(pTargetNode->arrNodes.GetCount())
+        {
+            _EndNode(pTargetNode->arrNodes[0],TRUE);
+            nCanceled++;
+        }
+        if(nCanceled) _Schedule();
+        return nCanceled;
+    }
+
+    int SAnimationEngine::CancelWindow(SWND swnd)
+    {
+        SMap<SWND,IAnimationTarget*>::CPair *p = m_mapWndTargets.Lookup(swnd);
+        if(!p) return 0;
+        return CancelTarget(p->m_value);
+    }
+
+    BOOL SAnimationEngine::IsRunning(UINT uAniID) const
+    {
+        return m_mapNodes.Lookup(uAniID) != NULL;
+    }
+
+    DWORD SAnimationEngine::Tick(DWORD dwNow)
+    {
+        m_uFrame++;
+        BOOL bUpdated = FALSE;
+
+        m_nDispatching++;
+        //回调中启动的动画追加在后面, 本帧不计算
+        size_t nNodes = m_arrNodes.GetCount();
+        for(size_t i=0;i<nNodes;i++)
+        {
+            AnimationNode *pNode = m_arrNodes[i];
+            if(pNode->bEnded) continue;
+            if(!pNode->bStarted)
+            {
+                pNode->bStarted = TRUE;
+                pNode->dwStart = dwNow + pNode->dwDelay;
+            }
+            LONG lPassed = (LONG)(dwNow - pNode->dwStart);
+            if(lPassed < 0) continue;
+
+            AnimationTargetNode *pTarget = pNode->pTarget;
+            float fTime = pNode->dwDuration ? (float)lPassed/pNode->dwDuration : 1.0f;
+            BOOL bFinished = fTime >= 1.0f;
+            if(bFinished) fTime = 1.0f;
+            float fRatio = pNode->pInterpolator ? pNode->pInterpolator->getInterpolation(fTime) : fTime;
+
+            m_stats.nValues++;
+            bUpdated = TRUE;
+            if(!pTarget->pTarget->SetAnimatedValue(pNode->nProp,pNode->fFrom + (pNode->fTo - pNode->fFrom)*fRatio))
+            {//目标已经失效
+                CancelTarget(pTarget->pTarget);
+                continue;
+            }
+            if(pTarget->uFrame != m_uFrame)
+            {
+                pTarget->uFrame = m_uFrame;
+                m_arrUpdated.Add(pTarget);
+            }
+            if(bFinished) _EndNode(pNode,FALSE);
+        }
+
+        //所有属性都计算完后每个目标刷新一次
+        for(size_t i=0;i<m_arrUpdated.GetCount();i++)
+        {
+            AnimationTargetNode *pTarget = m_arrUpdated[i];
+            if(!pTarget->bValid) continue;
+            m_stats.nTargetUpdates++;
+            pTarget->pTarget->OnAnimationFrame();
+        }
+        m_arrUpdated.RemoveAll();
+        m_nDispatching--;
+        if(bUpdated) m_stats.nFrames++;
+
+        _FireEnded();
+        if(m_bDirty && !m_nDispatching) _Compact();
+        return GetNextDelay(dwNow);
+    }
+
+    void SAnimationEngine::_FireEnded()
+    {
+        //回调中可能启动新的动画或者取消其它动画
+        SArray<ENDEDINFO> arrEnded;
+        arrEnded.Copy(m_arrEnded);
+        m_arrEnded.RemoveAll();
+        for(size_t i=0;i<arrEnded.GetCount();i++)
+        {
+            const ENDEDINFO & info = arrEnded[i];
+            info.funEnd(info.uAniID,info.bCanceled,info.lParam);
+        }
+    }
+
+    void SAnimationEngine::_Compact()
+    {
+        size_t j = 0;
+        for(size_t i=0;i<m_arrNodes.GetCount();i++)
+        {
+            AnimationNode *pNode = m_arrNodes[i];
+            if(pNode->bEnded)
+            {
+                delete pNode;
+                continue;
+            }
+            if(i != j) m_arrNodes[j] = pNode;
+            j++;
+        }
+        m_arrNodes.RemoveAt(j,m_arrNodes.GetCount()-j);
+
+        SPOSITION pos = m_mapTargets.GetStartPosition();
+        while(pos)
+        {
+            SMap<IAnimationTarget*,AnimationTargetNode*>::CPair *p = m_mapTargets.GetNext(pos);
+            AnimationTargetNode *pTarget = p->m_value;
+            if(pTarget->arrNodes.GetCount()) continue;
+            if(pTarget->swnd)
+            {
+                m_mapWndTargets.RemoveKey(pTarget->swnd);
+                delete static_cast<SWindowAnimationTarget*>(pTarget->pTarget);
+            }
+            delete pTarget;
+            m_mapTargets.RemoveAtPos((SPOSITION)p);
+        }
+        m_bDirty = FALSE;
+    }
+
+    DWORD SAnimationEngine::GetNextDelay(DWORD dwNow) const
+    {
+        DWORD dwRet = INFINITE;
+        for(size_t i=0;i<m_arrNodes.GetCount();i++)
+        {
+            const AnimationNode *pNode = m_arrNodes[i];
+            if(pNode->bEnded) continue;
+            if(!pNode->bStarted) return 0;
+            LONG lWait = (LONG)(pNode->dwStart - dwNow);
+            if(lWait <= 0) return 0;
+            if((DWORD)lWait < dwRet) dwRet = lWait;
+        }
+        //结束的动画等下一帧删除
+        if(dwRet == INFINITE && m_bDirty) dwRet = 0;
+        return dwRet;
+    }
+
+    void SAnimationEngine::_Schedule()
+    {
+        if(!m_pContainer || m_nDispatching) return;
+        if(!m_bRegistered)
+        {
+            m_bRegistered = m_pContainer->RegisterTimelineHandler(this);
+            m_bFrameRequested = m_bRegistered;
+        }
+        //已经在等下一帧时不用重新计算, 下一帧返回新的延时
+        if(m_bFrameRequested) return;
+        m_bFrameRequested = m_pContainer->RequestNextFrame(this,0);
+    }
+
+    void SAnimationEngine::OnNextFrame()
+    {
+        OnFrame(KFrameInterval);
+    }
+
+    DWORD SAnimationEngine::OnFrame(DWORD dwElapsed)
+    {
+        DWORD dwDelay = Tick(GetTickCount());
+        m_bFrameRequested = dwDelay == 0;
+        return dwDelay;
+    }
+
+}//namespace SOUI
@@ -398,12 +398,14 @@ SImageWnd::SImageWnd()
     , m_fl(kNone_FilterLevel)
     , m_bManaged(FALSE)
 	, m_iTile(0)
+    , m_dwAsyncReq(0)
 {
     m_bMsgTransparent=TRUE;
 }
 
 SImageWnd::~SImageWnd()
 {
+    CancelAsyncImage();
     if(m_bManaged && m_pSkin)
     {
         m_pSkin->Release();
@@ -462,6 +464,7 @@ BOOL SImageWnd::SetSkin(ISkinObj *pSkin,int iFrame/*=0*/,BOOL bAutoFree/*=TRUE*/
 
 void SImageWnd::SetImage(IBitmap * pBitmap,FilterLevel fl)
 {
+    CancelAsyncImage();
     m_pImg = pBitmap;
     m_fl = fl;
     if(GetLayoutParam()->IsWrapContent(Any) && GetParent())
@@ -472,6 +475,37 @@ void SImageWnd::SetImage(IBitmap * pBitmap,FilterLevel fl)
     Invalidate();
 }
 
+BOOL SImageWnd::SetImageAsync(const SStringW & strImgID,FilterLevel fl)
+{
+    CancelAsyncImage();
+    m_fl = fl;
+    m_dwAsyncReq = SAsyncImageLoader::getSingleton().LoadImage(strImgID,this);
+    return m_dwAsyncReq != 0;
+}
+
+void SImageWnd::CancelAsyncImage()
+{
+    if(m_dwAsyncReq)
+    {
+        SAsyncImageLoader::getSingleton().Cancel(m_dwAsyncReq);
+        m_dwAsyncReq = 0;
+    }
+}
+
+void SImageWnd::OnAsyncImageLoaded(DWORD dwReqID,const SStringW & strImgID,IBitmap * pImg)
+{
+    if(dwReqID != m_dwAsyncReq) return;
+    m_dwAsyncReq = 0;
+    if(pImg) SetImage(pImg,m_fl);
+    else STRACEW(L"load image [%s] failed!",strImgID);
+}
+
+HRESULT SImageWnd::OnAttrAsyncSrc(const SStringW & strValue,BOOL bLoading)
+{
+    SetImageAsync(strValue,m_fl);
+    return S_FALSE;
+}
+
 BOOL SImageWnd::SetIcon( int nSubID )
 {
     if(!m_pSkin) return FALSE;
@@ -573,27 +607,34 @@ void SAnimateImgWnd::OnShowWindow( BOOL bShow, UINT nStatus )
 
 void SAnimateImgWnd::OnNextFrame()
 {
-    if(!m_pSkin) GetContainer()->UnregisterTimelineHandler(this);
-    else
+    OnFrame(KFrameInterval);
+}
+
+DWORD SAnimateImgWnd::OnFrame(DWORD dwElapsed)
+{
+    if(!m_pSkin)
     {
-        if(m_iTimeFrame > (m_nSpeed/10)) m_iTimeFrame=0;
-        if(m_iTimeFrame==0)
-        {
-            int nStates=m_pSkin->GetStates();
-            m_iCurFrame++;
-			Invalidate();
+        GetContainer()->UnregisterTimelineHandler(this);
+        return INFINITE;
+    }
+    m_iTimeFrame -= (int)dwElapsed;
+    if(m_iTimeFrame <= 0)
+    {
+        int nStates=m_pSkin->GetStates();
+        m_iCurFrame++;
+        Invalidate();
 
-			if(m_iCurFrame==nStates)
-			{
-				m_iCurFrame = 0;
-				if(m_nRepeat != -1 && ++ m_iRepeat == m_nRepeat)
-				{//检查重复次数
-					Stop();
-				}
-			}
+        if(m_iCurFrame==nStates)
+        {
+            m_iCurFrame = 0;
+            if(m_nRepeat != -1 && ++ m_iRepeat == m_nRepeat)
+            {//检查重复次数
+                Stop();
+            }
         }
-        m_iTimeFrame++;
+        m_iTimeFrame = m_nSpeed;
     }
+    return m_iTimeFrame>0?m_iTimeFrame:0;
 }
 
 void SAnimateImgWnd::OnColorize(COLORREF cr)
@@ -2,10 +2,119 @@
 #include "control/SListView.h"
 #include "helper/SListViewItemLocator.h"
 #include <algorithm>
+#include <process.h>
+
+#define TIMER_MEASUREITEM   10      //取回后台计算的表项高度的定时器
+#define TIMER_MEASUREDELAY  11      //宽度变化后延迟启动后台计算, 拖动改变大小时只计算最后的宽度
+#define MEASURE_DELAY       200     //宽度停止变化多久后重新计算(ms)
+#define MEASURE_BATCH_SIZE  64      //后台计算结果每批提交的数量
 
 namespace SOUI
 {
 
+    //////////////////////////////////////////////////////////////////////////
+    // SListViewHeightWorker
+    // 在工作线程中调用ILvAdapter::measureItemHeight, 结果由界面线程取回后写入ItemLocator
+    class SListViewHeightWorker
+    {
+    public:
+        struct ITEMHEIGHT
+        {
+            int iItem;
+            int nHeight;
+        };
+
+        SListViewHeightWorker():m_hThread(NULL),m_bStop(0),m_bRunning(FALSE)
+        {
+        }
+
+        ~SListViewHeightWorker()
+        {
+            Stop();
+        }
+
+        void Start(ILvAdapter *pAdapter,int nItems,int nWidth,int iStart)
+        {
+            Stop();
+            m_adapter = pAdapter;
+            m_nItems = nItems;
+            m_nWidth = nWidth;
+            m_iStart = iStart;
+            m_bStop = 0;
+            m_bRunning = TRUE;
+            m_hThread = (HANDLE)_beginthreadex(NULL,0,ThreadProc,this,0,NULL);
+            if(!m_hThread) m_bRunning = FALSE;
+        }
+
+        void Stop()
+        {
+            if(m_hThread)
+            {
+                InterlockedExchange(&m_bStop,1);
+                WaitForSingleObject(m_hThread,INFINITE);
+                CloseHandle(m_hThread);
+                m_hThread = NULL;
+            }
+            m_adapter = NULL;
+            m_bRunning = FALSE;
+            m_lstResult.RemoveAll();
+        }
+
+        //取回已经计算好的表项高度, 返回FALSE表示计算已经结束
+        BOOL FetchResults(SArray<ITEMHEIGHT> & lstResult)
+        {
+            SAutoLock lock(m_cs);
+            lstResult.Append(m_lstResult);
+            m_lstResult.RemoveAll();
+            return m_bRunning;
+        }
+
+    protected:
+        static unsigned int __stdcall ThreadProc(void *pParam)
+        {
+            ((SListViewHeightWorker*)pParam)->Run();
+            return 0;
+        }
+
+        void Run()
+        {
+            SArray<ITEMHEIGHT> lstBatch;
+            for(int i=0;i<m_nItems && !m_bStop;i++)
+            {
+                int iItem = (m_iStart+i)%m_nItems;  //从当前显示位置开始计算
+                int nHeight = m_adapter->measureItemHeight(iItem,m_nWidth);
+                if(nHeight<0)
+                {
+                    if(i==0) break;     //adapter不支持后台计算
+                    continue;
+                }
+                ITEMHEIGHT ih={iItem,nHeight};
+                lstBatch.Add(ih);
+                if(lstBatch.GetCount()>=MEASURE_BATCH_SIZE)
+                {
+                    SAutoLock lock(m_cs);
+                    m_lstResult.Append(lstBatch);
+                    lstBatch.RemoveAll();
+                }
+            }
+            SAutoLock lock(m_cs);
+            m_lstResult.Append(lstBatch);
+            m_bRunning = FALSE;
+        }
+
+        CAutoRefPtr<ILvAdapter> m_adapter;
+        int     m_nItems;
+        int     m_nWidth;
+        int     m_iStart;
+
+        HANDLE          m_hThread;
+        volatile LONG   m_bStop;
+        BOOL            m_bRunning;
+
+        SCriticalSection    m_cs;
+        SArray<ITEMHEIGHT>  m_lstResult;
+    };
+
 
     class SListViewDataSetObserver : public TObjRefImpl<ILvDataSetObserver>
     {
@@ -42,7 +151,10 @@ namespace SOUI
         ,m_pSkinDivider(NULL)
         ,m_bWantTab(FALSE)
         ,m_bDataSetInvalidated(FALSE)
+        ,m_nMeasureWidth(-1)
+        ,m_nMeasureSupport(-1)
     {
+        m_pHeightWorker = new SListViewHeightWorker;
         m_bFocusable = TRUE;
         m_observer.Attach(new SListViewDataSetObserver(this));
         m_dwUpdateInterval= 40;
@@ -52,6 +164,7 @@ namespace SOUI
 
     SListView::~SListView()
     {
+        delete m_pHeightWorker;
         m_observer=NULL;
         m_lvItemLocator=NULL;
     }
@@ -64,6 +177,8 @@ namespace SOUI
             return FALSE;
         }
 
+        StopMeasureItems();
+        m_nMeasureSupport = -1;
         if(m_adapter)
         {
             m_adapter->unregisterDataSetObserver(m_observer);
@@ -153,6 +268,76 @@ namespace SOUI
             m_iSelItem = -1;
         UpdateScrollBar();
         UpdateVisibleItems();
+        StartMeasureItems();
+    }
+
+    void SListView::StartMeasureItems()
+    {
+        StopMeasureItems();
+        if(!m_adapter || !m_lvItemLocator || m_lvItemLocator->IsFixHeight()) return;
+        int nItems = m_adapter->getCount();
+        int nWidth = GetClientRect().Width();
+        if(nItems == 0 || nWidth <= 0) return;
+        int iStart = (std::max)(m_iFirstVisible,0);
+        if(m_nMeasureSupport == -1)
+        {//先在界面线程试算一项, adapter不支持时不启动线程
+            m_nMeasureSupport = m_adapter->measureItemHeight(iStart,nWidth)>=0 ? 1 : 0;
+        }
+        if(!m_nMeasureSupport) return;
+        m_nMeasureWidth = nWidth;
+        m_pHeightWorker->Start(m_adapter,nItems,nWidth,iStart);
+        SetTimer(TIMER_MEASUREITEM,50);
+    }
+
+    void SListView::StopMeasureItems()
+    {
+        if(GetContainer())
+        {
+            KillTimer(TIMER_MEASUREITEM);
+            KillTimer(TIMER_MEASUREDELAY);
+        }
+        m_pHeightWorker->Stop();
+        m_nMeasureWidth = -1;
+    }
+
+    void SListView::OnTimer(char cTimerID)
+    {
+        if(cTimerID == TIMER_MEASUREDELAY)
+        {
+            KillTimer(TIMER_MEASUREDELAY);
+            StartMeasureItems();
+            return;
+        }
+        if(cTimerID != TIMER_MEASUREITEM)
+        {
+            __super::OnTimer(cTimerID);
+            return;
+        }
+        SArray<SListViewHeightWorker::ITEMHEIGHT> lstResult;
+        if(!m_pHeightWorker->FetchResults(lstResult))
+            KillTimer(TIMER_MEASUREITEM);
+        if(lstResult.IsEmpty()) return;
+
+        //保持第一个显示项在视图中的位置不变
+        int iAnchor = m_iFirstVisible;
+        int nAnchorOffset = iAnchor==-1?0:(m_lvItemLocator->Item2Position(iAnchor)-m_siVer.nPos);
+        int nOldTotalHeight = m_lvItemLocator->GetTotalHeight();
+        int iLastVisible = m_iFirstVisible + (int)m_lstItems.GetCount();
+        int nItems = m_adapter->getCount();
+        for(size_t i=0;i<lstResult.GetCount();i++)
+        {
+            const SListViewHeightWorker::ITEMHEIGHT & ih = lstResult[i];
+            if(ih.iItem >= nItems) continue;
+            //显示中的表项已经按实际窗口计算了高度
+            if(ih.iItem >= m_iFirstVisible && ih.iItem < iLastVisible) continue;
+            m_lvItemLocator->SetItemHeight(ih.iItem,ih.nHeight);
+        }
+        if(m_lvItemLocator->GetTotalHeight() != nOldTotalHeight)
+        {
+            if(iAnchor != -1) m_siVer.nPos = (std::max)(m_lvItemLocator->Item2Position(iAnchor)-nAnchorOffset,0);
+            UpdateScrollBar();
+            UpdateVisibleItems();
+        }
     }
 
     void SListView::onDataSetInvalidated()
@@ -369,10 +554,17 @@ namespace SOUI
         }
 
         UpdateVisibleItems();
+        if(m_nMeasureSupport != 0 && rcClient.Width() != m_nMeasureWidth)
+        {//旧宽度的结果已经没用, 等宽度稳定后再重新计算
+            StopMeasureItems();
+            m_nMeasureWidth = rcClient.Width();
+            SetTimer(TIMER_MEASUREDELAY,MEASURE_DELAY);
+        }
     }
 
     void SListView::OnDestroy()
     {
+        StopMeasureItems();
 		if(m_adapter)
 		{
 			m_adapter->unregisterDataSetObserver(m_observer);
@@ -851,6 +1043,7 @@ namespace SOUI
 		__super::OnScaleChanged(nScale);
 		if(m_lvItemLocator) m_lvItemLocator->SetScale(nScale);
 		DispatchMessage2Items(UM_SETSCALE,nScale,0);
+		StartMeasureItems();
 	}
 
 	HRESULT SListView::OnLanguageChanged()
@@ -1,12 +1,13 @@
 ﻿#include "souistd.h"
 #include "control/Stabctrl.h"
 #include "animator/SInterpolatorImpl.h"
+#include "animator/SAnimationEngine.h"
 #include <algorithm>
 
 namespace SOUI
 {
 
-	class STabSlider : public SWindow, public ITimelineHandler
+	class STabSlider : public SWindow, public IAnimationTarget
 	{
 		SOUI_CLASS_NAME(STabSlider, L"tabslider")
 
@@ -15,7 +16,6 @@ namespace SOUI
 			: m_pTabCtrl(pTabCtrl)
 			, m_aniInterpoloator(pInterpolator)
 			, m_nSteps(nSteps)
-			, m_iStep(0)
 		{
 			SASSERT(pTabCtrl);
 			SASSERT(pInterpolator);
@@ -111,7 +111,8 @@ namespace SOUI
 
 				m_memRT->SetViewportOrg(CPoint());
 
-				GetContainer()->RegisterTimelineHandler(this);
+				GetContainer()->GetAnimationEngine()->Animate(this,ANIPROP_USER,(float)m_nFrom,(float)m_nTo,
+					m_nSteps*KFrameInterval,m_aniInterpoloator,0,OnSlideEnd,(LPARAM)this);
 				pTabCtrl->GetItem(iTo)->SetVisible(FALSE);
 				SetVisible(TRUE, TRUE);
 			}
@@ -205,7 +206,8 @@ namespace SOUI
 
 				m_memRT->SetViewportOrg(CPoint());
 
-				GetContainer()->RegisterTimelineHandler(this);
+				GetContainer()->GetAnimationEngine()->Animate(this,ANIPROP_USER,(float)m_nFrom,(float)m_nTo,
+					m_nSteps*KFrameInterval,m_aniInterpoloator,0,OnSlideEnd,(LPARAM)this);
 				pTabCtrl->GetItem(iTo)->SetVisible(FALSE);
 				SetVisible(TRUE, TRUE);
 			}
@@ -215,22 +217,30 @@ namespace SOUI
 		{
 		}
 
-		void OnNextFrame()
+		virtual BOOL GetAnimatedValue(int nProp,float & fValue)
 		{
-			if (++m_iStep > m_nSteps)
-			{
-				Stop();
-			}
+			fValue = (float)(m_bVertical ? m_ptOffset.y : m_ptOffset.x);
+			return TRUE;
+		}
+
+		virtual BOOL SetAnimatedValue(int nProp,float fValue)
+		{
+			if (m_bVertical)
+				m_ptOffset.y = (int)fValue;
 			else
-			{
-				float fPos = m_aniInterpoloator->getInterpolation(m_iStep*1.0f/m_nSteps);
-				int nOffset = m_nFrom + (int)(fPos * (m_nTo - m_nFrom));
-				if (m_bVertical)
-					m_ptOffset.y = nOffset;
-				else
-					m_ptOffset.x = nOffset;
-				InvalidateRect(NULL);
-			}
+				m_ptOffset.x = (int)fValue;
+			return TRUE;
+		}
+
+		virtual void OnAnimationFrame()
+		{
+			InvalidateRect(NULL);
+		}
+
+		static void OnSlideEnd(UINT uAniID,BOOL bCanceled,LPARAM lParam)
+		{
+			//被取消时slider已经在销毁
+			if (!bCanceled) ((STabSlider*)lParam)->Stop();
 		}
 
 		void Stop()
@@ -257,7 +267,7 @@ namespace SOUI
 
 		void OnDestroy()
 		{
-			GetContainer()->UnregisterTimelineHandler(this);
+			GetContainer()->GetAnimationEngine()->CancelTarget(this);
 			SWindow::OnDestroy();
 		}
 
@@ -266,7 +276,6 @@ namespace SOUI
 		//int                        m_nAniRange;
 		int						   m_nFrom,m_nTo;
 		int                        m_nSteps;
-		int                        m_iStep;
 		bool                       m_bVertical;
 		CAutoRefPtr<IInterpolator> m_aniInterpoloator;
 		STabCtrl *                 m_pTabCtrl;
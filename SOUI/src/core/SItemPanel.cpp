@@ -360,7 +360,7 @@ SItemPanel * SItemPanel::Create(SWindow *pFrameHost,pugi::xml_node xmlNode,IItem
 //不继承宿主的字体，从指定的字体或者系统字体开始，避免在GetRenderTarget时还需要从宿主窗口到获取当前的文字属性。
 void SItemPanel::BeforePaint(IRenderTarget *pRT, SPainter &painter)
 {
-	IFontPtr fontText = GetStyle().GetTextFont(IIF_STATE4(m_dwState,0,1,2,3));
+	CAutoRefPtr<IFont> fontText = GetStyle().GetTextFont(IIF_STATE4(m_dwState,0,1,2,3));
 	COLORREF crText = GetStyle().GetTextColor(IIF_STATE4(m_dwState,0,1,2,3));
 	if(fontText == NULL)
 		fontText = SFontPool::getSingleton().GetFont(FF_DEFAULTFONT,GetScale());
@@ -374,11 +374,21 @@ void SItemPanel::OnShowWindow(BOOL bShow, UINT nStatus)
 {
     __super::OnShowWindow(bShow,nStatus);
     if(IsVisible(TRUE))
+    {
         m_pFrmHost->GetContainer()->RegisterTimelineHandler(this);
+        OnFrameScheduleChanged();
+    }
     else
         m_pFrmHost->GetContainer()->UnregisterTimelineHandler(this);
 }
 
+void SItemPanel::OnFrameScheduleChanged()
+{
+    //表项内的handler由宿主的帧时钟驱动, 按表项内最早到期的handler唤醒
+    if(IsVisible(TRUE))
+        m_pFrmHost->GetContainer()->RequestNextFrame(this,m_frameClock.GetNextDelay(GetTickCount()));
+}
+
 void SItemPanel::OnDestroy()
 {
     m_pFrmHost->GetContainer()->UnregisterTimelineHandler(this);
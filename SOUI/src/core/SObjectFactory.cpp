@@ -61,6 +61,8 @@ IObject * SObjectFactoryMgr::CreateObject(const SObjectInfo & objInfo) const
         SLOGFMTW(L"Warning: no ojbect %s of type:%d in SOUI!!", (LPCWSTR)objInfo.mName, objInfo.mType);
         return NULL;
     }
+    SPROFILE_SCOPE_DETAIL("SObjectFactoryMgr::CreateObject",(LPCWSTR)objInfo.mName);
+    SPROFILE_COUNT(1,0);
     IObject * pRet = GetKeyObject(objInfo)->NewObject();
     SASSERT(pRet);
     SetSwndDefAttr(pRet);
@@ -88,6 +90,7 @@ void SObjectFactoryMgr::SetSwndDefAttr(IObject * pObject) const
     LPCWSTR pszClassName = pObject->GetObjectClass();
     
 	if (pObject->GetObjectType() != Window) return;
+    SPROFILE_SCOPE("SObjectFactoryMgr::SetSwndDefAttr");
 
     //检索并设置类的默认属性
     pugi::xml_node defAttr = GETCSS(pszClassName);
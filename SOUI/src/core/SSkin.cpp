@@ -6,6 +6,8 @@
 #include "souistd.h"
 #include "core/Sskin.h"
 #include "helper/SDIBHelper.h"
+#include "res.mgr/SSkinDiskCache.h"
+#include "res.mgr/SSkinAtlas.h"
 
 namespace SOUI
 {
@@ -18,6 +20,7 @@ SSkinImgList::SSkinImgList()
 ,m_bVertical(FALSE)
 ,m_filterLevel(kNone_FilterLevel)
 ,m_bAutoFit(TRUE)
+,m_crImgColorized(0)
 {
 
 }
@@ -29,12 +32,69 @@ SSkinImgList::~SSkinImgList()
 SIZE SSkinImgList::GetSkinSize()
 {
     SIZE ret = {0, 0};
-    if(m_pImg) ret=m_pImg->Size();
+    if(m_pImg) ret=GetImageRect().Size();
     if(m_bVertical) ret.cy/=m_nStates;
     else ret.cx/=m_nStates;
     return ret;
 }
 
+CRect SSkinImgList::GetImageRect() const
+{
+    if(!m_rcImg.IsRectEmpty() || !m_pImg) return m_rcImg;
+    return CRect(CPoint(0,0),m_pImg->Size());
+}
+
+HRESULT SSkinImgList::_GetSubImage(IBitmap **ppImg)
+{
+    if(!m_pImg) return E_FAIL;
+    if(m_rcImg.IsRectEmpty()) return m_pImg->Clone(ppImg);
+
+    CAutoRefPtr<IBitmap> pImg;
+    if(!m_pImg->GetRenderFactory()->CreateBitmap(&pImg)) return E_OUTOFMEMORY;
+    HRESULT hr = pImg->Init(m_rcImg.Width(),m_rcImg.Height(),NULL);
+    if(FAILED(hr)) return hr;
+
+    const DWORD *pSrc = (const DWORD*)m_pImg->GetPixelBits();
+    DWORD *pDst = (DWORD*)pImg->LockPixelBits();
+    if(!pSrc || !pDst)
+    {
+        if(pDst) pImg->UnlockPixelBits(pDst);
+        return E_FAIL;
+    }
+    int nSrcWid = m_pImg->Width();
+    pSrc += m_rcImg.top*nSrcWid + m_rcImg.left;
+    for(int y=0;y<m_rcImg.Height();y++)
+    {
+        memcpy(pDst + y*m_rcImg.Width(),pSrc + y*nSrcWid,m_rcImg.Width()*4);
+    }
+    pImg->UnlockPixelBits(pDst);
+    *ppImg = pImg;
+    (*ppImg)->AddRef();
+    return S_OK;
+}
+
+BOOL SSkinImgList::PackToAtlas(SSkinAtlas *pAtlas,SResProviderMgr *pImgCache)
+{
+    if(!pAtlas || !m_pImg || !m_rcImg.IsRectEmpty()) return FALSE;
+    LPCWSTR pszClass = GetObjectClass();
+    if(wcscmp(pszClass,SSkinImgList::GetClassName())!=0
+        && wcscmp(pszClass,SSkinImgFrame::GetClassName())!=0
+        && wcscmp(pszClass,SSkinImgFrame2::GetClassName())!=0
+        && wcscmp(pszClass,SSkinScrollbar::GetClassName())!=0)
+        return FALSE;
+
+    CAutoRefPtr<IBitmap> pPage;
+    CRect rcImg;
+    if(!pAtlas->Add(m_pImg,&pPage,&rcImg)) return FALSE;
+    IBitmap *pSrc = m_pImg;
+    pSrc->AddRef();
+    m_pImg = pPage;
+    m_rcImg = rcImg;
+    m_imgColorized = NULL;
+    pAtlas->ReleaseSource(pSrc,pImgCache);
+    return TRUE;
+}
+
 BOOL SSkinImgList::IgnoreState()
 {
     return GetStates()==1;
@@ -54,6 +114,7 @@ void SSkinImgList::_Draw(IRenderTarget *pRT, LPCRECT rcDraw, DWORD dwState,BYTE
         OffsetRect(&rcSrc,0, dwState * sz.cy);
     else
         OffsetRect(&rcSrc, dwState * sz.cx, 0);
+    OffsetRect(&rcSrc,m_rcImg.left,m_rcImg.top);
     pRT->DrawBitmapEx(rcDraw,m_pImg,&rcSrc,GetExpandMode(),byAlpha);
 }
 
@@ -68,24 +129,48 @@ UINT SSkinImgList::GetExpandMode()
 void SSkinImgList::OnColorize(COLORREF cr)
 {
     if(!m_bEnableColorize) return;
-    if(cr == m_crColorize) return;
 	m_crColorize = cr;
+	if(cr == 0) m_imgColorized = NULL;
+}
 
-    if(m_imgBackup)
-    {//restore
-        LPCVOID pSrc = m_imgBackup->GetPixelBits();
-        LPVOID pDst = m_pImg->LockPixelBits();
-        memcpy(pDst,pSrc,m_pImg->Width()*m_pImg->Height()*4);
-        m_pImg->UnlockPixelBits(pDst);
-    }else
+void SSkinImgList::Draw(IRenderTarget *pRT, LPCRECT rcDraw, DWORD dwState,BYTE byAlpha)
+{
+    if(m_crColorize == 0 || !m_pImg)
     {
-        if(S_OK != m_pImg->Clone(&m_imgBackup)) return;
+        _Draw(pRT,rcDraw,dwState,byAlpha);
+        return;
     }
-    
-	if(cr!=0)
-		SDIBHelper::Colorize(m_pImg,cr);
-	else
-		m_imgBackup = NULL;//free backup
+
+    COLORREF crOld = pRT->GetColorize();
+    if(pRT->SetColorize(m_crColorize) == S_OK)
+    {
+        _Draw(pRT,rcDraw,dwState,byAlpha);
+        pRT->SetColorize(crOld);
+        return;
+    }
+
+    //渲染引擎不支持绘制时着色, 使用着色后的位图副本绘制
+    if(!m_imgColorized || m_crImgColorized != m_crColorize)
+    {
+        m_imgColorized = NULL;
+        if(S_OK == _GetSubImage(&m_imgColorized))
+        {
+            SDIBHelper::Colorize(m_imgColorized,m_crColorize);
+            m_crImgColorized = m_crColorize;
+        }
+    }
+    if(!m_imgColorized)
+    {
+        _Draw(pRT,rcDraw,dwState,byAlpha);
+        return;
+    }
+    CAutoRefPtr<IBitmap> pImg = m_pImg;
+    CRect rcImg = m_rcImg;
+    m_pImg = m_imgColorized;
+    m_rcImg.SetRectEmpty();
+    _Draw(pRT,rcDraw,dwState,byAlpha);
+    m_pImg = pImg;
+    m_rcImg = rcImg;
 }
 
 void SSkinImgList::_Scale(ISkinObj * skinObj, int nScale)
@@ -109,13 +194,22 @@ void SSkinImgList::_Scale(ISkinObj * skinObj, int nScale)
 		szSkin.cx *= GetStates();
 	}
 
-	if(m_imgBackup)
+	//合并到大图的skin先取出自己的区域再缩放
+	CAutoRefPtr<IBitmap> pSrc = m_pImg;
+	if(m_pImg && !m_rcImg.IsRectEmpty())
 	{
-		m_imgBackup->Scale(&pRet->m_imgBackup,szSkin.cx,szSkin.cy,kHigh_FilterLevel);
+		pSrc = NULL;
+		_GetSubImage(&pSrc);
 	}
-	if(m_pImg)
+	if(pSrc)
 	{
-		m_pImg->Scale(&pRet->m_pImg,szSkin.cx,szSkin.cy,kHigh_FilterLevel);
+		//优先从磁盘缓存加载重采样结果
+		SSkinDiskCache *pCache = SSkinDiskCache::getSingletonPtr();
+		if(!pCache || !pCache->LoadScaledImage(pSrc,szSkin,kHigh_FilterLevel,&pRet->m_pImg))
+		{
+			pSrc->Scale(&pRet->m_pImg,szSkin.cx,szSkin.cy,kHigh_FilterLevel);
+			if(pCache && pRet->m_pImg) pCache->SaveScaledImage(pSrc,kHigh_FilterLevel,pRet->m_pImg);
+		}
 	}
 }
 
@@ -136,6 +230,7 @@ void SSkinImgFrame::_Draw(IRenderTarget *pRT, LPCRECT rcDraw, DWORD dwState,BYTE
     else
         pt.x=sz.cx*dwState;
     CRect rcSour(pt,sz);
+    rcSour.OffsetRect(m_rcImg.TopLeft());
     pRT->DrawBitmap9Patch(rcDraw,m_pImg,&rcSour,&m_rcMargin,GetExpandMode(),byAlpha);
 }
 
@@ -355,12 +450,14 @@ void SSkinScrollbar::_Draw(IRenderTarget *pRT, LPCRECT prcDraw, DWORD dwState,BY
         rcMargin.left=m_nMargin,rcMargin.right=m_nMargin;
 
     CRect rcSour=GetPartRect(nSbCode,nState,bVertical);
+    rcSour.OffsetRect(m_rcImg.TopLeft());
     
     pRT->DrawBitmap9Patch(prcDraw,m_pImg,&rcSour,&rcMargin,m_bTile?EM_TILE:EM_STRETCH,byAlpha);
     
     if(nSbCode==SB_THUMBTRACK && m_bHasGripper)
     {
         rcSour=GetPartRect(SB_THUMBGRIPPER,0,bVertical);
+        rcSour.OffsetRect(m_rcImg.TopLeft());
         CRect rcDraw=*prcDraw;
         
         if (bVertical)
@@ -710,6 +807,7 @@ HRESULT SSkinImgFrame2::OnAttrSrc(const SStringW & strValue,BOOL bLoading)
 	pImgCenter->UnlockPixelBits(pBuf2);
 
 	m_pImg = pImgCenter;
+	m_rcImg.SetRectEmpty();
 	pImgCenter->Release();
 	pImg->Release();
 
@@ -19,6 +19,7 @@ SwndContainerImpl::SwndContainerImpl()
     ,m_dropTarget(this)
     ,m_focusMgr(this)
     ,m_bZorderDirty(TRUE)
+    ,m_aniEngine(this)
 {
     SWindow::SetContainer(this);
 }
@@ -381,32 +382,36 @@ void SwndContainerImpl::OnActivate( UINT nState )
 
 BOOL SwndContainerImpl::RegisterTimelineHandler( ITimelineHandler *pHandler )
 {
-    SPOSITION pos=m_lstTimelineHandler.Find(pHandler);
-    if(pos) return FALSE;
-    m_lstTimelineHandler.AddTail(pHandler);
+    if(!m_frameClock.Add(pHandler,GetTickCount())) return FALSE;
+    OnFrameScheduleChanged();
     return TRUE;
 }
 
 BOOL SwndContainerImpl::UnregisterTimelineHandler( ITimelineHandler *pHandler )
 {
-    SPOSITION pos=m_lstTimelineHandler.Find(pHandler);
-    if(!pos) return FALSE;
-    m_lstTimelineHandler.RemoveAt(pos);
+    if(!m_frameClock.Remove(pHandler)) return FALSE;
+    OnFrameScheduleChanged();
+    return TRUE;
+}
+
+BOOL SwndContainerImpl::RequestNextFrame( ITimelineHandler *pHandler,DWORD dwDelay )
+{
+    if(!m_frameClock.Wake(pHandler,dwDelay,GetTickCount())) return FALSE;
+    OnFrameScheduleChanged();
     return TRUE;
 }
 
 void SwndContainerImpl::OnNextFrame()
 {
-    if(!IsVisible(TRUE)) return;
-    
-    SList<ITimelineHandler*> lstCopy;
-    CopyList(m_lstTimelineHandler,lstCopy);
-    SPOSITION pos=lstCopy.GetHeadPosition();
-    while(pos)
-    {
-        ITimelineHandler * pHandler=lstCopy.GetNext(pos);
-        pHandler->OnNextFrame();
-    }
+    OnFrame(KFrameInterval);
+}
+
+DWORD SwndContainerImpl::OnFrame( DWORD dwElapsed )
+{
+    DWORD dwNow = GetTickCount();
+    //隐藏时不派发, 到期的handler等显示后再调用
+    if(!IsVisible(TRUE)) return m_frameClock.GetNextDelay(dwNow);
+    return m_frameClock.Tick(dwNow);
 }
 
 void SwndContainerImpl::OnActivateApp( BOOL bActive, DWORD dwThreadID )
@@ -6,6 +6,7 @@
 #include "helper/color.h"
 #include "helper/SplitString.h"
 #include "helper/copylist.hpp"
+#include "res.mgr/SResWarmup.h"
 
 #include "../updatelayeredwindow/SUpdateLayeredWindow.h"
 
@@ -16,6 +17,14 @@ namespace SOUI
 #define TIMER_NEXTFRAME 2
 #define KConstDummyPaint    0x80000000
 
+//预加载清单的录制和启动计时只在主窗口完成第一帧时停止. Run之前主窗口还没有登记, 这时只认没有owner的顶层窗口
+static BOOL IsMainHostWnd(HWND hWnd)
+{
+    HWND hMainWnd = SApplication::getSingleton().GetMainWnd();
+    if(hMainWnd) return hWnd == hMainWnd;
+    return !(::GetWindowLong(hWnd,GWL_STYLE) & WS_CHILD) && ::GetWindow(hWnd,GW_OWNER) == NULL;
+}
+
 
 //////////////////////////////////////////////////////////////////////////
 //    SDummyWnd
@@ -104,6 +113,8 @@ SHostWnd::SHostWnd( LPCTSTR pszResName /*= NULL*/ )
 , m_bTrackFlag(FALSE)
 , m_bCaretShowing(FALSE)
 , m_bCaretActive(FALSE)
+, m_bFrameTimerArmed(FALSE)
+, m_dwFrameTimerDue(0)
 , m_bNeedRepaint(FALSE)
 , m_bNeedAllRepaint(TRUE)
 , m_pTipCtrl(NULL)
@@ -170,6 +181,7 @@ BOOL SHostWnd::_InitFromXml(pugi::xml_node xmlNode,int nWidth,int nHeight)
         return FALSE;
     }
     if(!CSimpleWnd::IsWindow()) return FALSE;
+    SPROFILE_SCOPE("SHostWnd::InitFromXml");
     
     //free old script module
     if(m_pScriptModule)
@@ -294,7 +306,10 @@ BOOL SHostWnd::_InitFromXml(pugi::xml_node xmlNode,int nWidth,int nHeight)
 
 
 
-    SWindow::InitFromXml(xmlNode.child(L"root"));
+    {
+        SPROFILE_SCOPE("SWindow::InitFromXml");
+        SWindow::InitFromXml(xmlNode.child(L"root"));
+    }
     BuildWndTreeZorder();
 
 	//width or height == 0 代表使用XML中指定的大小
@@ -391,6 +406,7 @@ void SHostWnd::OnPrint(HDC dc, UINT uFlags)
 
     if (m_bNeedRepaint)
     {
+        SPROFILE_SCOPE("SHostWnd::Paint");
         m_bNeedRepaint = FALSE;
 
         SPainter painter;
@@ -446,6 +462,15 @@ void SHostWnd::OnPrint(HDC dc, UINT uFlags)
     m_bRending = FALSE;
 
     UpdateHost(dc,rcInvalid);
+
+    //主窗口第一帧已经完成, 停止录制预加载清单和启动计时. 闪屏, 下拉框和菜单先绘制时继续录制
+    SResWarmup *pWarmup = SApplication::getSingleton().GetResWarmup();
+    BOOL bRecording = pWarmup && pWarmup->IsRecording();
+    if((bRecording || SProfiler::IsEnabled()) && IsMainHostWnd(m_hWnd))
+    {
+        if(bRecording) pWarmup->StopRecord();
+        if(SProfiler::IsEnabled()) SProfiler::OnFirstFrame();
+    }
 }
 
 void SHostWnd::OnPaint(HDC dc)
@@ -464,6 +489,7 @@ BOOL SHostWnd::OnEraseBkgnd(HDC dc)
 
 int SHostWnd::OnCreate( LPCREATESTRUCT lpCreateStruct )
 {
+    SPROFILE_SCOPE("SHostWnd::OnCreate");
     GETRENDERFACTORY->CreateRenderTarget(&m_memRT,0,0);
     GETRENDERFACTORY->CreateRegion(&m_rgnInvalidate);
     m_pTipCtrl = GETTOOLTIPFACTORY->CreateToolTip(m_hWnd);
@@ -526,6 +552,9 @@ void SHostWnd::OnSize(UINT nType, CSize size)
 {
     if(IsIconic()) return;
 
+    //最小化时停止了帧定时器
+    if(!m_bFrameTimerArmed) _ArmFrameTimer(TRUE);
+
     if (size.cx==0 || size.cy==0)
         return;
     
@@ -601,10 +630,35 @@ void SHostWnd::OnSwndTimer( char cTimerID )
         m_bCaretActive=!m_bCaretActive;
     }else if(cTimerID==TIMER_NEXTFRAME)
     {
-        if(!::IsIconic(m_hWnd)) OnNextFrame();
+        if(::IsIconic(m_hWnd))
+        {//最小化期间不需要动画, 还原时在OnSize中重新设置
+            SWindow::KillTimer(TIMER_NEXTFRAME);
+            m_bFrameTimerArmed = FALSE;
+            return;
+        }
+        OnFrame(0);
+        _ArmFrameTimer(TRUE);
     }
 }
 
+void SHostWnd::_ArmFrameTimer(BOOL bForce)
+{
+    DWORD dwNow = GetTickCount();
+    DWORD dwDelay = m_frameClock.GetNextDelay(dwNow);
+    if(dwDelay == INFINITE)
+    {//所有handler都在等待, 停止定时器
+        if(m_bFrameTimerArmed) SWindow::KillTimer(TIMER_NEXTFRAME);
+        m_bFrameTimerArmed = FALSE;
+        return;
+    }
+    DWORD dwDue = dwNow + dwDelay;
+    //已经设置的定时器更早触发, 到时再重新计算
+    if(!bForce && m_bFrameTimerArmed && (LONG)(dwDue - m_dwFrameTimerDue) >= 0) return;
+
+    m_bFrameTimerArmed = SWindow::SetTimer(TIMER_NEXTFRAME,dwDelay);
+    m_dwFrameTimerDue = dwDue;
+}
+
 void SHostWnd::_DrawCaret(CPoint pt,BOOL bErase)
 {
     SASSERT(m_caret);
@@ -759,6 +813,7 @@ void SHostWnd::OnReleaseRenderTarget(IRenderTarget * pRT,const CRect &rc,DWORD g
 
 void SHostWnd::UpdateHost(HDC dc, const CRect &rcInvalid )
 {
+    SPROFILE_SCOPE("SHostWnd::UpdateHost");
     if(m_hostAttr.m_bTranslucent)
     {
         SASSERT(m_hostAttr.m_byAlpha>5);
@@ -1245,18 +1300,10 @@ BOOL SHostWnd::AnimateHostWindow(DWORD dwTime,DWORD dwFlags)
     }
 }
 
-BOOL SHostWnd::RegisterTimelineHandler( ITimelineHandler *pHandler )
-{
-    BOOL bRet = SwndContainerImpl::RegisterTimelineHandler(pHandler);
-    if(bRet && m_lstTimelineHandler.GetCount()==1) SWindow::SetTimer(TIMER_NEXTFRAME,10);
-    return bRet;
-}
-
-BOOL SHostWnd::UnregisterTimelineHandler( ITimelineHandler *pHandler )
+void SHostWnd::OnFrameScheduleChanged()
 {
-    BOOL bRet=SwndContainerImpl::UnregisterTimelineHandler(pHandler);
-    if(bRet && m_lstTimelineHandler.IsEmpty()) SWindow::KillTimer(TIMER_NEXTFRAME);
-    return bRet;
+    //注销handler时不调整, 定时器提前触发时重新计算
+    _ArmFrameTimer(FALSE);
 }
 
 const SStringW & SHostWnd::GetTranslatorContext()
@@ -1404,6 +1451,7 @@ void SHostWnd::UpdateLayout()
 {
 	if (!IsLayoutDirty()) 
 		return;
+	SPROFILE_SCOPE("SHostWnd::UpdateLayout");
 	if (_IsRootWrapContent())
 	{
 		int nWid = m_hostAttr.m_width.toPixelSize(GetScale());
@@ -1,7 +1,6 @@
 ﻿#include "souistd.h"
 #include "helper/SDIBHelper.h"
-
-#define RGB2GRAY(r,g,b) (((b)*117 + (g)*601 + (r)*306) >> 10)
+#include <pixelkernels.h>
 
 namespace SOUI
 {
@@ -11,252 +10,37 @@ namespace SOUI
 		UINT     nHei;
     };
 
-	// ------------------------------------------------------------
-	// 有太多的算法需要用某种方式(map)变换位图的每个像素的颜色，比如
-	// 彩色转换为灰度图，gamma校正，颜色空间转换,hsl调整.所以写一个模板做为参数调用的通用算法
-	// ------------------------------------------------------------
-	template <class Mode, class Param>
-	bool ColorTransform(DIBINFO* pDib, Mode mode, const Param &param)
-	{
-		if (NULL == pDib||NULL == pDib->pBits)
-		{
-			return false;
-		}
-        
-        int nPixels = pDib->nWid * pDib->nHei;
-        LPBYTE pBit = pDib->pBits;
-        for(int i=0;i<nPixels;i++, pBit+=4)
-        {
-            mode(pBit, param);
-        }
-
-		return true;
-	}
-
-
-	// 灰度 = 0.299 * red + 0.587 * green + 0.114 * blue 
-	inline void GrayMode(BYTE *pColor,const int &)
-	{
-        pColor[0] = pColor[1] = pColor[2] = RGB2GRAY(pColor[0],pColor[1],pColor[2]);
-	}
-    
-    struct COLORIZEPARAM{
-        BYTE hue;
-        BYTE sat;
-        int  a0;//[0-256]
-        int  a1;//[0-256]
-    };
-
-    void FillColorizeParam(COLORIZEPARAM &param ,BYTE hue,BYTE sat,float fBlend)
-    {
-        param.hue = hue;
-        param.sat = sat;
-        SASSERT(fBlend>=0.0f && fBlend <=1.0f);
-        param.a0 = (int)(fBlend*256);
-        param.a1 = 256 - param.a0;
-    }
-
-    ////////////////////////////////////////////////////////////////////////////////
-    #define  HSLMAX   255	/* H,L, and S vary over 0-HSLMAX */
-    #define  RGBMAX   255   /* R,G, and B vary over 0-RGBMAX */
-        /* HSLMAX BEST IF DIVISIBLE BY 6 */
-        /* RGBMAX, HSLMAX must each fit in a BYTE. */
-        /* Hue is undefined if Saturation is 0 (grey-scale) */
-        /* This value determines where the Hue scrollbar is */
-        /* initially set for achromatic colors */
-    #define HSLUNDEFINED (HSLMAX*2/3)
-    ////////////////////////////////////////////////////////////////////////////////
-    RGBQUAD RGBtoHSL(RGBQUAD lRGBColor)
-    {
-        BYTE R,G,B;					/* input RGB values */
-        BYTE H,L,S;					/* output HSL values */
-        BYTE cMax,cMin;				/* max and min RGB values */
-        WORD Rdelta,Gdelta,Bdelta;	/* intermediate value: % of spread from max*/
-
-        R = lRGBColor.rgbRed;	/* get R, G, and B out of DWORD */
-        G = lRGBColor.rgbGreen;
-        B = lRGBColor.rgbBlue;
-
-        cMax = (std::max)( (std::max)(R,G), B);	/* calculate lightness */
-        cMin = (std::min)( (std::min)(R,G), B);
-        L = (BYTE)((((cMax+cMin)*HSLMAX)+RGBMAX)/(2*RGBMAX));
-
-        if (cMax==cMin){			/* r=g=b --> achromatic case */
-            S = 0;					/* saturation */
-            H = HSLUNDEFINED;		/* hue */
-        } else {					/* chromatic case */
-            if (L <= (HSLMAX/2))	/* saturation */
-                S = (BYTE)((((cMax-cMin)*HSLMAX)+((cMax+cMin)/2))/(cMax+cMin));
-            else
-                S = (BYTE)((((cMax-cMin)*HSLMAX)+((2*RGBMAX-cMax-cMin)/2))/(2*RGBMAX-cMax-cMin));
-            /* hue */
-            Rdelta = (WORD)((((cMax-R)*(HSLMAX/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
-            Gdelta = (WORD)((((cMax-G)*(HSLMAX/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
-            Bdelta = (WORD)((((cMax-B)*(HSLMAX/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
-
-            if (R == cMax)
-                H = (BYTE)(Bdelta - Gdelta);
-            else if (G == cMax)
-                H = (BYTE)((HSLMAX/3) + Rdelta - Bdelta);
-            else /* B == cMax */
-                H = (BYTE)(((2*HSLMAX)/3) + Gdelta - Rdelta);
-
-            //		if (H < 0) H += HSLMAX;     //always false
-            if (H > HSLMAX) H -= HSLMAX;
-        }
-        RGBQUAD hsl={L,S,H,0};
-        return hsl;
-    }
-
-    ////////////////////////////////////////////////////////////////////////////////
-    RGBQUAD RGBtoRGBQUAD(COLORREF cr)
-    {
-        RGBQUAD c;
-        c.rgbRed = GetRValue(cr);	/* get R, G, and B out of DWORD */
-        c.rgbGreen = GetGValue(cr);
-        c.rgbBlue = GetBValue(cr);
-        c.rgbReserved=0;
-        return c;
-    }
-    ////////////////////////////////////////////////////////////////////////////////
-    COLORREF RGBQUADtoRGB (RGBQUAD c)
-    {
-        return RGB(c.rgbRed,c.rgbGreen,c.rgbBlue);
-    }
-
-    ////////////////////////////////////////////////////////////////////////////////
-    float HueToRGB(float n1,float n2, float hue)
-    {
-        //<F. Livraghi> fixed implementation for HSL2RGB routine
-        float rValue;
-
-        if (hue > 360)
-            hue = hue - 360;
-        else if (hue < 0)
-            hue = hue + 360;
-
-        if (hue < 60)
-            rValue = n1 + (n2-n1)*hue/60.0f;
-        else if (hue < 180)
-            rValue = n2;
-        else if (hue < 240)
-            rValue = n1+(n2-n1)*(240-hue)/60;
-        else
-            rValue = n1;
-
-        return rValue;
-    }
-    ////////////////////////////////////////////////////////////////////////////////
-    ////////////////////////////////////////////////////////////////////////////////
-    RGBQUAD HSLtoRGB(RGBQUAD lHSLColor)
-    { 
-        //<F. Livraghi> fixed implementation for HSL2RGB routine
-        float h,s,l;
-        float m1,m2;
-        BYTE r,g,b;
-
-        h = (float)lHSLColor.rgbRed * 360.0f/255.0f;
-        s = (float)lHSLColor.rgbGreen/255.0f;
-        l = (float)lHSLColor.rgbBlue/255.0f;
-
-        if (l <= 0.5)	m2 = l * (1+s);
-        else			m2 = l + s - l*s;
-
-        m1 = 2 * l - m2;
-
-        if (s == 0) {
-            r=g=b=(BYTE)(l*255.0f);
-        } else {
-            r = (BYTE)(HueToRGB(m1,m2,h+120) * 255.0f);
-            g = (BYTE)(HueToRGB(m1,m2,h) * 255.0f);
-            b = (BYTE)(HueToRGB(m1,m2,h-120) * 255.0f);
-        }
-
-        RGBQUAD rgb = {b,g,r,0};
-        return rgb;
-    }
-
-    inline void ColorizeMode(BYTE *pAbgr, const COLORIZEPARAM & param)
-    {
-        BYTE red = pAbgr[0],green=pAbgr[1],blue=pAbgr[2],alpha=pAbgr[3];
-        
-        if(alpha == 0) return;
-        if(alpha!=255)
-        {
-            red = (red * 255)/alpha;
-            green = (green * 255)/alpha;
-            blue = (blue * 255)/alpha;
-        }
-        RGBQUAD pixel = {blue,green, red};
-
-        if (param.a0 == 256){
-            RGBQUAD color = RGBtoHSL(pixel);
-            color.rgbRed= param.hue;
-            color.rgbGreen=param.sat;
-            pixel = HSLtoRGB(color);
-            red = pixel.rgbRed;
-            green = pixel.rgbGreen;
-            blue = pixel.rgbBlue;
-        } else {
-            RGBQUAD color = pixel;
-            RGBQUAD hsl;
-            hsl.rgbRed= param.hue;
-            hsl.rgbGreen=param.sat;
-            hsl.rgbBlue = (BYTE)RGB2GRAY(color.rgbRed,color.rgbGreen,color.rgbBlue);
-            hsl = HSLtoRGB(hsl);
-            red = (BYTE)((hsl.rgbRed * param.a0 + color.rgbRed * param.a1)>>8);
-            green = (BYTE)((hsl.rgbBlue * param.a0 + color.rgbBlue * param.a1)>>8);
-            blue = (BYTE)((hsl.rgbGreen * param.a0 + color.rgbGreen * param.a1)>>8);
-        }
-        if(alpha!=255)
-        {
-            red = (red *alpha)/255;
-            green = (green *alpha)/255;
-            blue = (blue *alpha)/255;
-        }
-        pAbgr[0] = red;
-        pAbgr[1] = green;
-        pAbgr[2] = blue;
-    }
-
     bool SDIBHelper::Colorize(IBitmap * pBmp, COLORREF crRef)
     {
-        RGBQUAD color = RGBtoRGBQUAD(crRef);
-        RGBQUAD hsl = SOUI::RGBtoHSL(color);
-        COLORIZEPARAM param;
-        FillColorizeParam(param,hsl.rgbRed,hsl.rgbGreen,0.8f);
+        LPBYTE pBits = (LPBYTE)pBmp->LockPixelBits();
+        if(!pBits) return false;
 
-        DIBINFO di={(LPBYTE)pBmp->LockPixelBits(),pBmp->Width(),pBmp->Height()};
+        COLORIZELUT lut;
+        SPixelKernels::BuildColorizeLut(lut,crRef);
 
-        bool bRet = false;
-        do 
-        {
-
-            bRet =ColorTransform(&di, ColorizeMode,param);
-
-        } while (false);
-
-        pBmp->UnlockPixelBits(di.pBits);
-        return bRet;
+        SPixelKernels::Colorize(pBits,pBmp->Width()*pBmp->Height(),lut);
+        pBmp->UnlockPixelBits(pBits);
+        return true;
     }
 
     bool SDIBHelper::Colorize(COLORREF & crTarget,COLORREF crRef)
     {
-        RGBQUAD color = RGBtoRGBQUAD(crRef);
-        RGBQUAD hsl = SOUI::RGBtoHSL(color);
-        COLORIZEPARAM param;
-        FillColorizeParam(param,hsl.rgbRed,hsl.rgbGreen,0.8f);
-        
-        ColorizeMode((BYTE*)&crTarget,param);
+        if(((BYTE*)&crTarget)[3] == 0) return true;//alpha为0的颜色不处理
+
+        COLORIZELUT lut;
+        SPixelKernels::BuildColorizeLut(lut,crRef);
+
+        SPixelKernels::Colorize((BYTE*)&crTarget,1,lut);
         return true;
     }   
 
 	bool SDIBHelper::GrayImage(IBitmap * pBmp)
 	{
-	    DIBINFO di={(LPBYTE)pBmp->LockPixelBits(),pBmp->Width(),pBmp->Height()};
-		bool bRet =ColorTransform(&di, GrayMode,0);
-		pBmp->UnlockPixelBits(di.pBits);
-		return bRet;
+	    LPBYTE pBits = (LPBYTE)pBmp->LockPixelBits();
+		if(!pBits) return false;
+		SPixelKernels::Gray(pBits,pBmp->Width()*pBmp->Height());
+		pBmp->UnlockPixelBits(pBits);
+		return true;
 	}
 	
 
@@ -268,24 +52,14 @@ namespace SOUI
         int nWid = rc.right-rc.left;
         int nHei = rc.bottom -rc.top;
         
-        int r=0,g=0,b=0;
+        UINT sum[3]={0};
         for(int y=0;y<nHei;y++)
         {
-            LPBYTE p = pLine + rc.left * 4;
-            for(int x=0;x<nWid;x++)
-            {
-                r += *p++;
-                g += *p++;
-                b += *p++;
-                p++;//skip alpha
-            }
+            SPixelKernels::SumPixels(pLine + rc.left * 4,nWid,sum);
             pLine += di.nWid*4;
         }
-        int nPixels = (nWid*nHei);
-        r /= nPixels;
-        g /= nPixels;
-        b /= nPixels;
-        return RGB(r,g,b);
+        UINT nPixels = (nWid*nHei);
+        return RGB(sum[0]/nPixels,sum[1]/nPixels,sum[2]/nPixels);
     }
     
     int __cdecl RgbCmp(const void *p1,const void *p2)
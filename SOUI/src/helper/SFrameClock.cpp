@@ -0,0 +1,148 @@
+﻿#include "souistd.h"
+#include "helper/SFrameClock.h"
+
+namespace SOUI
+{
+    SFrameClock::SFrameClock(UINT nFrameInterval)
+        :m_nFrameInterval(nFrameInterval?nFrameInterval:1)
+        ,m_nCount(0)
+        ,m_nDispatching(0)
+        ,m_bDirty(FALSE)
+    {
+        ResetStats();
+    }
+
+    void SFrameClock::SetFrameInterval(UINT nFrameInterval)
+    {
+        m_nFrameInterval = nFrameInterval?nFrameInterval:1;
+    }
+
+    void SFrameClock::ResetStats()
+    {
+        memset(&m_stats,0,sizeof(m_stats));
+    }
+
+    int SFrameClock::_Find(ITimelineHandler *pHandler) const
+    {
+        for(size_t i=0;i<m_arrEntries.GetCount();i++)
+        {
+            if(m_arrEntries[i].pHandler == pHandler) return (int)i;
+        }
+        return -1;
+    }
+
+    BOOL SFrameClock::_IsDue(const FRAMEENTRY & entry,DWORD dwNow) const
+    {
+        //系统定时器有误差, 半帧以内到期的handler在本帧调用, 避免为几ms再等一帧
+        return !entry.bSleeping && (LONG)(entry.dwWake - dwNow) <= (LONG)(m_nFrameInterval/2);
+    }
+
+    void SFrameClock::_Schedule(FRAMEENTRY & entry,DWORD dwDelay,DWORD dwNow)
+    {
+        entry.bSleeping = dwDelay == INFINITE;
+        if(entry.bSleeping) return;
+        //两次调用的间隔不小于一帧
+        if(dwDelay < m_nFrameInterval) dwDelay = m_nFrameInterval;
+        entry.dwWake = dwNow + dwDelay;
+    }
+
+    void SFrameClock::_Compact()
+    {
+        size_t j = 0;
+        for(size_t i=0;i<m_arrEntries.GetCount();i++)
+        {
+            if(!m_arrEntries[i].pHandler) continue;
+            if(i != j) m_arrEntries[j] = m_arrEntries[i];
+            j++;
+        }
+        m_arrEntries.RemoveAt(j,m_arrEntries.GetCount()-j);
+        m_bDirty = FALSE;
+    }
+
+    BOOL SFrameClock::Add(ITimelineHandler *pHandler,DWORD dwNow)
+    {
+        if(_Find(pHandler) != -1) return FALSE;
+        FRAMEENTRY entry = {pHandler,dwNow,dwNow,FALSE,FALSE};
+        _Schedule(entry,0,dwNow);
+        m_arrEntries.Add(entry);
+        m_nCount++;
+        return TRUE;
+    }
+
+    BOOL SFrameClock::Remove(ITimelineHandler *pHandler)
+    {
+        int iEntry = _Find(pHandler);
+        if(iEntry == -1) return FALSE;
+        if(m_nDispatching)
+        {//正在派发, 不能移动后面的项
+            m_arrEntries[iEntry].pHandler = NULL;
+            m_bDirty = TRUE;
+        }else
+        {
+            m_arrEntries.RemoveAt(iEntry);
+        }
+        m_nCount--;
+        return TRUE;
+    }
+
+    BOOL SFrameClock::Wake(ITimelineHandler *pHandler,DWORD dwDelay,DWORD dwNow)
+    {
+        int iEntry = _Find(pHandler);
+        if(iEntry == -1) return FALSE;
+        _Schedule(m_arrEntries[iEntry],dwDelay,dwNow);
+        m_arrEntries[iEntry].bWoken = TRUE;
+        return TRUE;
+    }
+
+    DWORD SFrameClock::Tick(DWORD dwNow)
+    {
+        m_stats.nTicks++;
+        UINT nDispatches = m_stats.nDispatches;
+
+        m_nDispatching++;
+        //回调中注册的handler追加在后面, 本帧不调用
+        size_t nEntries = m_arrEntries.GetCount();
+        for(size_t i=0;i<nEntries;i++)
+        {
+            ITimelineHandler *pHandler = m_arrEntries[i].pHandler;
+            if(!pHandler || !_IsDue(m_arrEntries[i],dwNow)) continue;
+            //提前调用时按它请求的时间计算, 避免handler为剩下的几ms再等一帧
+            DWORD dwTime = (LONG)(m_arrEntries[i].dwWake - dwNow) > 0 ? m_arrEntries[i].dwWake : dwNow;
+            DWORD dwElapsed = dwTime - m_arrEntries[i].dwLast;
+            m_arrEntries[i].dwLast = dwTime;
+            m_arrEntries[i].bWoken = FALSE;
+            m_stats.nDispatches++;
+            DWORD dwDelay = pHandler->OnFrame(dwElapsed);
+            //回调中数组可能重新分配, 重新取; handler可能已经注销
+            FRAMEENTRY & entry = m_arrEntries[i];
+            if(entry.pHandler != pHandler) continue;
+            FRAMEENTRY woken = entry;
+            _Schedule(entry,dwDelay,dwTime);
+            if(woken.bWoken && !woken.bSleeping && (entry.bSleeping || (LONG)(woken.dwWake - entry.dwWake) < 0))
+            {//回调中(例如通过RequestNextFrame)请求了更早的时间, 不被返回值覆盖
+                entry.dwWake = woken.dwWake;
+                entry.bSleeping = FALSE;
+            }
+        }
+        m_nDispatching--;
+        if(m_nDispatching == 0 && m_bDirty) _Compact();
+
+        if(m_stats.nDispatches == nDispatches) m_stats.nIdleTicks++;
+        return GetNextDelay(dwNow);
+    }
+
+    DWORD SFrameClock::GetNextDelay(DWORD dwNow) const
+    {
+        DWORD dwRet = INFINITE;
+        for(size_t i=0;i<m_arrEntries.GetCount();i++)
+        {
+            const FRAMEENTRY & entry = m_arrEntries[i];
+            if(!entry.pHandler || entry.bSleeping) continue;
+            if(_IsDue(entry,dwNow)) return 0;
+            DWORD dwDelay = entry.dwWake - dwNow;
+            if(dwDelay < dwRet) dwRet = dwDelay;
+        }
+        return dwRet;
+    }
+
+}//namespace SOUI
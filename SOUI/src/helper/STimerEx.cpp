@@ -12,54 +12,101 @@ namespace SOUI
 //////////////////////////////////////////////////////////////////////////
 template<> STimer2 * SSingleton<STimer2>::ms_Singleton=0;
 
-BOOL STimer2::_SetTimer( SWND swnd,UINT_PTR uTimerID,UINT nElapse )
+STimer2::STimer2()
 {
-    _KillTimer(swnd,uTimerID);
-    UINT_PTR idEvent=::SetTimer(NULL,uTimerID,nElapse,_TimerProc);
-    if(idEvent==0) return FALSE;
-    TIMERINFO ti= {swnd,uTimerID};
-    (*m_mapNamedObj)[idEvent]=ti;
-    return TRUE;
 }
 
-void STimer2::_KillTimer( SWND swnd,UINT_PTR uTimerID )
+STimer2::~STimer2()
 {
-    SPOSITION pos=m_mapNamedObj->GetStartPosition();
+    SPOSITION pos = m_mapThreads.GetStartPosition();
     while(pos)
     {
-        SMap<UINT_PTR,TIMERINFO>::CPair *p=m_mapNamedObj->GetNext(pos);
-        if(p->m_value.Swnd==swnd && p->m_value.uTimerID==uTimerID)
-        {
-            ::KillTimer(NULL,p->m_key);
-            m_mapNamedObj->RemoveAtPos((SPOSITION)p);
-            break;
-        }
+        ThreadTimer *pTimer = m_mapThreads.GetNextValue(pos);
+        //其它线程的线程定时器在线程退出时由系统删除
+        if(pTimer->uHostTimer) ::KillTimer(NULL,pTimer->uHostTimer);
+        delete pTimer;
     }
+    m_mapThreads.RemoveAll();
 }
 
-void STimer2::_KillTimer( SWND Swnd )
+STimer2::ThreadTimer * STimer2::_GetThreadTimer(BOOL bCreate)
 {
-    SPOSITION pos=m_mapNamedObj->GetStartPosition();
-    while(pos)
+    DWORD dwThreadId = GetCurrentThreadId();
+    SAutoLock lock(m_cs);
+    const SMap<DWORD,ThreadTimer*>::CPair *p = m_mapThreads.Lookup(dwThreadId);
+    if(p) return p->m_value;
+    if(!bCreate) return NULL;
+    ThreadTimer *pTimer = new ThreadTimer;
+    m_mapThreads[dwThreadId] = pTimer;
+    return pTimer;
+}
+
+BOOL STimer2::_ArmHostTimer(ThreadTimer *pTimer,BOOL bForce)
+{
+    DWORD dwNow = GetTickCount();
+    DWORD dwDelay = pTimer->wheel.GetNextDelay(dwNow);
+    if(dwDelay == INFINITE)
     {
-        SMap<UINT_PTR,TIMERINFO>::CPair *p=m_mapNamedObj->GetNext(pos);
-        if(p->m_value.Swnd==Swnd)
-        {
-            ::KillTimer(NULL,p->m_key);
-            m_mapNamedObj->RemoveAtPos((SPOSITION)p);
-        }
+        if(pTimer->uHostTimer) ::KillTimer(NULL,pTimer->uHostTimer);
+        pTimer->uHostTimer = 0;
+        return TRUE;
     }
+    DWORD dwDue = dwNow + dwDelay;
+    //已经设置的系统定时器更早触发, 到时再重新计算
+    if(!bForce && pTimer->uHostTimer && (LONG)(dwDue - pTimer->dwHostDue) >= 0) return TRUE;
+
+    //线程定时器传入本线程已有的ID时替换原来的定时器
+    UINT_PTR uTimer = ::SetTimer(NULL,pTimer->uHostTimer,dwDelay,_TimerProc);
+    if(uTimer == 0) return FALSE;
+    pTimer->uHostTimer = uTimer;
+    pTimer->dwHostDue = dwDue;
+    return TRUE;
 }
 
+BOOL STimer2::_SetTimer( SWND swnd,UINT_PTR uTimerID,UINT nElapse )
+{
+    ThreadTimer *pTimer = _GetThreadTimer(TRUE);
+    pTimer->wheel.SetTimer(swnd,uTimerID,nElapse,GetTickCount());
+    if(_ArmHostTimer(pTimer,FALSE)) return TRUE;
+    pTimer->wheel.KillTimer(swnd,uTimerID);
+    return FALSE;
+}
+
+void STimer2::_KillTimer( SWND swnd,UINT_PTR uTimerID )
+{
+    //系统定时器不需要调整, 提前触发时重新计算
+    ThreadTimer *pTimer = _GetThreadTimer(FALSE);
+    if(pTimer) pTimer->wheel.KillTimer(swnd,uTimerID);
+}
+
+void STimer2::_KillTimer( SWND Swnd )
+{
+    ThreadTimer *pTimer = _GetThreadTimer(FALSE);
+    if(pTimer) pTimer->wheel.KillTimer(Swnd);
+}
+
+void STimer2::_OnTimer( SWND swnd,UINT_PTR uTimerID )
+{
+    SWindow *pSwnd=SWindowMgr::GetWindow(swnd);
+    if(pSwnd) pSwnd->SSendMessage(WM_TIMER2,uTimerID);
+}
 
 VOID CALLBACK STimer2::_TimerProc( HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime )
 {
-    TIMERINFO ti;
-    if(getSingleton().GetKeyObject(idEvent,ti))
+    STimer2 & timer = getSingleton();
+    ThreadTimer *pTimer = timer._GetThreadTimer(FALSE);
+    if(!pTimer) return;
+    SArray<TIMERINFO> lstFired;
+    pTimer->wheel.Advance(GetTickCount(),lstFired);
+    timer._ArmHostTimer(pTimer,TRUE);
+
+    for(size_t i=0;i<lstFired.GetCount();i++)
     {
-        SWindow *pSwnd=SWindowMgr::GetWindow(ti.Swnd);
-        if(pSwnd) pSwnd->SSendMessage(WM_TIMER2,ti.uTimerID);
+        const TIMERINFO & ti = lstFired[i];
+        //前面的定时器消息中可能删除了后面的定时器或者窗口
+        if(!pTimer->wheel.HasTimer(ti.Swnd,ti.uTimerID)) continue;
+        timer._OnTimer(ti.Swnd,ti.uTimerID);
     }
 }
 
-}//namespace SOUI
\ No newline at end of file
+}//namespace SOUI
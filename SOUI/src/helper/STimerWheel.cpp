@@ -0,0 +1,318 @@
+﻿#include "souistd.h"
+#include "helper/STimerWheel.h"
+
+namespace SOUI
+{
+    struct TimerNode
+    {
+        SWND        swnd;
+        UINT_PTR    uTimerID;
+        UINT        nElapse;
+        ULONGLONG   llExpire;       //到期的tick
+        int         iLevel;
+        int         iSlot;
+        TimerNode * pPrev;          //槽内的双向链表
+        TimerNode * pNext;
+        TimerNode * pOwnerPrev;     //同一个窗口的定时器
+        TimerNode * pOwnerNext;
+    };
+
+    STimerWheel::STimerWheel(DWORD dwNow,UINT nTickMs)
+        :m_nTickMs(nTickMs?nTickMs:1)
+        ,m_dwLastNow(dwNow)
+        ,m_llNowMs(dwNow)
+        ,m_nCount(0)
+    {
+        m_llCurTick = _NowTick();
+        memset(m_nLevelCount,0,sizeof(m_nLevelCount));
+        memset(m_level0,0,sizeof(m_level0));
+        memset(m_levelN,0,sizeof(m_levelN));
+    }
+
+    STimerWheel::~STimerWheel()
+    {
+        SPOSITION pos = m_mapOwners.GetStartPosition();
+        while(pos)
+        {
+            TimerNode *pNode = m_mapOwners.GetNextValue(pos);
+            while(pNode)
+            {
+                TimerNode *pNext = pNode->pOwnerNext;
+                delete pNode;
+                pNode = pNext;
+            }
+        }
+    }
+
+    void STimerWheel::_SyncClock(DWORD dwNow)
+    {
+        //GetTickCount回绕后差值仍然正确, 时间倒退时忽略
+        LONG lDelta = (LONG)(dwNow - m_dwLastNow);
+        if(lDelta <= 0) return;
+        m_llNowMs += (DWORD)lDelta;
+        m_dwLastNow = dwNow;
+    }
+
+    ULONGLONG STimerWheel::_NowTick() const
+    {
+        return m_llNowMs/m_nTickMs;
+    }
+
+    TimerNode * STimerWheel::_FindNode(SWND swnd,UINT_PTR uTimerID) const
+    {
+        const SMap<SWND,TimerNode*>::CPair *p = m_mapOwners.Lookup(swnd);
+        if(!p) return NULL;
+        for(TimerNode *pNode = p->m_value; pNode; pNode = pNode->pOwnerNext)
+        {
+            if(pNode->uTimerID == uTimerID) return pNode;
+        }
+        return NULL;
+    }
+
+    void STimerWheel::_Schedule(TimerNode *pNode)
+    {
+        ULONGLONG llExpire = pNode->llExpire;
+        if(llExpire < m_llCurTick) llExpire = m_llCurTick;
+        ULONGLONG llDelta = llExpire - m_llCurTick;
+
+        int iLevel,iSlot;
+        if(llDelta < KLevel0Size)
+        {
+            iLevel = 0;
+            iSlot = (int)(llExpire & (KLevel0Size-1));
+        }else
+        {
+            //超出时间轮范围的放在最高层的最远处, 下放时重新计算
+            const ULONGLONG llMaxDelta = (((ULONGLONG)1)<<(KLevel0Bits+KLevelNBits*(KLevels-1))) - 1;
+            if(llDelta > llMaxDelta)
+            {
+                llDelta = llMaxDelta;
+                llExpire = m_llCurTick + llMaxDelta;
+            }
+            int nShift = KLevel0Bits;
+            iLevel = 1;
+            while(llDelta >= (((ULONGLONG)1)<<(nShift+KLevelNBits)))
+            {
+                iLevel++;
+                nShift += KLevelNBits;
+            }
+            iSlot = (int)((llExpire>>nShift) & (KLevelNSize-1));
+        }
+
+        TimerNode **ppHead = _GetSlot(iLevel,iSlot);
+        pNode->iLevel = iLevel;
+        pNode->iSlot = iSlot;
+        pNode->pPrev = NULL;
+        pNode->pNext = *ppHead;
+        if(*ppHead) (*ppHead)->pPrev = pNode;
+        *ppHead = pNode;
+        m_nLevelCount[iLevel]++;
+    }
+
+    void STimerWheel::_Unschedule(TimerNode *pNode)
+    {
+        if(pNode->pPrev) pNode->pPrev->pNext = pNode->pNext;
+        else *_GetSlot(pNode->iLevel,pNode->iSlot) = pNode->pNext;
+        if(pNode->pNext) pNode->pNext->pPrev = pNode->pPrev;
+        pNode->pPrev = pNode->pNext = NULL;
+        m_nLevelCount[pNode->iLevel]--;
+    }
+
+    void STimerWheel::_Cascade(int iLevel,int iSlot)
+    {
+        //先摘下整个槽, 重新插入时可能回到同一个槽
+        TimerNode **ppHead = _GetSlot(iLevel,iSlot);
+        TimerNode *pNode = *ppHead;
+        *ppHead = NULL;
+        while(pNode)
+        {
+            TimerNode *pNext = pNode->pNext;
+            m_nLevelCount[iLevel]--;
+            _Schedule(pNode);
+            pNode = pNext;
+        }
+    }
+
+    void STimerWheel::_FreeNode(TimerNode *pNode)
+    {
+        if(pNode->pOwnerPrev)
+        {
+            pNode->pOwnerPrev->pOwnerNext = pNode->pOwnerNext;
+        }else if(pNode->pOwnerNext)
+        {
+            m_mapOwners[pNode->swnd] = pNode->pOwnerNext;
+        }else
+        {
+            m_mapOwners.RemoveKey(pNode->swnd);
+        }
+        if(pNode->pOwnerNext) pNode->pOwnerNext->pOwnerPrev = pNode->pOwnerPrev;
+        _Unschedule(pNode);
+        delete pNode;
+        m_nCount--;
+    }
+
+    void STimerWheel::SetTimer(SWND swnd,UINT_PTR uTimerID,UINT nElapse,DWORD dwNow)
+    {
+        _SyncClock(dwNow);
+        TimerNode *pNode = _FindNode(swnd,uTimerID);
+        if(pNode)
+        {
+            _Unschedule(pNode);
+        }else
+        {
+            pNode = new TimerNode;
+            pNode->swnd = swnd;
+            pNode->uTimerID = uTimerID;
+            pNode->pOwnerPrev = NULL;
+            SMap<SWND,TimerNode*>::CPair *p = m_mapOwners.Lookup(swnd);
+            pNode->pOwnerNext = p?p->m_value:NULL;
+            if(pNode->pOwnerNext) pNode->pOwnerNext->pOwnerPrev = pNode;
+            m_mapOwners[swnd] = pNode;
+            m_nCount++;
+        }
+        pNode->nElapse = nElapse;
+        //向上取整到tick, 同一个tick内到期的定时器一起处理
+        pNode->llExpire = (m_llNowMs + nElapse + m_nTickMs - 1)/m_nTickMs;
+        _Schedule(pNode);
+    }
+
+    BOOL STimerWheel::KillTimer(SWND swnd,UINT_PTR uTimerID)
+    {
+        TimerNode *pNode = _FindNode(swnd,uTimerID);
+        if(!pNode) return FALSE;
+        _FreeNode(pNode);
+        return TRUE;
+    }
+
+    int STimerWheel::KillTimer(SWND swnd)
+    {
+        SMap<SWND,TimerNode*>::CPair *p = m_mapOwners.Lookup(swnd);
+        if(!p) return 0;
+        TimerNode *pNode = p->m_value;
+        m_mapOwners.RemoveKey(swnd);
+        int nKilled = 0;
+        while(pNode)
+        {
+            TimerNode *pNext = pNode->pOwnerNext;
+            _Unschedule(pNode);
+            delete pNode;
+            nKilled++;
+            pNode = pNext;
+        }
+        m_nCount -= nKilled;
+        return nKilled;
+    }
+
+    BOOL STimerWheel::HasTimer(SWND swnd,UINT_PTR uTimerID) const
+    {
+        return _FindNode(swnd,uTimerID) != NULL;
+    }
+
+    int STimerWheel::Advance(DWORD dwNow,SArray<TIMERINFO> & lstFired)
+    {
+        _SyncClock(dwNow);
+        ULONGLONG llNowTick = _NowTick();
+
+        //到期的定时器按顺序串起来, 全部取出后再重新计时
+        TimerNode *pHead = NULL, *pTail = NULL;
+        while(m_llCurTick <= llNowTick)
+        {
+            if(m_nCount == 0)
+            {
+                m_llCurTick = llNowTick + 1;
+                break;
+            }
+            int iIndex = (int)(m_llCurTick & (KLevel0Size-1));
+            if(iIndex == 0)
+            {//第0层转完一圈, 把高层对应的槽下放
+                int nShift = KLevel0Bits;
+                for(int iLevel = 1; iLevel < KLevels; iLevel++)
+                {
+                    int iSlot = (int)((m_llCurTick>>nShift) & (KLevelNSize-1));
+                    _Cascade(iLevel,iSlot);
+                    if(iSlot != 0) break;
+                    nShift += KLevelNBits;
+                }
+            }
+            if(m_nLevelCount[0] == 0)
+            {//第0层为空, 直接跳到下一次下放
+                ULONGLONG llNext = (m_llCurTick | (KLevel0Size-1)) + 1;
+                m_llCurTick = llNext<llNowTick+1?llNext:llNowTick+1;
+                continue;
+            }
+            TimerNode *pNode = m_level0[iIndex];
+            m_level0[iIndex] = NULL;
+            while(pNode)
+            {
+                TimerNode *pNext = pNode->pNext;
+                m_nLevelCount[0]--;
+                pNode->pPrev = pTail;
+                pNode->pNext = NULL;
+                if(pTail) pTail->pNext = pNode;
+                else pHead = pNode;
+                pTail = pNode;
+                pNode = pNext;
+            }
+            m_llCurTick++;
+        }
+
+        int nFired = 0;
+        while(pHead)
+        {
+            TimerNode *pNext = pHead->pNext;
+            TIMERINFO ti = {pHead->swnd,pHead->uTimerID};
+            lstFired.Add(ti);
+            nFired++;
+            //周期定时器从当前时间重新计时, 不补发错过的周期
+            pHead->llExpire = (m_llNowMs + pHead->nElapse + m_nTickMs - 1)/m_nTickMs;
+            _Schedule(pHead);
+            pHead = pNext;
+        }
+        return nFired;
+    }
+
+    DWORD STimerWheel::GetNextDelay(DWORD dwNow)
+    {
+        _SyncClock(dwNow);
+        if(m_nCount == 0) return INFINITE;
+
+        //高层的定时器不会早于它所在的槽下放的时间, 下放时需要唤醒一次
+        const ULONGLONG llNone = (ULONGLONG)-1;
+        ULONGLONG llNext = llNone;
+        int nShift = KLevel0Bits;
+        for(int iLevel = 1; iLevel < KLevels; iLevel++, nShift += KLevelNBits)
+        {
+            if(m_nLevelCount[iLevel] == 0) continue;
+            //第iLevel层的槽在tick对齐到1<<nShift时下放
+            ULONGLONG llBlock = (m_llCurTick + (((ULONGLONG)1)<<nShift) - 1) >> nShift;
+            for(int i = 0; i < KLevelNSize; i++, llBlock++)
+            {
+                ULONGLONG llTick = llBlock << nShift;
+                if(llTick >= llNext) break;
+                if(m_levelN[iLevel-1][llBlock & (KLevelNSize-1)])
+                {
+                    llNext = llTick;
+                    break;
+                }
+            }
+        }
+        if(m_nLevelCount[0])
+        {
+            for(ULONGLONG llTick = m_llCurTick; llTick < m_llCurTick + KLevel0Size && llTick < llNext; llTick++)
+            {
+                if(m_level0[llTick & (KLevel0Size-1)])
+                {
+                    llNext = llTick;
+                    break;
+                }
+            }
+        }
+        SASSERT(llNext != llNone);
+
+        ULONGLONG llDue = llNext * m_nTickMs;
+        if(llDue <= m_llNowMs) return 0;
+        ULONGLONG llDelay = llDue - m_llNowMs;
+        return llDelay < INFINITE ? (DWORD)llDelay : INFINITE - 1;
+    }
+
+}//namespace SOUI
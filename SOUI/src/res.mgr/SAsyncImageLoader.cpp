@@ -0,0 +1,359 @@
+﻿#include "souistd.h"
+#include "res.mgr/SAsyncImageLoader.h"
+#include "helper/mybuffer.h"
+#include "helper/SplitString.h"
+#include <process.h>
+
+namespace SOUI
+{
+    template<> SAsyncImageLoader * SSingleton<SAsyncImageLoader>::ms_Singleton = 0;
+
+    const int KMaxDecodeThreads = 16;
+
+    struct AsyncImageJob
+    {
+        SStringW strImgID;
+        SStringT strType;
+        SStringT strName;
+        SList<AsyncImageReq> lstReq;   //合并到这个任务的请求
+        CAutoRefPtr<IImgX> pImgX;      //解码结果
+        CAutoRefPtr<IBitmap> pImg;     //缓存中找到的图片
+        BOOL bQueued;                  //还在等待解码
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    //在UI线程中接收解码完成的任务
+    class SAsyncImageReceiver : public CSimpleWnd
+    {
+    public:
+        enum{
+            UM_IMAGEDECODED = (WM_USER+1001)
+        };
+
+        SAsyncImageReceiver(SAsyncImageLoader * pLoader) :m_pLoader(pLoader)
+        {
+        }
+
+        LRESULT OnImageDecoded(UINT uMsg,WPARAM wParam,LPARAM lParam)
+        {
+            m_pLoader->OnJobDone((AsyncImageJob*)lParam);
+            return 0;
+        }
+
+        BEGIN_MSG_MAP_EX(SAsyncImageReceiver)
+            MESSAGE_HANDLER_EX(UM_IMAGEDECODED, OnImageDecoded)
+        END_MSG_MAP()
+
+    protected:
+        SAsyncImageLoader * m_pLoader;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    SAsyncImageLoader::SAsyncImageLoader(int nThreads)
+        :m_nThreads(0)
+        ,m_bExit(0)
+        ,m_dwNextReqID(1)
+    {
+        SetThreadCount(nThreads);
+        m_hSemJob = CreateSemaphore(NULL,0,MAXLONG,NULL);
+        m_pReceiver = new SAsyncImageReceiver(this);
+        m_pReceiver->Create(_T("AsyncImageReceiver"),WS_POPUP,0,0,0,0,0,HWND_MESSAGE,0);
+        SASSERT(m_pReceiver->IsWindow());
+    }
+
+    SAsyncImageLoader::~SAsyncImageLoader()
+    {
+        InterlockedExchange(&m_bExit,1);
+        if(m_lstThreads.GetCount())
+        {
+            ReleaseSemaphore(m_hSemJob,(LONG)m_lstThreads.GetCount(),NULL);
+            WaitForMultipleObjects((DWORD)m_lstThreads.GetCount(),m_lstThreads.GetData(),TRUE,INFINITE);
+            for(size_t i=0;i<m_lstThreads.GetCount();i++)
+            {
+                CloseHandle(m_lstThreads[i]);
+            }
+            m_lstThreads.RemoveAll();
+        }
+        CloseHandle(m_hSemJob);
+
+        //窗口销毁后还没有处理的完成消息被丢弃, 任务统一在这里释放
+        m_pReceiver->DestroyWindow();
+        delete m_pReceiver;
+        m_pReceiver = NULL;
+
+        SPOSITION pos = m_mapJobs.GetStartPosition();
+        while(pos)
+        {
+            delete m_mapJobs.GetNextValue(pos);
+        }
+        m_mapJobs.RemoveAll();
+        m_lstQueue.RemoveAll();
+    }
+
+    int SAsyncImageLoader::SetThreadCount(int nThreads)
+    {
+        if(nThreads < 1) nThreads = 1;
+        if(nThreads > KMaxDecodeThreads) nThreads = KMaxDecodeThreads;
+
+        SAutoLock lock(m_cs);
+        if(m_lstThreads.IsEmpty())
+        {
+            m_nThreads = nThreads;
+        }else if(nThreads > m_nThreads)
+        {
+            m_nThreads = nThreads;
+            _StartThreads();
+        }
+        return m_nThreads;
+    }
+
+    void SAsyncImageLoader::_StartThreads()
+    {
+        while((int)m_lstThreads.GetCount() < m_nThreads)
+        {
+            HANDLE hThread = (HANDLE)_beginthreadex(NULL,0,WorkThread,this,0,NULL);
+            if(!hThread) break;
+            m_lstThreads.Add(hThread);
+        }
+    }
+
+    DWORD SAsyncImageLoader::LoadImage(const SStringW & strImgID,IAsyncImageCallback * pCallback)
+    {
+        if(!pCallback) return 0;
+
+        SStringTList strLst;
+        if(ParseResID(S_CW2T(strImgID),strLst) != 2) return 0;
+
+        SAutoLock lock(m_cs);
+        AsyncImageReq req = {m_dwNextReqID++,pCallback};
+        if(m_dwNextReqID == 0) m_dwNextReqID = 1;
+
+        SStringW strKey = strImgID;
+        strKey.MakeLower();
+        SMap<SStringW,AsyncImageJob*>::CPair *p = m_mapJobs.Lookup(strKey);
+        if(p)
+        {//同一个图片正在加载, 合并请求
+            p->m_value->lstReq.AddTail(req);
+            return req.dwReqID;
+        }
+
+        AsyncImageJob *pJob = new AsyncImageJob;
+        pJob->strImgID = strImgID;
+        pJob->strType = strLst[0];
+        pJob->strName = strLst[1];
+        pJob->lstReq.AddTail(req);
+        m_mapJobs[strKey] = pJob;
+
+        IBitmap *pImg = SApplication::getSingleton().FindCachedImage(pJob->strType,pJob->strName,100);
+        if(pImg)
+        {//已经在图片缓存中, 不需要解码, 仍然异步回调
+            pJob->pImg.Attach(pImg);
+            pJob->bQueued = FALSE;
+            m_pReceiver->PostMessage(SAsyncImageReceiver::UM_IMAGEDECODED,0,(LPARAM)pJob);
+            return req.dwReqID;
+        }
+
+        pJob->bQueued = TRUE;
+        m_lstQueue.AddTail(pJob);
+
+        _StartThreads();
+        ReleaseSemaphore(m_hSemJob,1,NULL);
+        return req.dwReqID;
+    }
+
+    BOOL SAsyncImageLoader::Cancel(DWORD dwReqID)
+    {
+        SAutoLock lock(m_cs);
+        SPOSITION pos = m_lstDelivering.GetHeadPosition();
+        while(pos)
+        {
+            SPOSITION posCur = pos;
+            if(m_lstDelivering.GetNext(pos).dwReqID == dwReqID)
+            {
+                m_lstDelivering.RemoveAt(posCur);
+                return TRUE;
+            }
+        }
+
+        pos = m_mapJobs.GetStartPosition();
+        while(pos)
+        {
+            AsyncImageJob *pJob = m_mapJobs.GetNextValue(pos);
+            SPOSITION posReq = pJob->lstReq.GetHeadPosition();
+            while(posReq)
+            {
+                SPOSITION posCur = posReq;
+                if(pJob->lstReq.GetNext(posReq).dwReqID == dwReqID)
+                {
+                    pJob->lstReq.RemoveAt(posCur);
+                    if(pJob->lstReq.IsEmpty() && pJob->bQueued)
+                    {//还没有开始解码, 直接删除任务
+                        _RemoveJob(pJob);
+                    }
+                    return TRUE;
+                }
+            }
+        }
+        return FALSE;
+    }
+
+    int SAsyncImageLoader::CancelAll(IAsyncImageCallback * pCallback)
+    {
+        SAutoLock lock(m_cs);
+        int nRet = 0;
+        SPOSITION pos = m_lstDelivering.GetHeadPosition();
+        while(pos)
+        {
+            SPOSITION posCur = pos;
+            if(m_lstDelivering.GetNext(pos).pCallback == pCallback)
+            {
+                m_lstDelivering.RemoveAt(posCur);
+                nRet++;
+            }
+        }
+
+        SList<AsyncImageJob*> lstEmpty;
+        pos = m_mapJobs.GetStartPosition();
+        while(pos)
+        {
+            AsyncImageJob *pJob = m_mapJobs.GetNextValue(pos);
+            SPOSITION posReq = pJob->lstReq.GetHeadPosition();
+            while(posReq)
+            {
+                SPOSITION posCur = posReq;
+                if(pJob->lstReq.GetNext(posReq).pCallback == pCallback)
+                {
+                    pJob->lstReq.RemoveAt(posCur);
+                    nRet++;
+                }
+            }
+            if(pJob->lstReq.IsEmpty() && pJob->bQueued)
+                lstEmpty.AddTail(pJob);
+        }
+        pos = lstEmpty.GetHeadPosition();
+        while(pos)
+        {
+            _RemoveJob(lstEmpty.GetNext(pos));
+        }
+        return nRet;
+    }
+
+    int SAsyncImageLoader::GetPendingCount()
+    {
+        SAutoLock lock(m_cs);
+        return (int)m_mapJobs.GetCount();
+    }
+
+    //调用前需要锁定m_cs
+    void SAsyncImageLoader::_RemoveJob(AsyncImageJob *pJob)
+    {
+        SStringW strKey = pJob->strImgID;
+        strKey.MakeLower();
+        m_mapJobs.RemoveKey(strKey);
+        if(pJob->bQueued)
+        {
+            SPOSITION pos = m_lstQueue.Find(pJob);
+            if(pos) m_lstQueue.RemoveAt(pos);
+        }
+        delete pJob;
+    }
+
+    void SAsyncImageLoader::_DecodeJob(AsyncImageJob *pJob)
+    {
+        SApplication *pApp = SApplication::getSingletonPtr();
+        size_t szBuf = pApp->GetRawBufferSize(pJob->strType,pJob->strName);
+        if(szBuf == 0) return;
+
+        CMyBuffer<BYTE> buf(szBuf);
+        if(!pApp->GetRawBuffer(pJob->strType,pJob->strName,buf,szBuf)) return;
+
+        CAutoRefPtr<IImgX> pImgX;
+        pApp->GetRenderFactory()->GetImgDecoderFactory()->CreateImgX(&pImgX);
+        if(pImgX && pImgX->LoadFromMemory(buf,szBuf) > 0)
+        {
+            pJob->pImgX = pImgX;
+        }
+    }
+
+    unsigned int SAsyncImageLoader::WorkThread(void *pParam)
+    {
+        SAsyncImageLoader *pThis = (SAsyncImageLoader*)pParam;
+        //WIC解码器需要初始化COM
+        HRESULT hrCom = CoInitializeEx(NULL,COINIT_MULTITHREADED);
+        for(;;)
+        {
+            WaitForSingleObject(pThis->m_hSemJob,INFINITE);
+            if(pThis->m_bExit) break;
+
+            AsyncImageJob *pJob = NULL;
+            {
+                SAutoLock lock(pThis->m_cs);
+                if(pThis->m_lstQueue.IsEmpty()) continue;//任务已经被取消
+                pJob = pThis->m_lstQueue.RemoveHead();
+                pJob->bQueued = FALSE;
+            }
+
+            //任务离开队列后只有OnJobDone会删除它, 解码不需要加锁
+            pThis->_DecodeJob(pJob);
+            pThis->m_pReceiver->PostMessage(SAsyncImageReceiver::UM_IMAGEDECODED,0,(LPARAM)pJob);
+        }
+        if(SUCCEEDED(hrCom)) CoUninitialize();
+        return 0;
+    }
+
+    void SAsyncImageLoader::OnJobDone(AsyncImageJob *pJob)
+    {
+        CAutoRefPtr<IImgX> pImgX;
+        CAutoRefPtr<IBitmap> pImg;
+        SStringW strImgID = pJob->strImgID;
+        SStringT strType = pJob->strType, strName = pJob->strName;
+        SList<DWORD> lstReqID;
+        {
+            SAutoLock lock(m_cs);
+            SPOSITION pos = pJob->lstReq.GetHeadPosition();
+            while(pos)
+            {
+                const AsyncImageReq & req = pJob->lstReq.GetNext(pos);
+                m_lstDelivering.AddTail(req);
+                lstReqID.AddTail(req.dwReqID);
+            }
+            pImgX = pJob->pImgX;
+            pImg = pJob->pImg;
+            _RemoveJob(pJob);
+        }
+        if(lstReqID.IsEmpty()) return;//所有请求都被取消了
+
+        if(!pImg && pImgX)
+        {
+            GETRENDERFACTORY->CreateBitmap(&pImg);
+            if(pImg && FAILED(pImg->Init(pImgX->GetFrame(0))))
+            {
+                pImg = NULL;
+            }
+            if(pImg) SApplication::getSingleton().AddCachedImage(strType,strName,100,pImg);
+        }
+
+        //回调中可能取消其它请求或者销毁其它回调对象, 每次回调前重新从m_lstDelivering中取出请求
+        SPOSITION posID = lstReqID.GetHeadPosition();
+        while(posID)
+        {
+            DWORD dwReqID = lstReqID.GetNext(posID);
+            AsyncImageReq req = {0,NULL};
+            {
+                SAutoLock lock(m_cs);
+                SPOSITION pos = m_lstDelivering.GetHeadPosition();
+                while(pos)
+                {
+                    SPOSITION posCur = pos;
+                    if(m_lstDelivering.GetNext(pos).dwReqID == dwReqID)
+                    {
+                        req = m_lstDelivering.GetAt(posCur);
+                        m_lstDelivering.RemoveAt(posCur);
+                        break;
+                    }
+                }
+            }
+            if(req.pCallback) req.pCallback->OnAsyncImageLoaded(req.dwReqID,strImgID,pImg);
+        }
+    }
+}
@@ -16,35 +16,178 @@ template<> SFontPool* SSingleton<SFontPool>::ms_Singleton    = 0;
 
 SFontPool::SFontPool(IRenderFactory *pRendFactory)
     :m_RenderFactory(pRendFactory)
+    ,m_uUseSeq(0)
+    ,m_nMaxFonts(0)
+    ,m_nBytes(0)
+    ,m_nHit(0)
+    ,m_nMiss(0)
+    ,m_nEvicted(0)
 {
     m_pFunOnKeyRemoved=OnKeyRemoved;
+    m_descCacheDefFont.dwStyle = 0;
 }
 
+SFontPool::~SFontPool()
+{
+    m_mapDescCache.RemoveAll();
+    RemoveAll();
+}
 
-IFontPtr SFontPool::GetFont(FONTSTYLE style, const SStringW & fontFaceName,pugi::xml_node xmlExProp)
+static SStringT XmlPropToString(pugi::xml_node xmlExProp)
 {
-	IFontPtr hftRet=0;
+	pugi::xml_writer_buff writer;
+	xmlExProp.print(writer,L"\t",pugi::format_default,pugi::encoding_utf16);
+	return S_CW2T(SStringW(writer.buffer(),writer.size()));
+}
 
+IFontPtr SFontPool::GetFont(FONTSTYLE style, const SStringW & fontFaceName,pugi::xml_node xmlExProp)
+{
 	SStringT strFace = S_CW2T(fontFaceName);
 	if(strFace.IsEmpty()) strFace = GetDefFontInfo().strFaceName;
 	
-	pugi::xml_writer_buff writer;
-	xmlExProp.print(writer,L"\t",pugi::format_default,pugi::encoding_utf16);
-	SStringT strXmlProp= S_CW2T(SStringW(writer.buffer(),writer.size()));
-
-	FontInfo info = {style.dwStyle,strFace,strXmlProp};
+	FontInfo info = {style.dwStyle,strFace,XmlPropToString(xmlExProp)};
+	return _GetFont(info,xmlExProp);
+}
 
+IFontPtr SFontPool::_GetFont(const FontInfo & info,pugi::xml_node xmlExProp)
+{
+	IFontPtr hftRet=0;
 	if(HasKey(info))
 	{
 		hftRet=GetKeyObject(info);
+		_TouchFont(hftRet);
+		m_nHit++;
 	}
 	else
 	{
 		hftRet = _CreateFont(info.dwStyle,info.strFaceName,xmlExProp);
+		if(!hftRet) return NULL;
 		AddKeyObject(info,hftRet);
+
+		FontUsage usage;
+		usage.key = info;
+		usage.uLastUse = ++m_uUseSeq;
+		usage.cbSize = _MeasureFont(info);
+		m_mapUsage[hftRet] = usage;
+		m_nBytes += usage.cbSize;
+		m_nMiss++;
+
+		//新建的字体要返回给调用者，淘汰时排除它
+		if(m_nMaxFonts && GetCount()>m_nMaxFonts)
+			_Trim(m_nMaxFonts - m_nMaxFonts/4,hftRet);
 	}
 	return hftRet;
+}
+
+void SFontPool::_TouchFont(IFontPtr pFont)
+{
+    SMap<IFontPtr,FontUsage>::CPair *p = m_mapUsage.Lookup(pFont);
+    if(p) p->m_value.uLastUse = ++m_uUseSeq;
+}
+
+bool SFontPool::_IsFontIdle(IFontPtr pFont)
+{
+    //只有字体池持有的字体才能被淘汰
+    long cRef = pFont->AddRef();
+    pFont->Release();
+    return cRef == 2;
+}
+
+//key在字体表和使用记录中各保存一份, 每个字体对象保存一个LOGFONT
+UINT SFontPool::_MeasureFont(const FontInfo & info)
+{
+    UINT cbKey = sizeof(FontInfo) + (info.strFaceName.GetLength()+info.strPropEx.GetLength()+2)*sizeof(TCHAR);
+    return cbKey*2 + sizeof(FontUsage) - sizeof(FontInfo) + sizeof(IFontPtr) + sizeof(LOGFONT);
+}
+
+struct FontLastUse
+{
+    ULONGLONG uLastUse;
+    IFontPtr  pFont;
+};
+
+static int __cdecl CompareLastUse(const void *p1,const void *p2)
+{
+    const FontLastUse *pUse1 = (const FontLastUse*)p1;
+    const FontLastUse *pUse2 = (const FontLastUse*)p2;
+    if(pUse1->uLastUse < pUse2->uLastUse) return -1;
+    if(pUse1->uLastUse > pUse2->uLastUse) return 1;
+    return 0;
+}
+
+UINT SFontPool::Trim(UINT nMaxFonts)
+{
+    return _Trim(nMaxFonts,NULL);
+}
+
+UINT SFontPool::_Trim(UINT nMaxFonts,IFontPtr pKeep)
+{
+    if(GetCount()<=nMaxFonts) return 0;
+
+    SArray<FontLastUse> lstIdle;
+    SPOSITION pos = m_mapUsage.GetStartPosition();
+    while(pos)
+    {
+        SMap<IFontPtr,FontUsage>::CPair *p = m_mapUsage.GetNext(pos);
+        if(p->m_key == pKeep || !_IsFontIdle(p->m_key)) continue;
+        FontLastUse lastUse = {p->m_value.uLastUse,p->m_key};
+        lstIdle.Add(lastUse);
+    }
+    qsort(lstIdle.GetData(),lstIdle.GetCount(),sizeof(FontLastUse),CompareLastUse);
+
+    UINT nRemoved = 0;
+    for(size_t i=0;i<lstIdle.GetCount() && GetCount()>nMaxFonts;i++)
+    {
+        FontInfo key = m_mapUsage[lstIdle[i].pFont].key;
+        RemoveKeyObject(key);
+        nRemoved++;
+    }
+    m_nEvicted += nRemoved;
+    return nRemoved;
+}
+
+void SFontPool::SetMaxFonts(UINT nMaxFonts)
+{
+    m_nMaxFonts = nMaxFonts;
+    if(m_nMaxFonts) Trim(m_nMaxFonts);
+}
+
+void SFontPool::GetStat(FONTPOOLSTAT *pStat) const
+{
+    pStat->nFonts = (UINT)m_mapNamedObj->GetCount();
+    pStat->nBytes = m_nBytes;
+    pStat->nHit = m_nHit;
+    pStat->nMiss = m_nMiss;
+    pStat->nEvicted = m_nEvicted;
+}
+
+void SFontPool::_OnFontRemoved(IFontPtr pFont)
+{
+    SMap<IFontPtr,FontUsage>::CPair *pUsage = m_mapUsage.Lookup(pFont);
+    if(pUsage)
+    {
+        m_nBytes -= pUsage->m_value.cbSize;
+        m_mapUsage.RemoveKey(pFont);
+    }
 
+    //保留解析结果，只清除字体对象
+    SPOSITION pos = m_mapDescCache.GetStartPosition();
+    while(pos)
+    {
+        SMap<FontDescKey,FontDescInfo>::CPair *p = m_mapDescCache.GetNext(pos);
+        if(p->m_value.pFont == pFont) p->m_value.pFont = NULL;
+    }
+}
+
+void SFontPool::_ValidateDescCache()
+{
+    //解析结果依赖默认字体，默认字体变化后需要重新解析
+    const FontInfo & defFont = GetDefFontInfo();
+    if(defFont.dwStyle == m_descCacheDefFont.dwStyle 
+        && defFont.strFaceName == m_descCacheDefFont.strFaceName)
+        return;
+    m_descCacheDefFont = defFont;
+    m_mapDescCache.RemoveAll();
 }
 
 static const WCHAR  KFontPropSeprator=   (L',');   //字体属性之间的分隔符，不再支持其它符号。
@@ -70,6 +213,35 @@ static const WCHAR  KFontCharset[]   =   (L"charset");
 #define LEN_CHARSET (ARRAYSIZE(KFontCharset)-1)
 
 IFontPtr SFontPool::GetFont( const SStringW & strFont ,int scale)
+{
+    _ValidateDescCache();
+
+    FontDescKey key = {strFont,scale};
+    SMap<FontDescKey,FontDescInfo>::CPair *p = m_mapDescCache.Lookup(key);
+    if(p && p->m_value.pFont)
+    {
+        _TouchFont(p->m_value.pFont);
+        m_nHit++;
+        return p->m_value.pFont;
+    }
+
+    pugi::xml_document docExProp;
+    FontDescInfo descInfo;
+    if(p)
+    {//字体对象已经被释放，使用缓存的解析结果重建
+        descInfo.info = p->m_value.info;
+        SStringW strXmlProp = S_CT2W(descInfo.info.strPropEx);
+        docExProp.load_buffer((LPCWSTR)strXmlProp,strXmlProp.GetLength()*sizeof(wchar_t),pugi::parse_default,pugi::encoding_utf16);
+    }else
+    {
+        _ParseFontDesc(strFont,scale,descInfo.info,docExProp.append_child(L"propex"));
+    }
+    descInfo.pFont = _GetFont(descInfo.info,docExProp.first_child());
+    m_mapDescCache[key] = descInfo;
+    return descInfo.pFont;
+}
+
+void SFontPool::_ParseFontDesc(const SStringW & strFont,int scale,FontInfo & info,pugi::xml_node nodePropEx) const
 {
     FONTSTYLE fntStyle(GetDefFontInfo().dwStyle);
 	fntStyle.attr.cSize = 0;
@@ -84,8 +256,6 @@ IFontPtr SFontPool::GetFont( const SStringW & strFont ,int scale)
 	short cAdding = 0;
 	short cSize = 0;
 
-	pugi::xml_document docExProp;
-	pugi::xml_node nodePropEx = docExProp.append_child(L"propex");
     for(int i=(int)fontProp.GetCount()-1;i>=0;i--)
     {
         SStringWList strPair;
@@ -138,7 +308,10 @@ IFontPtr SFontPool::GetFont( const SStringW & strFont ,int scale)
 		fntStyle.attr.cSize = fontStyle.attr.cSize * scale/100 + cAdding;  //cAdding为正代表字体变大，否则变小
 	}
 
-    return GetFont(fntStyle, strFace,nodePropEx);
+    info.dwStyle = fntStyle.dwStyle;
+    info.strFaceName = S_CW2T(strFace);
+    if(info.strFaceName.IsEmpty()) info.strFaceName = GetDefFontInfo().strFaceName;
+    info.strPropEx = XmlPropToString(nodePropEx);
 }
 
 
@@ -1,6 +1,7 @@
 ﻿#include "souistd.h"
 #include "res.mgr/SResProviderMgr.h"
 #include "res.mgr/SResProvider.h"
+#include "res.mgr/SResWarmup.h"
 
 
 #include "helper/mybuffer.h"
@@ -10,14 +11,24 @@ namespace SOUI
 {
     const static TCHAR KTypeFile[]      = _T("file");  //从文件加载资源时指定的类型
 
+    const size_t KDefImageCacheBudget = 32*1024*1024;  //默认图片缓存预算
 
-    SResProviderMgr::SResProviderMgr()
+    const UINT KResIndexInitSlots = 256;    //资源查找索引的初始槽位数
+
+    const UINT KResIndexMaxMisses = 4096;   //索引中最多保存的找不到的资源数, 超出后不再加入索引
+
+
+    SResProviderMgr::SResProviderMgr():m_szImgCacheBudget(KDefImageCacheBudget),m_pWarmup(NULL),m_nResIndexMisses(0)
     {
+        memset(&m_imgCacheStats,0,sizeof(m_imgCacheStats));
+        m_pResIndex = _NewResIndexTable(KResIndexInitSlots);
     }
 
     SResProviderMgr::~SResProviderMgr(void)
     {
         RemoveAll();
+        delete []m_pResIndex->pSlots;
+        delete m_pResIndex;
     }
 
     void SResProviderMgr::RemoveAll()
@@ -33,6 +44,8 @@ namespace SOUI
             pResProvider->Release();
         }
         m_lstResPackage.RemoveAll();
+        _ClearResIndex();
+        ClearImageCache();
         
         pos = m_mapCachedCursor.GetStartPosition();
         while(pos)
@@ -48,27 +61,178 @@ namespace SOUI
     {
         if(!pszType) return NULL;
 
-        SAutoLock lock(m_cs);
+        IResProvider * pRet = NULL;
+        if(!pszResName || IS_INTRESOURCE(pszResName))
+        {//没有名字或者是整数ID(PE资源)的查询不进索引
+            SAutoLock lock(m_cs);
+            pRet = _FindResProvider(pszType,pszResName);
+        }else
+        {
+            ULONG uHash = _HashResKey(pszType,pszResName);
+            ResIndexEntry * pEntry = _LookupResIndex(m_pResIndex,uHash,pszType,pszResName);
+            if(pEntry)
+            {
+                pRet = pEntry->pResProvider;
+            }else
+            {
+                SAutoLock lock(m_cs);
+                pRet = _UpdateResIndex(pszType,pszResName,uHash);
+            }
+        }
+#ifdef _DEBUG
+        if(pRet)
+        {
+            _CountResUsage(pszType,pszResName);
+        }
+#endif
+        return pRet;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // 资源查找索引
+    // 开放寻址的散列表, 槽位和表指针都用InterlockedExchangePointer发布, 读线程看到的表项总是完整的
+    ULONG SResProviderMgr::_HashResKey(LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        //FNV-1a, 只折叠ASCII大小写. 非ASCII字符大小写不同时最多多建一个表项, 不影响结果
+        ULONG uHash = 2166136261u;
+        for(LPCTSTR p = pszType; *p; p++)
+        {
+            TCHAR c = *p;
+            if(c>=_T('A') && c<=_T('Z')) c += _T('a')-_T('A');
+            uHash = (uHash ^ (ULONG)c) * 16777619u;
+        }
+        uHash = (uHash ^ (ULONG)_T(':')) * 16777619u;
+        for(LPCTSTR p = pszResName; *p; p++)
+        {
+            TCHAR c = *p;
+            if(c>=_T('A') && c<=_T('Z')) c += _T('a')-_T('A');
+            uHash = (uHash ^ (ULONG)c) * 16777619u;
+        }
+        return uHash;
+    }
+
+    SResProviderMgr::ResIndexTable * SResProviderMgr::_NewResIndexTable(UINT nSlots)
+    {
+        ResIndexTable * pTable = new ResIndexTable;
+        pTable->nMask = nSlots - 1;
+        pTable->nCount = 0;
+        pTable->pSlots = new ResIndexEntry * volatile[nSlots];
+        memset((void*)pTable->pSlots,0,sizeof(ResIndexEntry*)*nSlots);
+        return pTable;
+    }
+
+    SResProviderMgr::ResIndexEntry * SResProviderMgr::_LookupResIndex(const ResIndexTable *pTable,ULONG uHash,LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        for(UINT i = uHash & pTable->nMask; ; i = (i+1) & pTable->nMask)
+        {
+            ResIndexEntry * pEntry = pTable->pSlots[i];
+            if(!pEntry) return NULL;
+            if(pEntry->uHash == uHash
+                && _tcsicmp(pEntry->strName,pszResName) == 0
+                && _tcsicmp(pEntry->strType,pszType) == 0)
+                return pEntry;
+        }
+    }
+
+    void SResProviderMgr::_PutResIndexSlot(ResIndexTable *pTable,ResIndexEntry *pEntry)
+    {
+        UINT i = pEntry->uHash & pTable->nMask;
+        while(pTable->pSlots[i]) i = (i+1) & pTable->nMask;
+        InterlockedExchangePointer((PVOID volatile*)&pTable->pSlots[i],pEntry);
+        pTable->nCount ++;
+    }
+
+    IResProvider * SResProviderMgr::_FindResProvider(LPCTSTR pszType,LPCTSTR pszResName)
+    {
         SPOSITION pos=m_lstResPackage.GetTailPosition();
         while(pos)
         {
             IResProvider * pResProvider = m_lstResPackage.GetPrev(pos);
             if(pResProvider->HasResource(pszType,pszResName)) 
-            {
-#ifdef _DEBUG
-                m_mapResUsageCount[SStringT().Format(_T("%s:%s"),pszType,pszResName).MakeLower()] ++;
-#endif
                 return pResProvider;
-            }
         }
         return NULL;
     }
+
+    //索引未命中: 遍历资源包查找, 并把结果(包括找不到)加入索引. 调用前先锁定m_cs
+    //表项不能单独删除, 找不到的资源超过KResIndexMaxMisses后不再加入索引, 避免任意的名字撑大索引
+    IResProvider * SResProviderMgr::_UpdateResIndex(LPCTSTR pszType,LPCTSTR pszResName,ULONG uHash)
+    {
+        ResIndexTable * pTable = m_pResIndex;
+        ResIndexEntry * pEntry = _LookupResIndex(pTable,uHash,pszType,pszResName);
+        if(pEntry) return pEntry->pResProvider;//其它线程已经加入
+
+        IResProvider * pResProvider = _FindResProvider(pszType,pszResName);
+        if(!pResProvider)
+        {
+            if(m_nResIndexMisses >= KResIndexMaxMisses) return NULL;
+            m_nResIndexMisses ++;
+        }
+
+        pEntry = new ResIndexEntry;
+        pEntry->uHash = uHash;
+        pEntry->strType = pszType;
+        pEntry->strType.MakeLower();
+        pEntry->strName = pszResName;
+        pEntry->strName.MakeLower();
+        pEntry->pResProvider = pResProvider;
+
+        if((pTable->nCount+1)*2 > pTable->nMask+1)
+        {//装载因子超过1/2时扩容. 旧表可能还有线程在读, 保留到RemoveAll时释放
+            ResIndexTable * pNewTable = _NewResIndexTable((pTable->nMask+1)*2);
+            for(UINT i=0;i<=pTable->nMask;i++)
+            {
+                if(pTable->pSlots[i]) _PutResIndexSlot(pNewTable,pTable->pSlots[i]);
+            }
+            _PutResIndexSlot(pNewTable,pEntry);
+            InterlockedExchangePointer((PVOID volatile*)&m_pResIndex,pNewTable);
+            m_lstRetiredIndex.AddTail(pTable);
+        }else
+        {
+            _PutResIndexSlot(pTable,pEntry);
+        }
+        return pEntry->pResProvider;
+    }
+
+    //释放所有表项, 调用时不能有其它线程在查找
+    void SResProviderMgr::_ClearResIndex()
+    {
+        ResIndexTable * pTable = m_pResIndex;
+        for(UINT i=0;i<=pTable->nMask;i++)
+        {
+            delete pTable->pSlots[i];
+            pTable->pSlots[i] = NULL;
+        }
+        pTable->nCount = 0;
+        m_nResIndexMisses = 0;
+
+        SPOSITION pos = m_lstRetiredIndex.GetHeadPosition();
+        while(pos)
+        {
+            ResIndexTable * pRetired = m_lstRetiredIndex.GetNext(pos);
+            delete []pRetired->pSlots;
+            delete pRetired;
+        }
+        m_lstRetiredIndex.RemoveAll();
+    }
    
     void SResProviderMgr::AddResProvider( IResProvider * pResProvider ,LPCTSTR pszUidef)
     {
         SAutoLock lock(m_cs);
         m_lstResPackage.AddTail(pResProvider);
 		pResProvider->AddRef();
+        //新资源包优先级最高, 只需要用它检查已经索引的资源(包括之前找不到的)
+        ResIndexTable * pTable = m_pResIndex;
+        for(UINT i=0;i<=pTable->nMask;i++)
+        {
+            ResIndexEntry * pEntry = pTable->pSlots[i];
+            if(pEntry && pResProvider->HasResource(pEntry->strType,pEntry->strName))
+            {
+                if(!pEntry->pResProvider) m_nResIndexMisses --;
+                InterlockedExchangePointer((PVOID volatile*)&pEntry->pResProvider,pResProvider);
+            }
+        }
+        ClearImageCache();//新资源包可能覆盖已经缓存的图片
 		if(pszUidef) 
 		{
 			IUiDefInfo * pUiDef = SUiDef::getSingleton().CreateUiDefInfo(pResProvider,pszUidef);
@@ -88,7 +252,20 @@ namespace SOUI
             if(pResProvierT == pResProvider)
             {
                 m_lstResPackage.RemoveAt(posPrev);
+                //只重新查找指向被删除资源包的表项, 找不到的表项仍然有效
+                ResIndexTable * pTable = m_pResIndex;
+                for(UINT i=0;i<=pTable->nMask;i++)
+                {
+                    ResIndexEntry * pEntry = pTable->pSlots[i];
+                    if(pEntry && pEntry->pResProvider == pResProvider)
+                    {
+                        IResProvider * pNext = _FindResProvider(pEntry->strType,pEntry->strName);
+                        if(!pNext) m_nResIndexMisses ++;
+                        InterlockedExchangePointer((PVOID volatile*)&pEntry->pResProvider,pNext);
+                    }
+                }
                 pResProvierT->Release();
+                ClearImageCache();
                 break;
             }
         }
@@ -101,49 +278,55 @@ namespace SOUI
 
     LPCTSTR SResProviderMgr::SysCursorName2ID( LPCTSTR pszCursorName )
     {
-        SAutoLock lock(m_cs);
-        if(!_tcsicmp(pszCursorName,_T("arrow")))
-            return IDC_ARROW;
-        if(!_tcsicmp(pszCursorName,_T("ibeam")))
-            return IDC_IBEAM;
-        if(!_tcsicmp(pszCursorName,_T("wait")))
-            return IDC_WAIT;
-        if(!_tcsicmp(pszCursorName,_T("cross")))
-            return IDC_CROSS;
-        if(!_tcsicmp(pszCursorName,_T("uparrow")))
-            return IDC_UPARROW;
-        if(!_tcsicmp(pszCursorName,_T("size")))
-            return IDC_SIZE;
-        if(!_tcsicmp(pszCursorName,_T("sizenwse")))
-            return IDC_SIZENWSE;
-        if(!_tcsicmp(pszCursorName,_T("sizenesw")))
-            return IDC_SIZENESW;
-        if(!_tcsicmp(pszCursorName,_T("sizewe")))
-            return IDC_SIZEWE;
-        if(!_tcsicmp(pszCursorName,_T("sizens")))
-            return IDC_SIZENS;
-        if(!_tcsicmp(pszCursorName,_T("sizeall")))
-            return IDC_SIZEALL;
-        if(!_tcsicmp(pszCursorName,_T("no")))
-            return IDC_NO;
-        if(!_tcsicmp(pszCursorName,_T("hand")))
-            return IDC_HAND;
-        if(!_tcsicmp(pszCursorName,_T("help")))
-            return IDC_HELP;
+        //按名字排序, 二分查找
+        static const struct
+        {
+            LPCTSTR pszName;
+            LPCTSTR pszID;
+        } KSysCursors[] = {
+            {_T("arrow"),IDC_ARROW},
+            {_T("cross"),IDC_CROSS},
+            {_T("hand"),IDC_HAND},
+            {_T("help"),IDC_HELP},
+            {_T("ibeam"),IDC_IBEAM},
+            {_T("no"),IDC_NO},
+            {_T("size"),IDC_SIZE},
+            {_T("sizeall"),IDC_SIZEALL},
+            {_T("sizenesw"),IDC_SIZENESW},
+            {_T("sizens"),IDC_SIZENS},
+            {_T("sizenwse"),IDC_SIZENWSE},
+            {_T("sizewe"),IDC_SIZEWE},
+            {_T("uparrow"),IDC_UPARROW},
+            {_T("wait"),IDC_WAIT},
+        };
+        int nLow = 0, nHigh = ARRAYSIZE(KSysCursors)-1;
+        while(nLow <= nHigh)
+        {
+            int nMid = (nLow+nHigh)/2;
+            int nCmp = _tcsicmp(pszCursorName,KSysCursors[nMid].pszName);
+            if(nCmp == 0) return KSysCursors[nMid].pszID;
+            if(nCmp < 0) nHigh = nMid-1;
+            else nLow = nMid+1;
+        }
         return NULL;
    }
 
     BOOL SResProviderMgr::GetRawBuffer( LPCTSTR strType,LPCTSTR pszResName,LPVOID pBuf,size_t size )
     {
-        SAutoLock lock(m_cs);
         if(IsFileType(strType))
         {
             return SResLoadFromFile::GetRawBuffer(pszResName,pBuf,size);
         }else
         {
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("%s:%s"),strType,pszResName).MakeLower()] ++;
+            _CountResUsage(strType,pszResName);
 #endif
+            SResWarmup * pWarmup = IS_INTRESOURCE(pszResName)?NULL:m_pWarmup;
+            if(pWarmup)
+            {
+                pWarmup->OnResRequest(WARMUP_RAW,strType,pszResName);
+                if(pWarmup->TakeRawBuffer(strType,pszResName,pBuf,size)) return TRUE;
+            }
             IResProvider *pResProvider=GetMatchResProvider(strType,pszResName);
             if(!pResProvider) return FALSE;
             return pResProvider->GetRawBuffer(strType,pszResName,pBuf,size);
@@ -152,15 +335,21 @@ namespace SOUI
 
     size_t SResProviderMgr::GetRawBufferSize( LPCTSTR strType,LPCTSTR pszResName )
     {
-        SAutoLock lock(m_cs);
         if(IsFileType(strType))
         {
             return SResLoadFromFile::GetRawBufferSize(pszResName);
         }else
         {
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("%s:%s"),strType,pszResName).MakeLower()] ++;
+            _CountResUsage(strType,pszResName);
 #endif
+            SResWarmup * pWarmup = IS_INTRESOURCE(pszResName)?NULL:m_pWarmup;
+            if(pWarmup)
+            {
+                pWarmup->OnResRequest(WARMUP_RAW,strType,pszResName);
+                size_t szBuf = pWarmup->GetRawBufferSize(strType,pszResName);
+                if(szBuf) return szBuf;
+            }
 
             IResProvider *pResProvider=GetMatchResProvider(strType,pszResName);
             if(!pResProvider) return 0;
@@ -170,14 +359,13 @@ namespace SOUI
 
     IImgX * SResProviderMgr::LoadImgX( LPCTSTR strType,LPCTSTR pszResName )
     {
-        SAutoLock lock(m_cs);
         if(IsFileType(strType))
         {
             return SResLoadFromFile::LoadImgX(pszResName);
         }else
         {
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("%s:%s"),strType,pszResName).MakeLower()] ++;
+            _CountResUsage(strType,pszResName);
 #endif
 
             IResProvider *pResProvider=GetMatchResProvider(strType,pszResName);
@@ -189,32 +377,180 @@ namespace SOUI
     IBitmap * SResProviderMgr::LoadImage( LPCTSTR pszType,LPCTSTR pszResName )
     {
         if(!pszType) return NULL;
-        SAutoLock lock(m_cs);
+        //整数ID(PE资源)不缓存, 也不预加载
+        BOOL bNamed = !IS_INTRESOURCE(pszResName);
+        SStringT strKey;
+        IBitmap *pImg = NULL;
+        if(bNamed)
+        {
+            strKey = _ImageCacheKey(pszType,pszResName,100);
+            SAutoLock lock(m_cs);
+            pImg = _FindCachedImage(strKey);
+            if(pImg) return pImg;
+        }
+        //不加锁加载, 资源包自己保证线程安全. 两个线程同时加载同一个图片时后加入缓存的替换先加入的
+
         if(IsFileType(pszType))
         {
-            return SResLoadFromFile::LoadImage(pszResName);
+            pImg = SResLoadFromFile::LoadImage(pszResName);
         }else
         {
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("%s:%s"),pszType,pszResName).MakeLower()] ++;
+            _CountResUsage(pszType,pszResName);
 #endif
 
-            IResProvider *pResProvider=GetMatchResProvider(pszType,pszResName);
-            if(!pResProvider) return NULL;
-            return pResProvider->LoadImage(pszType,pszResName);
+            SResWarmup * pWarmup = bNamed?m_pWarmup:NULL;
+            if(pWarmup)
+            {
+                pWarmup->OnResRequest(WARMUP_IMAGE,pszType,pszResName);
+                pImg = pWarmup->TakeImage(pszType,pszResName);
+            }
+            if(!pImg)
+            {
+                IResProvider *pResProvider=GetMatchResProvider(pszType,pszResName);
+                if(!pResProvider) return NULL;
+                pImg = pResProvider->LoadImage(pszType,pszResName);
+            }
         }
+        if(pImg && bNamed)
+        {
+            SAutoLock lock(m_cs);
+            _AddCachedImage(strKey,pImg);
+        }
+        return pImg;
     }
 
-    HBITMAP SResProviderMgr::LoadBitmap( LPCTSTR pszResName ,BOOL bFromFile /*= FALSE*/)
+    void SResProviderMgr::SetResWarmup(SResWarmup *pWarmup)
+    {
+        SAutoLock lock(m_cs);
+        m_pWarmup = pWarmup;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // 图片缓存
+    void SResProviderMgr::SetImageCacheBudget(size_t szBudget)
+    {
+        SAutoLock lock(m_cs);
+        m_szImgCacheBudget = szBudget;
+        _TrimImageCache(szBudget);
+    }
+
+    void SResProviderMgr::GetImageCacheStats(IMAGECACHESTATS *pStats)
+    {
+        SAutoLock lock(m_cs);
+        *pStats = m_imgCacheStats;
+        pStats->nCount = (int)m_lruImgCache.GetCount();
+        pStats->szBudget = m_szImgCacheBudget;
+    }
+
+    void SResProviderMgr::ClearImageCache()
+    {
+        SAutoLock lock(m_cs);
+        _TrimImageCache(0);
+    }
+
+    IBitmap * SResProviderMgr::FindCachedImage(LPCTSTR pszType,LPCTSTR pszResName,int nScale)
     {
+        if(!pszType || IS_INTRESOURCE(pszResName)) return NULL;
         SAutoLock lock(m_cs);
+        return _FindCachedImage(_ImageCacheKey(pszType,pszResName,nScale));
+    }
+
+    void SResProviderMgr::AddCachedImage(LPCTSTR pszType,LPCTSTR pszResName,int nScale,IBitmap *pImg)
+    {
+        if(!pszType || IS_INTRESOURCE(pszResName) || !pImg) return;
+        SAutoLock lock(m_cs);
+        _AddCachedImage(_ImageCacheKey(pszType,pszResName,nScale),pImg);
+    }
+
+    int SResProviderMgr::RemoveCachedImage(IBitmap *pImg)
+    {
+        if(!pImg) return 0;
+        SAutoLock lock(m_cs);
+        int nRemoved = 0;
+        SPOSITION pos = m_lruImgCache.GetHeadPosition();
+        while(pos)
+        {
+            SPOSITION posCur = pos;
+            CachedImage *pItem = m_lruImgCache.GetNext(pos);
+            if(pItem->pImg != pImg) continue;
+            m_lruImgCache.RemoveAt(posCur);
+            m_mapImgCache.RemoveKey(pItem->strKey);
+            m_imgCacheStats.szBytes -= pItem->szBytes;
+            delete pItem;
+            nRemoved++;
+        }
+        return nRemoved;
+    }
+
+    SStringT SResProviderMgr::_ImageCacheKey(LPCTSTR pszType,LPCTSTR pszResName,int nScale)
+    {
+        return SStringT().Format(_T("%s:%s@%d"),pszType,pszResName,nScale).MakeLower();
+    }
+
+    IBitmap * SResProviderMgr::_FindCachedImage(const SStringT & strKey)
+    {
+        const SMap<SStringT,SPOSITION>::CPair *p = m_mapImgCache.Lookup(strKey);
+        if(!p)
+        {
+            m_imgCacheStats.dwMisses++;
+            return NULL;
+        }
+        m_imgCacheStats.dwHits++;
+        //移动到LRU头部
+        m_lruImgCache.MoveToHead(p->m_value);
+        IBitmap *pImg = m_lruImgCache.GetAt(p->m_value)->pImg;
+        pImg->AddRef();
+        return pImg;
+    }
+
+    void SResProviderMgr::_AddCachedImage(const SStringT & strKey,IBitmap *pImg)
+    {
+        size_t szBytes = (size_t)pImg->Width()*pImg->Height()*4;
+        if(szBytes > m_szImgCacheBudget) return;//单个图片超出预算时不缓存
+
+        SMap<SStringT,SPOSITION>::CPair *p = m_mapImgCache.Lookup(strKey);
+        if(p)
+        {//替换旧图片
+            CachedImage *pOld = m_lruImgCache.GetAt(p->m_value);
+            m_imgCacheStats.szBytes -= pOld->szBytes;
+            m_lruImgCache.RemoveAt(p->m_value);
+            m_mapImgCache.RemoveKey(strKey);
+            delete pOld;
+        }
+
+        _TrimImageCache(m_szImgCacheBudget - szBytes);
+
+        CachedImage *pItem = new CachedImage;
+        pItem->strKey = strKey;
+        pItem->pImg = pImg;
+        pItem->szBytes = szBytes;
+        m_mapImgCache[strKey] = m_lruImgCache.AddHead(pItem);
+        m_imgCacheStats.szBytes += szBytes;
+    }
+
+    //从LRU尾部淘汰图片, 直到缓存大小不超过szBudget
+    void SResProviderMgr::_TrimImageCache(size_t szBudget)
+    {
+        while(m_imgCacheStats.szBytes > szBudget && !m_lruImgCache.IsEmpty())
+        {
+            CachedImage *pItem = m_lruImgCache.RemoveTail();
+            m_mapImgCache.RemoveKey(pItem->strKey);
+            m_imgCacheStats.szBytes -= pItem->szBytes;
+            if(szBudget) m_imgCacheStats.dwEvicts++;
+            delete pItem;
+        }
+    }
+
+    HBITMAP SResProviderMgr::LoadBitmap( LPCTSTR pszResName ,BOOL bFromFile /*= FALSE*/)
+    {
         if(bFromFile)
         {
             return SResLoadFromFile::LoadBitmap(pszResName);
         }else
         {
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("bitmap:%s"),pszResName).MakeLower()] ++;
+            _CountResUsage(KTypeBitmap,pszResName);
 #endif
 
             IResProvider *pResProvider=GetMatchResProvider(KTypeBitmap,pszResName);
@@ -225,7 +561,6 @@ namespace SOUI
 
     HCURSOR SResProviderMgr::LoadCursor( LPCTSTR pszResName ,BOOL bFromFile /*= FALSE*/)
     {
-        SAutoLock lock(m_cs);
         if(IS_INTRESOURCE(pszResName))
             return ::LoadCursor(NULL, pszResName);
         else 
@@ -234,8 +569,11 @@ namespace SOUI
             if(pszCursorID)
                 return ::LoadCursor(NULL, pszCursorID);
         }
-        const CURSORMAP::CPair * pPair  = m_mapCachedCursor.Lookup(pszResName);
-        if(pPair) return pPair->m_value;
+        {
+            SAutoLock lock(m_cs);
+            const CURSORMAP::CPair * pPair  = m_mapCachedCursor.Lookup(pszResName);
+            if(pPair) return pPair->m_value;
+        }
         
         HCURSOR hRet = NULL;
         if(bFromFile)
@@ -245,7 +583,7 @@ namespace SOUI
         {
         
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("cursor:%s"),pszResName).MakeLower()] ++;
+            _CountResUsage(KTypeCursor,pszResName);
 #endif
 
             IResProvider *pResProvider=GetMatchResProvider(KTypeCursor,pszResName);
@@ -253,22 +591,30 @@ namespace SOUI
                 hRet =pResProvider->LoadCursor(pszResName);
         }
         if(hRet)
-        {
-            m_mapCachedCursor[pszResName]=hRet;
+        {//其它线程可能已经加载了同一个光标, 使用先加入的
+            SAutoLock lock(m_cs);
+            const CURSORMAP::CPair * pPair  = m_mapCachedCursor.Lookup(pszResName);
+            if(pPair)
+            {
+                DestroyCursor(hRet);
+                hRet = pPair->m_value;
+            }else
+            {
+                m_mapCachedCursor[pszResName]=hRet;
+            }
         }
         return hRet;
     }
 
     HICON SResProviderMgr::LoadIcon( LPCTSTR pszResName,int cx/*=0*/,int cy/*=0*/ ,BOOL bFromFile /*= FALSE*/)
     {
-        SAutoLock lock(m_cs);
         if(bFromFile)
         {
             return SResLoadFromFile::LoadIcon(pszResName,cx,cy);
         }else
         {
 #ifdef _DEBUG
-            m_mapResUsageCount[SStringT().Format(_T("icon:%s"),pszResName).MakeLower()] ++;
+            _CountResUsage(KTypeIcon,pszResName);
 #endif
             IResProvider *pResProvider=GetMatchResProvider(KTypeIcon,pszResName);
             if(!pResProvider) return NULL;
@@ -276,9 +622,21 @@ namespace SOUI
         }
     }
 
-    BOOL SResProviderMgr::HasResource( LPCTSTR pszType,LPCTSTR pszResName )
+#ifdef _DEBUG
+    void SResProviderMgr::_CountResUsage(LPCTSTR pszType,LPCTSTR pszResName)
     {
+        SStringT strKey;
+        if(IS_INTRESOURCE(pszResName))
+            strKey.Format(_T("%s:#%d"),pszType,(int)(ULONG_PTR)pszResName);
+        else
+            strKey.Format(_T("%s:%s"),pszType,pszResName);
         SAutoLock lock(m_cs);
+        m_mapResUsageCount[strKey.MakeLower()] ++;
+    }
+#endif
+
+    BOOL SResProviderMgr::HasResource( LPCTSTR pszType,LPCTSTR pszResName )
+    {
         if(IsFileType(pszType))
         {
             return ::GetFileAttributes(pszResName) != INVALID_FILE_ATTRIBUTES;
@@ -0,0 +1,325 @@
+﻿#include "souistd.h"
+#include "res.mgr/SResWarmup.h"
+#include "res.mgr/SResProviderMgr.h"
+#include <process.h>
+
+namespace SOUI
+{
+    const int KMaxWarmupThreads = 8;
+
+    enum
+    {
+        JOB_QUEUED = 0, //等待工作线程处理
+        JOB_RUNNING,    //正在读取或解码
+        JOB_READY,      //已经完成, 等待取走
+        JOB_TAKEN,      //已经被取走
+        JOB_CANCELED,   //完成前被请求, 由请求线程自己加载
+        JOB_FAILED,     //资源不存在或者解码失败
+    };
+
+    struct WarmupJob
+    {
+        WARMUPKIND kind;
+        SStringT strType;
+        SStringT strName;
+        volatile LONG nState;
+        BYTE *   pData;             //WARMUP_RAW的数据
+        size_t   szData;
+        CAutoRefPtr<IImgX> pImgX;   //WARMUP_IMAGE的解码结果
+
+        WarmupJob():nState(JOB_QUEUED),pData(NULL),szData(0){}
+        ~WarmupJob(){Clear();}
+
+        void Clear()
+        {
+            if(pData) free(pData);
+            pData = NULL;
+            szData = 0;
+            pImgX = NULL;
+        }
+    };
+
+    static LPCWSTR KWarmupKindNames[] = {L"raw",L"image"};
+
+    //////////////////////////////////////////////////////////////////////////
+    SResWarmup::SResWarmup(SResProviderMgr *pResMgr)
+        :m_pResMgr(pResMgr)
+        ,m_iNextJob(0)
+        ,m_nReady(0)
+        ,m_nHits(0)
+        ,m_nMisses(0)
+        ,m_bRecording(FALSE)
+    {
+        m_pResMgr->SetResWarmup(this);
+    }
+
+    SResWarmup::~SResWarmup()
+    {
+        if(m_bRecording) StopRecord();
+        m_pResMgr->SetResWarmup(NULL);
+        Stop();
+    }
+
+    SStringT SResWarmup::_MakeKey(WARMUPKIND kind,LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        return SStringT().Format(_T("%d:%s:%s"),kind,pszType,pszResName).MakeLower();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // 录制
+    BOOL SResWarmup::StartRecord(LPCTSTR pszManifest)
+    {
+        if(!pszManifest) return FALSE;
+        SAutoLock lock(m_csRecord);
+        m_strManifest = pszManifest;
+        m_lstRecord.RemoveAll();
+        m_mapRecord.RemoveAll();
+        m_bRecording = TRUE;
+        return TRUE;
+    }
+
+    BOOL SResWarmup::StopRecord()
+    {
+        SAutoLock lock(m_csRecord);
+        if(!m_bRecording) return FALSE;
+        m_bRecording = FALSE;
+
+        pugi::xml_document xmlDoc;
+        pugi::xml_node xmlRoot = xmlDoc.append_child(L"warmup");
+        for(size_t i=0;i<m_lstRecord.GetCount();i++)
+        {
+            const RecordItem & item = m_lstRecord[i];
+            pugi::xml_node xmlRes = xmlRoot.append_child(L"res");
+            xmlRes.append_attribute(L"kind").set_value(KWarmupKindNames[item.kind]);
+            xmlRes.append_attribute(L"type").set_value(S_CT2W(item.strType));
+            xmlRes.append_attribute(L"name").set_value(S_CT2W(item.strName));
+        }
+        return xmlDoc.save_file(m_strManifest,L"\t",pugi::format_default,pugi::encoding_utf8);
+    }
+
+    void SResWarmup::OnResRequest(WARMUPKIND kind,LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        if(!m_bRecording || !pszType || !pszResName) return;
+        SStringT strKey = _MakeKey(kind,pszType,pszResName);
+        SAutoLock lock(m_csRecord);
+        if(!m_bRecording || m_mapRecord.Lookup(strKey)) return;
+        m_mapRecord[strKey] = TRUE;
+        RecordItem item;
+        item.kind = kind;
+        item.strType = pszType;
+        item.strName = pszResName;
+        m_lstRecord.Add(item);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // 回放
+    int SResWarmup::Replay(LPCTSTR pszManifest,IRenderFactory *pRenderFactory,int nThreads)
+    {
+        Stop();
+
+        pugi::xml_document xmlDoc;
+        if(!xmlDoc.load_file(pszManifest,pugi::parse_default,pugi::encoding_utf8)) return 0;
+
+        m_pRenderFactory = pRenderFactory;
+        pugi::xml_node xmlRes = xmlDoc.child(L"warmup").child(L"res");
+        while(xmlRes)
+        {
+            WARMUPKIND kind = wcscmp(xmlRes.attribute(L"kind").value(),KWarmupKindNames[WARMUP_IMAGE])==0?WARMUP_IMAGE:WARMUP_RAW;
+            SStringT strType = S_CW2T(xmlRes.attribute(L"type").value());
+            SStringT strName = S_CW2T(xmlRes.attribute(L"name").value());
+            xmlRes = xmlRes.next_sibling(L"res");
+
+            if(strType.IsEmpty() || strName.IsEmpty()) continue;
+            if(kind == WARMUP_IMAGE && !pRenderFactory) continue;
+            SStringT strKey = _MakeKey(kind,strType,strName);
+            if(m_mapJobs.Lookup(strKey)) continue;
+
+            WarmupJob *pJob = new WarmupJob;
+            pJob->kind = kind;
+            pJob->strType = strType;
+            pJob->strName = strName;
+            m_lstJobs.Add(pJob);
+            m_mapJobs[strKey] = pJob;
+        }
+        if(m_lstJobs.IsEmpty()) return 0;
+
+        if(nThreads <= 0)
+        {
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            nThreads = (int)si.dwNumberOfProcessors;
+        }
+        if(nThreads > KMaxWarmupThreads) nThreads = KMaxWarmupThreads;
+        if(nThreads > (int)m_lstJobs.GetCount()) nThreads = (int)m_lstJobs.GetCount();
+        for(int i=0;i<nThreads;i++)
+        {
+            HANDLE hThread = (HANDLE)_beginthreadex(NULL,0,WorkThread,this,0,NULL);
+            if(!hThread) break;
+            m_lstThreads.Add(hThread);
+        }
+        return (int)m_lstJobs.GetCount();
+    }
+
+    BOOL SResWarmup::Wait(DWORD dwTimeout)
+    {
+        if(m_lstThreads.IsEmpty()) return TRUE;
+        return WaitForMultipleObjects((DWORD)m_lstThreads.GetCount(),m_lstThreads.GetData(),TRUE,dwTimeout) != WAIT_TIMEOUT;
+    }
+
+    void SResWarmup::Stop()
+    {
+        //让工作线程不再领取新任务, 等待正在处理的任务完成
+        InterlockedExchange(&m_iNextJob,(LONG)m_lstJobs.GetCount());
+        if(m_lstThreads.GetCount())
+        {
+            WaitForMultipleObjects((DWORD)m_lstThreads.GetCount(),m_lstThreads.GetData(),TRUE,INFINITE);
+            for(size_t i=0;i<m_lstThreads.GetCount();i++)
+            {
+                CloseHandle(m_lstThreads[i]);
+            }
+            m_lstThreads.RemoveAll();
+        }
+        for(size_t i=0;i<m_lstJobs.GetCount();i++)
+        {
+            delete m_lstJobs[i];
+        }
+        m_lstJobs.RemoveAll();
+        m_mapJobs.RemoveAll();
+        m_pRenderFactory = NULL;
+        m_iNextJob = 0;
+        m_nReady = m_nHits = m_nMisses = 0;
+    }
+
+    void SResWarmup::GetStats(WARMUPSTATS *pStats)
+    {
+        pStats->nEntries = (int)m_lstJobs.GetCount();
+        pStats->nReady = m_nReady;
+        pStats->nHits = m_nHits;
+        pStats->nMisses = m_nMisses;
+        SAutoLock lock(m_csRecord);
+        pStats->nRecorded = (int)m_lstRecord.GetCount();
+    }
+
+    unsigned int SResWarmup::WorkThread(void *pParam)
+    {
+        SResWarmup *pThis = (SResWarmup*)pParam;
+        //WIC解码器需要初始化COM
+        HRESULT hrCom = CoInitializeEx(NULL,COINIT_MULTITHREADED);
+        for(;;)
+        {
+            LONG iJob = InterlockedIncrement(&pThis->m_iNextJob)-1;
+            if(iJob >= (LONG)pThis->m_lstJobs.GetCount()) break;
+
+            WarmupJob *pJob = pThis->m_lstJobs[iJob];
+            if(InterlockedCompareExchange(&pJob->nState,JOB_RUNNING,JOB_QUEUED) != JOB_QUEUED)
+                continue;//开始前已经被请求
+            BOOL bOK = pThis->_RunJob(pJob);
+            if(InterlockedCompareExchange(&pJob->nState,bOK?JOB_READY:JOB_FAILED,JOB_RUNNING) != JOB_RUNNING)
+                pJob->Clear();//处理过程中被请求, 请求线程已经自己加载了
+            else if(bOK)
+                InterlockedIncrement(&pThis->m_nReady);
+        }
+        if(SUCCEEDED(hrCom)) CoUninitialize();
+        return 0;
+    }
+
+    //在工作线程中执行, 直接访问资源包, 不经过SResProviderMgr的锁
+    BOOL SResWarmup::_RunJob(WarmupJob *pJob)
+    {
+        IResProvider *pResProvider = m_pResMgr->GetMatchResProvider(pJob->strType,pJob->strName);
+        if(!pResProvider) return FALSE;
+        size_t szBuf = pResProvider->GetRawBufferSize(pJob->strType,pJob->strName);
+        if(szBuf == 0) return FALSE;
+        BYTE *pBuf = (BYTE*)malloc(szBuf);
+        if(!pBuf) return FALSE;
+        if(!pResProvider->GetRawBuffer(pJob->strType,pJob->strName,pBuf,szBuf))
+        {
+            free(pBuf);
+            return FALSE;
+        }
+
+        if(pJob->kind == WARMUP_IMAGE)
+        {
+            CAutoRefPtr<IImgX> pImgX;
+            m_pRenderFactory->GetImgDecoderFactory()->CreateImgX(&pImgX);
+            if(pImgX && pImgX->LoadFromMemory(pBuf,szBuf) > 0)
+                pJob->pImgX = pImgX;
+            free(pBuf);
+            return pJob->pImgX != NULL;
+        }else
+        {
+            pJob->pData = pBuf;
+            pJob->szData = szBuf;
+            return TRUE;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // 取走预加载的结果
+    WarmupJob * SResWarmup::_FindJob(WARMUPKIND kind,LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        if(m_lstJobs.IsEmpty() || !pszType || !pszResName) return NULL;
+        const SMap<SStringT,WarmupJob*>::CPair *p = m_mapJobs.Lookup(_MakeKey(kind,pszType,pszResName));
+        return p?p->m_value:NULL;
+    }
+
+    //完成的任务转为JOB_TAKEN并返回TRUE; 没有完成的任务直接取消, 不等待工作线程
+    BOOL SResWarmup::_TakeJob(WarmupJob *pJob)
+    {
+        for(;;)
+        {
+            LONG nState = pJob->nState;
+            if(nState == JOB_TAKEN || nState == JOB_CANCELED || nState == JOB_FAILED) return FALSE;
+            LONG nNewState = nState == JOB_READY ? JOB_TAKEN : JOB_CANCELED;
+            if(InterlockedCompareExchange(&pJob->nState,nNewState,nState) != nState) continue;
+            if(nNewState == JOB_TAKEN) return TRUE;
+            InterlockedIncrement(&m_nMisses);
+            return FALSE;
+        }
+    }
+
+    size_t SResWarmup::GetRawBufferSize(LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        WarmupJob *pJob = _FindJob(WARMUP_RAW,pszType,pszResName);
+        if(!pJob || pJob->nState != JOB_READY) return 0;
+        return pJob->szData;
+    }
+
+    BOOL SResWarmup::TakeRawBuffer(LPCTSTR pszType,LPCTSTR pszResName,LPVOID pBuf,size_t size)
+    {
+        WarmupJob *pJob = _FindJob(WARMUP_RAW,pszType,pszResName);
+        if(!pJob) return FALSE;
+        if(pJob->nState == JOB_READY && size < pJob->szData) return FALSE;//缓冲区不够, 保留结果
+        if(!_TakeJob(pJob)) return FALSE;
+
+        BOOL bRet = FALSE;
+        if(pJob->pData)
+        {
+            memcpy(pBuf,pJob->pData,pJob->szData);
+            InterlockedIncrement(&m_nHits);
+            bRet = TRUE;
+        }
+        pJob->Clear();
+        return bRet;
+    }
+
+    IBitmap * SResWarmup::TakeImage(LPCTSTR pszType,LPCTSTR pszResName)
+    {
+        WarmupJob *pJob = _FindJob(WARMUP_IMAGE,pszType,pszResName);
+        if(!pJob || !_TakeJob(pJob)) return NULL;
+
+        IBitmap *pImg = NULL;
+        if(pJob->pImgX)
+        {
+            m_pRenderFactory->CreateBitmap(&pImg);
+            if(pImg && FAILED(pImg->Init(pJob->pImgX->GetFrame(0))))
+            {
+                pImg->Release();
+                pImg = NULL;
+            }
+            if(pImg) InterlockedIncrement(&m_nHits);
+        }
+        pJob->Clear();
+        return pImg;
+    }
+}
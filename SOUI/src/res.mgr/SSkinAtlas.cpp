@@ -0,0 +1,165 @@
+﻿#include "souistd.h"
+#include "res.mgr/SSkinAtlas.h"
+#include "res.mgr/SResProviderMgr.h"
+
+namespace SOUI
+{
+    const int KAtlasBorder = 1;    //图片四周复制的边缘宽度
+
+    SSkinAtlas::SSkinAtlas(int nPageSize,int nMaxImageSize)
+        :m_nPageSize(nPageSize)
+        ,m_nMaxImageSize(min(nMaxImageSize,nPageSize-KAtlasBorder*2))
+        ,m_nImages(0)
+        ,m_szImageBytes(0)
+        ,m_szReleasedBytes(0)
+    {
+    }
+
+    SSkinAtlas::~SSkinAtlas()
+    {
+        for(size_t i=0;i<m_lstPages.GetCount();i++)
+        {
+            delete m_lstPages[i];
+        }
+        m_lstPages.RemoveAll();
+    }
+
+    BOOL SSkinAtlas::Add(IBitmap *pImg,IBitmap **ppPage,RECT *prcImg)
+    {
+        if(!pImg || !ppPage || !prcImg) return FALSE;
+        int nWid = pImg->Width();
+        int nHei = pImg->Height();
+        if(nWid<=0 || nHei<=0 || nWid>m_nMaxImageSize || nHei>m_nMaxImageSize) return FALSE;
+        if(!pImg->GetPixelBits()) return FALSE;
+
+        int nSlotWid = nWid + KAtlasBorder*2;
+        int nSlotHei = nHei + KAtlasBorder*2;
+
+        ATLASPAGE *pPage = NULL;
+        POINT pt;
+        for(size_t i=0;i<m_lstPages.GetCount();i++)
+        {
+            if(_Alloc(m_lstPages[i],nSlotWid,nSlotHei,&pt))
+            {
+                pPage = m_lstPages[i];
+                break;
+            }
+        }
+        if(!pPage)
+        {
+            CAutoRefPtr<IBitmap> pPageImg;
+            pImg->GetRenderFactory()->CreateBitmap(&pPageImg);
+            if(!pPageImg || FAILED(pPageImg->Init(m_nPageSize,m_nPageSize,NULL)))
+                return FALSE;
+            pPage = new ATLASPAGE;
+            pPage->pImg = pPageImg;
+            pPage->nBottom = 0;
+            pPage->szUsed = 0;
+            m_lstPages.Add(pPage);
+            if(!_Alloc(pPage,nSlotWid,nSlotHei,&pt)) return FALSE;
+        }
+
+        _CopyImage(pPage,pt,pImg);
+        pPage->szUsed += nSlotWid*nSlotHei;
+        m_nImages++;
+        m_szImageBytes += nWid*nHei*4;
+
+        *ppPage = pPage->pImg;
+        (*ppPage)->AddRef();
+        prcImg->left = pt.x + KAtlasBorder;
+        prcImg->top = pt.y + KAtlasBorder;
+        prcImg->right = prcImg->left + nWid;
+        prcImg->bottom = prcImg->top + nHei;
+        return TRUE;
+    }
+
+    void SSkinAtlas::ReleaseSource(IBitmap *pImg,SResProviderMgr *pImgCache)
+    {
+        if(!pImg) return;
+        //图片缓存还引用源图片时, 合并只会增加内存
+        if(pImgCache) pImgCache->RemoveCachedImage(pImg);
+        size_t szBytes = (size_t)pImg->Width()*pImg->Height()*4;
+        if(pImg->Release() == 0) m_szReleasedBytes += szBytes;
+    }
+
+    //在高度最接近的行中分配, 没有合适的行时在底部增加新行
+    BOOL SSkinAtlas::_Alloc(ATLASPAGE *pPage,int nWid,int nHei,POINT *pt)
+    {
+        int iBest = -1;
+        for(size_t i=0;i<pPage->lstShelf.GetCount();i++)
+        {
+            const SHELF & shelf = pPage->lstShelf[i];
+            if(shelf.nHei < nHei || shelf.x + nWid > m_nPageSize) continue;
+            if(iBest == -1 || shelf.nHei < pPage->lstShelf[iBest].nHei)
+                iBest = (int)i;
+        }
+        //行高比图片高很多时开新行, 减少浪费
+        if(iBest != -1 && pPage->lstShelf[iBest].nHei > nHei*2 && pPage->nBottom + nHei <= m_nPageSize)
+            iBest = -1;
+
+        if(iBest == -1)
+        {
+            if(pPage->nBottom + nHei > m_nPageSize) return FALSE;
+            SHELF shelf = {pPage->nBottom,nHei,0};
+            pPage->lstShelf.Add(shelf);
+            pPage->nBottom += nHei;
+            iBest = (int)pPage->lstShelf.GetCount()-1;
+        }
+
+        SHELF & shelf = pPage->lstShelf[iBest];
+        pt->x = shelf.x;
+        pt->y = shelf.y;
+        shelf.x += nWid;
+        return TRUE;
+    }
+
+    void SSkinAtlas::_CopyImage(ATLASPAGE *pPage,POINT pt,IBitmap *pImg)
+    {
+        int nWid = pImg->Width();
+        int nHei = pImg->Height();
+        const DWORD *pSrc = (const DWORD*)pImg->GetPixelBits();
+        DWORD *pBits = (DWORD*)pPage->pImg->LockPixelBits();
+        if(!pBits) return;
+
+        DWORD *pDst = pBits + (pt.y + KAtlasBorder)*m_nPageSize + pt.x + KAtlasBorder;
+        for(int y=0;y<nHei;y++)
+        {
+            DWORD *pRow = pDst + y*m_nPageSize;
+            memcpy(pRow,pSrc + y*nWid,nWid*4);
+            //左右边缘
+            for(int i=1;i<=KAtlasBorder;i++)
+            {
+                pRow[-i] = pRow[0];
+                pRow[nWid-1+i] = pRow[nWid-1];
+            }
+        }
+        //上下边缘, 包括四个角
+        int nRowPixels = nWid + KAtlasBorder*2;
+        DWORD *pFirst = pDst - KAtlasBorder;
+        DWORD *pLast = pDst + (nHei-1)*m_nPageSize - KAtlasBorder;
+        for(int i=1;i<=KAtlasBorder;i++)
+        {
+            memcpy(pFirst - i*m_nPageSize,pFirst,nRowPixels*4);
+            memcpy(pLast + i*m_nPageSize,pLast,nRowPixels*4);
+        }
+        pPage->pImg->UnlockPixelBits(pBits);
+    }
+
+    void SSkinAtlas::GetStats(SKINATLASSTATS *pStats) const
+    {
+        pStats->nPages = (int)m_lstPages.GetCount();
+        pStats->nImages = m_nImages;
+        pStats->szPageBytes = (size_t)pStats->nPages*m_nPageSize*m_nPageSize*4;
+        pStats->szImageBytes = m_szImageBytes;
+        pStats->szReleasedBytes = m_szReleasedBytes;
+        pStats->nBitmapsSaved = m_nImages - pStats->nPages;
+        pStats->nBytesSaved = (INT64)pStats->szReleasedBytes - (INT64)pStats->szPageBytes;
+
+        size_t szUsed = 0;
+        for(size_t i=0;i<m_lstPages.GetCount();i++)
+        {
+            szUsed += m_lstPages[i]->szUsed;
+        }
+        pStats->fFillRatio = pStats->nPages?(float)szUsed/((float)pStats->nPages*m_nPageSize*m_nPageSize):0.0f;
+    }
+}
@@ -0,0 +1,198 @@
+﻿#include "souistd.h"
+#include "res.mgr/SSkinDiskCache.h"
+
+namespace SOUI
+{
+    template<> SSkinDiskCache * SSingleton<SSkinDiskCache>::ms_Singleton = 0;
+
+    const DWORD KScaledImgMagic   = 0x4B534353;    //'SCSK'
+    const DWORD KScaledImgVersion = 1;
+    const TCHAR KScaledImgExt[]   = _T(".sks");
+
+#pragma pack(push,4)
+    //缓存文件头, 后面紧跟nWid*nHei*4字节的预乘BGRA像素
+    struct SCALEDIMGHEADER
+    {
+        DWORD       dwMagic;
+        DWORD       dwVersion;
+        ULONGLONG   ullSrcHash;     //源图片像素hash
+        int         nSrcWid;
+        int         nSrcHei;
+        int         nWid;
+        int         nHei;
+        int         nFilter;
+        DWORD       dwReserved;
+    };
+#pragma pack(pop)
+
+    SSkinDiskCache::SSkinDiskCache()
+    {
+    }
+
+    SSkinDiskCache::~SSkinDiskCache()
+    {
+    }
+
+    BOOL SSkinDiskCache::SetCacheDir(LPCTSTR pszDir)
+    {
+        SAutoLock lock(m_cs);
+        m_strDir.Empty();
+        if(!pszDir || !pszDir[0]) return FALSE;
+
+        SStringT strDir = pszDir;
+        if(strDir.Right(1) == _T("\\") || strDir.Right(1) == _T("/"))
+            strDir = strDir.Left(strDir.GetLength()-1);
+
+        if(GetFileAttributes(strDir) == INVALID_FILE_ATTRIBUTES)
+        {
+            //逐级创建目录
+            for(int i=0;i<strDir.GetLength();i++)
+            {
+                if(i>0 && (strDir[i]==_T('\\') || strDir[i]==_T('/')) && strDir[i-1]!=_T(':'))
+                    CreateDirectory(strDir.Left(i),NULL);
+            }
+            CreateDirectory(strDir,NULL);
+        }
+        DWORD dwAttr = GetFileAttributes(strDir);
+        if(dwAttr == INVALID_FILE_ATTRIBUTES || !(dwAttr & FILE_ATTRIBUTE_DIRECTORY))
+            return FALSE;
+        m_strDir = strDir;
+        return TRUE;
+    }
+
+    //FNV-1a 64位hash, 按DWORD处理
+    ULONGLONG SSkinDiskCache::HashPixels(IBitmap *pImg)
+    {
+        const DWORD *p = (const DWORD*)pImg->GetPixelBits();
+        ULONGLONG ullHash = 14695981039346656037ULL;
+        if(!p) return ullHash;
+        int nPixels = pImg->Width()*pImg->Height();
+        for(int i=0;i<nPixels;i++)
+        {
+            ullHash ^= p[i];
+            ullHash *= 1099511628211ULL;
+        }
+        return ullHash;
+    }
+
+    SStringT SSkinDiskCache::_GetCacheFile(ULONGLONG ullSrcHash,SIZE szDest,FilterLevel fl) const
+    {
+        return SStringT().Format(_T("%s\\%08x%08x_%dx%d_%d%s"),(LPCTSTR)m_strDir,
+            (DWORD)(ullSrcHash>>32),(DWORD)ullSrcHash,szDest.cx,szDest.cy,(int)fl,KScaledImgExt);
+    }
+
+    BOOL SSkinDiskCache::LoadScaledImage(IBitmap *pSrc,SIZE szDest,FilterLevel fl,IBitmap **ppDest)
+    {
+        if(!pSrc || !ppDest || szDest.cx<=0 || szDest.cy<=0) return FALSE;
+        SAutoLock lock(m_cs);
+        if(m_strDir.IsEmpty()) return FALSE;
+
+        ULONGLONG ullSrcHash = HashPixels(pSrc);
+        SStringT strFile = _GetCacheFile(ullSrcHash,szDest,fl);
+
+        HANDLE hFile = CreateFile(strFile,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+        if(hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+        BOOL bRet = FALSE;
+        DWORD dwPixelBytes = szDest.cx*szDest.cy*4;
+        DWORD dwSizeHigh = 0;
+        DWORD dwSize = GetFileSize(hFile,&dwSizeHigh);
+        if(dwSizeHigh == 0 && dwSize == sizeof(SCALEDIMGHEADER)+dwPixelBytes)
+        {
+            HANDLE hMap = CreateFileMapping(hFile,NULL,PAGE_READONLY,0,0,NULL);
+            if(hMap)
+            {
+                const BYTE *pView = (const BYTE*)MapViewOfFile(hMap,FILE_MAP_READ,0,0,0);
+                if(pView)
+                {
+                    const SCALEDIMGHEADER *pHdr = (const SCALEDIMGHEADER*)pView;
+                    if(pHdr->dwMagic == KScaledImgMagic
+                        && pHdr->dwVersion == KScaledImgVersion
+                        && pHdr->ullSrcHash == ullSrcHash
+                        && pHdr->nSrcWid == pSrc->Width()
+                        && pHdr->nSrcHei == pSrc->Height()
+                        && pHdr->nWid == szDest.cx
+                        && pHdr->nHei == szDest.cy
+                        && pHdr->nFilter == (int)fl)
+                    {
+                        IBitmap *pImg = NULL;
+                        pSrc->GetRenderFactory()->CreateBitmap(&pImg);
+                        if(pImg)
+                        {
+                            if(SUCCEEDED(pImg->Init(szDest.cx,szDest.cy,(LPVOID)(pHdr+1))))
+                            {
+                                *ppDest = pImg;
+                                bRet = TRUE;
+                            }else
+                            {
+                                pImg->Release();
+                            }
+                        }
+                    }
+                    UnmapViewOfFile(pView);
+                }
+                CloseHandle(hMap);
+            }
+        }
+        CloseHandle(hFile);
+
+        if(!bRet)
+        {//无效的缓存文件
+            DeleteFile(strFile);
+        }
+        return bRet;
+    }
+
+    BOOL SSkinDiskCache::SaveScaledImage(IBitmap *pSrc,FilterLevel fl,IBitmap *pDest)
+    {
+        if(!pSrc || !pDest) return FALSE;
+        SAutoLock lock(m_cs);
+        if(m_strDir.IsEmpty()) return FALSE;
+
+        const void *pBits = pDest->GetPixelBits();
+        if(!pBits) return FALSE;
+
+        SCALEDIMGHEADER hdr = {0};
+        hdr.dwMagic = KScaledImgMagic;
+        hdr.dwVersion = KScaledImgVersion;
+        hdr.ullSrcHash = HashPixels(pSrc);
+        hdr.nSrcWid = pSrc->Width();
+        hdr.nSrcHei = pSrc->Height();
+        hdr.nWid = pDest->Width();
+        hdr.nHei = pDest->Height();
+        hdr.nFilter = (int)fl;
+
+        CSize szDest(hdr.nWid,hdr.nHei);
+        SStringT strFile = _GetCacheFile(hdr.ullSrcHash,szDest,fl);
+        //先写临时文件再改名, 防止其它进程读到不完整的文件
+        SStringT strTmp = strFile + SStringT().Format(_T(".%u"),GetCurrentProcessId());
+
+        HANDLE hFile = CreateFile(strTmp,GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+        if(hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+        DWORD dwPixelBytes = hdr.nWid*hdr.nHei*4;
+        DWORD dwWrite = 0;
+        BOOL bRet = WriteFile(hFile,&hdr,sizeof(hdr),&dwWrite,NULL) && dwWrite == sizeof(hdr);
+        if(bRet) bRet = WriteFile(hFile,pBits,dwPixelBytes,&dwWrite,NULL) && dwWrite == dwPixelBytes;
+        CloseHandle(hFile);
+
+        if(bRet) bRet = MoveFileEx(strTmp,strFile,MOVEFILE_REPLACE_EXISTING);
+        if(!bRet) DeleteFile(strTmp);
+        return bRet;
+    }
+
+    void SSkinDiskCache::Clear()
+    {
+        SAutoLock lock(m_cs);
+        if(m_strDir.IsEmpty()) return;
+
+        WIN32_FIND_DATA wfd;
+        HANDLE hFind = FindFirstFile(m_strDir + _T("\\*") + KScaledImgExt,&wfd);
+        if(hFind == INVALID_HANDLE_VALUE) return;
+        do
+        {
+            DeleteFile(m_strDir + _T("\\") + wfd.cFileName);
+        }while(FindNextFile(hFind,&wfd));
+        FindClose(hFind);
+    }
+}
@@ -3,6 +3,7 @@
 #include "core/Sskin.h"
 #include "SApp.h"
 #include "helper/mybuffer.h"
+#include "helper/SplitString.h"
 
 namespace SOUI
 {
@@ -10,7 +11,7 @@ namespace SOUI
 //////////////////////////////////////////////////////////////////////////
 // SSkinPool
 
-SSkinPool::SSkinPool()
+SSkinPool::SSkinPool():m_pAtlas(NULL)
 {
     m_pFunOnKeyRemoved=OnKeyRemoved;
 }
@@ -20,28 +21,47 @@ SSkinPool::~SSkinPool()
 #ifdef _DEBUG
     //查询哪些皮肤运行过程中没有使用过,将结果用输出到Output
     STRACEW(L"####Detecting Defined Skin Usage BEGIN");    
-    SPOSITION pos = m_mapNamedObj->GetStartPosition();
-    while(pos)
+    SArray<SkinKey> lstUnused;
+    GetUnusedSkins(lstUnused);
+    for(size_t i=0;i<lstUnused.GetCount();i++)
     {
-        SkinKey skinKey = m_mapNamedObj->GetNextKey(pos);
-        if(!m_mapSkinUseCount.Lookup(skinKey))
-        {
-            STRACEW(L"skin of [%s.%d] was not used.",skinKey.strName,skinKey.scale);
-        }
+        STRACEW(L"skin of [%s.%d] was not used.",lstUnused[i].strName,lstUnused[i].scale);
     }
     STRACEW(L"!!!!Detecting Defined Skin Usage END");    
 #endif
+    if(m_pAtlas) delete m_pAtlas;
+}
+
+void SSkinPool::EnableAtlas(BOOL bEnable)
+{
+    if(bEnable && !m_pAtlas)
+    {
+        m_pAtlas = new SSkinAtlas;
+    }else if(!bEnable && m_pAtlas)
+    {//已经合并的skin继续引用大图
+        delete m_pAtlas;
+        m_pAtlas = NULL;
+    }
+}
+
+BOOL SSkinPool::GetAtlasStats(SKINATLASSTATS *pStats) const
+{
+    if(!m_pAtlas) return FALSE;
+    m_pAtlas->GetStats(pStats);
+    return TRUE;
 }
 
 int SSkinPool::LoadSkins(pugi::xml_node xmlNode)
 {
     if(!xmlNode) return 0;
+    SPROFILE_SCOPE("SSkinPool::LoadSkins");
     
     int nLoaded=0;
     SStringW strSkinName, strTypeName;
+    SArray<SkinKey> lstPreload;
 
-	//loadSkins前把this加入到poolmgr,便于在skin中引用其它skin
-	SSkinPoolMgr::getSingleton().PushSkinPool(this);
+    if(xmlNode.attribute(L"atlas").as_bool(false))
+        EnableAtlas(TRUE);
 
     pugi::xml_node xmlSkin=xmlNode.first_child();
     while(xmlSkin)
@@ -54,30 +74,126 @@ int SSkinPool::LoadSkins(pugi::xml_node xmlNode)
             xmlSkin=xmlSkin.next_sibling();
             continue;
         }
-            
-        
-        ISkinObj *pSkin=SApplication::getSingleton().CreateSkinByName(strTypeName);
-        if(pSkin)
+
+        //只保存XML描述, 第一次GetSkin时再创建
+        SkinKey key = {strSkinName,xmlSkin.attribute(L"scale").as_int(100)};
+        SASSERT(!_HasSkin(key));
+        if(!_HasSkin(key))
         {
-            pSkin->InitFromXml(xmlSkin);
-			SkinKey key = {strSkinName,pSkin->GetScale()};
-			SASSERT(!HasKey(key));
-            AddKeyObject(key,pSkin);
+            m_mapPending[key] = m_xmlPending.append_copy(xmlSkin);
+            if(xmlSkin.attribute(L"preload").as_bool(false))
+                lstPreload.Add(key);
             nLoaded++;
         }
-        else
-        {
-            SASSERT_FMTW(FALSE,L"load skin error,type=%s,name=%s",strTypeName,strSkinName);
-        }
         xmlSkin=xmlSkin.next_sibling();
     }
 
-	//由于push时直接把this加入tail，为了防止重复调用，这里传NULL,直接从tail删除。
-	SSkinPoolMgr::getSingleton().PopSkinPool(NULL);
+    for(size_t i=0;i<lstPreload.GetCount();i++)
+    {
+        _GetSkin(lstPreload[i]);
+    }
 
+    SPROFILE_COUNT(nLoaded,0);
     return nLoaded;
 }
 
+int SSkinPool::WarmUp(const SStringW & strSkinNames,int nScale)
+{
+    SArray<SStringW> lstNames;
+    SplitString(strSkinNames,L',',lstNames);
+
+    int nCreated = 0;
+    for(size_t i=0;i<lstNames.GetCount();i++)
+    {
+        SStringW strName = lstNames[i];
+        strName.TrimBlank();
+        SkinKey key = {strName,nScale};
+        if(!m_mapPending.Lookup(key))
+        {
+            key.scale = 100;
+            if(!m_mapPending.Lookup(key)) continue;
+        }
+        if(_CreatePendingSkin(key)) nCreated++;
+    }
+    return nCreated;
+}
+
+size_t SSkinPool::GetUnusedSkins(SArray<SkinKey> & lstSkins) const
+{
+    SPOSITION pos = m_mapPending.GetStartPosition();
+    while(pos)
+    {
+        lstSkins.Add(m_mapPending.GetNextKey(pos));
+    }
+    pos = m_mapNamedObj->GetStartPosition();
+    while(pos)
+    {
+        SkinKey skinKey = m_mapNamedObj->GetNextKey(pos);
+        if(!m_mapSkinUseCount.Lookup(skinKey))
+        {
+            lstSkins.Add(skinKey);
+        }
+    }
+    return lstSkins.GetCount();
+}
+
+size_t SSkinPool::GetCount()
+{
+    return SCmnMap<SSkinPtr,SkinKey>::GetCount() + m_mapPending.GetCount();
+}
+
+void SSkinPool::RemoveAll()
+{
+    SCmnMap<SSkinPtr,SkinKey>::RemoveAll();
+    m_mapPending.RemoveAll();
+    m_xmlPending.reset();
+    m_mapSkinUseCount.RemoveAll();
+}
+
+bool SSkinPool::_HasSkin(const SkinKey & key) const
+{
+    return HasKey(key) || m_mapPending.Lookup(key)!=NULL;
+}
+
+ISkinObj * SSkinPool::_GetSkin(const SkinKey & key)
+{
+    const SMap<SkinKey,SSkinPtr>::CPair *p = m_mapNamedObj->Lookup(key);
+    if(p) return p->m_value;
+    return _CreatePendingSkin(key);
+}
+
+ISkinObj * SSkinPool::_CreatePendingSkin(const SkinKey & key)
+{
+    SMap<SkinKey,pugi::xml_node>::CPair *p = m_mapPending.Lookup(key);
+    if(!p) return NULL;
+    pugi::xml_node xmlSkin = p->m_value;
+    //先从等待列表中删除, 防止skin引用自己时重复创建
+    m_mapPending.RemoveKey(key);
+
+    ISkinObj *pSkin=SApplication::getSingleton().CreateSkinByName(xmlSkin.name());
+    if(!pSkin)
+    {
+        SASSERT_FMTW(FALSE,L"load skin error,type=%s,name=%s",xmlSkin.name(),key.strName);
+        m_xmlPending.remove_child(xmlSkin);
+        return NULL;
+    }
+
+    //创建前把this加入到poolmgr,便于在skin中引用同一个pool中的其它skin
+    SSkinPoolMgr::getSingleton().PushSkinPool(this);
+    pSkin->InitFromXml(xmlSkin);
+    //由于push时直接把this加入tail，为了防止重复调用，这里传NULL,直接从tail删除。
+    SSkinPoolMgr::getSingleton().PopSkinPool(NULL);
+
+    m_xmlPending.remove_child(xmlSkin);
+    if(m_pAtlas)
+    {
+        SSkinImgList *pImgList = sobj_cast<SSkinImgList>(pSkin);
+        if(pImgList) pImgList->PackToAtlas(m_pAtlas,GETRESPROVIDER);
+    }
+    AddKeyObject(key,pSkin);
+    return pSkin;
+}
+
 const int KBuiltinScales [] =
 {
 	100,125,150,200,250,300
@@ -100,23 +216,25 @@ ISkinObj* SSkinPool::GetSkin(const SStringW & strSkinName,int nScale)
 {
 	SkinKey key ={strSkinName,nScale};
 
-    if(!HasKey(key))
+    if(!_HasSkin(key))
     {
 		nScale = NormalizeScale(nScale);
 		key.scale = nScale;
-		if (!HasKey(key))
+		if (!_HasSkin(key))
 		{
 			bool bFind = false;
 			for (int i = 0; i < ARRAYSIZE(KBuiltinScales); i++)
 			{
 				key.scale = KBuiltinScales[i];
-				bFind = HasKey(key);
+				bFind = _HasSkin(key);
 				if (bFind) break;
 			}
 			if (!bFind)
 				return NULL;
 
-			ISkinObj * pSkinSrc = GetKeyObject(key);
+			ISkinObj * pSkinSrc = _GetSkin(key);
+			if (!pSkinSrc)
+				return NULL;
 			ISkinObj * pSkin = pSkinSrc->Scale(nScale);
 			if (pSkin)
 			{
@@ -125,10 +243,9 @@ ISkinObj* SSkinPool::GetSkin(const SStringW & strSkinName,int nScale)
 			}
 		}
     }
-#ifdef _DEBUG
-    m_mapSkinUseCount[key]++;
-#endif
-    return GetKeyObject(key);
+    ISkinObj * pRet = _GetSkin(key);
+    if(pRet) m_mapSkinUseCount[key]++;
+    return pRet;
 }
 
 void SSkinPool::OnKeyRemoved(const SSkinPtr & obj )
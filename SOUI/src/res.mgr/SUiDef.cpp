@@ -66,6 +66,7 @@ namespace SOUI{
 
 	SUiDefInfo::SUiDefInfo(IResProvider *pResProvider,LPCTSTR pszUidef)
 	{
+		SPROFILE_SCOPE("SUiDefInfo::SUiDefInfo");
 		SStringTList strUiDef;
 		if(2!=ParseResID(pszUidef,strUiDef))
 		{
@@ -15,6 +15,7 @@
 #define COM_ZIPRESPROVIDER _T("resprovider-zipd.dll")
 #define COM_LOG4Z   _T("log4zd.dll")
 #define COM_7ZIPRESPROVIDER _T("resprovider-7zipd.dll")
+#define COM_PACKRESPROVIDER _T("resprovider-packd.dll")
 #else
 #define COM_RENDER_GDI  _T("render-gdi.dll")
 #define COM_RENDER_SKIA _T("render-skia.dll")
@@ -23,6 +24,7 @@
 #define COM_ZIPRESPROVIDER _T("resprovider-zip.dll")
 #define COM_LOG4Z   _T("log4z.dll")
 #define COM_7ZIPRESPROVIDER _T("resprovider-7zip.dll")
+#define COM_PACKRESPROVIDER _T("resprovider-pack.dll")
 #endif	// _DEBUG
 
 
@@ -46,6 +48,7 @@
     #pragma comment(lib,"resprovider-zipd")
     #pragma comment(lib,"7zd")
     #pragma comment(lib,"resprovider-7zipd")
+    #pragma comment(lib,"resprovider-packd")
     #pragma comment(lib,"log4zd")
 #else//_DEBUG
 
@@ -62,6 +65,7 @@
     #pragma comment(lib,"resprovider-zip")
     #pragma comment(lib,"7z")
     #pragma comment(lib,"resprovider-7zip")
+    #pragma comment(lib,"resprovider-pack")
     #pragma comment(lib,"log4z")
 #endif//_DEBUG
 
@@ -108,6 +112,10 @@ namespace SOUI
 	{
 		BOOL SCreateInstance(IObjRef **);
 	} 
+    namespace RESPROVIDER_PACK
+    {
+        BOOL SCreateInstance(IObjRef **);
+    }
     namespace LOG4Z
     {
         BOOL SCreateInstance(IObjRef **);
@@ -168,6 +176,11 @@ public:
 	{
 		return SOUI::RESPROVIDER_7ZIP::SCreateInstance(ppObj);
 	}
+
+    BOOL CreateResProvider_PACK(IObjRef **ppObj)
+    {
+        return SOUI::RESPROVIDER_PACK::SCreateInstance(ppObj);
+    }
     
     BOOL CreateLog4z(IObjRef **ppObj)
     {
@@ -228,6 +241,11 @@ public:
 	{
 		return zip7ResLoader.CreateInstance(COM_7ZIPRESPROVIDER, ppObj);
 	}
+
+    BOOL CreateResProvider_PACK(IObjRef **ppObj)
+    {
+        return packResLoader.CreateInstance(COM_PACKRESPROVIDER,ppObj);
+    }
 	
     BOOL CreateLog4z(IObjRef **ppObj)
     {
@@ -242,6 +260,7 @@ protected:
     SComLoader zipResLoader;
     SComLoader log4zLoader;
     SComLoader zip7ResLoader;
+    SComLoader packResLoader;
     
     SOUI::SStringT m_strImgDecoder;
 };
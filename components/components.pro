@@ -19,10 +19,12 @@ SUBDIRS += imgdecoder-gdip
 SUBDIRS += ScriptModule-LUA
 SUBDIRS += log4z
 SUBDIRS += resprovider-7zip
+SUBDIRS += resprovider-pack
 
 imgdecoder-png.depends += zlib png
 render-skia.depends += skia
 resprovider-zip.depends += zlib utilities
 translator.depends += utilities
 resprovider-7zip.depends += 7z utilities
+resprovider-pack.depends += utilities
 ScriptModule-LUA.depends += soui lua-52
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <png.h>
 #include <pngstruct.h>
 #include <pnginfo.h>
+#include <zlib.h>
 
 #include "decoder-apng.h"
 #include <assert.h>
@@ -57,6 +58,87 @@ mypng_read_data(png_structp png_ptr, png_bytep data, png_size_t length)
    }
 }
 
+//把帧延时转换为10ms单位
+static unsigned short calcDelay(png_uint_16 delay_num,png_uint_16 delay_den)
+{
+    if (delay_den==0 || delay_den==100)
+        return delay_num;
+    else if (delay_den==10)
+        return delay_num*10;
+    else if (delay_den==1000)
+        return delay_num/10;
+    else
+        return delay_num*100/delay_den;
+}
+
+//将帧数据(不含偏移)按指定的方式绘制到画布上
+static void blendFrame(png_bytep canvas,png_uint_32 bytesPerRow,const png_bytep frame,
+                       png_uint_32 x_offset,png_uint_32 y_offset,png_uint_32 width,png_uint_32 height,
+                       png_uint_32 frameBytesPerRow,png_byte blend_op)
+{
+    png_bytep lineDst=canvas+y_offset*bytesPerRow + 4 * x_offset;
+    const png_byte * lineSour=frame;
+    switch(blend_op)
+    {
+    case PNG_BLEND_OP_OVER:
+        {
+            for(unsigned int y=0;y<height;y++)
+            {
+                png_bytep lineDst1=lineDst;
+                const png_byte * lineSour1=lineSour;
+                for(unsigned int x=0;x<width;x++)
+                {
+                    png_byte alpha = lineSour1[3];
+                    for(int i=0;i<4;i++)
+                    {
+                        lineDst1[i] = (lineDst1[i]*(255-alpha)+lineSour1[i]*alpha)>>8;
+                    }
+                    lineDst1 += 4;
+                    lineSour1 += 4;
+                }
+                lineDst += bytesPerRow;
+                lineSour+= frameBytesPerRow;
+            }
+        }
+        break;
+    case PNG_BLEND_OP_SOURCE:
+        {
+            for(unsigned int  y=0;y<height;y++)
+            {
+                memcpy(lineDst,lineSour,width*4);
+                lineDst += bytesPerRow;
+                lineSour+= frameBytesPerRow;
+            }
+        }
+        break;
+    default:
+        SASSERT(FALSE);
+        break;
+    }
+}
+
+//清除帧占用的画布区域
+static void clearFrame(png_bytep canvas,png_uint_32 bytesPerRow,
+                       png_uint_32 x_offset,png_uint_32 y_offset,png_uint_32 width,png_uint_32 height)
+{
+    png_bytep lineDst=canvas+y_offset*bytesPerRow + 4 * x_offset;
+    for(unsigned int y=0;y<height;y++)
+    {
+        memset(lineDst,0,width*4);
+        lineDst += bytesPerRow;
+    }
+}
+
+//设置统一的输出格式: 8位RGBA
+static void setRGBATransform(png_structp png_ptr)
+{
+    png_set_expand(png_ptr);
+    png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png_ptr);
+    png_set_gray_to_rgb(png_ptr);
+    png_set_strip_16(png_ptr);
+}
+
 APNGDATA * loadPng(IPngReader *pSrc)
 {
 	png_bytep  dataFrame;
@@ -87,15 +169,7 @@ APNGDATA * loadPng(IPngReader *pSrc)
     png_set_read_fn(png_ptr_read,pSrc,mypng_read_data);
     png_set_sig_bytes(png_ptr_read, 8);
  
-    if ((png_ptr_read->bit_depth < 8) ||
-        (png_ptr_read->color_type == PNG_COLOR_TYPE_PALETTE) ||
-        (info_ptr_read->valid & PNG_INFO_tRNS))
-        png_set_expand(png_ptr_read);
-
-    png_set_add_alpha(png_ptr_read, 0xff, PNG_FILLER_AFTER);
-    png_set_interlace_handling(png_ptr_read);
-    png_set_gray_to_rgb(png_ptr_read);
-    png_set_strip_16(png_ptr_read);
+    setRGBATransform(png_ptr_read);
    
 	png_read_info(png_ptr_read, info_ptr_read);
     png_read_update_info(png_ptr_read, info_ptr_read);
@@ -130,6 +204,7 @@ APNGDATA * loadPng(IPngReader *pSrc)
         png_bytep data = (png_bytep)malloc( bytesPerFrame * apng->nFrames);//为每一帧分配内存
         png_bytep curFrame = (png_bytep)malloc(bytesPerFrame);
         memset(curFrame,0,bytesPerFrame);
+        png_bytep prevFrame = (png_bytep)malloc(bytesPerFrame);
                
         apng->nLoops = png_get_num_plays(png_ptr_read, info_ptr_read);
         apng->pDelay = (unsigned short*)malloc(sizeof(unsigned short)*apng->nFrames);
@@ -142,91 +217,39 @@ APNGDATA * loadPng(IPngReader *pSrc)
             //计算出帧延时信息
             if (png_get_valid(png_ptr_read, info_ptr_read, PNG_INFO_fcTL))
             {
-                png_uint_16 delay_num = info_ptr_read->next_frame_delay_num,
-                            delay_den = info_ptr_read->next_frame_delay_den;
-            
-                if (delay_den==0 || delay_den==100)
-                    apng->pDelay[iFrame] = delay_num;
-                else
-                    if (delay_den==10)
-                        apng->pDelay[iFrame] = delay_num*10;
-                    else
-                        if (delay_den==1000)
-                            apng->pDelay[iFrame] = delay_num/10;
-                        else
-                            apng->pDelay[iFrame] = delay_num*100/delay_den;
+                apng->pDelay[iFrame] = calcDelay(info_ptr_read->next_frame_delay_num,info_ptr_read->next_frame_delay_den);
             }else
             {
                 apng->pDelay[iFrame] = 0;
             }
             //读取PNG帧到dataFrame中，不含偏移数据
             png_read_image(png_ptr_read, rowPointers);
-            {//将当前帧数据绘制到当前显示帧中:1)获得绘制的背景；2)计算出绘制位置; 3)使用指定的绘制方式与背景混合
+            {//将当前帧数据绘制到当前显示帧中
+                png_byte dispose_op = info_ptr_read->next_frame_dispose_op;
+                if(dispose_op == PNG_DISPOSE_OP_PREVIOUS)
+                {//第一帧的PREVIOUS按BACKGROUND处理, 其它帧保存绘制前的画布
+                    if(iFrame==0) dispose_op = PNG_DISPOSE_OP_BACKGROUND;
+                    else memcpy(prevFrame,curFrame,bytesPerFrame);
+                }
 
+                blendFrame(curFrame,bytesPerRow,dataFrame,
+                    info_ptr_read->next_frame_x_offset,info_ptr_read->next_frame_y_offset,
+                    info_ptr_read->next_frame_width,info_ptr_read->next_frame_height,
+                    bytesPerRow,info_ptr_read->next_frame_blend_op);
 
-                //1)计算出绘制位置
-                png_bytep lineDst=curFrame+info_ptr_read->next_frame_y_offset*bytesPerRow + 4 * info_ptr_read->next_frame_x_offset;
-                png_bytep lineSour=dataFrame;
-                //2)使用指定的绘制方式与背景混合
-                switch(info_ptr_read->next_frame_blend_op)
-                {
-                case PNG_BLEND_OP_OVER:
-                    {
-                        for(unsigned int y=0;y<info_ptr_read->next_frame_height;y++)
-                        {
-                            png_bytep lineDst1=lineDst;
-                            png_bytep lineSour1=lineSour;
-                            for(unsigned int x=0;x<info_ptr_read->next_frame_width;x++)
-                            {
-                                png_byte alpha = lineSour1[3];
-                                *lineDst1++ = ((*lineDst1)*(255-alpha)+(*lineSour1++)*alpha)>>8;
-                                *lineDst1++ = ((*lineDst1)*(255-alpha)+(*lineSour1++)*alpha)>>8;
-                                *lineDst1++ = ((*lineDst1)*(255-alpha)+(*lineSour1++)*alpha)>>8;
-                                *lineDst1++ = ((*lineDst1)*(255-alpha)+(*lineSour1++)*alpha)>>8;
-                            }
-                            lineDst += bytesPerRow;
-                            lineSour+= bytesPerRow;
-                        }
-                    }
-                    break;
-                case PNG_BLEND_OP_SOURCE:
-                    {
-                        for(unsigned int  y=0;y<info_ptr_read->next_frame_height;y++)
-                        {
-                            memcpy(lineDst,lineSour,info_ptr_read->next_frame_width*4);
-                            lineDst += bytesPerRow;
-                            lineSour+= bytesPerRow;
-                        }
-                    }
-                    break;
-                default:
-                    SASSERT(FALSE);
-                    break;
-                }
-                
                 png_bytep targetFrame = data + bytesPerFrame * iFrame;
                 memcpy(targetFrame,curFrame,bytesPerFrame);
 
-                lineDst=curFrame+info_ptr_read->next_frame_y_offset*bytesPerRow + 4 * info_ptr_read->next_frame_x_offset;
-
-                //3)处理当前帧绘制区域
-                switch(info_ptr_read->next_frame_dispose_op)
+                //处理当前帧绘制区域
+                switch(dispose_op)
                 {
                 case PNG_DISPOSE_OP_BACKGROUND://clear background
-                    {
-                        for(unsigned int y=0;y<info_ptr_read->next_frame_height;y++)
-                        {
-                            memset(lineDst,0,info_ptr_read->next_frame_width*4);
-                            lineDst += bytesPerRow;
-                        }
-
-                    }
+                    clearFrame(curFrame,bytesPerRow,
+                        info_ptr_read->next_frame_x_offset,info_ptr_read->next_frame_y_offset,
+                        info_ptr_read->next_frame_width,info_ptr_read->next_frame_height);
                     break;
-                case PNG_DISPOSE_OP_PREVIOUS://copy previous frame
-                    if(iFrame>0)
-                    {
-                        memcpy(curFrame,targetFrame-bytesPerFrame,bytesPerFrame);
-                    }
+                case PNG_DISPOSE_OP_PREVIOUS://restore canvas before this frame
+                    memcpy(curFrame,prevFrame,bytesPerFrame);
                     break;
                 case PNG_DISPOSE_OP_NONE://using current frame, doing nothing
                     break;
@@ -237,6 +260,7 @@ APNGDATA * loadPng(IPngReader *pSrc)
             }
 
         }
+        free(prevFrame);
         free(curFrame);
         free(dataFrame);
         apng->pdata =data;
@@ -275,6 +299,413 @@ void APNG_Destroy( APNGDATA *apng )
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+//流式APNG: 只保存压缩数据, 按需解码合成帧
+
+#define APNG_RING_SIZE      3   //缓存的合成帧数量
+#define APNG_MAX_CHECKPOINT 4   //最多保存的画布检查点
+#define APNG_MIN_INTERVAL   8   //检查点的最小间隔
+
+struct APNGCHUNK
+{
+    png_uint_32 nOffset;    //数据在压缩流中的偏移(不含fdAT的序号)
+    png_uint_32 nLen;
+};
+
+struct APNGFRAMEINFO
+{
+    png_uint_32 x,y,w,h;
+    png_byte    dispose_op;
+    png_byte    blend_op;
+    int         iFirstChunk;    //第一个数据块在块表中的索引
+    int         nChunks;
+    bool        bKeyFrame;      //覆盖整个画布且不和背景混合, 不依赖前面的帧
+};
+
+struct APNGSTREAMIMPL
+{
+    png_bytep   pBuf;           //压缩数据
+    size_t      nLen;
+    png_uint_32 nIHDR;          //IHDR块的偏移
+    png_bytep   pShared;        //IHDR与第一个数据块之间的辅助块(PLTE,tRNS等), 解码每一帧时都需要
+    size_t      nShared;
+
+    APNGFRAMEINFO * pFrames;
+    APNGCHUNK * pChunks;
+    int         nChunks;
+
+    png_uint_32 bytesPerFrame;
+    png_bytep   canvas;         //第iNext帧绘制前的画布
+    png_bytep   prevCanvas;     //PNG_DISPOSE_OP_PREVIOUS使用
+    png_bytep   frameData;      //解码出来的帧数据(不含偏移)
+    int         iNext;
+
+    int         nInterval;      //检查点间隔
+    png_bytep   checkpoints[APNG_MAX_CHECKPOINT];   //第i*nInterval帧绘制前的画布
+
+    png_bytep   ring[APNG_RING_SIZE];
+    int         ringFrame[APNG_RING_SIZE];
+    int         iRingNext;
+
+    CRITICAL_SECTION cs;
+};
+
+static png_uint_32 readU32(const png_byte *p)
+{
+    return ((png_uint_32)p[0]<<24)|((png_uint_32)p[1]<<16)|((png_uint_32)p[2]<<8)|p[3];
+}
+
+static void writeU32(png_bytep p,png_uint_32 v)
+{
+    p[0]=(png_byte)(v>>24);p[1]=(png_byte)(v>>16);p[2]=(png_byte)(v>>8);p[3]=(png_byte)v;
+}
+
+//写一个PNG块, 返回写入的长度
+static size_t writeChunk(png_bytep pDst,const char *pszType,const png_byte *pData,png_uint_32 nLen)
+{
+    writeU32(pDst,nLen);
+    memcpy(pDst+4,pszType,4);
+    if(nLen) memcpy(pDst+8,pData,nLen);
+    writeU32(pDst+8+nLen,crc32(0,pDst+4,nLen+4));
+    return nLen+12;
+}
+
+static void APNGStream_Free(APNGSTREAM *apng)
+{
+    APNGSTREAMIMPL *p = (APNGSTREAMIMPL*)apng->pImpl;
+    if(p)
+    {
+        free(p->pBuf);
+        free(p->pShared);
+        free(p->pFrames);
+        free(p->pChunks);
+        free(p->canvas);
+        free(p->prevCanvas);
+        free(p->frameData);
+        for(int i=0;i<APNG_MAX_CHECKPOINT;i++) free(p->checkpoints[i]);
+        for(int i=0;i<APNG_RING_SIZE;i++) free(p->ring[i]);
+        DeleteCriticalSection(&p->cs);
+        free(p);
+    }
+    free(apng->pDelay);
+    free(apng);
+}
+
+//扫描压缩流中的块, 建立帧表. 不是动画时返回false
+static bool parseChunks(APNGSTREAM *apng,APNGSTREAMIMPL *p)
+{
+    static const png_byte sig[8]={137,80,78,71,13,10,26,10};
+    if(p->nLen < 8 || memcmp(p->pBuf,sig,8)!=0) return false;
+
+    int nFrames = 0;            //acTL中的帧数
+    int iFrame = -1;            //当前fcTL对应的帧
+    int nMaxChunks = 0;
+    bool bData = false;         //已经遇到了数据块
+
+    //第一遍统计数据块数量
+    bool bAnimated = false;
+    for(size_t pos=8;pos+12<=p->nLen;)
+    {
+        png_uint_32 nLen = readU32(p->pBuf+pos);
+        if(nLen > p->nLen-pos-12) return false;
+        const png_byte *pType = p->pBuf+pos+4;
+        if(memcmp(pType,"IDAT",4)==0 || memcmp(pType,"fdAT",4)==0) nMaxChunks++;
+        else if(memcmp(pType,"acTL",4)==0) bAnimated = true;
+        pos += nLen+12;
+    }
+    if(!bAnimated || nMaxChunks == 0) return false;
+    p->pChunks = (APNGCHUNK*)malloc(sizeof(APNGCHUNK)*nMaxChunks);
+    p->pShared = (png_bytep)malloc(p->nLen);
+
+    for(size_t pos=8;pos+12<=p->nLen;)
+    {
+        png_uint_32 nLen = readU32(p->pBuf+pos);
+        const png_byte *pType = p->pBuf+pos+4;
+        const png_byte *pData = p->pBuf+pos+8;
+        size_t nNext = pos+nLen+12;
+
+        if(memcmp(pType,"IHDR",4)==0)
+        {
+            if(nLen != 13) return false;
+            p->nIHDR = (png_uint_32)pos;
+            apng->nWid = readU32(pData);
+            apng->nHei = readU32(pData+4);
+        }else if(memcmp(pType,"acTL",4)==0)
+        {
+            if(nLen != 8 || p->pFrames) return false;
+            nFrames = readU32(pData);
+            if(nFrames <= 1 || nFrames > 0xffff) return false;
+            apng->nLoops = readU32(pData+4);
+            p->pFrames = (APNGFRAMEINFO*)malloc(sizeof(APNGFRAMEINFO)*nFrames);
+            apng->pDelay = (unsigned short*)malloc(sizeof(unsigned short)*nFrames);
+        }else if(memcmp(pType,"fcTL",4)==0)
+        {
+            if(nLen != 26 || !p->pFrames || iFrame+1 >= nFrames) return false;
+            APNGFRAMEINFO & fi = p->pFrames[++iFrame];
+            fi.w = readU32(pData+4);
+            fi.h = readU32(pData+8);
+            fi.x = readU32(pData+12);
+            fi.y = readU32(pData+16);
+            apng->pDelay[iFrame] = calcDelay((png_uint_16)((pData[20]<<8)|pData[21]),(png_uint_16)((pData[22]<<8)|pData[23]));
+            fi.dispose_op = pData[24];
+            fi.blend_op = pData[25];
+            fi.iFirstChunk = p->nChunks;
+            fi.nChunks = 0;
+            //先比较偏移再比较剩余空间, 防止x+w溢出
+            if(fi.w == 0 || fi.h == 0
+                || fi.x > (png_uint_32)apng->nWid || fi.w > (png_uint_32)apng->nWid - fi.x
+                || fi.y > (png_uint_32)apng->nHei || fi.h > (png_uint_32)apng->nHei - fi.y)
+                return false;
+            if(iFrame == 0 && fi.dispose_op == PNG_DISPOSE_OP_PREVIOUS)
+                fi.dispose_op = PNG_DISPOSE_OP_BACKGROUND;
+            fi.bKeyFrame = iFrame==0 || (fi.x==0 && fi.y==0 && fi.w==(png_uint_32)apng->nWid && fi.h==(png_uint_32)apng->nHei
+                && fi.blend_op==PNG_BLEND_OP_SOURCE && fi.dispose_op!=PNG_DISPOSE_OP_PREVIOUS);
+        }else if(memcmp(pType,"IDAT",4)==0 || memcmp(pType,"fdAT",4)==0)
+        {
+            bool bIDAT = pType[0]=='I';
+            bData = true;
+            if(iFrame >= 0 && (bIDAT?iFrame==0:nLen>4))
+            {//没有fcTL的IDAT是不参与动画的默认图片
+                APNGCHUNK & chunk = p->pChunks[p->nChunks++];
+                chunk.nOffset = (png_uint_32)(pos+8+(bIDAT?0:4));
+                chunk.nLen = bIDAT?nLen:nLen-4;
+                p->pFrames[iFrame].nChunks++;
+            }
+        }else if(memcmp(pType,"IEND",4)==0)
+        {
+            break;
+        }else if(!bData && iFrame<0)
+        {//保存PLTE,tRNS等辅助块
+            memcpy(p->pShared+p->nShared,p->pBuf+pos,nLen+12);
+            p->nShared += nLen+12;
+        }
+        pos = nNext;
+    }
+
+    if(!p->pFrames || iFrame+1 != nFrames || apng->nWid<=0 || apng->nHei<=0) return false;
+    for(int i=0;i<nFrames;i++)
+    {
+        if(p->pFrames[i].nChunks == 0) return false;
+    }
+    apng->nFrames = nFrames;
+    if(p->nShared) p->pShared = (png_bytep)realloc(p->pShared,p->nShared);
+    return true;
+}
+
+//把一帧的数据块组装成独立的PNG后用libpng解码到frameData
+static bool decodeFrame(APNGSTREAM *apng,APNGSTREAMIMPL *p,int iFrame)
+{
+    const APNGFRAMEINFO & fi = p->pFrames[iFrame];
+    size_t nSize = 8 + 25 + p->nShared + 12;
+    for(int i=0;i<fi.nChunks;i++) nSize += p->pChunks[fi.iFirstChunk+i].nLen + 12;
+
+    png_bytep pPng = (png_bytep)malloc(nSize);
+    png_bytep pDst = pPng;
+    memcpy(pDst,p->pBuf,8);
+    pDst += 8;
+    png_byte ihdr[13];
+    memcpy(ihdr,p->pBuf+p->nIHDR+8,13);
+    writeU32(ihdr,fi.w);
+    writeU32(ihdr+4,fi.h);
+    pDst += writeChunk(pDst,"IHDR",ihdr,13);
+    if(p->nShared)
+    {
+        memcpy(pDst,p->pShared,p->nShared);
+        pDst += p->nShared;
+    }
+    for(int i=0;i<fi.nChunks;i++)
+    {
+        const APNGCHUNK & chunk = p->pChunks[fi.iFirstChunk+i];
+        pDst += writeChunk(pDst,"IDAT",p->pBuf+chunk.nOffset,chunk.nLen);
+    }
+    pDst += writeChunk(pDst,"IEND",NULL,0);
+
+    IPngReader_Mem mem((const char*)pPng+8,nSize-8);
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    png_bytepp rowPointers = (png_bytepp)malloc(sizeof(png_bytep)*fi.h);
+    bool bRet = false;
+    if (!setjmp(png_jmpbuf(png_ptr)))
+    {
+        png_set_read_fn(png_ptr,&mem,mypng_read_data);
+        png_set_sig_bytes(png_ptr, 8);
+        setRGBATransform(png_ptr);
+        png_read_info(png_ptr, info_ptr);
+        png_read_update_info(png_ptr, info_ptr);
+
+        for(png_uint_32 i=0;i<fi.h;i++)
+            rowPointers[i] = p->frameData + fi.w * 4 * i;
+        png_read_image(png_ptr,rowPointers);
+        bRet = true;
+    }
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    free(rowPointers);
+    free(pPng);
+    return bRet;
+}
+
+//在当前画布上绘制第iNext帧, iFrame==iNext时把合成结果复制到pOut
+static void renderNextFrame(APNGSTREAM *apng,APNGSTREAMIMPL *p,png_bytep pOut)
+{
+    int iFrame = p->iNext;
+    const APNGFRAMEINFO & fi = p->pFrames[iFrame];
+    png_uint_32 bytesPerRow = apng->nWid*4;
+
+    if(fi.dispose_op == PNG_DISPOSE_OP_PREVIOUS)
+        memcpy(p->prevCanvas,p->canvas,p->bytesPerFrame);
+
+    if(decodeFrame(apng,p,iFrame))
+        blendFrame(p->canvas,bytesPerRow,p->frameData,fi.x,fi.y,fi.w,fi.h,fi.w*4,fi.blend_op);
+
+    if(pOut) memcpy(pOut,p->canvas,p->bytesPerFrame);
+
+    switch(fi.dispose_op)
+    {
+    case PNG_DISPOSE_OP_BACKGROUND:
+        clearFrame(p->canvas,bytesPerRow,fi.x,fi.y,fi.w,fi.h);
+        break;
+    case PNG_DISPOSE_OP_PREVIOUS:
+        memcpy(p->canvas,p->prevCanvas,p->bytesPerFrame);
+        break;
+    }
+    p->iNext = (iFrame+1)%apng->nFrames;
+    if(p->iNext == 0)
+    {
+        memset(p->canvas,0,p->bytesPerFrame);
+    }else if(p->iNext % p->nInterval == 0)
+    {//保存检查点
+        int iCheck = p->iNext / p->nInterval - 1;
+        if(iCheck < APNG_MAX_CHECKPOINT && !p->checkpoints[iCheck])
+        {
+            p->checkpoints[iCheck] = (png_bytep)malloc(p->bytesPerFrame);
+            memcpy(p->checkpoints[iCheck],p->canvas,p->bytesPerFrame);
+        }
+    }
+}
+
+//把画布恢复到第iFrame帧绘制前之前最近的可用状态
+static void seekCanvas(APNGSTREAMIMPL *p,int iFrame)
+{
+    //当前画布本身就在目标之前, 且中间没有更近的起点时直接继续绘制
+    int iStart = 0;
+    for(int i=iFrame;i>0;i--)
+    {
+        if(p->pFrames[i].bKeyFrame || (i%p->nInterval==0 && i/p->nInterval-1 < APNG_MAX_CHECKPOINT && p->checkpoints[i/p->nInterval-1]))
+        {
+            iStart = i;
+            break;
+        }
+    }
+    if(p->iNext <= iFrame && p->iNext >= iStart) return;
+
+    if(iStart == 0 || p->pFrames[iStart].bKeyFrame)
+        memset(p->canvas,0,p->bytesPerFrame);
+    else
+        memcpy(p->canvas,p->checkpoints[iStart/p->nInterval-1],p->bytesPerFrame);
+    p->iNext = iStart;
+}
+
+//只读取IHDR和数据块之前的acTL, 获得一帧的字节数和帧数. 不是动画时返回false
+static bool probeAnimation(const png_byte *pBuf,size_t nLen,size_t *pFrameBytes,png_uint_32 *pFrames)
+{
+    static const png_byte sig[8]={137,80,78,71,13,10,26,10};
+    if(nLen < 8+25 || memcmp(pBuf,sig,8)!=0 || memcmp(pBuf+12,"IHDR",4)!=0) return false;
+    png_uint_32 nWid = readU32(pBuf+16);
+    png_uint_32 nHei = readU32(pBuf+20);
+    if(nWid == 0 || nHei == 0 || nWid > 0x4000 || nHei > 0x4000) return false;
+    for(size_t pos=8;pos+12<=nLen;)
+    {
+        png_uint_32 nChunk = readU32(pBuf+pos);
+        if(nChunk > nLen-pos-12) break;
+        const png_byte *pType = pBuf+pos+4;
+        if(memcmp(pType,"acTL",4)==0)
+        {
+            if(nChunk != 8) break;
+            *pFrameBytes = (size_t)nWid*nHei*4;
+            *pFrames = readU32(pBuf+pos+8);
+            return true;
+        }
+        if(memcmp(pType,"IDAT",4)==0) break;
+        pos += nChunk+12;
+    }
+    return false;
+}
+
+APNGSTREAM * APNGStream_Open(const char * pBuf, size_t nLen, size_t nMinFrameBytes)
+{
+    if(!pBuf || nLen < 8) return NULL;
+    size_t nFrameBytes = 0;
+    png_uint_32 nFrames = 0;
+    if(!probeAnimation((const png_byte*)pBuf,nLen,&nFrameBytes,&nFrames)
+        || nFrames <= nMinFrameBytes/nFrameBytes)
+        return NULL;
+    APNGSTREAM * apng = (APNGSTREAM*)malloc(sizeof(APNGSTREAM));
+    memset(apng,0,sizeof(APNGSTREAM));
+    APNGSTREAMIMPL *p = (APNGSTREAMIMPL*)malloc(sizeof(APNGSTREAMIMPL));
+    memset(p,0,sizeof(APNGSTREAMIMPL));
+    InitializeCriticalSection(&p->cs);
+    apng->pImpl = p;
+
+    //先在原始数据上解析, 成功后再复制
+    p->pBuf = (png_bytep)pBuf;
+    p->nLen = nLen;
+    if(!parseChunks(apng,p) || apng->nWid > 0x4000 || apng->nHei > 0x4000)
+    {
+        p->pBuf = NULL;
+        APNGStream_Free(apng);
+        return NULL;
+    }
+    p->pBuf = (png_bytep)malloc(nLen);
+    memcpy(p->pBuf,pBuf,nLen);
+
+    p->bytesPerFrame = apng->nWid*apng->nHei*4;
+    p->canvas = (png_bytep)calloc(p->bytesPerFrame,1);
+    p->prevCanvas = (png_bytep)malloc(p->bytesPerFrame);
+    p->frameData = (png_bytep)malloc(p->bytesPerFrame);
+    p->nInterval = max(APNG_MIN_INTERVAL,(apng->nFrames+APNG_MAX_CHECKPOINT)/(APNG_MAX_CHECKPOINT+1));
+    for(int i=0;i<APNG_RING_SIZE;i++) p->ringFrame[i] = -1;
+    return apng;
+}
+
+bool APNGStream_GetFrame(APNGSTREAM *apng,int iFrame,unsigned char *pBuf)
+{
+    if(!apng || !pBuf || iFrame<0 || iFrame>=apng->nFrames) return false;
+    APNGSTREAMIMPL *p = (APNGSTREAMIMPL*)apng->pImpl;
+    EnterCriticalSection(&p->cs);
+    png_bytep pRet = NULL;
+    for(int i=0;i<APNG_RING_SIZE;i++)
+    {
+        if(p->ringFrame[i] == iFrame)
+        {
+            pRet = p->ring[i];
+            break;
+        }
+    }
+    if(!pRet)
+    {
+        int iSlot = p->iRingNext;
+        p->iRingNext = (p->iRingNext+1)%APNG_RING_SIZE;
+        if(!p->ring[iSlot]) p->ring[iSlot] = (png_bytep)malloc(p->bytesPerFrame);
+        p->ringFrame[iSlot] = iFrame;
+        pRet = p->ring[iSlot];
+
+        seekCanvas(p,iFrame);
+        while(p->iNext != iFrame)
+        {
+            renderNextFrame(apng,p,NULL);
+        }
+        renderNextFrame(apng,p,pRet);
+    }
+    memcpy(pBuf,pRet,p->bytesPerFrame);
+    LeaveCriticalSection(&p->cs);
+    return true;
+}
+
+void APNGStream_Close(APNGSTREAM *apng)
+{
+    if(apng) APNGStream_Free(apng);
+}
+
 bool SavePng(const unsigned char *pData, int nWid,int nHei,int nStride,const wchar_t * pszFileName)
 {
     
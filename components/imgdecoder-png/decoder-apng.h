@@ -16,4 +16,23 @@ APNGDATA * LoadAPNG_from_memory(const char * pBuf, size_t nLen);
 
 void APNG_Destroy(APNGDATA *apng);
 
+//流式APNG: 只保存压缩数据, 帧在请求时解码合成, 内存占用与帧数无关
+struct APNGSTREAM
+{
+    unsigned short *pDelay;
+    int   nWid,nHei;
+    int   nFrames;
+    int   nLoops;
+    void *pImpl;
+};
+
+//不是多帧APNG, 或者全部帧合成后不超过nMinFrameBytes字节时返回NULL.
+//只解析文件头就能判断大小, 小图片不会复制数据
+APNGSTREAM * APNGStream_Open(const char * pBuf, size_t nLen, size_t nMinFrameBytes);
+
+//把合成后的第iFrame帧(未预乘的RGBA)复制到pBuf, pBuf大小为nWid*nHei*4
+bool APNGStream_GetFrame(APNGSTREAM *apng,int iFrame,unsigned char *pBuf);
+
+void APNGStream_Close(APNGSTREAM *apng);
+
 bool SavePng(const unsigned char *pData, int nWid,int nHei,int nStride,const wchar_t * pszFileName);
\ No newline at end of file
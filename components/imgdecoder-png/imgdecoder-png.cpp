@@ -7,10 +7,31 @@
 
 namespace SOUI
 {
+    //swap rgba to bgra and do premultiply
+    static void SwapAndPremultiply(BYTE *p,int pixel_count)
+    {
+        for (int i=0; i < pixel_count; ++i) {
+            BYTE a = p[3];
+            BYTE t = p[0];
+            if (a) 
+            {
+                p[0] = (p[2] *a)/255;
+                p[1] = (p[1] * a)/255;
+                p[2] =  (t   * a)/255;
+            }else
+            {
+                memset(p,0,4);
+            }
+            p += 4;
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
     //  SImgFrame_PNG
     SImgFrame_PNG::SImgFrame_PNG()
         :m_pdata(NULL)
+        ,m_pStream(NULL)
+        ,m_iFrame(0)
         ,m_nWid(0)
         ,m_nHei(0)
         ,m_nFrameDelay(0)
@@ -27,9 +48,18 @@ namespace SOUI
         m_nFrameDelay=(nDelay);
     }
 
+    void SImgFrame_PNG::AttachStream( APNGSTREAM *pStream,int iFrame,int nWid,int nHei,int nDelay )
+    {
+        m_pStream=pStream;
+        m_iFrame=iFrame;
+        m_nWid=(nWid);
+        m_nHei=(nHei);
+        m_nFrameDelay=(nDelay);
+    }
+
     BOOL SImgFrame_PNG::GetSize( UINT *pWid,UINT *pHei )
     {
-        if(!m_pdata) return FALSE;
+        if(!m_pdata && !m_pStream) return FALSE;
         *pWid = m_nWid;
         *pHei = m_nHei;
         return TRUE;
@@ -37,7 +67,14 @@ namespace SOUI
 
     BOOL SImgFrame_PNG::CopyPixels( /* [unique][in] */ const RECT *prc, /* [in] */ UINT cbStride, /* [in] */ UINT cbBufferSize, /* [size_is][out] */ BYTE *pbBuffer )
     {
-        if(!m_pdata || cbBufferSize != m_nHei * m_nWid *4) return FALSE;
+        if(cbBufferSize != m_nHei * m_nWid *4) return FALSE;
+        if(m_pStream)
+        {
+            if(!APNGStream_GetFrame(m_pStream,m_iFrame,pbBuffer)) return FALSE;
+            SwapAndPremultiply(pbBuffer,m_nWid*m_nHei);
+            return TRUE;
+        }
+        if(!m_pdata) return FALSE;
         memcpy(pbBuffer,m_pdata,cbBufferSize);
         return TRUE;
     }
@@ -47,14 +84,30 @@ namespace SOUI
     // SImgX_PNG
     int SImgX_PNG::LoadFromMemory( void *pBuf,size_t bufLen )
     {
+        APNGSTREAM * pStream = APNGStream_Open((char*)pBuf,bufLen,KImgXStreamFrameBytes);
+        if(pStream) return _DoStream(pStream);
         APNGDATA * pdata =LoadAPNG_from_memory((char*)pBuf,bufLen);
         return _DoDecode(pdata);
     }
 
+    //文件只读一次, 由LoadFromMemory决定是否流式解码
     int SImgX_PNG::LoadFromFile( LPCWSTR pszFileName )
     {
-        APNGDATA * pdata =LoadAPNG_from_file(pszFileName);
-        return _DoDecode(pdata);
+        FILE *f = _wfopen(pszFileName,L"rb");
+        if(!f) return 0;
+        fseek(f,0,SEEK_END);
+        long nLen = ftell(f);
+        fseek(f,0,SEEK_SET);
+        int nRet = 0;
+        if(nLen > 0)
+        {
+            char *pBuf = (char*)malloc(nLen);
+            if(fread(pBuf,1,nLen,f) == (size_t)nLen)
+                nRet = LoadFromMemory(pBuf,nLen);
+            free(pBuf);
+        }
+        fclose(f);
+        return nRet;
     }
 
     int SImgX_PNG::LoadFromFile( LPCSTR pszFileName )
@@ -69,6 +122,7 @@ namespace SOUI
         :m_bPremultiplied(bPremultiplied)
         ,m_pImgArray(NULL)
         ,m_pngData(NULL)
+        ,m_pStream(NULL)
     {
 
     }
@@ -78,6 +132,7 @@ namespace SOUI
         if(m_pImgArray) delete []m_pImgArray;
         m_pImgArray = NULL;
         if(m_pngData) APNG_Destroy(m_pngData);
+        if(m_pStream) APNGStream_Close(m_pStream);
     }
 
     int SImgX_PNG::_DoDecode(APNGDATA *pData)
@@ -88,25 +143,9 @@ namespace SOUI
         int nWid = m_pngData->nWid;
         int nHei = m_pngData->nHei;
 
-        //swap rgba to bgra and do premultiply
         BYTE *p=m_pngData->pdata;
-        int pixel_count = nWid * nHei * m_pngData->nFrames;
-        for (int i=0; i < pixel_count; ++i) {
-            BYTE a = p[3];
-            BYTE t = p[0];
-            if (a) 
-            {
-                p[0] = (p[2] *a)/255;
-                p[1] = (p[1] * a)/255;
-                p[2] =  (t   * a)/255;
-            }else
-            {
-                memset(p,0,4);
-            }
-            p += 4;
-        }
+        SwapAndPremultiply(p,nWid * nHei * m_pngData->nFrames);
 
-        p=m_pngData->pdata;
         m_pImgArray = new SImgFrame_PNG[m_pngData->nFrames];
         for(int i=0;i<m_pngData->nFrames;i++)
         {
@@ -116,8 +155,20 @@ namespace SOUI
         return m_pngData->nFrames;
     }
 
+    int SImgX_PNG::_DoStream(APNGSTREAM *pStream)
+    {
+        m_pStream = pStream;
+        m_pImgArray = new SImgFrame_PNG[m_pStream->nFrames];
+        for(int i=0;i<m_pStream->nFrames;i++)
+        {
+            m_pImgArray[i].AttachStream(m_pStream,i,m_pStream->nWid,m_pStream->nHei,m_pStream->pDelay[i]);
+        }
+        return m_pStream->nFrames;
+    }
+
     UINT SImgX_PNG::GetFrameCount()
     {
+        if(m_pStream) return m_pStream->nFrames;
         return m_pngData?m_pngData->nFrames:0;
     }
 
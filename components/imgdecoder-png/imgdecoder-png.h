@@ -11,6 +11,7 @@
 #include <interface/render-i.h>
 
 struct APNGDATA;
+struct APNGSTREAM;
 
 namespace SOUI
 {
@@ -20,6 +21,8 @@ namespace SOUI
     public:
         SImgFrame_PNG();
         void Attach(const BYTE * pdata,int nWid,int nHei,int nDelay);
+        //流式解码, CopyPixels时才解码合成帧
+        void AttachStream(APNGSTREAM *pStream,int iFrame,int nWid,int nHei,int nDelay);
 
         virtual BOOL GetSize(UINT *pWid,UINT *pHei);
         virtual BOOL CopyPixels( 
@@ -32,6 +35,8 @@ namespace SOUI
         int     m_nFrameDelay;
         int     m_nWid, m_nHei;
         const BYTE   *m_pdata;
+        APNGSTREAM   *m_pStream;
+        int     m_iFrame;
     };
     
     class SImgX_PNG : public TObjRefImpl<IImgX>
@@ -53,10 +58,12 @@ namespace SOUI
         ~SImgX_PNG(void);
         
         int _DoDecode(APNGDATA *pData);
+        int _DoStream(APNGSTREAM *pStream);
 
         BOOL m_bPremultiplied;
         
         APNGDATA       *    m_pngData;
+        APNGSTREAM     *    m_pStream;
         SImgFrame_PNG  *    m_pImgArray;
     };
 
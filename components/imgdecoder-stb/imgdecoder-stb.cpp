@@ -2,6 +2,7 @@
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 #include <windows.h>
 #include "imgdecoder-stb.h"
+#include <pixelkernels.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -97,22 +98,7 @@ namespace SOUI
     void SImgX_STB::_DoPromultiply( BYTE *pdata,int nWid,int nHei )
     {
         //swap rgba to bgra and do premultiply
-        BYTE *p=pdata;
-        int pixel_count = nWid * nHei;
-        for (int i=0; i < pixel_count; ++i) {
-            stbi_uc a = p[3];
-            stbi_uc t = p[0];
-            if (a) 
-            {
-                p[0] = (p[2] *a)/255;
-                p[1] = (p[1] * a)/255;
-                p[2] =  (t   * a)/255;
-            }else
-            {
-                memset(p,0,4);
-            }
-            p += 4;
-        }    
+        SPixelKernels::PremultiplyRGBA(pdata,nWid * nHei);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -24,6 +24,13 @@ INCLUDEPATH += . \
 dir = ../..
 include($$dir/common.pri)
 
+CONFIG(debug,debug|release){
+	LIBS += utilitiesd.lib
+}
+else{
+	LIBS += utilities.lib
+}
+
 # Input
 HEADERS += imgdecoder-stb.h stb_image.h
 SOURCES += imgdecoder-stb.cpp
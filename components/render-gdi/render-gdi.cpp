@@ -54,6 +54,29 @@ namespace SOUI
 		return FALSE;
 	}
 
+    BOOL SRenderFactory_GDI::GetRenderTargetPoolStat(RTPOOLSTAT *pStat)
+    {
+        memset(pStat,0,sizeof(RTPOOLSTAT));
+        return FALSE;
+    }
+
+    BOOL SRenderFactory_GDI::MeasureText(IFont *pFont,LPCTSTR pszText,int cchLen,LPRECT pRc,UINT uFormat)
+    {
+        //每次调用使用独立的内存DC，保证线程安全
+        HDC hdc = CreateCompatibleDC(NULL);
+        if(!hdc) return FALSE;
+        HGDIOBJ hOldFont = ::SelectObject(hdc,((SFont_GDI*)pFont)->GetFont());
+        int nRet = ::DrawText(hdc,pszText,cchLen,pRc,uFormat|DT_CALCRECT);
+        if(!nRet)
+        {
+            pRc->right = pRc->left;
+            pRc->bottom = pRc->top;
+        }
+        ::SelectObject(hdc,hOldFont);
+        DeleteDC(hdc);
+        return TRUE;
+    }
+
     
     //////////////////////////////////////////////////////////////////////////
     //  SBitmap_GDI
@@ -1132,6 +1155,12 @@ namespace SOUI
 		return E_NOTIMPL;
 	}
 
+	//GDI不支持绘制时着色, 由调用者自己处理
+	HRESULT SRenderTarget_GDI::SetColorize(COLORREF cr)
+	{
+		return cr==0?S_OK:E_NOTIMPL;
+	}
+
 
     //////////////////////////////////////////////////////////////////////////
     namespace RENDER_GDI
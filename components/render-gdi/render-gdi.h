@@ -37,6 +37,10 @@ namespace SOUI
 		virtual BOOL CreatePathEffect(REFGUID guidEffect,IPathEffect ** ppPathEffect);
 		
 		virtual BOOL CreatePathMeasure(IPathMeasure ** ppPathMeasure);
+
+        virtual BOOL GetRenderTargetPoolStat(RTPOOLSTAT *pStat);
+
+        virtual BOOL MeasureText(IFont *pFont,LPCTSTR pszText,int cchLen,LPRECT pRc,UINT uFormat);
     protected:
         CAutoRefPtr<IImgDecoderFactory> m_imgDecoderFactory;
     };
@@ -368,6 +372,10 @@ namespace SOUI
 
 		virtual HRESULT DrawPath(const IPath * path,IPathEffect * pathEffect=NULL);
 
+		virtual HRESULT SetColorize(COLORREF cr);
+
+		virtual COLORREF GetColorize() const {return 0;}
+
 	protected:
         HDC               m_hdc;
         SColor            m_curColor;
@@ -1,8 +1,10 @@
 ﻿#include "drawtext-skia.h"
+#include <algorithm>
 
 #define DT_ELLIPSIS (DT_PATH_ELLIPSIS|DT_END_ELLIPSIS|DT_WORD_ELLIPSIS)
 #define CH_ELLIPSIS L"..."
 #define MAX(a,b)    (((a) > (b)) ? (a) : (b))
+#define SKTEXT_STACK_CHARS  256  //省略号处理时使用栈缓冲的字符数
 
 static size_t breakTextEx(const SkPaint *pPaint, const wchar_t* textD, size_t length, SkScalar maxWidth,
                           SkScalar* measuredWidth) 
@@ -132,37 +134,119 @@ SkScalar SkTextLayoutEx::drawLine( SkCanvas *canvas, SkScalar x, SkScalar y, int
     return m_paint->measureText(text,(iEnd-iBegin)*sizeof(wchar_t));
 }
 
+//wids单调不减,返回满足wids[k]<=fMax的最大k,且不会截断在代理对中间
+static int findHeadCut(const wchar_t *text,const SkScalar *wids,int nLen,SkScalar fMax)
+{
+    int k = (int)(std::upper_bound(wids,wids+nLen+1,fMax) - wids) - 1;
+    if(k<0) return 0;
+    if(k>0 && k<nLen && (text[k-1] & 0xFC00) == 0xD800) k--;
+    return k;
+}
+
+//返回满足wids[nLen]-wids[k]<=fMax的最小k
+static int findTailCut(const SkScalar *wids,int nLen,SkScalar fMax)
+{
+    int k = (int)(std::lower_bound(wids,wids+nLen+1,wids[nLen]-fMax) - wids);
+    return k>nLen?nLen:k;
+}
+
+void SkTextLayoutEx::measurePrefix(int iBegin,int iEnd,SkScalar *pWid) const
+{
+    const wchar_t *text=m_text.begin()+iBegin;
+    int nLen = iEnd-iBegin;
+    //getTextWidths按unichar返回宽度,一个代理对只有一项
+    SkAutoSTMalloc<SKTEXT_STACK_CHARS,SkScalar> widths(nLen);
+    int nChars = m_paint->getTextWidths(text,nLen*sizeof(wchar_t),widths.get());
+
+    pWid[0]=0.0f;
+    int iChar=0;
+    for(int i=0;i<nLen;i++)
+    {
+        SkScalar fWid = iChar<nChars?widths[iChar++]:0.0f;
+        if((text[i] & 0xFC00) == 0xD800 && i<nLen-1)
+        {//代理对的宽度计入第二个wchar_t
+            pWid[i+1]=pWid[i];
+            i++;
+        }
+        pWid[i+1]=pWid[i]+fWid;
+    }
+}
+
+void SkTextLayoutEx::drawEllipsisText(SkCanvas *canvas, SkScalar x, SkScalar y,const wchar_t *text,int nHead,int iTail,int nLen) const
+{
+    int nTail = nLen-iTail;
+    int nBuf = nHead+3+nTail;
+    SkAutoSTMalloc<SKTEXT_STACK_CHARS,wchar_t> buf(nBuf);
+    memcpy(buf.get(),text,nHead*sizeof(wchar_t));
+    memcpy(buf.get()+nHead,CH_ELLIPSIS,3*sizeof(wchar_t));
+    memcpy(buf.get()+nHead+3,text+iTail,nTail*sizeof(wchar_t));
+    canvas->drawText(buf.get(),nBuf*sizeof(wchar_t),x,y,*m_paint);
+}
+
 SkScalar SkTextLayoutEx::drawLineEndWithEllipsis( SkCanvas *canvas, SkScalar x, SkScalar y, int iBegin,int iEnd,SkScalar fontHei,SkScalar maxWidth )
 {
-    SkScalar widReq=m_paint->measureText(m_text.begin()+iBegin,(iEnd-iBegin)*sizeof(wchar_t));
-    if(widReq<=m_rcBound.width())
+    int nLen = iEnd-iBegin;
+    SkAutoSTMalloc<SKTEXT_STACK_CHARS+1,SkScalar> wids(nLen+1);
+    measurePrefix(iBegin,iEnd,wids.get());
+    if(wids[nLen]<=maxWidth)
     {
         return drawLine(canvas,x,y,iBegin,iEnd,fontHei);
     }else
     {
         SkScalar fWidEllipsis = m_paint->measureText(CH_ELLIPSIS,sizeof(CH_ELLIPSIS)-sizeof(wchar_t));
-        maxWidth-=fWidEllipsis;
-        
-        int i=0;
         const wchar_t *text=m_text.begin()+iBegin;
-        SkScalar fWid=0.0f;
-        while(i<(iEnd-iBegin))
+        int nHead = findHeadCut(text,wids.get(),nLen,maxWidth-fWidEllipsis);
+        if(!(m_uFormat & DT_CALCRECT))
         {
-            SkScalar fWord = m_paint->measureText(text+i,sizeof(wchar_t));
-            if(fWid + fWord > maxWidth) break;
-            fWid += fWord;
-            i++;
+            drawEllipsisText(canvas,x,y,text,nHead,nLen,nLen);
         }
-        if(!(m_uFormat & DT_CALCRECT))
+        return wids[nHead]+fWidEllipsis;
+    }
+}
+
+SkScalar SkTextLayoutEx::drawLineWithPathEllipsis( SkCanvas *canvas, SkScalar x, SkScalar y, int iBegin,int iEnd,SkScalar fontHei,SkScalar maxWidth )
+{
+    int nLen = iEnd-iBegin;
+    SkAutoSTMalloc<SKTEXT_STACK_CHARS+1,SkScalar> wids(nLen+1);
+    measurePrefix(iBegin,iEnd,wids.get());
+    if(wids[nLen]<=maxWidth)
+    {
+        return drawLine(canvas,x,y,iBegin,iEnd,fontHei);
+    }
+
+    SkScalar fWidEllipsis = m_paint->measureText(CH_ELLIPSIS,sizeof(CH_ELLIPSIS)-sizeof(wchar_t));
+    SkScalar fAvail = maxWidth-fWidEllipsis;
+    const wchar_t *text=m_text.begin()+iBegin;
+
+    int iSep = nLen;
+    for(int i=nLen-1;i>=0;i--)
+    {
+        if(text[i]==L'\\' || text[i]==L'/')
         {
-            wchar_t *pbuf=new wchar_t[i+3];
-            memcpy(pbuf,text,i*sizeof(wchar_t));
-            memcpy(pbuf+i,CH_ELLIPSIS,3*sizeof(wchar_t));
-            canvas->drawText(pbuf,(i+3)*sizeof(wchar_t),x,y,*m_paint);
-            delete []pbuf;
+            iSep=i;
+            break;
         }
-        return fWid+fWidEllipsis;
     }
+
+    int nHead,iTail;
+    if(iSep<nLen && wids[nLen]-wids[iSep]<=fAvail)
+    {//尽量保留最后一个路径分隔符之后的内容
+        iTail = iSep;
+        nHead = findHeadCut(text,wids.get(),iTail,fAvail-(wids[nLen]-wids[iTail]));
+    }else if(iSep<nLen)
+    {//文件名也显示不下,只显示文件名的尾部
+        nHead = 0;
+        iTail = findTailCut(wids.get(),nLen,fAvail);
+    }else
+    {//没有路径分隔符,在中间截断
+        iTail = findTailCut(wids.get(),nLen,fAvail/2);
+        nHead = findHeadCut(text,wids.get(),iTail,fAvail-(wids[nLen]-wids[iTail]));
+    }
+    if(!(m_uFormat & DT_CALCRECT))
+    {
+        drawEllipsisText(canvas,x,y,text,nHead,iTail,nLen);
+    }
+    return wids[nHead]+fWidEllipsis+(wids[nLen]-wids[iTail]);
 }
 
 SkRect SkTextLayoutEx::draw( SkCanvas* canvas )
@@ -193,9 +277,13 @@ SkRect SkTextLayoutEx::draw( SkCanvas* canvas )
     }
     x += m_rcBound.fLeft;
 
-    canvas->save();
-
-    canvas->clipRect(m_rcBound);
+    //DT_CALCRECT时允许canvas为NULL, 只计算不绘制
+    SkASSERT(canvas || (m_uFormat & DT_CALCRECT));
+    if(canvas)
+    {
+        canvas->save();
+        canvas->clipRect(m_rcBound);
+    }
 
     float height = m_rcBound.height();
     float y=m_rcBound.fTop - metrics.fAscent;
@@ -206,8 +294,11 @@ SkRect SkTextLayoutEx::draw( SkCanvas* canvas )
         {
             y += (height - textHeight)/2.0f;
         }
-        if(m_uFormat & DT_ELLIPSIS)
-        {//只支持在行尾增加省略号
+        if(m_uFormat & DT_PATH_ELLIPSIS)
+        {//在中间增加省略号
+            rcDraw.fRight = rcDraw.fLeft + drawLineWithPathEllipsis(canvas,x,y,0,m_text.count(),fontHeight,m_rcBound.width());
+        }else if(m_uFormat & DT_ELLIPSIS)
+        {//在行尾增加省略号
             rcDraw.fRight = rcDraw.fLeft + drawLineEndWithEllipsis(canvas,x,y,0,m_text.count(),fontHeight,m_rcBound.width());
         }else
         {
@@ -233,8 +324,11 @@ SkRect SkTextLayoutEx::draw( SkCanvas* canvas )
             int iBegin=m_lines[iLine];
             int iEnd = iLine<(m_lines.count()-1)?m_lines[iLine+1]:m_text.count();
             SkScalar lineWid;
-            if(m_uFormat & DT_ELLIPSIS)
-            {//只支持在行尾增加省略号
+            if(m_uFormat & DT_PATH_ELLIPSIS)
+            {//在中间增加省略号
+                lineWid=drawLineWithPathEllipsis(canvas,x,y,iBegin,iEnd,fontHeight,m_rcBound.width());
+            }else if(m_uFormat & DT_ELLIPSIS)
+            {//在行尾增加省略号
                 lineWid=drawLineEndWithEllipsis(canvas,x,y,iBegin,iEnd,fontHeight,m_rcBound.width());
             }else
             {
@@ -246,6 +340,6 @@ SkRect SkTextLayoutEx::draw( SkCanvas* canvas )
         rcDraw.fRight = rcDraw.fLeft + maxLineWid;
         rcDraw.fBottom = y + metrics.fAscent;
     }
-    canvas->restore();
+    if(canvas) canvas->restore();
     return rcDraw;
 }
@@ -3,6 +3,7 @@
 #include <core/SkPaint.h>
 #include <core/SkCanvas.h>
 #include <core/sktdarray.h>
+#include <core/SkTemplates.h>
 
 class SkTextLayoutEx {
 public:
@@ -14,6 +15,14 @@ public:
 private:
     SkScalar drawLineEndWithEllipsis(SkCanvas *canvas, SkScalar x, SkScalar y, int iBegin,int iEnd,SkScalar fontHei,SkScalar maxWidth);
 
+    SkScalar drawLineWithPathEllipsis(SkCanvas *canvas, SkScalar x, SkScalar y, int iBegin,int iEnd,SkScalar fontHei,SkScalar maxWidth);
+
+    //计算[iBegin,iEnd)的宽度前缀和: pWid[i]为前i个wchar_t的宽度,共(iEnd-iBegin+1)项
+    void measurePrefix(int iBegin,int iEnd,SkScalar *pWid) const;
+
+    //绘制 text[0,nHead) + "..." + text[iTail,nLen)
+    void drawEllipsisText(SkCanvas *canvas, SkScalar x, SkScalar y,const wchar_t *text,int nHead,int iTail,int nLen) const;
+
     SkScalar drawLine(SkCanvas *canvas, SkScalar x, SkScalar y, int iBegin,int iEnd,SkScalar fontHei);
 
     void buildLines();
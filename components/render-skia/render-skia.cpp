@@ -3,9 +3,11 @@
 #include <effects\SkDashPathEffect.h>
 #include <effects\SkGradientShader.h>
 #include <effects\SkBlurMaskFilter.h>
+#include <core\SkColorFilter.h>
 #include "../skia/src/effects/SkBlurMask.h"
 
 #include <gdialpha.h>
+#include <pixelkernels.h>
 
 #include "drawtext-skia.h"
 
@@ -109,15 +111,119 @@ namespace SOUI
 	//////////////////////////////////////////////////////////////////////////
 	// SRenderFactory_Skia
 
+    //缓存池中RenderTarget的最大数量
+    #define RTPOOL_MAX_COUNT    8
+    //超过该像素数的RenderTarget不放回缓存池，避免长期占用大块内存
+    #define RTPOOL_MAX_PIXELS   (512*512)
+
+    //RenderTarget尺寸所属的级别: 向上取整到2的幂, 只在同一级别内复用, 
+    //避免0x0或探测尺寸的请求把缓存池中的大画布缩小后丢弃
+    static int RTSizeClass(int n)
+    {
+        if(n<=0) return -1;
+        int nClass = 0;
+        while((1<<nClass) < n) nClass++;
+        return nClass;
+    }
+
+    SRenderFactory_Skia::~SRenderFactory_Skia()
+    {
+        SPOSITION pos = m_lstRTPool.GetHeadPosition();
+        while(pos)
+        {
+            delete m_lstRTPool.GetNext(pos);
+        }
+        m_lstRTPool.RemoveAll();
+
+        for(int i=0;i<ARRAYSIZE(m_mapTypeface);i++)
+        {
+            pos = m_mapTypeface[i].GetStartPosition();
+            while(pos)
+            {
+                SkTypeface *pTypeface = m_mapTypeface[i].GetNextValue(pos);
+                if(pTypeface) pTypeface->unref();
+            }
+        }
+        DeleteCriticalSection(&m_csRTPool);
+        DeleteCriticalSection(&m_csTypeface);
+    }
+
 	BOOL SRenderFactory_Skia::CreateRenderTarget( IRenderTarget ** ppRenderTarget ,int nWid,int nHei)
 	{
-		*ppRenderTarget = new SRenderTarget_Skia(this, nWid, nHei);
+        SRenderTarget_Skia *pRT = NULL;
+        BOOL bResize = FALSE;
+
+        EnterCriticalSection(&m_csRTPool);
+        //优先复用相同大小的RenderTarget, 否则复用最近放回的一个同级别RenderTarget
+        int nClassWid = RTSizeClass(nWid), nClassHei = RTSizeClass(nHei);
+        SPOSITION posMatch = NULL;
+        SPOSITION pos = m_lstRTPool.GetTailPosition();
+        while(pos)
+        {
+            SPOSITION posCur = pos;
+            SRenderTarget_Skia *p = m_lstRTPool.GetPrev(pos);
+            const SkBitmap & bmp = p->m_curBmp->GetSkBitmap();
+            if(bmp.width() == nWid && bmp.height() == nHei)
+            {
+                posMatch = posCur;
+                break;
+            }
+            if(!posMatch && RTSizeClass(bmp.width()) == nClassWid 
+                && RTSizeClass(bmp.height()) == nClassHei)
+            {
+                posMatch = posCur;
+            }
+        }
+        if(posMatch)
+        {
+            pRT = m_lstRTPool.GetAt(posMatch);
+            m_lstRTPool.RemoveAt(posMatch);
+            const SkBitmap & bmp = pRT->m_curBmp->GetSkBitmap();
+            bResize = bmp.width() != nWid || bmp.height() != nHei;
+            m_rtPoolStat.nReused ++;
+            if(bResize) m_rtPoolStat.nResized ++;
+        }else
+        {
+            m_rtPoolStat.nCreated ++;
+        }
+        m_rtPoolStat.nPooled = (UINT)m_lstRTPool.GetCount();
+        LeaveCriticalSection(&m_csRTPool);
+
+        if(pRT)
+            pRT->ReuseFromPool(this,nWid,nHei);
+        else
+            pRT = new SRenderTarget_Skia(this, nWid, nHei);
+		*ppRenderTarget = pRT;
 		return TRUE;
 	}
 
+    BOOL SRenderFactory_Skia::RecycleRenderTarget(SRenderTarget_Skia *pRT)
+    {
+        if(!pRT->ResetForPool()) return FALSE;
+
+        BOOL bRet = FALSE;
+        EnterCriticalSection(&m_csRTPool);
+        if(m_lstRTPool.GetCount() < RTPOOL_MAX_COUNT)
+        {
+            m_lstRTPool.AddTail(pRT);
+            bRet = TRUE;
+        }
+        m_rtPoolStat.nPooled = (UINT)m_lstRTPool.GetCount();
+        LeaveCriticalSection(&m_csRTPool);
+        return bRet;
+    }
+
+    BOOL SRenderFactory_Skia::GetRenderTargetPoolStat(RTPOOLSTAT *pStat)
+    {
+        EnterCriticalSection(&m_csRTPool);
+        *pStat = m_rtPoolStat;
+        LeaveCriticalSection(&m_csRTPool);
+        return TRUE;
+    }
+
     BOOL SRenderFactory_Skia::CreateFont( IFont ** ppFont , const LOGFONT &lf )
     {
-        *ppFont = new SFont_Skia(this,&lf);
+        *ppFont = new SFont_Skia(this,&lf,GetTypeface(lf));
         return TRUE;
     }
 
@@ -170,6 +276,8 @@ namespace SOUI
         ,m_hGetDC(0)
         ,m_uGetDCFlag(0)
 		,m_bAntiAlias(true)
+        ,m_crColorize(0)
+        ,m_pColorizeFilter(NULL)
 	{
         m_ptOrg.fX=m_ptOrg.fY=0.0f;
         m_pRenderFactory = pRenderFactory;
@@ -199,12 +307,73 @@ namespace SOUI
 	SRenderTarget_Skia::~SRenderTarget_Skia()
 	{
 		if(m_SkCanvas) delete m_SkCanvas;
+        SkSafeUnref(m_pColorizeFilter);
 	}
 
+    void SRenderTarget_Skia::OnFinalRelease()
+    {
+        //回收过程中保持类厂有效, 类厂析构时会释放缓存池
+        CAutoRefPtr<IRenderFactory> pRenderFactory = m_pRenderFactory;
+        SRenderFactory_Skia *pFactory = static_cast<SRenderFactory_Skia*>((IRenderFactory*)pRenderFactory);
+        if(!pFactory || !pFactory->RecycleRenderTarget(this))
+            delete this;
+    }
+
+    //检查渲染对象是否只被当前RenderTarget引用(m_defXXX及m_curXXX)
+    static bool IsOwnedByRT(IObjRef *pObj)
+    {
+        long cRef = pObj->AddRef();
+        pObj->Release();
+        return cRef == 3;
+    }
+
+    BOOL SRenderTarget_Skia::ResetForPool()
+    {
+        if(m_hGetDC) return FALSE;
+
+        SelectDefaultObject(OT_BITMAP);
+        SelectDefaultObject(OT_PEN);
+        SelectDefaultObject(OT_BRUSH);
+        SelectDefaultObject(OT_FONT);
+
+        //默认对象被外部引用(如通过GetCurrentObject取走位图)时不能复用
+        if(!IsOwnedByRT(m_defBmp) || !IsOwnedByRT(m_defPen) 
+            || !IsOwnedByRT(m_defBrush) || !IsOwnedByRT(m_defFont))
+            return FALSE;
+
+        const SkBitmap & bmp = m_curBmp->GetSkBitmap();
+        if(bmp.width() * bmp.height() > RTPOOL_MAX_PIXELS)
+            return FALSE;
+
+        m_SkCanvas->restoreToCount(1);
+        m_SkCanvas->resetMatrix();
+        m_ptOrg.fX=m_ptOrg.fY=0.0f;
+        m_curColor = SColor(0xFF000000);
+        m_uGetDCFlag = 0;
+        m_bAntiAlias = true;
+        m_crColorize = 0;
+        m_pRenderFactory = NULL;    //避免缓存池与类厂循环引用
+        return TRUE;
+    }
+
+    void SRenderTarget_Skia::ReuseFromPool(IRenderFactory *pRenderFactory,int nWid,int nHei)
+    {
+        m_cRef = 1;
+        m_pRenderFactory = pRenderFactory;
+        const SkBitmap & bmp = m_curBmp->GetSkBitmap();
+        if(bmp.width() == nWid && bmp.height() == nHei)
+        {//大小相同只需要清空位图
+            if(bmp.getPixels()) memset(bmp.getPixels(),0,bmp.getSize());
+        }else
+        {
+            SIZE sz = {nWid,nHei};
+            Resize(sz);
+        }
+    }
+
 	HRESULT SRenderTarget_Skia::CreateCompatibleRenderTarget( SIZE szTarget,IRenderTarget **ppRenderTarget )
 	{
-        SRenderTarget_Skia *pRT = new SRenderTarget_Skia(m_pRenderFactory,szTarget.cx,szTarget.cy);
-        *ppRenderTarget = pRT;
+        m_pRenderFactory->CreateRenderTarget(ppRenderTarget,szTarget.cx,szTarget.cy);
 		return S_OK;
 	}
 
@@ -621,8 +790,7 @@ namespace SOUI
 
         SkPaint paint;
         paint.setAntiAlias(m_bAntiAlias);
-        
-        if(byAlpha != 0xFF) paint.setAlpha(byAlpha);
+        InitBitmapPaint(paint,byAlpha);
         m_SkCanvas->drawBitmapRectToRect(bmp,&skrcSrc,skrcDst,&paint);
         return S_OK;
     }
@@ -656,7 +824,7 @@ namespace SOUI
 
         SkPaint paint;
         paint.setAntiAlias(true);
-        if(byAlpha != 0xFF) paint.setAlpha(byAlpha);
+        InitBitmapPaint(paint,byAlpha);
         
         SkPaint::FilterLevel fl = (SkPaint::FilterLevel)HIWORD(expendMode);//SkPaint::kNone_FilterLevel;
         paint.setFilterLevel(fl);
@@ -665,22 +833,8 @@ namespace SOUI
         {
             m_SkCanvas->drawBitmapRectToRect(bmp,&rcSrc,rcDest,&paint);
         }else
-        {
-            PushClipRect(pRcDest,RGN_AND);
-            
-            SkIRect rcSrc = toSkIRect(pRcSrc);
-            SkRect rcSubDest={0.0f,0.0f,(float)rcSrc.width(),(float)rcSrc.height()};
-            for(float y=rcDest.fTop;y<rcDest.fBottom;y+=rcSrc.height())
-            {
-                rcSubDest.offsetTo(rcDest.fLeft,y);               
-                for(float x=rcDest.fLeft;x<rcDest.fRight;x += rcSrc.width())
-                {
-                    m_SkCanvas->drawBitmapRect(bmp,&rcSrc,rcSubDest,&paint);
-                    rcSubDest.offset((float)rcSrc.width(),0.0f);
-                }
-            }
-            
-            PopClip();
+        {//一次绘制完成平铺, 不再逐块绘制
+            DrawBitmapTile(bmp,toSkIRect(pRcSrc),rcDest,paint);
         }
         return S_OK;
 
@@ -745,21 +899,57 @@ namespace SOUI
         {EM_NULL,expendMode,EM_NULL}
         };
         
+        //所有格子共用一个画笔, 直接调用canvas绘制
+        SBitmap_Skia *pBmp = (SBitmap_Skia*)pBitmap;
+        SkBitmap bmp=pBmp->GetSkBitmap();
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        InitBitmapPaint(paint,byAlpha);
+        paint.setFilterLevel((SkPaint::FilterLevel)HIWORD(expendMode));
+
         for(int y=0;y<3;y++)
         {
             if(ySrc[y] == ySrc[y+1]) continue;
             for(int x=0;x<3;x++)
             {
                 if(xSrc[x] == xSrc[x+1]) continue;
-                RECT rcSrc = {xSrc[x],ySrc[y],xSrc[x+1],ySrc[y+1]};
-                RECT rcDest ={xDest[x],yDest[y],xDest[x+1],yDest[y+1]};
-                DrawBitmapEx(&rcDest,pBitmap,&rcSrc,mode[y][x],byAlpha);
+                SkIRect rcSrc = SkIRect::MakeLTRB(xSrc[x],ySrc[y],xSrc[x+1],ySrc[y+1]);
+                SkRect rcDest = SkRect::MakeLTRB((SkScalar)xDest[x],(SkScalar)yDest[y],(SkScalar)xDest[x+1],(SkScalar)yDest[y+1]);
+                UINT modeLow = LOWORD(mode[y][x]);
+                BOOL bSameSize = rcSrc.width() == xDest[x+1]-xDest[x] && rcSrc.height() == yDest[y+1]-yDest[y];
+                if(bSameSize || modeLow == EM_STRETCH)
+                {//原始大小时平铺与拉伸都等价于直接绘制
+                    rcDest.offset(m_ptOrg);
+                    m_SkCanvas->drawBitmapRect(bmp,&rcSrc,rcDest,&paint);
+                }else if(modeLow == EM_TILE)
+                {
+                    rcDest.offset(m_ptOrg);
+                    DrawBitmapTile(bmp,rcSrc,rcDest,paint);
+                }else
+                {//EM_NULL的边缘按原来的方式裁剪绘制
+                    RECT rcSrc2 = {xSrc[x],ySrc[y],xSrc[x+1],ySrc[y+1]};
+                    RECT rcDest2 ={xDest[x],yDest[y],xDest[x+1],yDest[y+1]};
+                    DrawBitmapEx(&rcDest2,pBitmap,&rcSrc2,mode[y][x],byAlpha);
+                }
             }
         }
         
         return S_OK;
     }
 
+    void SRenderTarget_Skia::DrawBitmapTile(const SkBitmap & bmp,const SkIRect & rcSrc,const SkRect & rcDest,const SkPaint & paint)
+    {
+        SkBitmap bmpSub;
+        if(!bmp.extractSubset(&bmpSub,rcSrc)) return;
+
+        //shader的原点对齐到目标矩形的左上角, 与逐块绘制的结果一致
+        SkMatrix mtx;
+        mtx.setTranslate(rcDest.fLeft,rcDest.fTop);
+        SkPaint paintTile(paint);
+        paintTile.setShader(SkShader::CreateBitmapShader(bmpSub,SkShader::kRepeat_TileMode,SkShader::kRepeat_TileMode,&mtx))->unref();
+        m_SkCanvas->drawRect(rcDest,paintTile);
+    }
+
 	IRenderObj * SRenderTarget_Skia::GetCurrentObject( OBJTYPE uType )
 	{
 		IRenderObj *pRet=NULL;
@@ -1332,6 +1522,58 @@ namespace SOUI
 		return S_OK;
 	}
 
+    //着色滤镜, 与SDIBHelper::Colorize使用同一个查找表算法
+    class SColorizeFilter_Skia : public SkColorFilter
+    {
+    public:
+        SColorizeFilter_Skia(COLORREF cr):m_cr(cr)
+        {
+            SPixelKernels::BuildColorizeLut(m_lut,cr);
+        }
+
+        COLORREF GetColor() const {return m_cr;}
+
+        virtual void filterSpan(const SkPMColor src[], int count,SkPMColor result[]) const SK_OVERRIDE
+        {
+            if(src != result) memcpy(result,src,count*sizeof(SkPMColor));
+            SPixelKernels::Colorize((BYTE*)result,count,m_lut);
+        }
+
+        virtual uint32_t getFlags() const SK_OVERRIDE
+        {
+            return kAlphaUnchanged_Flag;
+        }
+
+#ifndef SK_IGNORE_TO_STRING
+        virtual void toString(SkString* str) const SK_OVERRIDE
+        {
+            str->appendf("SColorizeFilter_Skia: (%08x)",m_cr);
+        }
+#endif
+        SK_DECLARE_NOT_FLATTENABLE_PROCS(SColorizeFilter_Skia)
+
+    private:
+        COLORREF    m_cr;
+        COLORIZELUT m_lut;
+    };
+
+    HRESULT SRenderTarget_Skia::SetColorize(COLORREF cr)
+    {
+        m_crColorize = cr;
+        if(cr != 0 && (!m_pColorizeFilter || ((SColorizeFilter_Skia*)m_pColorizeFilter)->GetColor() != cr))
+        {
+            SkSafeUnref(m_pColorizeFilter);
+            m_pColorizeFilter = new SColorizeFilter_Skia(cr);
+        }
+        return S_OK;
+    }
+
+    void SRenderTarget_Skia::InitBitmapPaint(SkPaint & paint,BYTE byAlpha)
+    {
+        if(byAlpha != 0xFF) paint.setAlpha(byAlpha);
+        if(m_crColorize != 0) paint.setColorFilter(m_pColorizeFilter);
+    }
+
 
     //////////////////////////////////////////////////////////////////////////
 	// SBitmap_Skia
@@ -1629,23 +1871,13 @@ namespace SOUI
     }
 
     static int s_cFont =0;
-    SFont_Skia::SFont_Skia( IRenderFactory * pRenderFac,const LOGFONT * plf) 
+    SFont_Skia::SFont_Skia( IRenderFactory * pRenderFac,const LOGFONT * plf,SkTypeface *pTypeface) 
         :TSkiaRenderObjImpl<IFont>(pRenderFac)
-        ,m_skFont(NULL)
+        ,m_skFont(pTypeface)
 		,m_blurStyle((SkBlurStyle)-1)
 		,m_blurRadius(0.0f)
     {
         memcpy(&m_lf,plf,sizeof(LOGFONT));
-#ifdef UNICODE
-        SStringA strFace=S_CT2A(plf->lfFaceName,CP_UTF8);
-#else
-		SStringA strFace=S_CT2A(plf->lfFaceName,CP_ACP);
-#endif
-		BYTE style=SkTypeface::kNormal;
-        if(plf->lfItalic) style |= SkTypeface::kItalic;
-        if(plf->lfWeight == FW_BOLD) style |= SkTypeface::kBold;
-
-        m_skFont=SkTypeface::CreateFromName(strFace,(SkTypeface::Style)style);
 
         m_skPaint.setTextSize(SkIntToScalar(abs(plf->lfHeight)));
         m_skPaint.setUnderlineText(!!plf->lfUnderline);
@@ -1695,6 +1927,58 @@ namespace SOUI
 		}
 	}
 
+    BOOL SRenderFactory_Skia::MeasureText(IFont *pFont,LPCTSTR pszText,int cchLen,LPRECT pRc,UINT uFormat)
+    {
+		if(cchLen<0) cchLen= _tcslen(pszText);
+		if(cchLen==0)
+        {
+            pRc->right=pRc->left;
+            pRc->bottom=pRc->top;
+            return TRUE;
+        }
+
+        //使用局部的SkPaint计算，不需要canvas，可以在工作线程中调用
+        SFont_Skia *pFontSkia = (SFont_Skia*)pFont;
+		SStringW strW=S_CT2W(SStringT(pszText,cchLen));
+        SkPaint     txtPaint = pFontSkia->GetPaint();
+        txtPaint.setTypeface(pFontSkia->GetFont());
+        if(uFormat & DT_CENTER)
+            txtPaint.setTextAlign(SkPaint::kCenter_Align);
+        else if(uFormat & DT_RIGHT)
+            txtPaint.setTextAlign(SkPaint::kRight_Align);
+
+        SkRect skrc=toSkRect(pRc);
+        skrc=DrawText_Skia(NULL,strW,strW.GetLength(),skrc,txtPaint,uFormat|DT_CALCRECT);
+        pRc->left=(int)skrc.fLeft;
+        pRc->top=(int)skrc.fTop;
+        pRc->right=(int)skrc.fRight;
+        pRc->bottom=(int)skrc.fBottom;
+        return TRUE;
+    }
+
+    SkTypeface * SRenderFactory_Skia::GetTypeface(const LOGFONT &lf)
+    {
+#ifdef UNICODE
+        SStringA strFace=S_CT2A(lf.lfFaceName,CP_UTF8);
+#else
+		SStringA strFace=S_CT2A(lf.lfFaceName,CP_ACP);
+#endif
+		BYTE style=SkTypeface::kNormal;
+        if(lf.lfItalic) style |= SkTypeface::kItalic;
+        if(lf.lfWeight == FW_BOLD) style |= SkTypeface::kBold;
+
+        EnterCriticalSection(&m_csTypeface);
+        SkTypeface *pTypeface = NULL;
+        if(!m_mapTypeface[style].Lookup(strFace,pTypeface))
+        {
+            pTypeface = SkTypeface::CreateFromName(strFace,(SkTypeface::Style)style);
+            m_mapTypeface[style][strFace] = pTypeface;
+        }
+        if(pTypeface) pTypeface->ref();
+        LeaveCriticalSection(&m_csTypeface);
+        return pTypeface;
+    }
+
 	namespace RENDER_SKIA
     {
         BOOL SCreateInstance( IObjRef ** ppRenderFactory )
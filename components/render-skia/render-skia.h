@@ -15,6 +15,8 @@
 
 namespace SOUI
 {
+    class SRenderTarget_Skia;
+
 	//////////////////////////////////////////////////////////////////////////
 	// SRenderFactory_Skia
 	class SRenderFactory_Skia : public TObjRefImpl<IRenderFactory>
@@ -22,12 +24,13 @@ namespace SOUI
 	public:
 		SRenderFactory_Skia()
 		{
+            InitializeCriticalSection(&m_csTypeface);
+            InitializeCriticalSection(&m_csRTPool);
+            memset(&m_rtPoolStat,0,sizeof(m_rtPoolStat));
 		}
         
-        ~SRenderFactory_Skia()
-        {
-        }
-        
+        ~SRenderFactory_Skia();
+
 		virtual BOOL CreateRenderTarget(IRenderTarget ** ppRenderTarget,int nWid,int nHei);
         virtual BOOL CreateFont(IFont ** ppFont , const LOGFONT &lf);
         virtual BOOL CreateBitmap(IBitmap ** ppBitmap);
@@ -42,9 +45,25 @@ namespace SOUI
 
 		virtual BOOL CreatePathMeasure(IPathMeasure ** ppPathMeasure);
 
+        virtual BOOL GetRenderTargetPoolStat(RTPOOLSTAT *pStat);
+
+        virtual BOOL MeasureText(IFont *pFont,LPCTSTR pszText,int cchLen,LPRECT pRc,UINT uFormat);
+
+        //获取共享的SkTypeface, 同一字体名及风格的不同字号共用一个typeface, 返回值已经增加引用计数
+        SkTypeface * GetTypeface(const LOGFONT &lf);
+
+        //RenderTarget引用计数为0时调用, 返回TRUE表示已经放回缓存池
+        BOOL RecycleRenderTarget(SRenderTarget_Skia *pRT);
 
 	protected:
         CAutoRefPtr<IImgDecoderFactory> m_imgDecoderFactory;
+
+        SList<SRenderTarget_Skia*> m_lstRTPool;     //可复用的RenderTarget
+        RTPOOLSTAT                 m_rtPoolStat;
+        CRITICAL_SECTION           m_csRTPool;
+
+        SMap<SStringA,SkTypeface*> m_mapTypeface[4];   //按SkTypeface::Style分组的typeface缓存
+        CRITICAL_SECTION           m_csTypeface;
 	};
 
     
@@ -108,7 +127,7 @@ namespace SOUI
 	{
 		SOUI_CLASS_NAME(SFont_Skia,L"font")
 	public:
-		SFont_Skia(IRenderFactory * pRenderFac,const LOGFONT * plf);
+		SFont_Skia(IRenderFactory * pRenderFac,const LOGFONT * plf,SkTypeface *pTypeface);
 
         virtual ~SFont_Skia();
 
@@ -366,10 +385,13 @@ namespace SOUI
 	//////////////////////////////////////////////////////////////////////////
 	class SRenderTarget_Skia: public TObjRefImpl<IRenderTarget>
 	{
+        friend class SRenderFactory_Skia;
 	public:
 		SRenderTarget_Skia(IRenderFactory* pRenderFactory,int nWid,int nHei);
 		~SRenderTarget_Skia();
 
+        virtual void OnFinalRelease();
+
 		//只支持创建位图表面
 		virtual HRESULT CreateCompatibleRenderTarget(SIZE szTarget,IRenderTarget **ppRenderTarget);
 
@@ -472,6 +494,13 @@ namespace SOUI
 
 		virtual HRESULT DrawPath(const IPath * path, IPathEffect * pathEffect=NULL);
 
+		virtual HRESULT SetColorize(COLORREF cr);
+
+		virtual COLORREF GetColorize() const
+		{
+			return m_crColorize;
+		}
+
     public:
         SkCanvas *GetCanvas(){return m_SkCanvas;}
 
@@ -488,6 +517,17 @@ namespace SOUI
 
 
     protected:
+        //放回缓存池前恢复初始状态, 返回FALSE表示不能复用
+        BOOL ResetForPool();
+        //从缓存池中取出后重新初始化
+        void ReuseFromPool(IRenderFactory *pRenderFactory,int nWid,int nHei);
+
+        //绘制位图时使用的画笔, 设置了着色时附加着色滤镜
+        void InitBitmapPaint(SkPaint & paint,BYTE byAlpha);
+
+        //使用重复模式的位图shader把rcSrc平铺到rcDest, 只需要一次绘制
+        void DrawBitmapTile(const SkBitmap & bmp,const SkIRect & rcSrc,const SkRect & rcDest,const SkPaint & paint);
+
 		SkCanvas *m_SkCanvas;
         SColor            m_curColor;
 		CAutoRefPtr<SBitmap_Skia> m_curBmp;
@@ -509,6 +549,9 @@ namespace SOUI
         UINT m_uGetDCFlag;
 
 		bool			m_bAntiAlias;
+
+        COLORREF        m_crColorize;           //当前着色颜色
+        SkColorFilter * m_pColorizeFilter;      //最近使用的着色滤镜, 着色颜色不变时复用
 	};
 	
 	namespace RENDER_SKIA
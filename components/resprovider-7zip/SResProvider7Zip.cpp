@@ -3,6 +3,7 @@
 
 #include "SResProvider7Zip.h"
 #include <pugixml/pugixml.hpp>
+#include <sprofiler.h>
 
 extern HICON CURSORICON_LoadFromBuf(const BYTE * bits,DWORD filesize,INT width, INT height,BOOL fCursor, UINT loadflags);
 extern HICON CURSORICON_LoadFromFile( LPCWSTR filename,
@@ -106,13 +107,13 @@ namespace SOUI{
 
     BOOL SResProvider7Zip::_Init( HINSTANCE hInst,LPCTSTR pszResName,LPCTSTR pszType  ,LPCSTR pszPsw)
     {
-        if(!m_zipFile.Open(hInst,pszResName,pszType)) return FALSE;
-        m_zipFile.SetPassword(pszPsw);
+        if(!m_zipFile.Open(hInst,pszResName,pszPsw,pszType)) return FALSE;
         return _LoadSkin();
     }
 
     BOOL SResProvider7Zip::Init( WPARAM wParam,LPARAM lParam )
     {
+        SPROFILE_SCOPE("SResProvider7Zip::Init");
 		ZIP7RES_PARAM *zipParam = (ZIP7RES_PARAM*)wParam;
         m_renderFactory = zipParam->pRenderFac;
 		m_childDir = zipParam->pszChildDir;
@@ -122,6 +123,8 @@ namespace SOUI{
 			m_childDir.TrimRight(L'/');
 			m_childDir += L"\\";
 		}
+		m_zipFile.SetCacheBudget(zipParam->dwCacheBudget);
+		m_zipFile.SetStats(zipParam->pStats);
 		if (zipParam->type == ZIP7RES_PARAM::ZIPFILE)
             return _Init(zipParam->pszZipFile,zipParam->pszPsw);
         else
@@ -168,6 +171,7 @@ namespace SOUI{
 
     BOOL SResProvider7Zip::_LoadSkin()
     {
+        SPROFILE_SCOPE("SResProvider7Zip::LoadIndex");
         CZipFile zf;
         BOOL bIdx=m_zipFile.GetFile(m_childDir + UIRES_INDEX,zf);
         if(!bIdx) return FALSE;
@@ -185,6 +189,7 @@ namespace SOUI{
             {
                 SResID id(S_CW2T(resType.name()),S_CW2T(resFile.attribute(L"name").value()));
                 m_mapFiles[id] = m_childDir + S_CW2T(resFile.attribute(L"path").value());
+                SPROFILE_COUNT(1,0);
                 resFile=resFile.next_sibling();
             }
             resType = resType.next_sibling();
@@ -1,12 +1,13 @@
 ﻿#include "Zip7Archive.h"
 #include <assert.h>
 
-#include "SevenZip/SevenZipExtractor.h"
-#include "SevenZip/SevenZipExtractorMemory.h"
-#include "SevenZip/SevenZipLister.h" 
+#include "SevenZip/UsefulFunctions.h"
+#include "SevenZip/PropVariant2.h"
+#include "CPP/7zip/IPassword.h"
 
 #include <shlwapi.h>
 #pragma comment(lib, "shlwapi.lib")
+#pragma comment(lib, "ole32.lib")
 
 #include <crtdbg.h>
 #include <tchar.h>
@@ -43,34 +44,6 @@ static std::wstring StdStringtoWideString(const std::string &stdstring)
 }
 
 
-static std::string WString2String(const std::wstring &wstr)
-{
-	int len = wstr.length();
-	const wchar_t *pStr = wstr.c_str();
-	std::string buf;
-	 
-
-	if (len < 0 && len != -1)
-	{
-		return buf;
-	}
-
-	// figure out how many narrow characters we are going to get
-	int nChars = WideCharToMultiByte(CP_ACP, 0,	pStr, len, NULL, 0, NULL, NULL);
-	if (len == -1)
-		--nChars;
-	if (nChars == 0)
-		return "";
-
-	// convert the wide string to a narrow string
-	// nb: slightly naughty to write directly into the string like this
-	buf.resize(nChars);
-	WideCharToMultiByte(CP_ACP, 0, pStr, len, const_cast<char*>(buf.c_str()), nChars, NULL, NULL);
-
-	return buf;
-}
-
-
     CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		: m_dwPos(0)
 	{
@@ -175,30 +148,107 @@ static std::string WString2String(const std::wstring &wstr)
 	//////////////////////////////////////////////////////////////////////////
 	//CZipArchive
 	//////////////////////////////////////////////////////////////////////////
-	
+
+	using namespace SevenZip;
+	using namespace SevenZip::intl;
+
+	static const UInt32 KNoBlock = (UInt32)-1;
+	static const DWORD KDefCacheBudget = 32*1024*1024;	//默认缓存32M解压后的数据
+
+	//把解压数据追加到内存中
+	class CItemOutStream : public ISequentialOutStream, public CMyUnknownImp
+	{
+	public:
+		MY_UNKNOWN_IMP
+
+		CItemOutStream(std::vector<BYTE> &buf) :m_buf(buf) {}
+
+		STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
+		{
+			const BYTE *p = (const BYTE*)data;
+			m_buf.insert(m_buf.end(), p, p + size);
+			if (processedSize)
+				*processedSize = size;
+			return S_OK;
+		}
+	private:
+		std::vector<BYTE> &m_buf;
+	};
+
+	//只接收items中预先登记的文件, 其它文件(同一数据块中排在前面的文件)直接跳过
+	class CItemExtractCallback : public IArchiveExtractCallback, public ICryptoGetTextPassword, public CMyUnknownImp
+	{
+	public:
+		MY_UNKNOWN_IMP1(ICryptoGetTextPassword)
+
+		CItemExtractCallback(const std::wstring &strPsw, std::map<UInt32, std::vector<BYTE> > &items)
+			:m_strPsw(strPsw), m_items(items), m_bOK(true)
+		{
+		}
+
+		bool IsOK() const { return m_bOK; }
+
+		STDMETHOD(SetTotal)(UInt64 size) { return S_OK; }
+		STDMETHOD(SetCompleted)(const UInt64 *completeValue) { return S_OK; }
+
+		STDMETHOD(GetStream)(UInt32 index, ISequentialOutStream **outStream, Int32 askExtractMode)
+		{
+			*outStream = NULL;
+			if (askExtractMode != NArchive::NExtract::NAskMode::kExtract)
+				return S_OK;
+			std::map<UInt32, std::vector<BYTE> >::iterator it = m_items.find(index);
+			if (it == m_items.end())
+				return S_OK;
+			it->second.clear();
+			CMyComPtr<ISequentialOutStream> stream = new CItemOutStream(it->second);
+			*outStream = stream.Detach();
+			return S_OK;
+		}
+
+		STDMETHOD(PrepareOperation)(Int32 askExtractMode) { return S_OK; }
+
+		STDMETHOD(SetOperationResult)(Int32 opRes)
+		{
+			if (opRes != NArchive::NExtract::NOperationResult::kOK)
+				m_bOK = false;
+			return S_OK;
+		}
+
+		STDMETHOD(CryptoGetTextPassword)(BSTR *password)
+		{
+			return StringToBstr(m_strPsw.c_str(), password);
+		}
+
+	private:
+		std::wstring m_strPsw;
+		std::map<UInt32, std::vector<BYTE> > &m_items;
+		bool m_bOK;
+	};
+
 	CZipArchive::CZipArchive()
+		: m_szCached(0)
+		, m_szBudget(KDefCacheBudget)
+		, m_nMaterialized(0)
+		, m_nBlockDecodes(0)
+		, m_pStats(NULL)
 	{
+		m_szPassword[0] = '\0';
+		InitializeCriticalSection(&m_cs);
 	}
 	CZipArchive::~CZipArchive()
 	{
 		Close();
+		DeleteCriticalSection(&m_cs);
 	}
 
-	BOOL CZipArchive::OpenZip()
-	{ 
-		m_szPassword[0] = '\0';
-
-		return TRUE;
-	}
 	void CZipArchive::Close()
 	{
 		CloseFile();
-		 
 	}
 	BOOL CZipArchive::IsOpen() const
 	{
-		return TRUE;
-	} 
+		return m_archive != NULL;
+	}
 
 	BOOL CZipArchive::SetPassword(LPCSTR pstrPassword)
 	{
@@ -211,29 +261,177 @@ static std::string WString2String(const std::wstring &wstr)
 		return TRUE;
 	}
 
+	void CZipArchive::SetCacheBudget(DWORD dwBytes)
+	{
+		EnterCriticalSection(&m_cs);
+		m_szBudget = dwBytes ? dwBytes : KDefCacheBudget;
+		ShrinkCache(0);
+		UpdateStats();
+		LeaveCriticalSection(&m_cs);
+	}
+
+	void CZipArchive::SetStats(SOUI::ZIP7RES_STATS *pStats)
+	{
+		EnterCriticalSection(&m_cs);
+		m_pStats = pStats;
+		UpdateStats();
+		LeaveCriticalSection(&m_cs);
+	}
+
 	// ZIP File API
 
 	BOOL CZipArchive::GetFile(LPCTSTR pszFileName, CZipFile& file)
 	{
-		std::string fileName = WString2String(pszFileName);
-		if (m_fileStreams.GetFile(fileName.c_str(),file.getBlob()))
-			return TRUE;
+		int iItem = FindItem(pszFileName);
+		if (iItem == -1)
+			return FALSE;
 
-		return FALSE;
+		EnterCriticalSection(&m_cs);
+		ITEMDATA items;
+		const std::vector<BYTE> *pData = LoadItem(iItem, items);
+		if (pData)
+		{
+			if (pData->empty())
+				file.getBlob().ClearContent();
+			else
+				file.getBlob().SetBlobContent(&(*pData)[0], (unsigned long)pData->size());
+		}
+		UpdateStats();
+		LeaveCriticalSection(&m_cs);
+		return pData != NULL;
 	}
-	 
+
+	//先在缓存中查找; 数据块不超过缓存预算时整块解压并缓存, 否则只解压这一个文件到items中
+	const std::vector<BYTE> * CZipArchive::LoadItem(UInt32 iItem, ITEMDATA &items)
+	{
+		static const std::vector<BYTE> emptyData;
+		const ITEMINFO &item = m_lstItems[iItem];
+		if (item.iBlock == KNoBlock)
+			return &emptyData;
+
+		std::map<UInt32, BLOCKCACHE>::iterator it = m_mapCache.find(item.iBlock);
+		if (it != m_mapCache.end())
+		{
+			m_lstLru.splice(m_lstLru.begin(), m_lstLru, it->second.itLru);
+		}
+		else
+		{
+			const BLOCKINFO &block = m_mapBlocks[item.iBlock];
+			if (block.size > m_szBudget)
+			{
+				if (!ExtractItems(&iItem, 1, items))
+					return NULL;
+				return &items[iItem];
+			}
+
+			if (!ExtractItems(&block.lstItems[0], (UInt32)block.lstItems.size(), items))
+				return NULL;
+			ShrinkCache(block.size);
+			m_lstLru.push_front(item.iBlock);
+			BLOCKCACHE &cache = m_mapCache[item.iBlock];
+			cache.itLru = m_lstLru.begin();
+			cache.items.swap(items);
+			m_szCached += block.size;
+			it = m_mapCache.find(item.iBlock);
+		}
+		ITEMDATA::iterator itData = it->second.items.find(iItem);
+		if (itData == it->second.items.end())
+			return NULL;
+		return &itData->second;
+	}
+
+	BOOL CZipArchive::ExtractItems(const UInt32 *pIndice, UInt32 nCount, ITEMDATA &items)
+	{
+		for (UInt32 i = 0; i < nCount; i++)
+		{
+			items[pIndice[i]].reserve((size_t)m_lstItems[pIndice[i]].size);
+		}
+
+		CItemExtractCallback *pCallback = new CItemExtractCallback(StdStringtoWideString(m_szPassword), items);
+		CMyComPtr<IArchiveExtractCallback> extractCallback = pCallback;
+		HRESULT hr = m_archive->Extract(pIndice, nCount, 0, extractCallback);
+		m_nBlockDecodes++;
+		if (hr != S_OK || !pCallback->IsOK())
+		{
+			items.clear();
+			return FALSE;
+		}
+
+		for (UInt32 i = 0; i < nCount; i++)
+		{
+			ITEMINFO &item = m_lstItems[pIndice[i]];
+			if (!item.bMaterialized)
+			{
+				item.bMaterialized = true;
+				m_nMaterialized++;
+			}
+		}
+		return TRUE;
+	}
+
+	//淘汰最久没有使用的数据块, 直到可以再放入szReserve字节
+	void CZipArchive::ShrinkCache(UInt64 szReserve)
+	{
+		while (!m_lstLru.empty() && m_szCached + szReserve > m_szBudget)
+		{
+			UInt32 iBlock = m_lstLru.back();
+			m_lstLru.pop_back();
+			m_szCached -= m_mapBlocks[iBlock].size;
+			m_mapCache.erase(iBlock);
+		}
+	}
+
+	void CZipArchive::UpdateStats()
+	{
+		if (!m_pStats)
+			return;
+		m_pStats->nItems = (int)m_lstItems.size();
+		m_pStats->nMaterialized = m_nMaterialized;
+		m_pStats->nBlockDecodes = m_nBlockDecodes;
+		m_pStats->nCachedBlocks = (int)m_mapCache.size();
+		m_pStats->dwCachedBytes = (DWORD)m_szCached;
+	}
+
+	std::wstring CZipArchive::NormalizeName(LPCWSTR pszName)
+	{
+		std::wstring strName = pszName;
+		for (size_t i = 0; i < strName.length(); i++)
+		{
+			if (strName[i] == L'/')
+				strName[i] = L'\\';
+		}
+		if (!strName.empty())
+			::CharLowerBuffW(&strName[0], (DWORD)strName.length());
+		return strName;
+	}
+
+	int CZipArchive::FindItem(LPCTSTR pszFileName) const
+	{
+		std::map<std::wstring, UInt32>::const_iterator it = m_mapItems.find(NormalizeName(pszFileName));
+		if (it == m_mapItems.end())
+			return -1;
+		return (int)it->second;
+	}
+
 	BOOL CZipArchive::Open(LPCTSTR pszFileName,LPCSTR pszPassword)
 	{
-		std::wstring s_pwd = StdStringtoWideString(pszPassword);
-		SevenZip::SevenZipPassword pwd(true, s_pwd);
-		CFileStream fileStreams;
-		SevenZip::SevenZipExtractorMemory decompress;
-		decompress.SetArchivePath(pszFileName);
-		 
-		return (S_OK == decompress.ExtractArchive(m_fileStreams, NULL, &pwd));
+		Close();
+		SetPassword(pszPassword);
+
+		CMyComPtr< IStream > fileStream = FileSys::OpenFileToRead(pszFileName);
+		if (fileStream == NULL)
+			return FALSE;
+		if (OpenStream(fileStream, CompressionFormat::SevenZip))
+			return TRUE;
+
+		//不是7z格式时按内容检测其它格式
+		CompressionFormatEnum format = CompressionFormat::SevenZip;
+		if (!UsefulFunctions::DetectCompressionFormat(pszFileName, format) || format == CompressionFormat::SevenZip)
+			return FALSE;
+		return OpenStream(fileStream, format);
 	}
 
-	BOOL CZipArchive::Open(HMODULE hModule, LPCTSTR pszName, LPCTSTR pszPassword, LPCTSTR pszType)
+	BOOL CZipArchive::Open(HMODULE hModule, LPCTSTR pszName, LPCSTR pszPassword, LPCTSTR pszType)
 	{
 		HRSRC hResInfo = ::FindResource(hModule, pszName, pszType);
 		if (hResInfo == NULL)
@@ -252,31 +450,115 @@ static std::string WString2String(const std::wstring &wstr)
 			return FALSE;
 
 		Close();
+		SetPassword(pszPassword);
 
-		m_fileRes.Attach(pData, dwLength);
+		//解压器需要可以定位的流, 把资源数据复制到内存流中
+		HGLOBAL hMem = ::GlobalAlloc(GMEM_MOVEABLE, dwLength);
+		if (hMem == NULL)
+			return FALSE;
+		memcpy(::GlobalLock(hMem), pData, dwLength);
+		::GlobalUnlock(hMem);
 
-		BOOL bOK=OpenZip();
-		if(!bOK)
+		IStream *pStream = NULL;
+		if (FAILED(::CreateStreamOnHGlobal(hMem, TRUE, &pStream)))
 		{
-			m_fileRes.Detach();
+			::GlobalFree(hMem);
+			return FALSE;
 		}
+		BOOL bOK = OpenStream(pStream, CompressionFormat::SevenZip);
+		pStream->Release();
 		return bOK;
 	}
 
-	void CZipArchive::CloseFile()
-	{ 
+	//只读取文件列表, 记录每个文件所在的数据块
+	BOOL CZipArchive::OpenStream(IStream *pStream, const CompressionFormatEnum &format)
+	{
+		CMyComPtr< IInArchive > archive = UsefulFunctions::GetArchiveReader(format);
+		if (archive == NULL)
+			return FALSE;
+		CMyComPtr< InStreamWrapper > inFile = new InStreamWrapper(pStream);
+		CMyComPtr< ArchiveOpenCallback > openCallback = new ArchiveOpenCallback();
+		openCallback->PasswordIsDefined = true;
+		openCallback->Password = StdStringtoWideString(m_szPassword).c_str();
+
+		LARGE_INTEGER liZero = {0};
+		pStream->Seek(liZero, STREAM_SEEK_SET, NULL);
+		if (archive->Open(inFile, 0, openCallback) != S_OK)
+			return FALSE;
+
+		UInt32 nItems = 0;
+		archive->GetNumberOfItems(&nItems);
+
+		EnterCriticalSection(&m_cs);
+		m_archive = archive;
+		m_lstItems.resize(nItems);
+		for (UInt32 i = 0; i < nItems; i++)
+		{
+			ITEMINFO &item = m_lstItems[i];
+			item.bMaterialized = false;
+			{
+				CPropVariant prop;
+				archive->GetProperty(i, kpidSize, &prop);
+				item.size = prop.vt == VT_UI8 ? prop.uhVal.QuadPart : 0;
+			}
+			bool bDir = false;
+			{
+				CPropVariant prop;
+				archive->GetProperty(i, kpidIsDir, &prop);
+				bDir = prop.vt == VT_BOOL && prop.boolVal != VARIANT_FALSE;
+			}
+			{
+				CPropVariant prop;
+				archive->GetProperty(i, kpidBlock, &prop);
+				if (prop.vt == VT_UI4)
+					item.iBlock = prop.ulVal;
+				else//没有数据块信息的格式, 每个文件单独作为一块
+					item.iBlock = (bDir || item.size == 0) ? KNoBlock : (0x80000000 | i);
+			}
+			if (bDir)
+				continue;
+			{
+				CPropVariant prop;
+				archive->GetProperty(i, kpidPath, &prop);
+				if (prop.vt == VT_BSTR)
+					m_mapItems.insert(std::make_pair(NormalizeName(prop.bstrVal), i));
+			}
+			if (item.iBlock != KNoBlock)
+			{
+				BLOCKINFO &block = m_mapBlocks[item.iBlock];
+				block.lstItems.push_back(i);
+				block.size += item.size;
+			}
+		}
+		UpdateStats();
+		LeaveCriticalSection(&m_cs);
+		return TRUE;
 	}
 
-	DWORD CZipArchive::ReadFile(void* pBuffer, DWORD dwBytes)
+	void CZipArchive::CloseFile()
 	{
-		DWORD dwRead = 0;
-		 
-
-		return dwRead;
+		EnterCriticalSection(&m_cs);
+		if (m_archive)
+		{
+			m_archive->Close();
+			m_archive.Release();
+		}
+		m_lstItems.clear();
+		m_mapItems.clear();
+		m_mapBlocks.clear();
+		m_mapCache.clear();
+		m_lstLru.clear();
+		m_szCached = 0;
+		m_nMaterialized = 0;
+		m_nBlockDecodes = 0;
+		UpdateStats();
+		LeaveCriticalSection(&m_cs);
 	}
- 
+
 	DWORD CZipArchive::GetFileSize( LPCTSTR pszFileName )
 	{
-		std::string fileName = WString2String(pszFileName);
-		return m_fileStreams.GetFileSize(fileName.c_str());
-	} 
\ No newline at end of file
+		int iItem = FindItem(pszFileName);
+		if (iItem == -1)
+			return 0;
+		return (DWORD)m_lstItems[iItem].size;
+	}
@@ -13,6 +13,15 @@
 
 
 #include "SevenZip/FileStream.h"
+#include "SevenZip/CompressionFormat.h"
+#include "CPP/7zip/Archive/IArchive.h"
+#include "CPP/Common/MyCom.h"
+#include <vector>
+#include <list>
+#include <map>
+#include <string>
+
+#include "zip7resprovider-param.h"
 
 typedef struct ZIP_FIND_DATA
 {
@@ -53,33 +62,82 @@ protected:
 };
 
 //	ZIP Archive class, load files from a zip archive
+//	打开时只读取文件列表, 文件在第一次访问时才解压; 同一个solid数据块中的文件一次解压并缓存,
+//	缓存超过预算时按LRU淘汰数据块
 class CZipArchive
 {
-protected: 
-	CZipFile		m_fileRes;	
+protected:
 	char			m_szPassword[64];
 public:
 	CZipArchive();
 	~CZipArchive();
 
 	BOOL Open(LPCTSTR pszFileName, LPCSTR pszPassword);
-	BOOL Open(HMODULE hModule, LPCTSTR pszName, LPCTSTR pszPassword, LPCTSTR pszType = _T("ZIP"));
+	BOOL Open(HMODULE hModule, LPCTSTR pszName, LPCSTR pszPassword, LPCTSTR pszType = _T("ZIP"));
 
 	void Close();
 	BOOL IsOpen() const;
-	
+
 	BOOL SetPassword(LPCSTR pstrPassword);
-	 
-	BOOL GetFile(LPCTSTR pszFileName, CZipFile& file); 
+
+	BOOL GetFile(LPCTSTR pszFileName, CZipFile& file);
 	DWORD GetFileSize(LPCTSTR pszFileName);
-	 
+
+	//设置解压缓存的字节数上限, 0使用默认值
+	void SetCacheBudget(DWORD dwBytes);
+	//设置统计输出, 每次解压后更新
+	void SetStats(SOUI::ZIP7RES_STATS *pStats);
+
 protected:
-	BOOL OpenZip();
+	struct ITEMINFO
+	{
+		UInt64	size;
+		UInt32	iBlock;			//所在的数据块, 空文件为KNoBlock
+		bool	bMaterialized;	//是否已经解压过
+	};
+
+	struct BLOCKINFO
+	{
+		std::vector<UInt32> lstItems;	//块中的文件, 按解压顺序
+		UInt64	size;					//块中文件解压后的总大小
+
+		BLOCKINFO() :size(0) {}
+	};
+
+	typedef std::map<UInt32, std::vector<BYTE> > ITEMDATA;
+
+	struct BLOCKCACHE
+	{
+		std::list<UInt32>::iterator itLru;
+		ITEMDATA	items;
+	};
+
+	BOOL OpenStream(IStream *pStream, const SevenZip::CompressionFormatEnum &format);
 	void CloseFile();
+	int  FindItem(LPCTSTR pszFileName) const;
+	const std::vector<BYTE> * LoadItem(UInt32 iItem, ITEMDATA &items);
+	BOOL ExtractItems(const UInt32 *pIndice, UInt32 nCount, ITEMDATA &items);
+	void ShrinkCache(UInt64 szReserve);
+	void UpdateStats();
+
+	static std::wstring NormalizeName(LPCWSTR pszName);
 
-	DWORD ReadFile(void* pBuffer, DWORD dwBytes);
 private:
-	CFileStream m_fileStreams;
+	CRITICAL_SECTION		m_cs;
+	CMyComPtr<IInArchive>	m_archive;
+
+	std::vector<ITEMINFO>	m_lstItems;
+	std::map<std::wstring, UInt32> m_mapItems;	//规范化的文件名到序号
+	std::map<UInt32, BLOCKINFO>	m_mapBlocks;
+
+	std::map<UInt32, BLOCKCACHE> m_mapCache;
+	std::list<UInt32>		m_lstLru;		//最近使用的数据块在前
+	UInt64					m_szCached;
+	UInt64					m_szBudget;
+
+	int						m_nMaterialized;
+	int						m_nBlockDecodes;
+	SOUI::ZIP7RES_STATS		*m_pStats;
 };
 
 #endif	//	__ZIP7ARCHIVE_H__
@@ -3,6 +3,17 @@
 namespace SOUI
 {
     struct IRenderFactory;
+
+    //按需解压的统计信息
+    struct ZIP7RES_STATS
+    {
+        int     nItems;         //压缩包中的文件数
+        int     nMaterialized;  //至少解压过一次的文件数
+        int     nBlockDecodes;  //解码数据块的次数
+        int     nCachedBlocks;  //缓存中的数据块数
+        DWORD   dwCachedBytes;  //缓存中解压后的数据字节数
+    };
+
     struct ZIP7RES_PARAM
     {
         enum {ZIPFILE,PEDATA} type;
@@ -18,6 +29,8 @@ namespace SOUI
         };
         LPCSTR          pszPsw; 
 		LPCTSTR			pszChildDir;
+        DWORD           dwCacheBudget;  //解压缓存的字节数上限, 0使用默认值(32M)
+        ZIP7RES_STATS * pStats;         //可选, provider在每次解压后更新, 需要在provider释放前保持有效
         void ZipFile(IRenderFactory *_pRenderFac,LPCTSTR _pszFile,LPCSTR _pszPsw =NULL, LPCTSTR _pszChildDir = NULL)
         {
             type=ZIPFILE;
@@ -25,6 +38,8 @@ namespace SOUI
 			pszChildDir = _pszChildDir;
             pRenderFac = _pRenderFac;
             pszPsw     = _pszPsw;
+            dwCacheBudget = 0;
+            pStats     = NULL;
         }
         void ZipResource(IRenderFactory *_pRenderFac,HINSTANCE hInst,LPCTSTR pszResName,LPCTSTR pszResType=_T("zip"),LPCSTR _pszPsw =NULL, LPCTSTR _pszChildDir = NULL)
         {
@@ -35,6 +50,8 @@ namespace SOUI
             peInfo.pszResName=pszResName;
             peInfo.pszResType=pszResType;
             pszPsw     = _pszPsw;
+            dwCacheBudget = 0;
+            pStats     = NULL;
         }
     };
 }
\ No newline at end of file
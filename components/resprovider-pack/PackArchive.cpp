@@ -0,0 +1,234 @@
+﻿#include "stdafx.h"
+#include "PackArchive.h"
+
+namespace SOUI
+{
+    CPackArchive::CPackArchive()
+        :m_hFile(INVALID_HANDLE_VALUE)
+        ,m_hMapping(NULL)
+        ,m_pData(NULL)
+        ,m_dwSize(0)
+        ,m_bVerifyCrc(FALSE)
+        ,m_pHeader(NULL)
+        ,m_pEntries(NULL)
+        ,m_pNames(NULL)
+        ,m_pHashSlots(NULL)
+    {
+    }
+
+    CPackArchive::~CPackArchive()
+    {
+        Close();
+    }
+
+    BOOL CPackArchive::Open(LPCTSTR pszFileName,BOOL bVerifyCrc)
+    {
+        Close();
+        HANDLE hFile = ::CreateFile(pszFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(INVALID_HANDLE_VALUE==hFile) return FALSE;
+
+        DWORD dwSizeHigh = 0;
+        DWORD dwSize = ::GetFileSize(hFile, &dwSizeHigh);
+        if(dwSize == INVALID_FILE_SIZE || dwSize < sizeof(PACKHEADER) || dwSizeHigh != 0)
+        {
+            ::CloseHandle(hFile);
+            return FALSE;
+        }
+        HANDLE hMapping = ::CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        const BYTE *pView = hMapping ? (const BYTE*)::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if(!pView)
+        {
+            if(hMapping) ::CloseHandle(hMapping);
+            ::CloseHandle(hFile);
+            return FALSE;
+        }
+        m_hFile = hFile;
+        m_hMapping = hMapping;
+        m_pData = pView;//_Attach失败时由Close解除映射
+        m_bVerifyCrc = bVerifyCrc;
+        if(!_Attach(pView,dwSize))
+        {
+            Close();
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    BOOL CPackArchive::Open(HMODULE hModule,LPCTSTR pszName,LPCTSTR pszType,BOOL bVerifyCrc)
+    {
+        Close();
+        HRSRC hResInfo = ::FindResource(hModule, pszName, pszType);
+        if (hResInfo == NULL)
+            return FALSE;
+
+        DWORD dwLength = ::SizeofResource(hModule, hResInfo);
+        if (dwLength < sizeof(PACKHEADER))
+            return FALSE;
+
+        HGLOBAL hResData = ::LoadResource(hModule, hResInfo);
+        if (hResData == NULL)
+            return FALSE;
+
+        const BYTE* pData = (const BYTE*)::LockResource(hResData);
+        if (pData == NULL)
+            return FALSE;
+
+        m_bVerifyCrc = bVerifyCrc;
+        if(!_Attach(pData,dwLength))
+        {
+            Close();
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    void CPackArchive::Close()
+    {
+        if(m_hMapping)
+        {
+            ::UnmapViewOfFile(m_pData);
+            ::CloseHandle(m_hMapping);
+            m_hMapping = NULL;
+        }
+        if(m_hFile != INVALID_HANDLE_VALUE)
+        {
+            ::CloseHandle(m_hFile);
+            m_hFile = INVALID_HANDLE_VALUE;
+        }
+        m_pData = NULL;
+        m_dwSize = 0;
+        m_pHeader = NULL;
+        m_pEntries = NULL;
+        m_pNames = NULL;
+        m_pHashSlots = NULL;
+    }
+
+    //打开时检查所有偏移, 之后读取只需要检查数据本身
+    BOOL CPackArchive::_Attach(const BYTE *pData,DWORD dwSize)
+    {
+        const PACKHEADER *pHeader = (const PACKHEADER*)pData;
+        if(pHeader->dwMagic != KPackMagic || pHeader->wVersion != KPackVersion) return FALSE;
+        if(RespackCrc32(0,pHeader,offsetof(PACKHEADER,dwHeaderCrc)) != pHeader->dwHeaderCrc) return FALSE;
+
+        ULONGLONG ullTocEnd = (ULONGLONG)pHeader->dwTocOffset + (ULONGLONG)pHeader->nEntries*sizeof(PACKENTRY);
+        ULONGLONG ullHashEnd = (ULONGLONG)pHeader->dwHashOffset + (ULONGLONG)pHeader->nHashSlots*sizeof(DWORD);
+        if(pHeader->dwTocOffset % sizeof(DWORD) || pHeader->dwHashOffset % sizeof(DWORD)) return FALSE;
+        if(ullTocEnd != pHeader->dwNameOffset
+            || (ULONGLONG)pHeader->dwNameOffset + pHeader->dwNameSize > pHeader->dwHashOffset
+            || ullHashEnd > dwSize)
+            return FALSE;
+        if(pHeader->nHashSlots & (pHeader->nHashSlots-1)) return FALSE;
+        if(RespackCrc32(0,pData+pHeader->dwTocOffset,(size_t)(ullHashEnd-pHeader->dwTocOffset)) != pHeader->dwTocCrc) return FALSE;
+
+        const PACKENTRY *pEntries = (const PACKENTRY*)(pData+pHeader->dwTocOffset);
+        for(DWORD i=0;i<pHeader->nEntries;i++)
+        {
+            const PACKENTRY &entry = pEntries[i];
+            if((ULONGLONG)entry.dwOffset + entry.dwPackedSize > pHeader->dwTocOffset) return FALSE;
+            if(entry.dwNameOffset % sizeof(WCHAR)) return FALSE;
+            if((ULONGLONG)entry.dwNameOffset + (entry.wTypeLen + entry.wNameLen + 2)*sizeof(WCHAR) > pHeader->dwNameSize) return FALSE;
+            LPCWSTR pszType = (LPCWSTR)(pData + pHeader->dwNameOffset + entry.dwNameOffset);
+            if(pszType[entry.wTypeLen] != 0 || pszType[entry.wTypeLen + 1 + entry.wNameLen] != 0) return FALSE;
+            if(entry.dwMethod == PACK_STORED)
+            {
+                if(entry.dwPackedSize != entry.dwSize) return FALSE;
+            }else if(entry.dwMethod != PACK_LZ4)
+            {
+                return FALSE;
+            }
+        }
+
+        m_pData = pData;
+        m_dwSize = dwSize;
+        m_pHeader = pHeader;
+        m_pEntries = pEntries;
+        m_pNames = pData + pHeader->dwNameOffset;
+        m_pHashSlots = pHeader->nHashSlots?(const DWORD*)(pData + pHeader->dwHashOffset):NULL;
+        return TRUE;
+    }
+
+    BOOL CPackArchive::_MatchEntry(const PACKENTRY *pEntry,LPCWSTR pszType,LPCWSTR pszName) const
+    {
+        LPCWSTR pszEntryType = (LPCWSTR)(m_pNames + pEntry->dwNameOffset);
+        LPCWSTR pszEntryName = pszEntryType + pEntry->wTypeLen + 1;
+        return wcsncmp(pszEntryType,pszType,pEntry->wTypeLen) == 0 && pszType[pEntry->wTypeLen] == 0
+            && wcsncmp(pszEntryName,pszName,pEntry->wNameLen) == 0 && pszName[pEntry->wNameLen] == 0;
+    }
+
+    int CPackArchive::_CompareEntry(const PACKENTRY *pEntry,LPCWSTR pszType,LPCWSTR pszName) const
+    {
+        LPCWSTR pszEntryType = (LPCWSTR)(m_pNames + pEntry->dwNameOffset);
+        int nRet = wcscmp(pszEntryType,pszType);
+        if(nRet != 0) return nRet;
+        return wcscmp(pszEntryType + pEntry->wTypeLen + 1,pszName);
+    }
+
+    int CPackArchive::FindEntry(LPCWSTR pszType,LPCWSTR pszName) const
+    {
+        if(!m_pData) return -1;
+        if(m_pHashSlots)
+        {
+            DWORD dwHash = RespackHash(pszType,pszName);
+            DWORD dwMask = m_pHeader->nHashSlots - 1;
+            for(DWORD i = dwHash & dwMask, n = 0; n <= dwMask; i = (i+1) & dwMask, n++)
+            {
+                DWORD iEntry = m_pHashSlots[i];
+                if(iEntry == 0 || iEntry > m_pHeader->nEntries) return -1;
+                const PACKENTRY *pEntry = m_pEntries + iEntry - 1;
+                if(pEntry->dwHash == dwHash && _MatchEntry(pEntry,pszType,pszName))
+                    return (int)iEntry - 1;
+            }
+            return -1;
+        }
+        //目录按(类型,名字)排序
+        int iLow = 0, iHigh = (int)m_pHeader->nEntries - 1;
+        while(iLow <= iHigh)
+        {
+            int iMid = (iLow + iHigh) / 2;
+            int nCmp = _CompareEntry(m_pEntries + iMid,pszType,pszName);
+            if(nCmp == 0) return iMid;
+            if(nCmp < 0) iLow = iMid + 1;
+            else iHigh = iMid - 1;
+        }
+        return -1;
+    }
+
+    DWORD CPackArchive::GetEntryCount() const
+    {
+        return m_pHeader?m_pHeader->nEntries:0;
+    }
+
+    DWORD CPackArchive::GetEntrySize(int iEntry) const
+    {
+        if(iEntry < 0 || (DWORD)iEntry >= GetEntryCount()) return 0;
+        return m_pEntries[iEntry].dwSize;
+    }
+
+    BOOL CPackArchive::ReadEntry(int iEntry,LPVOID pBuf,DWORD dwSize) const
+    {
+        if(iEntry < 0 || (DWORD)iEntry >= GetEntryCount()) return FALSE;
+        const PACKENTRY &entry = m_pEntries[iEntry];
+        if(dwSize < entry.dwSize) return FALSE;
+
+        const BYTE *pSrc = m_pData + entry.dwOffset;
+        if(entry.dwMethod == PACK_STORED)
+        {
+            memcpy(pBuf,pSrc,entry.dwSize);
+        }else if(!RespackUnpackBlocks(pSrc,entry.dwPackedSize,(BYTE*)pBuf,entry.dwSize))
+        {
+            return FALSE;
+        }
+        if(m_bVerifyCrc && RespackCrc32(0,pBuf,entry.dwSize) != entry.dwCrc) return FALSE;
+        return TRUE;
+    }
+
+    const BYTE * CPackArchive::GetStoredData(int iEntry) const
+    {
+        if(iEntry < 0 || (DWORD)iEntry >= GetEntryCount()) return NULL;
+        const PACKENTRY &entry = m_pEntries[iEntry];
+        if(entry.dwMethod != PACK_STORED) return NULL;
+        const BYTE *pData = m_pData + entry.dwOffset;
+        if(m_bVerifyCrc && RespackCrc32(0,pData,entry.dwSize) != entry.dwCrc) return NULL;
+        return pData;
+    }
+}
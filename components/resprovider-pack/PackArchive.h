@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "respack-format.h"
+
+namespace SOUI
+{
+    /**
+    * @class      CPackArchive
+    * @brief      只读的资源包
+    *
+    * Describe    整个包映射到内存, 打开后只读, 可以在多个线程中同时读取.
+    *             按小写的(类型,名字)查找, 先查散列表, 散列表不可用时二分查找
+    */
+    class CPackArchive
+    {
+    public:
+        CPackArchive();
+        ~CPackArchive();
+
+        //bVerifyCrc: 读取资源时校验数据的crc32
+        BOOL Open(LPCTSTR pszFileName,BOOL bVerifyCrc = FALSE);
+        BOOL Open(HMODULE hModule,LPCTSTR pszName,LPCTSTR pszType,BOOL bVerifyCrc = FALSE);
+        void Close();
+        BOOL IsOpen() const {return m_pData!=NULL;}
+
+        //pszType, pszName必须是小写, 返回目录序号, 找不到返回-1
+        int FindEntry(LPCWSTR pszType,LPCWSTR pszName) const;
+
+        DWORD GetEntryCount() const;
+        DWORD GetEntrySize(int iEntry) const;
+
+        //解压到调用者的缓冲区, dwSize不能小于资源大小
+        BOOL ReadEntry(int iEntry,LPVOID pBuf,DWORD dwSize) const;
+
+        //未压缩的资源直接返回包中的数据, 压缩的资源返回NULL
+        const BYTE * GetStoredData(int iEntry) const;
+
+    protected:
+        BOOL _Attach(const BYTE *pData,DWORD dwSize);
+        BOOL _MatchEntry(const PACKENTRY *pEntry,LPCWSTR pszType,LPCWSTR pszName) const;
+        int  _CompareEntry(const PACKENTRY *pEntry,LPCWSTR pszType,LPCWSTR pszName) const;
+
+        HANDLE              m_hFile;
+        HANDLE              m_hMapping;
+        const BYTE *        m_pData;
+        DWORD               m_dwSize;
+        BOOL                m_bVerifyCrc;
+
+        const PACKHEADER *  m_pHeader;
+        const PACKENTRY  *  m_pEntries;
+        const BYTE *        m_pNames;
+        const DWORD *       m_pHashSlots;
+    };
+}
@@ -0,0 +1,178 @@
+﻿#include "stdafx.h"
+#pragma warning(disable:4251)
+
+#include "SResProviderPack.h"
+#include <sprofiler.h>
+
+extern HICON CURSORICON_LoadFromBuf(const BYTE * bits,DWORD filesize,INT width, INT height,BOOL fCursor, UINT loadflags);
+
+namespace SOUI{
+
+    //资源数据: 未压缩的资源引用包中的数据, 压缩的资源解压到临时缓冲区
+    class CPackEntryData
+    {
+    public:
+        CPackEntryData():m_pData(NULL),m_pBuf(NULL),m_dwSize(0){}
+        ~CPackEntryData()
+        {
+            if(m_pBuf) free(m_pBuf);
+        }
+
+        BOOL Load(const CPackArchive & packFile,int iEntry)
+        {
+            if(iEntry==-1) return FALSE;
+            m_dwSize = packFile.GetEntrySize(iEntry);
+            m_pData = packFile.GetStoredData(iEntry);
+            if(m_pData) return TRUE;
+            m_pBuf = (BYTE*)malloc(m_dwSize?m_dwSize:1);
+            if(!m_pBuf) return FALSE;
+            if(!packFile.ReadEntry(iEntry,m_pBuf,m_dwSize)) return FALSE;
+            m_pData = m_pBuf;
+            return TRUE;
+        }
+
+        const BYTE * GetData() const {return m_pData;}
+        DWORD GetSize() const {return m_dwSize;}
+
+    protected:
+        const BYTE * m_pData;
+        BYTE *       m_pBuf;
+        DWORD        m_dwSize;
+    };
+
+    SResProviderPack::SResProviderPack():m_renderFactory(NULL)
+	{
+	}
+
+	SResProviderPack::~SResProviderPack(void)
+	{
+	}
+
+	HBITMAP SResProviderPack::LoadBitmap(LPCTSTR pszResName )
+	{
+		CPackEntryData data;
+		if(!data.Load(m_packFile,_GetEntryIndex(pszResName,_T("BITMAP")))) return NULL;
+
+		//读取位图头
+		const BITMAPFILEHEADER *pBmpFileHeader=(const BITMAPFILEHEADER *)data.GetData();
+		//检测位图头
+		if (data.GetSize() < sizeof(BITMAPFILEHEADER) || pBmpFileHeader->bfType != ((WORD) ('M'<<8)|'B'))
+		{
+			return NULL;
+		}
+		//判断位图长度
+		if (pBmpFileHeader->bfSize > data.GetSize() || pBmpFileHeader->bfOffBits > data.GetSize())
+		{
+			return NULL;
+		}
+		const BITMAPINFO * lpBitmap=(const BITMAPINFO *)(pBmpFileHeader+1);
+		const BYTE * lpBits=data.GetData()+pBmpFileHeader->bfOffBits;
+		HDC hDC = GetDC(NULL);
+		HBITMAP hBitmap= CreateDIBitmap(hDC,&lpBitmap->bmiHeader,CBM_INIT,lpBits,lpBitmap,DIB_RGB_COLORS);
+		ReleaseDC(NULL,hDC);
+
+		return hBitmap;
+	}
+
+	HICON SResProviderPack::LoadIcon(LPCTSTR pszResName ,int cx/*=0*/,int cy/*=0*/)
+	{
+		CPackEntryData data;
+		if(!data.Load(m_packFile,_GetEntryIndex(pszResName,_T("ICON")))) return NULL;
+        return CURSORICON_LoadFromBuf(data.GetData(),data.GetSize(),cx,cy,FALSE,LR_DEFAULTSIZE|LR_DEFAULTCOLOR);
+	}
+
+    HCURSOR SResProviderPack::LoadCursor( LPCTSTR pszResName )
+    {
+		CPackEntryData data;
+		if(!data.Load(m_packFile,_GetEntryIndex(pszResName,_T("CURSOR")))) return NULL;
+        return (HCURSOR)CURSORICON_LoadFromBuf(data.GetData(),data.GetSize(),0,0,TRUE,LR_DEFAULTSIZE|LR_DEFAULTCOLOR);
+    }
+
+	IBitmap * SResProviderPack::LoadImage( LPCTSTR strType,LPCTSTR pszResName)
+	{
+		CPackEntryData data;
+		if(!data.Load(m_packFile,_GetEntryIndex(pszResName,strType))) return NULL;
+        IBitmap * pBmp=NULL;
+        m_renderFactory->CreateBitmap(&pBmp);
+        if(!pBmp) return NULL;
+        pBmp->LoadFromMemory((LPBYTE)data.GetData(),data.GetSize());
+        return pBmp;
+	}
+
+    IImgX   * SResProviderPack::LoadImgX( LPCTSTR strType,LPCTSTR pszResName )
+    {
+		CPackEntryData data;
+		if(!data.Load(m_packFile,_GetEntryIndex(pszResName,strType))) return NULL;
+
+        IImgX *pImgX=NULL;
+        m_renderFactory->GetImgDecoderFactory()->CreateImgX(&pImgX);
+        if(!pImgX) return NULL;
+
+        if(0==pImgX->LoadFromMemory((void*)data.GetData(),data.GetSize()))
+        {
+            pImgX->Release();
+            pImgX=NULL;
+        }
+        return pImgX;
+    }
+
+    BOOL SResProviderPack::Init( WPARAM wParam,LPARAM lParam )
+    {
+        SPROFILE_SCOPE("SResProviderPack::Init");
+        PACKRES_PARAM *packParam=(PACKRES_PARAM*)wParam;
+        m_renderFactory = packParam->pRenderFac;
+        BOOL bRet;
+        if(packParam->type == PACKRES_PARAM::PACKFILE)
+            bRet = m_packFile.Open(packParam->pszPackFile,packParam->bVerifyCrc);
+        else
+            bRet = m_packFile.Open(packParam->peInfo.hInst,packParam->peInfo.pszResName,packParam->peInfo.pszResType,packParam->bVerifyCrc);
+        SPROFILE_COUNT(m_packFile.GetEntryCount(),0);
+        return bRet;
+    }
+
+	int SResProviderPack::_GetEntryIndex( LPCTSTR pszResName,LPCTSTR pszType )
+	{
+		if(!pszResName || !pszType) return -1;
+		//包中的类型和名字都是小写
+		SStringW strType = S_CT2W(pszType);
+		SStringW strName = S_CT2W(pszResName);
+		strType.MakeLower();
+		strName.MakeLower();
+		return m_packFile.FindEntry(strType,strName);
+	}
+
+	size_t SResProviderPack::GetRawBufferSize( LPCTSTR strType,LPCTSTR pszResName )
+	{
+		int iEntry=_GetEntryIndex(pszResName,strType);
+		if(iEntry==-1) return 0;
+		return m_packFile.GetEntrySize(iEntry);
+	}
+
+	BOOL SResProviderPack::GetRawBuffer( LPCTSTR strType,LPCTSTR pszResName,LPVOID pBuf,size_t size )
+	{
+		int iEntry=_GetEntryIndex(pszResName,strType);
+		if(iEntry==-1) return FALSE;
+		if(size<m_packFile.GetEntrySize(iEntry))
+		{
+			SetLastError(ERROR_INSUFFICIENT_BUFFER);
+			return FALSE;
+		}
+		//直接解压到调用者的缓冲区
+		return m_packFile.ReadEntry(iEntry,pBuf,(DWORD)size);
+	}
+
+	BOOL SResProviderPack::HasResource( LPCTSTR strType,LPCTSTR pszResName )
+	{
+		return _GetEntryIndex(pszResName,strType)!=-1;
+	}
+
+    namespace RESPROVIDER_PACK
+    {
+        BOOL SCreateInstance( IObjRef ** ppObj )
+        {
+            *ppObj = new SResProviderPack;
+            return TRUE;
+        }
+    }
+
+}//namespace SOUI
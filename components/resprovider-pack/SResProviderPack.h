@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <interface/SResProvider-i.h>
+#include <unknown/obj-ref-impl.hpp>
+#include <string/tstring.h>
+#include <string/strcpcvt.h>
+#include <interface/render-i.h>
+
+#include "PackArchive.h"
+#include "packresprovider-param.h"
+
+namespace SOUI{
+
+/**
+* @class      SResProviderPack
+* @brief      从uiresbuilder -k生成的资源包(.spk)中读取资源
+*
+* Describe    包中已经保存了资源的类型和名字, 不需要uires.idx.
+*             未压缩的图片直接从映射的数据解码, 没有额外复制
+*/
+class SResProviderPack : public TObjRefImpl<IResProvider>
+{
+public:
+	SResProviderPack();
+	~SResProviderPack(void);
+
+    virtual BOOL Init(WPARAM wParam,LPARAM lParam);
+
+    virtual BOOL HasResource(LPCTSTR strType,LPCTSTR pszResName);
+    virtual HICON   LoadIcon(LPCTSTR pszResName,int cx,int cy);
+    virtual HBITMAP    LoadBitmap(LPCTSTR pszResName);
+    virtual HCURSOR LoadCursor(LPCTSTR pszResName);
+    virtual IBitmap * LoadImage(LPCTSTR strType,LPCTSTR pszResName);
+    virtual IImgX   * LoadImgX(LPCTSTR strType,LPCTSTR pszResName);
+    virtual size_t GetRawBufferSize(LPCTSTR strType,LPCTSTR pszResName);
+    virtual BOOL GetRawBuffer(LPCTSTR strType,LPCTSTR pszResName,LPVOID pBuf,size_t size);
+
+protected:
+	int _GetEntryIndex(LPCTSTR pszResName,LPCTSTR pszType);
+
+    CAutoRefPtr<IRenderFactory> m_renderFactory;
+	CPackArchive m_packFile;
+};
+
+namespace RESPROVIDER_PACK
+{
+    SOUI_COM_C BOOL SOUI_COM_API SCreateInstance(IObjRef ** ppObj);
+}
+
+}//namespace SOUI
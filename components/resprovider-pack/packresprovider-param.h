@@ -0,0 +1,36 @@
+﻿#pragma once
+
+namespace SOUI
+{
+	struct IRenderFactory;
+	struct PACKRES_PARAM
+	{
+		enum { PACKFILE, PEDATA } type;
+		IRenderFactory *pRenderFac;
+		union {
+			LPCTSTR pszPackFile;
+			struct {
+				HINSTANCE hInst;
+				LPCTSTR pszResName;
+				LPCTSTR pszResType;
+			}peInfo;
+		};
+		BOOL			bVerifyCrc;	//读取资源时校验crc32
+		void PackFile(IRenderFactory *_pRenderFac, LPCTSTR _pszFile, BOOL _bVerifyCrc = FALSE)
+		{
+			type = PACKFILE;
+			pszPackFile = _pszFile;
+			pRenderFac = _pRenderFac;
+			bVerifyCrc = _bVerifyCrc;
+		}
+		void PackResource(IRenderFactory *_pRenderFac, HINSTANCE hInst, LPCTSTR pszResName, LPCTSTR pszResType = _T("spk"), BOOL _bVerifyCrc = FALSE)
+		{
+			type = PEDATA;
+			pRenderFac = _pRenderFac;
+			peInfo.hInst = hInst;
+			peInfo.pszResName = pszResName;
+			peInfo.pszResType = pszResType;
+			bVerifyCrc = _bVerifyCrc;
+		}
+	};
+}
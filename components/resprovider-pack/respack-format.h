@@ -0,0 +1,338 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       respack-format.h
+* @brief      资源包(.spk)格式定义
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    resprovider-pack和uiresbuilder共用, 只依赖windows.h
+*
+*   PACKHEADER
+*   数据区:     每个资源一段, 未压缩的资源按KPackAlign对齐, 可以直接从映射的文件中使用
+*   PACKENTRY[nEntries]:  按(类型,名字)排序的目录
+*   名字表:     小写的UTF16字符串, 每个资源为"type\0name\0"
+*   散列表:     nHashSlots个DWORD, 值为目录序号+1, 0为空槽位, 线性探测
+*
+*   压缩的资源按KPackBlockSize分块, 每块前面有一个DWORD头: 低31位为块数据长度, 最高位表示该块没有压缩.
+*   块使用LZ4块格式编码, 每块独立解码.
+*/
+
+#pragma once
+
+namespace SOUI
+{
+    const DWORD KPackMagic      = 0x4B505353;   //'SSPK'
+    const WORD  KPackVersion    = 1;
+    const DWORD KPackAlign      = 16;           //未压缩资源的对齐字节数
+    const DWORD KPackBlockSize  = 64*1024;      //压缩块大小
+    const DWORD KPackRawBlock   = 0x80000000;   //块头标志: 未压缩
+
+    enum
+    {
+        PACK_STORED = 0,    //未压缩
+        PACK_LZ4    = 1,    //LZ4分块压缩
+    };
+
+#pragma pack(push,4)
+    struct PACKHEADER
+    {
+        DWORD dwMagic;
+        WORD  wVersion;
+        WORD  wFlags;
+        DWORD nEntries;
+        DWORD dwTocOffset;      //目录偏移
+        DWORD dwNameOffset;     //名字表偏移
+        DWORD dwNameSize;       //名字表字节数
+        DWORD dwHashOffset;     //散列表偏移
+        DWORD nHashSlots;       //散列表槽位数, 2的幂, 0表示只能二分查找
+        DWORD dwTocCrc;         //目录, 名字表和散列表的crc32
+        DWORD dwHeaderCrc;      //本结构前面字段的crc32
+    };
+
+    struct PACKENTRY
+    {
+        DWORD dwHash;           //RespackHash("type","name")
+        DWORD dwNameOffset;     //在名字表中的字节偏移
+        WORD  wTypeLen;         //类型长度(字符)
+        WORD  wNameLen;         //名字长度(字符)
+        DWORD dwMethod;         //PACK_STORED, PACK_LZ4
+        DWORD dwOffset;         //数据在包中的偏移
+        DWORD dwSize;           //原始大小
+        DWORD dwPackedSize;     //包中的字节数
+        DWORD dwCrc;            //原始数据的crc32
+    };
+#pragma pack(pop)
+
+    //////////////////////////////////////////////////////////////////////////
+    // crc32, 与zlib相同
+    class CRespackCrcTable
+    {
+    public:
+        CRespackCrcTable()
+        {
+            for(DWORD i=0;i<256;i++)
+            {
+                DWORD c = i;
+                for(int k=0;k<8;k++) c = (c&1)?(0xEDB88320 ^ (c>>1)):(c>>1);
+                m_table[i] = c;
+            }
+        }
+        DWORD m_table[256];
+    };
+
+    inline DWORD RespackCrc32(DWORD dwCrc,const void *pData,size_t nSize)
+    {
+        static const CRespackCrcTable s_crcTable;
+        const BYTE *p = (const BYTE*)pData;
+        dwCrc = ~dwCrc;
+        while(nSize--) dwCrc = s_crcTable.m_table[(dwCrc ^ *p++) & 0xFF] ^ (dwCrc >> 8);
+        return ~dwCrc;
+    }
+
+    //小写的type和name的FNV-1a
+    inline DWORD RespackHash(const wchar_t *pszType,const wchar_t *pszName)
+    {
+        DWORD dwHash = 2166136261u;
+        for(const wchar_t *p = pszType; *p; p++) dwHash = (dwHash ^ (DWORD)*p) * 16777619u;
+        dwHash = (dwHash ^ (DWORD)L':') * 16777619u;
+        for(const wchar_t *p = pszName; *p; p++) dwHash = (dwHash ^ (DWORD)*p) * 16777619u;
+        return dwHash;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // LZ4块格式编解码
+
+    //压缩后的最大长度
+    inline int RespackLZ4Bound(int nSize)
+    {
+        return nSize + nSize/255 + 16;
+    }
+
+    inline DWORD RespackRead32(const BYTE *p)
+    {
+        return p[0] | (p[1]<<8) | (p[2]<<16) | ((DWORD)p[3]<<24);
+    }
+
+    inline BYTE * RespackPutLength(BYTE *op,size_t nLen)
+    {
+        while(nLen >= 255)
+        {
+            *op++ = 255;
+            nLen -= 255;
+        }
+        *op++ = (BYTE)nLen;
+        return op;
+    }
+
+    //贪心匹配的单遍压缩, 返回压缩后的长度, 0表示输出缓冲区不够
+    inline int RespackLZ4Compress(const BYTE *pSrc,int nSrc,BYTE *pDst,int nDstCap)
+    {
+        const int KHashLog = 12;
+        const int KMinMatch = 4;
+        int table[1<<KHashLog];
+        memset(table,0,sizeof(table));
+
+        const BYTE *ip = pSrc, *anchor = pSrc;
+        const BYTE *iend = pSrc + nSrc;
+        const BYTE *mflimit = iend - 12;    //最后一个匹配的起点
+        const BYTE *matchlimit = iend - 5;  //最后5个字节必须是字面量
+        BYTE *op = pDst, *oend = pDst + nDstCap;
+
+        if(nSrc >= 13)
+        {
+            while(ip < mflimit)
+            {
+                DWORD dwSeq = RespackRead32(ip);
+                DWORD h = (dwSeq * 2654435761u) >> (32-KHashLog);
+                const BYTE *ref = pSrc + table[h];
+                table[h] = (int)(ip - pSrc);
+                if(ref >= ip || ip - ref > 65535 || RespackRead32(ref) != dwSeq)
+                {
+                    ip++;
+                    continue;
+                }
+                //向前扩展匹配
+                while(ip > anchor && ref > pSrc && ip[-1] == ref[-1])
+                {
+                    ip--;
+                    ref--;
+                }
+                const BYTE *p = ip + KMinMatch, *r = ref + KMinMatch;
+                while(p < matchlimit && *p == *r)
+                {
+                    p++;
+                    r++;
+                }
+
+                size_t nLit = ip - anchor;
+                size_t nMatch = p - ip - KMinMatch;
+                if(op + 1 + nLit/255 + 1 + nLit + 2 + nMatch/255 + 1 > oend) return 0;
+
+                BYTE *token = op++;
+                if(nLit >= 15)
+                {
+                    *token = 15<<4;
+                    op = RespackPutLength(op,nLit-15);
+                }else
+                {
+                    *token = (BYTE)(nLit<<4);
+                }
+                memcpy(op,anchor,nLit);
+                op += nLit;
+
+                WORD wOffset = (WORD)(ip - ref);
+                *op++ = (BYTE)wOffset;
+                *op++ = (BYTE)(wOffset>>8);
+
+                if(nMatch >= 15)
+                {
+                    *token |= 15;
+                    op = RespackPutLength(op,nMatch-15);
+                }else
+                {
+                    *token |= (BYTE)nMatch;
+                }
+                ip = anchor = p;
+            }
+        }
+
+        //最后的字面量
+        size_t nLit = iend - anchor;
+        if(op + 1 + nLit/255 + 1 + nLit > oend) return 0;
+        if(nLit >= 15)
+        {
+            *op++ = 15<<4;
+            op = RespackPutLength(op,nLit-15);
+        }else
+        {
+            *op++ = (BYTE)(nLit<<4);
+        }
+        memcpy(op,anchor,nLit);
+        op += nLit;
+        return (int)(op - pDst);
+    }
+
+    //解码一个块, 检查所有边界, 返回解码的字节数, 数据损坏时返回-1
+    inline int RespackLZ4Decompress(const BYTE *pSrc,int nSrc,BYTE *pDst,int nDstCap)
+    {
+        const BYTE *ip = pSrc, *iend = pSrc + nSrc;
+        BYTE *op = pDst, *oend = pDst + nDstCap;
+        for(;;)
+        {
+            if(ip >= iend) return -1;
+            unsigned int token = *ip++;
+
+            size_t nLit = token >> 4;
+            if(nLit == 15)
+            {
+                BYTE b;
+                do{
+                    if(ip >= iend) return -1;
+                    b = *ip++;
+                    nLit += b;
+                }while(b == 255);
+            }
+            if((size_t)(iend - ip) < nLit || (size_t)(oend - op) < nLit) return -1;
+            memcpy(op,ip,nLit);
+            op += nLit;
+            ip += nLit;
+            if(ip == iend) break;//最后一个序列只有字面量
+
+            if(iend - ip < 2) return -1;
+            size_t nOffset = ip[0] | (ip[1]<<8);
+            ip += 2;
+            if(nOffset == 0 || nOffset > (size_t)(op - pDst)) return -1;
+
+            size_t nMatch = token & 15;
+            if(nMatch == 15)
+            {
+                BYTE b;
+                do{
+                    if(ip >= iend) return -1;
+                    b = *ip++;
+                    nMatch += b;
+                }while(b == 255);
+            }
+            nMatch += 4;
+            if((size_t)(oend - op) < nMatch) return -1;
+
+            const BYTE *ref = op - nOffset;
+            if(nOffset >= nMatch)
+            {
+                memcpy(op,ref,nMatch);
+                op += nMatch;
+            }else
+            {//重叠的匹配逐字节复制
+                for(size_t i=0;i<nMatch;i++) *op++ = *ref++;
+            }
+        }
+        return (int)(op - pDst);
+    }
+
+    //按KPackBlockSize分块压缩, pDst至少需要RespackPackBound(nSrc)字节, 返回写入的字节数
+    inline DWORD RespackPackBound(DWORD nSrc)
+    {
+        DWORD nBlocks = (nSrc + KPackBlockSize - 1)/KPackBlockSize;
+        return nBlocks*4 + (DWORD)RespackLZ4Bound((int)nSrc);
+    }
+
+    inline DWORD RespackPackBlocks(const BYTE *pSrc,DWORD nSrc,BYTE *pDst)
+    {
+        BYTE *op = pDst;
+        for(DWORD dwPos = 0; dwPos < nSrc; dwPos += KPackBlockSize)
+        {
+            DWORD nBlock = nSrc - dwPos;
+            if(nBlock > KPackBlockSize) nBlock = KPackBlockSize;
+            //压缩后不小于原始数据时按原样保存
+            int nPacked = RespackLZ4Compress(pSrc+dwPos,(int)nBlock,op+4,(int)nBlock-1);
+            DWORD dwHead;
+            if(nPacked > 0)
+            {
+                dwHead = (DWORD)nPacked;
+            }else
+            {
+                memcpy(op+4,pSrc+dwPos,nBlock);
+                dwHead = nBlock | KPackRawBlock;
+            }
+            op[0] = (BYTE)dwHead;
+            op[1] = (BYTE)(dwHead>>8);
+            op[2] = (BYTE)(dwHead>>16);
+            op[3] = (BYTE)(dwHead>>24);
+            op += 4 + (dwHead & ~KPackRawBlock);
+        }
+        return (DWORD)(op - pDst);
+    }
+
+    //解码所有块, 解码后的长度必须正好是nDst
+    inline BOOL RespackUnpackBlocks(const BYTE *pSrc,DWORD nSrc,BYTE *pDst,DWORD nDst)
+    {
+        const BYTE *ip = pSrc, *iend = pSrc + nSrc;
+        BYTE *op = pDst, *oend = pDst + nDst;
+        while(ip < iend)
+        {
+            if(iend - ip < 4) return FALSE;
+            DWORD dwHead = RespackRead32(ip);
+            ip += 4;
+            DWORD nBlock = dwHead & ~KPackRawBlock;
+            if((DWORD)(iend - ip) < nBlock) return FALSE;
+            DWORD nOut = (DWORD)(oend - op);
+            if(nOut > KPackBlockSize) nOut = KPackBlockSize;
+            if(dwHead & KPackRawBlock)
+            {
+                if(nBlock > nOut) return FALSE;
+                memcpy(op,ip,nBlock);
+                op += nBlock;
+            }else
+            {
+                int nDecoded = RespackLZ4Decompress(ip,(int)nBlock,op,(int)nOut);
+                if(nDecoded < 0) return FALSE;
+                op += nDecoded;
+            }
+            ip += nBlock;
+        }
+        return op == oend;
+    }
+}
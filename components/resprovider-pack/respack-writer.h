@@ -0,0 +1,173 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       respack-writer.h
+* @brief      生成资源包(.spk)
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    uiresbuilder -k和souitest使用, 依赖STL
+*/
+
+#pragma once
+
+#include "respack-format.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <wctype.h>
+
+namespace SOUI
+{
+    class CRespackWriter
+    {
+    public:
+        /**
+         * AddEntry
+         * @brief    添加一个资源
+         * @param    const wchar_t * pszType --  类型, 保存为小写
+         * @param    const wchar_t * pszName --  名字, 保存为小写
+         * @param    const BYTE * pData --  数据
+         * @param    DWORD dwSize --  数据长度
+         * @param    BOOL bStore --  直接保存, 用于已经压缩过的图片
+         * @return   void
+         * Describe  压缩率不到1/8的资源也直接保存, 这样的资源可以从映射的数据中直接使用
+         */
+        void AddEntry(const wchar_t *pszType,const wchar_t *pszName,const BYTE *pData,DWORD dwSize,BOOL bStore)
+        {
+            Record rec;
+            rec.strType = pszType;
+            rec.strName = pszName;
+            std::transform(rec.strType.begin(),rec.strType.end(),rec.strType.begin(),ToLower);
+            std::transform(rec.strName.begin(),rec.strName.end(),rec.strName.begin(),ToLower);
+            rec.dwSize = dwSize;
+            rec.dwCrc = RespackCrc32(0,pData,dwSize);
+            rec.dwMethod = PACK_STORED;
+            if(dwSize && !bStore)
+            {
+                rec.data.resize(RespackPackBound(dwSize));
+                rec.data.resize(RespackPackBlocks(pData,dwSize,&rec.data[0]));
+                if(rec.data.size() < dwSize - dwSize/8) rec.dwMethod = PACK_LZ4;
+            }
+            if(rec.dwMethod == PACK_STORED) rec.data.assign(pData,pData+dwSize);
+            m_lstRecord.push_back(rec);
+        }
+
+        size_t GetCount() const {return m_lstRecord.size();}
+
+        //生成资源包, 同名的资源只保留第一个, 返回被忽略的资源数
+        int Build(std::vector<BYTE> &out)
+        {
+            std::stable_sort(m_lstRecord.begin(),m_lstRecord.end(),RecordLess);
+            std::vector<const Record*> lstRec;
+            int nDup = 0;
+            for(size_t i=0;i<m_lstRecord.size();i++)
+            {
+                if(!lstRec.empty() && !RecordLess(*lstRec.back(),m_lstRecord[i]))
+                {
+                    nDup++;
+                    continue;
+                }
+                lstRec.push_back(&m_lstRecord[i]);
+            }
+
+            out.assign(sizeof(PACKHEADER),0);
+            std::vector<PACKENTRY> lstEntry(lstRec.size());
+            std::vector<BYTE> names;
+            for(size_t i=0;i<lstRec.size();i++)
+            {
+                const Record &rec = *lstRec[i];
+                PACKENTRY &entry = lstEntry[i];
+                entry.dwHash = RespackHash(rec.strType.c_str(),rec.strName.c_str());
+                entry.dwNameOffset = (DWORD)names.size();
+                entry.wTypeLen = (WORD)rec.strType.length();
+                entry.wNameLen = (WORD)rec.strName.length();
+                entry.dwMethod = rec.dwMethod;
+                entry.dwSize = rec.dwSize;
+                entry.dwPackedSize = (DWORD)rec.data.size();
+                entry.dwCrc = rec.dwCrc;
+                AppendString(names,rec.strType);
+                AppendString(names,rec.strName);
+
+                if(rec.dwMethod == PACK_STORED) PadTo(out,KPackAlign);
+                entry.dwOffset = (DWORD)out.size();
+                out.insert(out.end(),rec.data.begin(),rec.data.end());
+            }
+
+            DWORD nHashSlots = 0;
+            if(!lstEntry.empty())
+            {
+                nHashSlots = 16;
+                while(nHashSlots < lstEntry.size()*2) nHashSlots <<= 1;
+            }
+            std::vector<DWORD> hashSlots(nHashSlots,0);
+            for(size_t i=0;i<lstEntry.size();i++)
+            {
+                DWORD iSlot = lstEntry[i].dwHash & (nHashSlots-1);
+                while(hashSlots[iSlot]) iSlot = (iSlot+1) & (nHashSlots-1);
+                hashSlots[iSlot] = (DWORD)i+1;
+            }
+
+            PACKHEADER header;
+            memset(&header,0,sizeof(header));
+            header.dwMagic = KPackMagic;
+            header.wVersion = KPackVersion;
+            header.nEntries = (DWORD)lstEntry.size();
+            PadTo(out,sizeof(DWORD));
+            header.dwTocOffset = (DWORD)out.size();
+            if(!lstEntry.empty())
+                out.insert(out.end(),(const BYTE*)&lstEntry[0],(const BYTE*)(&lstEntry[0]+lstEntry.size()));
+            header.dwNameOffset = (DWORD)out.size();
+            header.dwNameSize = (DWORD)names.size();
+            out.insert(out.end(),names.begin(),names.end());
+            PadTo(out,sizeof(DWORD));
+            header.dwHashOffset = (DWORD)out.size();
+            header.nHashSlots = nHashSlots;
+            if(nHashSlots)
+                out.insert(out.end(),(const BYTE*)&hashSlots[0],(const BYTE*)(&hashSlots[0]+nHashSlots));
+            header.dwTocCrc = RespackCrc32(0,&out[header.dwTocOffset],out.size()-header.dwTocOffset);
+            header.dwHeaderCrc = RespackCrc32(0,&header,offsetof(PACKHEADER,dwHeaderCrc));
+            memcpy(&out[0],&header,sizeof(header));
+            return nDup;
+        }
+
+    protected:
+        struct Record
+        {
+            std::wstring strType;
+            std::wstring strName;
+            DWORD dwMethod;
+            DWORD dwSize;
+            DWORD dwCrc;
+            std::vector<BYTE> data;
+        };
+
+        //与SResProviderPack查找时使用的_wcslwr一致
+        static wchar_t ToLower(wchar_t c)
+        {
+            return (wchar_t)towlower(c);
+        }
+
+        static bool RecordLess(const Record &r1,const Record &r2)
+        {
+            int nRet = wcscmp(r1.strType.c_str(),r2.strType.c_str());
+            if(nRet != 0) return nRet<0;
+            return wcscmp(r1.strName.c_str(),r2.strName.c_str())<0;
+        }
+
+        static void AppendString(std::vector<BYTE> &buf,const std::wstring &str)
+        {
+            const BYTE *p = (const BYTE*)str.c_str();
+            buf.insert(buf.end(),p,p+(str.length()+1)*sizeof(wchar_t));
+        }
+
+        static void PadTo(std::vector<BYTE> &buf,DWORD dwAlign)
+        {
+            while(buf.size() % dwAlign) buf.push_back(0);
+        }
+
+        std::vector<Record> m_lstRecord;
+    };
+}
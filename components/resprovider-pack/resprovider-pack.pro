@@ -0,0 +1,42 @@
+######################################################################
+# Automatically generated by qmake (2.01a) ?? ?? 23 19:28:51 2014
+######################################################################
+
+TEMPLATE = lib
+TARGET =  resprovider-pack
+CONFIG(x64){
+TARGET = $$TARGET"64"
+}
+!LIB_ALL:!COM_LIB{
+	RC_FILE += resprovider-pack.rc
+	CONFIG += dll
+}
+else{
+	CONFIG += staticlib
+}
+
+DEPENDPATH += .
+INCLUDEPATH += . \
+			   ../../soui/include \
+			   ../../utilities/include \
+
+DEFINES += RESPROVIDERPACK_EXPORTS
+
+dir = ../..
+include($$dir/common.pri)
+
+CONFIG(debug,debug|release){
+	LIBS += utilitiesd.lib
+}
+else{
+	LIBS += utilities.lib
+}
+
+
+PRECOMPILED_HEADER = stdafx.h
+
+# Input
+HEADERS += SResProviderPack.h PackArchive.h respack-format.h respack-writer.h packresprovider-param.h
+SOURCES += cursoricon.cpp \
+           SResProviderPack.cpp \
+           PackArchive.cpp
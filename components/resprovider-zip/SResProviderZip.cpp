@@ -3,6 +3,7 @@
 
 #include "SResProviderZip.h"
 #include <pugixml/pugixml.hpp>
+#include <sprofiler.h>
 
 extern HICON CURSORICON_LoadFromBuf(const BYTE * bits,DWORD filesize,INT width, INT height,BOOL fCursor, UINT loadflags);
 extern HICON CURSORICON_LoadFromFile( LPCWSTR filename,
@@ -21,10 +22,10 @@ namespace SOUI{
 
 	HBITMAP SResProviderZip::LoadBitmap(LPCTSTR pszResName )
 	{
-		SStringT strPath=_GetFilePath(pszResName,_T("BITMAP"));
-		if(strPath.IsEmpty()) return NULL;
+		int iFile=_GetFileIndex(pszResName,_T("BITMAP"));
+		if(iFile==-1) return NULL;
 		CZipFile zf;
-		if(!m_zipFile.GetFile(strPath,zf)) return NULL;
+		if(!m_zipFile.GetFile(iFile,zf)) return NULL;
 
 		HDC hDC = GetDC(NULL);
 		//读取位图头
@@ -49,29 +50,29 @@ namespace SOUI{
 
 	HICON SResProviderZip::LoadIcon(LPCTSTR pszResName ,int cx/*=0*/,int cy/*=0*/)
 	{
-		SStringT strPath=_GetFilePath(pszResName,_T("ICON"));
-		if(strPath.IsEmpty()) return NULL;
+		int iFile=_GetFileIndex(pszResName,_T("ICON"));
+		if(iFile==-1) return NULL;
 		CZipFile zf;
-		if(!m_zipFile.GetFile(strPath,zf)) return NULL;
+		if(!m_zipFile.GetFile(iFile,zf)) return NULL;
 
         return CURSORICON_LoadFromBuf(zf.GetData(),zf.GetSize(),cx,cy,FALSE,LR_DEFAULTSIZE|LR_DEFAULTCOLOR);
 	}
 
     HCURSOR SResProviderZip::LoadCursor( LPCTSTR pszResName )
     {
-        SStringT strPath=_GetFilePath(pszResName,_T("CURSOR"));
-        if(strPath.IsEmpty()) return NULL;
+        int iFile=_GetFileIndex(pszResName,_T("CURSOR"));
+        if(iFile==-1) return NULL;
         CZipFile zf;
-        if(!m_zipFile.GetFile(strPath,zf)) return NULL;
+        if(!m_zipFile.GetFile(iFile,zf)) return NULL;
         return (HCURSOR)CURSORICON_LoadFromBuf(zf.GetData(),zf.GetSize(),0,0,TRUE,LR_DEFAULTSIZE|LR_DEFAULTCOLOR);
     }
 
 	IBitmap * SResProviderZip::LoadImage( LPCTSTR strType,LPCTSTR pszResName)
 	{
-		SStringT strPath=_GetFilePath(pszResName,strType);
-		if(strPath.IsEmpty()) return NULL;
+		int iFile=_GetFileIndex(pszResName,strType);
+		if(iFile==-1) return NULL;
 		CZipFile zf;
-		if(!m_zipFile.GetFile(strPath,zf)) return NULL;
+		if(!m_zipFile.GetFile(iFile,zf)) return NULL;
         IBitmap * pBmp=NULL;
         m_renderFactory->CreateBitmap(&pBmp);
         if(!pBmp) return NULL;
@@ -81,10 +82,10 @@ namespace SOUI{
 
     IImgX   * SResProviderZip::LoadImgX( LPCTSTR strType,LPCTSTR pszResName )
     {
-        SStringT strPath=_GetFilePath(pszResName,strType);
-        if(strPath.IsEmpty()) return NULL;
+        int iFile=_GetFileIndex(pszResName,strType);
+        if(iFile==-1) return NULL;
         CZipFile zf;
-        if(!m_zipFile.GetFile(strPath,zf)) return NULL;
+        if(!m_zipFile.GetFile(iFile,zf)) return NULL;
 
         IImgX *pImgX=NULL;
         m_renderFactory->GetImgDecoderFactory()->CreateImgX(&pImgX);
@@ -98,9 +99,9 @@ namespace SOUI{
         return pImgX;
     }
 
-	BOOL SResProviderZip::_Init( LPCTSTR pszZipFile ,LPCSTR pszPsw)
+	BOOL SResProviderZip::_Init( LPCTSTR pszZipFile ,LPCSTR pszPsw,BOOL bMapFile)
 	{
-		if(!m_zipFile.Open(pszZipFile)) return FALSE;
+		if(!m_zipFile.Open(pszZipFile,bMapFile)) return FALSE;
         m_zipFile.SetPassword(pszPsw);
 		return _LoadSkin();
 	}
@@ -114,6 +115,7 @@ namespace SOUI{
 
     BOOL SResProviderZip::Init( WPARAM wParam,LPARAM lParam )
     {
+        SPROFILE_SCOPE("SResProviderZip::Init");
         ZIPRES_PARAM *zipParam=(ZIPRES_PARAM*)wParam;
         m_renderFactory = zipParam->pRenderFac;
 		m_childDir = zipParam->pszChildDir;
@@ -124,61 +126,56 @@ namespace SOUI{
 			m_childDir += L"\\";
 		}
         if(zipParam->type == ZIPRES_PARAM::ZIPFILE)
-            return _Init(zipParam->pszZipFile,zipParam->pszPsw);
+            return _Init(zipParam->pszZipFile,zipParam->pszPsw,zipParam->bMapFile);
         else
             return _Init(zipParam->peInfo.hInst,zipParam->peInfo.pszResName,zipParam->peInfo.pszResType,zipParam->pszPsw);
     }
 
-	SStringT SResProviderZip::_GetFilePath( LPCTSTR pszResName,LPCTSTR pszType )
+	int SResProviderZip::_GetFileIndex( LPCTSTR pszResName,LPCTSTR pszType )
 	{
 		SResID resID(pszType,pszResName);
-		SMap<SResID,SStringT>::CPair *p = m_mapFiles.Lookup(resID);
-		if(!p) return _T("");
+		SMap<SResID,int>::CPair *p = m_mapFiles.Lookup(resID);
+		if(!p) return -1;
 		return p->m_value;
 	}
 
 	size_t SResProviderZip::GetRawBufferSize( LPCTSTR strType,LPCTSTR pszResName )
 	{
-		SStringT strPath=_GetFilePath(pszResName,strType);
-		if(strPath.IsEmpty()) return FALSE;
-		ZIP_FIND_DATA zfd;
-		HANDLE hf=m_zipFile.FindFirstFile(strPath,&zfd);
-		if(INVALID_HANDLE_VALUE==hf) return 0;
-		m_zipFile.FindClose(hf);
-		return zfd.nFileSizeUncompressed;
+		int iFile=_GetFileIndex(pszResName,strType);
+		if(iFile==-1) return 0;
+		return m_zipFile.GetFileSize(iFile);
 	}
 
 	BOOL SResProviderZip::GetRawBuffer( LPCTSTR strType,LPCTSTR pszResName,LPVOID pBuf,size_t size )
 	{
-		SStringT strPath=_GetFilePath(pszResName,strType);
-		if(strPath.IsEmpty()) return FALSE;
-		CZipFile zf;
-		if(!m_zipFile.GetFile(strPath,zf)) return NULL;
-		if(size<zf.GetSize())
+		int iFile=_GetFileIndex(pszResName,strType);
+		if(iFile==-1) return FALSE;
+		if(size<m_zipFile.GetFileSize(iFile))
 		{
 			SetLastError(ERROR_INSUFFICIENT_BUFFER);
 			return FALSE;
 		}
-		memcpy(pBuf,zf.GetData(),zf.GetSize());
-		return TRUE;
+		//直接解压到调用者的缓冲区
+		return m_zipFile.GetFileData(iFile,pBuf,(DWORD)size);
 	}
 
 	BOOL SResProviderZip::HasResource( LPCTSTR strType,LPCTSTR pszResName )
 	{
 		SResID resID(strType,pszResName);
-		SMap<SResID,SStringT>::CPair *p = m_mapFiles.Lookup(resID);
+		SMap<SResID,int>::CPair *p = m_mapFiles.Lookup(resID);
 		return p!=NULL;
 	}
 
 	BOOL SResProviderZip::_LoadSkin()
 	{
+		SPROFILE_SCOPE("SResProviderZip::LoadIndex");
 		CZipFile zf;
 		BOOL bIdx=m_zipFile.GetFile(m_childDir+UIRES_INDEX,zf);
 		if(!bIdx) return FALSE;
 
+		//zf可能直接引用zip数据, 不能原地解析
 		pugi::xml_document xmlDoc;
-		SStringA strFileName;
-		if(!xmlDoc.load_buffer_inplace(zf.GetData(),zf.GetSize(),pugi::parse_default,pugi::encoding_utf8)) return FALSE;
+		if(!xmlDoc.load_buffer(zf.GetData(),zf.GetSize(),pugi::parse_default,pugi::encoding_utf8)) return FALSE;
 		pugi::xml_node xmlElem=xmlDoc.child(L"resource");
         if(!xmlElem) return FALSE;
         pugi::xml_node resType=xmlElem.first_child();
@@ -188,7 +185,9 @@ namespace SOUI{
             while(resFile)
             {
                 SResID id(S_CW2T(resType.name()),S_CW2T(resFile.attribute(L"name").value()));
-                m_mapFiles[id] = m_childDir + S_CW2T(resFile.attribute(L"path").value());
+                //解析索引时就确定zip中的文件, 之后不需要再按文件名查找
+                m_mapFiles[id] = m_zipFile.GetFileIndex(m_childDir + S_CW2T(resFile.attribute(L"path").value()));
+                SPROFILE_COUNT(1,0);
                 resFile=resFile.next_sibling();
             }
             resType = resType.next_sibling();
@@ -32,12 +32,12 @@ public:
     virtual BOOL GetRawBuffer(LPCTSTR strType,LPCTSTR pszResName,LPVOID pBuf,size_t size);
 
 protected:
-    BOOL _Init(LPCTSTR pszZipFile ,LPCSTR pszPsw);
+    BOOL _Init(LPCTSTR pszZipFile ,LPCSTR pszPsw,BOOL bMapFile);
     BOOL _Init(HINSTANCE hInst,LPCTSTR pszResName,LPCTSTR pszType ,LPCSTR pszPsw);
 	BOOL _LoadSkin();
-	SStringT _GetFilePath(LPCTSTR pszResName,LPCTSTR pszType);
+	int _GetFileIndex(LPCTSTR pszResName,LPCTSTR pszType);
 	
-	SMap<SResID,SStringT> m_mapFiles;
+	SMap<SResID,int> m_mapFiles;   //资源对应的zip文件索引
     CAutoRefPtr<IRenderFactory> m_renderFactory;
 	CZipArchive m_zipFile;
 	SStringT m_childDir;
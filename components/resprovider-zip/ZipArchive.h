@@ -30,6 +30,7 @@ protected:
 	LPBYTE	m_pData;
 	DWORD	m_dwPos;
 	DWORD	m_dwSize;
+	BOOL	m_bView;	//m_pData指向zip数据本身, 不需要释放
 #ifdef ZLIB_DECRYPTION
 	// Decryption
 	const DWORD*	m_pCrcTable;
@@ -50,6 +51,7 @@ public:
 	BOOL Attach(LPBYTE pData, DWORD dwSize);
 	void Detach();
 protected:
+	BOOL AttachView(const BYTE* pData, DWORD dwSize);
 
 #ifdef ZLIB_DECRYPTION
 	BOOL _DecryptFile(LPCSTR pstrPassword, LPBYTE& pData, DWORD& dwSize, DWORD crc32);
@@ -149,23 +151,35 @@ protected:
 		int		nPos;
 	};
 
+	//文件名索引, 开放寻址, 不区分大小写, '/'和'\'等价
+	struct HashSlot
+	{
+		DWORD	dwHash;
+		int		iIndex;		//-1表示空
+	};
+
 	HANDLE			m_hFile;
+	HANDLE			m_hMapping;	//文件映射, 映射后m_fileRes引用映射的数据
 	CZipFile		m_fileRes;
 
 	ZipDirHeader	m_Header;
 	ZipDirFileHeader** m_Files;
 	BYTE*			m_DirData;
 	CHAR			m_szPassword[64];
+	HashSlot*		m_pHashSlots;
+	DWORD			m_dwHashMask;
 
 public:
 	CZipArchive();
 	~CZipArchive();
 
-	BOOL Open(LPCTSTR pszFileName);
+	//bMapFile: 把文件映射到内存, 之后读取不需要系统调用, 可以在多个线程中同时读取. 映射失败时使用文件句柄读取
+	BOOL Open(LPCTSTR pszFileName, BOOL bMapFile = TRUE);
 	BOOL Open(HMODULE hModule,LPCTSTR pszName,LPCTSTR pszType=_T("ZIP"));
 
 	void Close();
 	BOOL IsOpen() const;
+	BOOL IsMapped() const;
 	int GetEntries() const;
 
 	BOOL SetPassword(LPCSTR pstrPassword);
@@ -183,6 +197,11 @@ public:
 		return GetFile2(GetFileIndex(pszFileName),file);
 	}
 	BOOL GetFile2(int iIndex, CZipFile& file);
+
+	//把文件解压到pBuf, dwSize不能小于GetFileSize. 不经过CZipFile中转
+	BOOL GetFileData(int iIndex, LPVOID pBuf, DWORD dwSize);
+	//未压缩且未加密的文件在zip数据已经在内存中时直接返回数据地址, 否则返回NULL
+	const BYTE* GetFileView(int iIndex);
 	// FindFile API
 
 	HANDLE FindFirstFile(LPCTSTR pszFileName, LPZIP_FIND_DATA lpFindFileData) const;
@@ -192,9 +211,17 @@ public:
 protected:
 	BOOL OpenZip();
 	void CloseFile();
+	void BuildIndex();
 
 	DWORD ReadFile(void* pBuffer, DWORD dwBytes);
 	DWORD SeekFile(LONG lOffset, UINT nFrom);
+	//从指定位置读取, 不改变文件指针, 可以在多个线程中同时调用
+	DWORD ReadFileAt(DWORD dwOffset, void* pBuffer, DWORD dwBytes);
+	//读取本地文件头, 返回文件数据的偏移, 失败返回-1
+	DWORD ReadLocalHeader(int iIndex, ZipLocalHeader& hdr);
+
+	static DWORD HashName(LPCTSTR pszName);
+	BOOL IsNameEqual(int iIndex, LPCTSTR pszName);
 };
 
 #endif	//	__ZIPARCHIVE_H__
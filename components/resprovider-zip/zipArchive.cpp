@@ -24,7 +24,8 @@
 CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		: m_pData(NULL),
 		m_dwSize(0),
-		m_dwPos(0)
+		m_dwPos(0),
+		m_bView(FALSE)
 	{
 #ifdef ZLIB_DECRYPTION
 		m_pCrcTable = NULL;
@@ -64,10 +65,12 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		if (m_pData == NULL)
 			return TRUE;
 
-		delete[] m_pData;
+		if (!m_bView)
+			delete[] m_pData;
 		m_pData = NULL;
 		m_dwSize = 0;
 		m_dwPos = 0;
+		m_bView = FALSE;
 
 		return TRUE;
 	}
@@ -225,6 +228,33 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		m_pData = NULL;
 		m_dwSize = 0;
 		m_dwPos = 0;
+		m_bView = FALSE;
+	}
+
+	BOOL CZipFile::AttachView(const BYTE* pData, DWORD dwSize)
+	{
+		//不检查可读性, 避免访问映射文件的所有页面
+		if(m_pData) return FALSE;
+		m_pData = (LPBYTE)pData;
+		m_dwSize = dwSize;
+		m_bView = TRUE;
+		return TRUE;
+	}
+
+	// Perform inflation; wbits < 0 indicates no zlib header inside the data.
+	static BOOL InflateData(const BYTE* pSrc, DWORD cSize, LPBYTE pDst, DWORD ucSize)
+	{
+		z_stream stream = { 0 };
+		stream.next_in = (Bytef*) pSrc;
+		stream.avail_in = (uInt) cSize;
+		stream.next_out = (Bytef*) pDst;
+		stream.avail_out = ucSize;
+		int err = inflateInit2(&stream, -MAX_WBITS);
+		if (err != Z_OK)
+			return FALSE;
+		err = inflate(&stream, Z_FINISH);
+		inflateEnd(&stream);
+		return err == Z_STREAM_END && stream.total_out == ucSize;
 	}
 
 
@@ -234,8 +264,11 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 	
 	CZipArchive::CZipArchive()
 		: m_hFile(INVALID_HANDLE_VALUE),
+		m_hMapping(NULL),
 		m_Files(NULL),
-		m_DirData(NULL)
+		m_DirData(NULL),
+		m_pHashSlots(NULL),
+		m_dwHashMask(0)
 	{
 		memset(&m_Header, 0, sizeof(m_Header));
 	}
@@ -259,8 +292,6 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 			return FALSE;
 		}
 
-		_ASSERTE(m_Header.nDirEntries < 1000); // Sanity check
-
 		m_DirData = (LPBYTE)malloc(m_Header.dirSize);
 		_ASSERTE(m_DirData);
 
@@ -285,12 +316,14 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		}
 
 		LPBYTE pData = m_DirData;
+		LPBYTE pDataEnd = m_DirData + m_Header.dirSize;
 		for (int i = 0; i < m_Header.nDirEntries; i++)
 		{
 			// Set the header pointer in the m_Files array
 			ZipDirFileHeader* fh = (ZipDirFileHeader*) pData;
 			m_Files[i] = fh;
-			if (fh->sig != FILE_SIGNATURE)
+			if (pData + sizeof(ZipDirFileHeader) > pDataEnd || fh->sig != FILE_SIGNATURE
+				|| pData + sizeof(ZipDirFileHeader) + fh->fnameLen + fh->xtraLen + fh->cmntLen > pDataEnd)
 			{
 				Close();
 				return FALSE;
@@ -307,8 +340,76 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 
 		m_szPassword[0] = '\0';
 
+		BuildIndex();
 		return TRUE;
 	}
+
+	DWORD CZipArchive::HashName(LPCTSTR pszName)
+	{
+		//FNV-1a
+		DWORD dwHash = 2166136261;
+		for(; *pszName; pszName++)
+		{
+			TCHAR c = *pszName == _T('/') ? _T('\\') : (TCHAR)_totlower(*pszName);
+			dwHash ^= (DWORD)c;
+			dwHash *= 16777619;
+		}
+		return dwHash;
+	}
+
+	//zip中的文件名转换为TCHAR, 与原来FindNextFile的处理一致
+	static void GetEntryName(LPCSTR pszName, int nLen, TCHAR szFile[MAX_PATH])
+	{
+		memset(szFile, 0, sizeof(TCHAR)*MAX_PATH);
+		::OemToCharBuff(pszName, szFile, min(nLen, MAX_PATH-1));
+	}
+
+	BOOL CZipArchive::IsNameEqual(int iIndex, LPCTSTR pszName)
+	{
+		TCHAR szFile[MAX_PATH];
+		GetEntryName(m_Files[iIndex]->GetName(), m_Files[iIndex]->fnameLen, szFile);
+		LPCTSTR p1 = szFile, p2 = pszName;
+		for(; *p1 && *p2; p1++, p2++)
+		{
+			TCHAR c1 = *p1 == _T('/') ? _T('\\') : (TCHAR)_totlower(*p1);
+			TCHAR c2 = *p2 == _T('/') ? _T('\\') : (TCHAR)_totlower(*p2);
+			if(c1 != c2) return FALSE;
+		}
+		return *p1 == *p2;
+	}
+
+	void CZipArchive::BuildIndex()
+	{
+		//装载因子不超过0.5, 查找时一定能遇到空位
+		DWORD dwSlots = 16;
+		while(dwSlots < (DWORD)m_Header.nDirEntries*2)
+			dwSlots <<= 1;
+		m_pHashSlots = new HashSlot[dwSlots];
+		m_dwHashMask = dwSlots - 1;
+		for(DWORD i = 0; i < dwSlots; i++)
+			m_pHashSlots[i].iIndex = -1;
+
+		TCHAR szFile[MAX_PATH];
+		for(int i = 0; i < m_Header.nDirEntries; i++)
+		{
+			GetEntryName(m_Files[i]->GetName(), m_Files[i]->fnameLen, szFile);
+			DWORD dwHash = HashName(szFile);
+			DWORD iSlot = dwHash & m_dwHashMask;
+			BOOL bDup = FALSE;
+			while(m_pHashSlots[iSlot].iIndex != -1)
+			{//同名文件保留第一个, 与原来的顺序查找一致
+				if(m_pHashSlots[iSlot].dwHash == dwHash && IsNameEqual(m_pHashSlots[iSlot].iIndex, szFile))
+				{
+					bDup = TRUE;
+					break;
+				}
+				iSlot = (iSlot + 1) & m_dwHashMask;
+			}
+			if(bDup) continue;
+			m_pHashSlots[iSlot].dwHash = dwHash;
+			m_pHashSlots[iSlot].iIndex = i;
+		}
+	}
 	void CZipArchive::Close()
 	{
 		CloseFile();
@@ -323,12 +424,22 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 			free(m_DirData);
 			m_DirData = NULL;
 		}
+		if (m_pHashSlots != NULL)
+		{
+			delete[] m_pHashSlots;
+			m_pHashSlots = NULL;
+			m_dwHashMask = 0;
+		}
 		memset(&m_Header, 0, sizeof(m_Header));
 	}
 	BOOL CZipArchive::IsOpen() const
 	{
 		return m_hFile != INVALID_HANDLE_VALUE;
 	}
+	BOOL CZipArchive::IsMapped() const
+	{
+		return m_hMapping != NULL;
+	}
 	int CZipArchive::GetEntries() const
 	{
 		return m_Header.nDirEntries;
@@ -353,9 +464,47 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 	}
 
 	BOOL CZipArchive::GetFile2(int iIndex, CZipFile& file)
+	{
+		if (!file.IsOpen())
+			return FALSE;
+		return GetFileData(iIndex, file.GetData(), file.GetSize());
+	}
+
+	DWORD CZipArchive::ReadLocalHeader(int iIndex, ZipLocalHeader& hdr)
+	{
+		ZipDirFileHeader* fh = m_Files[iIndex];
+		DWORD dwRead = ReadFileAt(fh->hdrOffset, &hdr, sizeof(hdr));
+		if (dwRead != sizeof(hdr) || hdr.sig != LOCAL_SIGNATURE)
+			return (DWORD)-1;
+		//本地文件头中的大小可能为0(使用了数据描述符), 以中心目录为准
+		hdr.crc32 = fh->crc32;
+		hdr.cSize = fh->cSize;
+		hdr.ucSize = fh->ucSize;
+		return fh->hdrOffset + sizeof(hdr) + hdr.fnameLen + hdr.xtraLen;
+	}
+
+	const BYTE* CZipArchive::GetFileView(int iIndex)
+	{
+		if (!m_fileRes.IsOpen())
+			return NULL;
+		if (iIndex < 0 || iIndex >= m_Header.nDirEntries)
+			return NULL;
+		ZipDirFileHeader* fh = m_Files[iIndex];
+		if (fh->compression != FILE_COMP_STORE || (fh->flag & 1))
+			return NULL;
+
+		ZipLocalHeader hdr;
+		DWORD dwOffset = ReadLocalHeader(iIndex, hdr);
+		if (dwOffset == (DWORD)-1 || hdr.cSize != hdr.ucSize)
+			return NULL;
+		if (dwOffset > m_fileRes.GetSize() || m_fileRes.GetSize() - dwOffset < hdr.cSize)
+			return NULL;
+		return m_fileRes.GetData() + dwOffset;
+	}
+
+	BOOL CZipArchive::GetFileData(int iIndex, LPVOID pBuf, DWORD dwSize)
 	{
 		_ASSERTE(IsOpen());
-		_ASSERTE(iIndex >= 0 && iIndex < m_Header.nDirEntries);
 
 		if (m_hFile == INVALID_HANDLE_VALUE)
 			return FALSE;
@@ -363,70 +512,40 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 			return FALSE;
 
 		ZipLocalHeader hdr;
-		SeekFile(m_Files[iIndex]->hdrOffset, FILE_BEGIN);
-
-		DWORD dwRead = ReadFile(&hdr, sizeof(hdr));
-		if (dwRead != sizeof(hdr))
+		DWORD dwOffset = ReadLocalHeader(iIndex, hdr);
+		if (dwOffset == (DWORD)-1)
 			return FALSE;
-
-		if (hdr.sig != LOCAL_SIGNATURE)
+		if (dwSize < hdr.ucSize)
 			return FALSE;
 
-		SeekFile(hdr.fnameLen + hdr.xtraLen, FILE_CURRENT);
-
-		DWORD dwSize = hdr.cSize;
 		if (hdr.flag & 1)
-		{//这个接口不支持加密
-			return FALSE;
+		{//加密文件需要先整体解密
+			CZipFile file;
+			if (!GetFile(iIndex, file) || file.GetSize() > dwSize)
+				return FALSE;
+			memcpy(pBuf, file.GetData(), file.GetSize());
+			return TRUE;
 		}
 
 		switch (hdr.compression)
 		{
 		case LOCAL_COMP_STORE:
-			_ASSERTE(hdr.cSize == hdr.ucSize);
-			dwRead = ReadFile(file.GetData(), hdr.cSize);
-			return dwRead==hdr.cSize;
-		case LOCAL_COMP_DEFLAT: 
+			if (hdr.cSize != hdr.ucSize)
+				return FALSE;
+			return ReadFileAt(dwOffset, pBuf, hdr.cSize) == hdr.cSize;
+		case LOCAL_COMP_DEFLAT:
 			{
-				if(file.GetSize()<hdr.ucSize) return FALSE;
-				// Read Source Data.
-				LPBYTE pData=new BYTE[hdr.cSize];
-
-				if (pData == NULL)
-					return FALSE;
-
-				dwRead = ReadFile(pData, hdr.cSize);
-				if (dwRead != hdr.cSize)
-				{
-					delete[] pData;
-					return FALSE;
+				if (m_fileRes.IsOpen())
+				{//数据已经在内存中, 直接解压
+					if (dwOffset > m_fileRes.GetSize() || m_fileRes.GetSize() - dwOffset < hdr.cSize)
+						return FALSE;
+					return InflateData(m_fileRes.GetData() + dwOffset, hdr.cSize, (LPBYTE)pBuf, hdr.ucSize);
 				}
-
-				LPBYTE pTarget=file.GetData();
-
-				z_stream stream = { 0 };
-				stream.next_in = (Bytef*) pData;
-				stream.avail_in = (uInt) hdr.cSize;
-				stream.next_out = (Bytef*) pTarget;
-				stream.avail_out = hdr.ucSize;
-				stream.zalloc = (alloc_func) NULL;
-				stream.zfree = (free_func) NULL;
-				// Perform inflation; wbits < 0 indicates no zlib header inside the data.
-				int err = inflateInit2(&stream, -MAX_WBITS);
-				if (err == Z_OK)
-				{
-					err = inflate(&stream, Z_OK);
-					if (err != Z_OK && err != Z_STREAM_END)
-						_ASSERTE(err == Z_OK);
-					inflateEnd(&stream);
-					if (err == Z_STREAM_END)
-						err = Z_OK;
-					inflateEnd(&stream);
-				}
-
+				LPBYTE pData = new BYTE[hdr.cSize];
+				BOOL bRet = ReadFileAt(dwOffset, pData, hdr.cSize) == hdr.cSize
+					&& InflateData(pData, hdr.cSize, (LPBYTE)pBuf, hdr.ucSize);
 				delete[] pData;
-
-				return err == Z_OK;
+				return bRet;
 			}
 		default:
 			_ASSERTE(FALSE); // unsupported compression scheme
@@ -445,18 +564,16 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		if (iIndex < 0 || iIndex >= m_Header.nDirEntries)
 			return FALSE;
 
-		ZipLocalHeader hdr;
-		SeekFile(m_Files[iIndex]->hdrOffset, FILE_BEGIN);
-
-		DWORD dwRead = ReadFile(&hdr, sizeof(hdr));
-		if (dwRead != sizeof(hdr))
-			return FALSE;
+		//未压缩的文件直接引用zip数据
+		const BYTE* pView = GetFileView(iIndex);
+		if (pView)
+			return file.AttachView(pView, m_Files[iIndex]->ucSize);
 
-		if (hdr.sig != LOCAL_SIGNATURE)
+		ZipLocalHeader hdr;
+		DWORD dwOffset = ReadLocalHeader(iIndex, hdr);
+		if (dwOffset == (DWORD)-1)
 			return FALSE;
 
-		SeekFile(hdr.fnameLen + hdr.xtraLen, FILE_CURRENT);
-
 		// 		// Decompress file if needed.
 		LPBYTE pData;
 		pData = new BYTE[hdr.cSize];
@@ -464,7 +581,7 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		if (pData == NULL)
 			return FALSE;
 
-		dwRead = ReadFile(pData, hdr.cSize);
+		DWORD dwRead = ReadFileAt(dwOffset, pData, hdr.cSize);
 		if (dwRead != hdr.cSize)
 		{
             delete[] pData;
@@ -503,31 +620,15 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 				_ASSERTE(pTarget);
 
 				if (pTarget == NULL)
-					return FALSE;
-
-				z_stream stream = { 0 };
-				stream.next_in = (Bytef*) pData;
-				stream.avail_in = (uInt) hdr.cSize;
-				stream.next_out = (Bytef*) pTarget;
-				stream.avail_out = hdr.ucSize;
-				stream.zalloc = (alloc_func) NULL;
-				stream.zfree = (free_func) NULL;
-				// Perform inflation; wbits < 0 indicates no zlib header inside the data.
-				int err = inflateInit2(&stream, -MAX_WBITS);
-				if (err == Z_OK)
 				{
-					err = inflate(&stream, Z_OK);
-					if (err != Z_OK && err != Z_STREAM_END)
-						_ASSERTE(err == Z_OK);
-					inflateEnd(&stream);
-					if (err == Z_STREAM_END)
-						err = Z_OK;
-					inflateEnd(&stream);
+					delete[] pData;
+					return FALSE;
 				}
 
+				BOOL bOK = InflateData(pData, dwSize, pTarget, hdr.ucSize);
 				delete[] pData;
 
-				if (err != Z_OK)
+				if (!bOK)
 				{
 					delete[] pTarget;
 					return FALSE;
@@ -537,6 +638,7 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 			break;
 		default:
 			_ASSERTE(FALSE); // unsupported compression scheme
+			delete[] pData;
 			return FALSE;
 		}
 		// The memory we allocated is passed to the file, which
@@ -638,7 +740,7 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		return TRUE;
 	}
 
-	BOOL CZipArchive::Open(LPCTSTR pszFileName)
+	BOOL CZipArchive::Open(LPCTSTR pszFileName, BOOL bMapFile/* = TRUE*/)
 	{
 		_ASSERTE(!::IsBadStringPtr(pszFileName, MAX_PATH));
 		HANDLE hFile = ::CreateFile(pszFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -647,11 +749,30 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		
 		Close();
 		m_hFile=hFile;
+
+		if(bMapFile)
+		{
+			DWORD dwSizeHigh = 0;
+			DWORD dwSize = ::GetFileSize(hFile, &dwSizeHigh);
+			if(dwSize != INVALID_FILE_SIZE && dwSize != 0 && dwSizeHigh == 0)
+			{
+				m_hMapping = ::CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+				LPBYTE pView = m_hMapping ? (LPBYTE)::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+				if(pView)
+				{
+					m_fileRes.AttachView(pView, dwSize);
+				}else if(m_hMapping)
+				{//地址空间不足等情况下使用文件句柄读取
+					::CloseHandle(m_hMapping);
+					m_hMapping = NULL;
+				}
+			}
+		}
+
 		BOOL bOK=OpenZip();
 		if(!bOK)
 		{
-			CloseHandle(m_hFile);
-			m_hFile=INVALID_HANDLE_VALUE;
+			CloseFile();
 		}
 		return bOK;
 	}
@@ -693,7 +814,16 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 	{
 		if (m_hFile != INVALID_HANDLE_VALUE)
 		{
-			if (m_fileRes.IsOpen())
+			if (m_hMapping != NULL)
+			{
+				LPBYTE pView = m_fileRes.GetData();
+				m_fileRes.Detach();
+				::UnmapViewOfFile(pView);
+				::CloseHandle(m_hMapping);
+				m_hMapping = NULL;
+				::CloseHandle(m_hFile);
+			}
+			else if (m_fileRes.IsOpen())
 				m_fileRes.Detach();
 			else
 				::CloseHandle(m_hFile);
@@ -714,6 +844,29 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 
 		return dwRead;
 	}
+	DWORD CZipArchive::ReadFileAt(DWORD dwOffset, void* pBuffer, DWORD dwBytes)
+	{
+		_ASSERTE(m_hFile != INVALID_HANDLE_VALUE);
+
+		if (m_fileRes.IsOpen())
+		{
+			DWORD dwSize = m_fileRes.GetSize();
+			if (dwOffset >= dwSize)
+				return 0;
+			if (dwBytes > dwSize - dwOffset)
+				dwBytes = dwSize - dwOffset;
+			memcpy(pBuffer, m_fileRes.GetData() + dwOffset, dwBytes);
+			return dwBytes;
+		}
+
+		OVERLAPPED ov = { 0 };
+		ov.Offset = dwOffset;
+		DWORD dwRead = 0;
+		if (!::ReadFile(m_hFile, pBuffer, dwBytes, &dwRead, &ov))
+			return 0;
+		return dwRead;
+	}
+
 	DWORD CZipArchive::SeekFile(LONG lOffset, UINT nFrom)
 	{
 		_ASSERTE(m_hFile != INVALID_HANDLE_VALUE);
@@ -741,13 +894,7 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		if (iIndex < 0 || iIndex >= m_Header.nDirEntries)
 			return 0;
 
-		ZipLocalHeader hdr;
-		SeekFile(m_Files[iIndex]->hdrOffset, FILE_BEGIN);
-
-		DWORD dwRead = ReadFile(&hdr, sizeof(hdr));
-		if (dwRead != sizeof(hdr))
-			return 0;
-		return hdr.ucSize;
+		return m_Files[iIndex]->ucSize;
 	}
 
 	int CZipArchive::GetFileIndex( LPCTSTR pszFileName )
@@ -755,10 +902,14 @@ CZipFile::CZipFile(DWORD dwSize/*=0*/)
 		_ASSERTE(IsOpen());
 		_ASSERTE(!::IsBadStringPtr(pszFileName, MAX_PATH));
 
-		ZIP_FIND_DATA fd;
-		HANDLE hFindFile = FindFirstFile(pszFileName, &fd);
-		if (hFindFile == INVALID_HANDLE_VALUE)
+		if (m_pHashSlots == NULL || pszFileName == NULL)
 			return -1;
-		FindClose(hFindFile);
-		return fd.nIndex;
+
+		DWORD dwHash = HashName(pszFileName);
+		for (DWORD iSlot = dwHash & m_dwHashMask; m_pHashSlots[iSlot].iIndex != -1; iSlot = (iSlot + 1) & m_dwHashMask)
+		{
+			if (m_pHashSlots[iSlot].dwHash == dwHash && IsNameEqual(m_pHashSlots[iSlot].iIndex, pszFileName))
+				return m_pHashSlots[iSlot].iIndex;
+		}
+		return -1;
 	}
\ No newline at end of file
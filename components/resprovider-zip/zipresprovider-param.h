@@ -17,13 +17,15 @@ namespace SOUI
 		};
 		LPCSTR          pszPsw; //ZIP密码
 		LPCTSTR			pszChildDir;
-		void ZipFile(IRenderFactory *_pRenderFac, LPCTSTR _pszFile, LPCSTR _pszPsw = NULL, LPCTSTR _pszChildDir = NULL)
+		BOOL			bMapFile;	//ZIPFILE时把文件映射到内存中读取
+		void ZipFile(IRenderFactory *_pRenderFac, LPCTSTR _pszFile, LPCSTR _pszPsw = NULL, LPCTSTR _pszChildDir = NULL, BOOL _bMapFile = TRUE)
 		{
 			type = ZIPFILE;
 			pszZipFile = _pszFile;
 			pszChildDir = _pszChildDir;
 			pRenderFac = _pRenderFac;
 			pszPsw = _pszPsw;
+			bMapFile = _bMapFile;
 		}
 		void ZipResource(IRenderFactory *_pRenderFac, HINSTANCE hInst, LPCTSTR pszResName, LPCTSTR pszResType = _T("zip"), LPCSTR _pszPsw = NULL, LPCTSTR _pszChildDir = NULL)
 		{
@@ -34,6 +36,7 @@ namespace SOUI
 			peInfo.pszResName = pszResName;
 			peInfo.pszResType = pszResType;
 			pszPsw = _pszPsw;
+			bMapFile = FALSE;
 		}
 	};
 }
\ No newline at end of file
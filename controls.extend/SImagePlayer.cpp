@@ -41,8 +41,15 @@ void SImagePlayer::OnShowWindow( BOOL bShow, UINT nStatus )
 
 void SImagePlayer::OnNextFrame()
 {
-    m_nNextInterval -= 10;
-    if(m_nNextInterval <= 0 && m_aniSkin)
+    OnFrame(KFrameInterval);
+}
+
+DWORD SImagePlayer::OnFrame(DWORD dwElapsed)
+{
+    if(!m_aniSkin) return INFINITE;
+    //֮֡䲻Ҫص, ʵʾʱ
+    m_nNextInterval -= (int)dwElapsed;
+    if(m_nNextInterval <= 0)
     {
         int nStates=m_aniSkin->GetStates();
         m_iCurFrame++;
@@ -54,6 +61,7 @@ void SImagePlayer::OnNextFrame()
         else
             m_nNextInterval =m_aniSkin->GetFrameDelay()*10;	
     }
+    return m_nNextInterval>0?m_nNextInterval:0;
 }
 
 HRESULT SImagePlayer::OnAttrSkin( const SStringW & strValue, BOOL bLoading )
@@ -69,6 +77,9 @@ HRESULT SImagePlayer::OnAttrSkin( const SStringW & strValue, BOOL bLoading )
             m_nNextInterval = 90;
         else
             m_nNextInterval =m_aniSkin->GetFrameDelay()*10;	
+        //ûskinʱOnFrameINFINITE, skin; ԭskinֻһ֡ʱûע
+        if(IsVisible(TRUE) && m_aniSkin->GetStates()>1 && !GetContainer()->RequestNextFrame(this,m_nNextInterval))
+            GetContainer()->RegisterTimelineHandler(this);
     }
 	return bLoading?S_OK:S_FALSE;
 }
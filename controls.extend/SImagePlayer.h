@@ -35,6 +35,8 @@ namespace SOUI
         virtual CSize GetDesiredSize(LPCRECT pRcContainer);
     protected://ITimerLineHander
         virtual void OnNextFrame();
+        //ʵʾʱл֡, صһ֡ʱ
+        virtual DWORD OnFrame(DWORD dwElapsed);
 
     public://Դ
         SOUI_ATTRS_BEGIN()		
@@ -44,7 +44,8 @@ namespace SOUI
             SIZE sz={0};
             if(m_nFrames>0 && m_pFrames)
             {
-                sz=m_pFrames[0].pBmp->Size();
+                IBitmap *pBmp=GetFrameBitmap(0);
+                if(pBmp) sz=pBmp->Size();
             }
             return sz;
         }
@@ -67,17 +68,25 @@ namespace SOUI
             return nRet;
         }
         
+        /**
+        * GetFrameImage
+        * @brief    ָ֡λͼ
+        * @param    int iFrame --  ֡,Ϊ-1ʱǰ֡
+        * @return   IBitmap * -- ֡λͼ
+        * Describe  ֡λͼܰ贴ڻ֡ʱͷ, صλͼ֤ЧһεGetFrameImage,
+        *           ҪʱʹʱԼAddRef
+        */    
         IBitmap * GetFrameImage(int iFrame=-1)
         {
             if(iFrame==-1) iFrame=m_iFrame;
-            long nRet=-1;
             if(m_nFrames>1 && iFrame>=0 && iFrame<m_nFrames)
             {
-                return m_pFrames[iFrame].pBmp;
+                m_pFrameImage = GetFrameBitmap(iFrame);
             }else
             {
-                return NULL;
+                m_pFrameImage = NULL;
             }
+            return m_pFrameImage;
         }
 
 
@@ -131,13 +140,27 @@ namespace SOUI
             if(m_nFrames == 0 || !m_pFrames) return;
             if(dwState!=-1) SelectActiveFrame(dwState);
             CRect rcSrc(CPoint(0,0),GetSkinSize());
-            pRT->DrawBitmapEx(rcDraw,m_pFrames[m_iFrame].pBmp,rcSrc,EM_STRETCH,byAlpha);
+            IBitmap *pBmp=GetFrameBitmap(m_iFrame);
+            if(pBmp) pRT->DrawBitmapEx(rcDraw,pBmp,rcSrc,EM_STRETCH,byAlpha);
+        }
+
+        /**
+        * GetFrameBitmap
+        * @brief    ָ֡λͼ
+        * @param    int iFrame --  ֡
+        * @return   IBitmap * -- ֡λͼ
+        * Describe  ﰴ贴֡λͼ
+        */    
+        virtual IBitmap * GetFrameBitmap(int iFrame)
+        {
+            return m_pFrames[iFrame].pBmp;
         }
 
         int m_nFrames;
         int m_iFrame;
 
         SAniImgFrame * m_pFrames;
+        CAutoRefPtr<IBitmap> m_pFrameImage; //GetFrameImageصλͼ
     };
 
 }
\ No newline at end of file
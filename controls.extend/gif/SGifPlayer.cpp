@@ -43,8 +43,15 @@ void SGifPlayer::OnShowWindow( BOOL bShow, UINT nStatus )
 
 void SGifPlayer::OnNextFrame()
 {
-    m_nNextInterval -= 10;
-    if(m_nNextInterval <= 0 && m_aniSkin)
+    OnFrame(KFrameInterval);
+}
+
+DWORD SGifPlayer::OnFrame(DWORD dwElapsed)
+{
+    if(!m_aniSkin) return INFINITE;
+    //֮֡䲻Ҫص, ʵʾʱ
+    m_nNextInterval -= (int)dwElapsed;
+    if(m_nNextInterval <= 0)
     {
         int nStates=m_aniSkin->GetStates();
         m_iCurFrame++;
@@ -56,6 +63,7 @@ void SGifPlayer::OnNextFrame()
         else
             m_nNextInterval =m_aniSkin->GetFrameDelay()*10;	
     }
+    return m_nNextInterval>0?m_nNextInterval:0;
 }
 
 HRESULT SGifPlayer::OnAttrSkin( const SStringW & strValue, BOOL bLoading )
@@ -71,6 +79,9 @@ HRESULT SGifPlayer::OnAttrSkin( const SStringW & strValue, BOOL bLoading )
             m_nNextInterval = 90;
         else
             m_nNextInterval =m_aniSkin->GetFrameDelay()*10;	
+        //ûskinʱOnFrameINFINITE, skin; ԭskinֻһ֡ʱûע
+        if(IsVisible(TRUE) && m_aniSkin->GetStates()>1 && !GetContainer()->RequestNextFrame(this,m_nNextInterval))
+            GetContainer()->RegisterTimelineHandler(this);
     }
 	return bLoading?S_OK:S_FALSE;
 }
@@ -111,8 +122,9 @@ BOOL SGifPlayer::_PlayFile( LPCTSTR pszFileName, BOOL bGif )
 		GetParent()->UpdateChildrenPosition();
 	}
 	if(IsVisible(TRUE))
-	{
-		GetContainer()->RegisterTimelineHandler(this);
+	{//Ѿעʱڵȴ
+		if(!GetContainer()->RequestNextFrame(this))
+			GetContainer()->RegisterTimelineHandler(this);
 	}
 	return TRUE;
 }
@@ -64,17 +64,55 @@ int SSkinAPNG::_InitImgFrame( IImgX *pImgX )
     m_pFrames = NULL;
     m_nFrames =0;
     m_iFrame = 0;
+    m_imgX = NULL;
+    m_pFrameImage = NULL;
     if(!pImgX) return 0;
 
     m_nFrames = pImgX->GetFrameCount();
+    if(m_nFrames == 0) return 0;
     m_pFrames = new SAniImgFrame[m_nFrames];
+
+    UINT nWid=0,nHei=0;
+    pImgX->GetFrame(0)->GetSize(&nWid,&nHei);
+    //ʹֵͬ: ʽʱֻʹõļ֡
+    if((size_t)nWid*nHei*4*m_nFrames > KImgXStreamFrameBytes)
+    {
+        m_imgX = pImgX;
+        m_szImg.SetSize(nWid,nHei);
+        for(int i=0;i<KFrameCache;i++) m_iCached[i] = -1;
+        m_iCacheNext = 0;
+    }
     for(int i=0;i<m_nFrames;i++)
     {
-        GETRENDERFACTORY->CreateBitmap(&m_pFrames[i].pBmp);
-        m_pFrames[i].pBmp->Init(pImgX->GetFrame(i));
+        if(!m_imgX)
+        {
+            GETRENDERFACTORY->CreateBitmap(&m_pFrames[i].pBmp);
+            m_pFrames[i].pBmp->Init(pImgX->GetFrame(i));
+        }
         m_pFrames[i].nDelay=pImgX->GetFrame(i)->GetDelay();
     }
     return m_nFrames;
 }
 
+SIZE SSkinAPNG::GetSkinSize()
+{
+    if(m_imgX) return m_szImg;
+    return SSkinAni::GetSkinSize();
+}
+
+IBitmap * SSkinAPNG::GetFrameBitmap(int iFrame)
+{
+    if(!m_imgX || m_pFrames[iFrame].pBmp) return m_pFrames[iFrame].pBmp;
+
+    //ͷ紴֡λͼ
+    int iOld = m_iCached[m_iCacheNext];
+    if(iOld != -1) m_pFrames[iOld].pBmp = NULL;
+
+    GETRENDERFACTORY->CreateBitmap(&m_pFrames[iFrame].pBmp);
+    m_pFrames[iFrame].pBmp->Init(m_imgX->GetFrame(iFrame));
+    m_iCached[m_iCacheNext] = iFrame;
+    m_iCacheNext = (m_iCacheNext+1)%KFrameCache;
+    return m_pFrames[iFrame].pBmp;
+}
+
 }//end of namespace SOUI
\ No newline at end of file
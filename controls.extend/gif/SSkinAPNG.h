@@ -28,11 +28,13 @@ namespace SOUI
     {
         SOUI_CLASS_NAME(SSkinAPNG, L"apng")
     public:
-        SSkinAPNG()
+        SSkinAPNG():m_iCacheNext(0)
         {
 
         }
 
+        virtual SIZE GetSkinSize();
+
         
         /**
          * LoadFromFile
@@ -61,5 +63,13 @@ namespace SOUI
         
         int _InitImgFrame(IImgX *pImgX);
 
+        virtual IBitmap * GetFrameBitmap(int iFrame);
+
+        enum {KFrameCache = 3};
+        CAutoRefPtr<IImgX>  m_imgX;     //֡ݽϴʱ, ʱŴ֡λͼ
+        CSize               m_szImg;
+        int                 m_iCached[KFrameCache]; //Ѿλͼ֡
+        int                 m_iCacheNext;
+
     };
 }//end of name space SOUI
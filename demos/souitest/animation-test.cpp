@@ -0,0 +1,287 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <animator/SAnimationEngine.h>
+#include <animator/SInterpolatorImpl.h>
+#include <helper/SFrameClock.h>
+#include <stdio.h>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//动画引擎使用虚拟时钟, 结果与真实时间无关
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=AnimationEngineTest.DISABLED_*
+
+enum {PROP_X = ANIPROP_USER, PROP_Y, PROP_Z, PROP_W};
+
+struct TestTarget : public IAnimationTarget
+{
+	float fValues[4];
+	int nSets;
+	int nFrames;		//相当于刷新的次数
+	BOOL bValid;
+
+	TestTarget():nSets(0),nFrames(0),bValid(TRUE)
+	{
+		fValues[0] = fValues[1] = fValues[2] = fValues[3] = -1.0f;
+	}
+
+	virtual BOOL GetAnimatedValue(int nProp,float & fValue)
+	{
+		fValue = fValues[nProp-PROP_X];
+		return TRUE;
+	}
+	virtual BOOL SetAnimatedValue(int nProp,float fValue)
+	{
+		if(!bValid) return FALSE;
+		fValues[nProp-PROP_X] = fValue;
+		nSets++;
+		return TRUE;
+	}
+	virtual void OnAnimationFrame(){nFrames++;}
+};
+
+struct EndRecord
+{
+	int nEnded;
+	int nCanceled;
+	UINT uLastID;
+	EndRecord():nEnded(0),nCanceled(0),uLastID(0){}
+};
+
+static void OnEnd(UINT uAniID,BOOL bCanceled,LPARAM lParam)
+{
+	EndRecord *pRec = (EndRecord*)lParam;
+	if(bCanceled) pRec->nCanceled++;
+	else pRec->nEnded++;
+	pRec->uLastID = uAniID;
+}
+
+TEST(AnimationEngineTest,LinearAndEnd)
+{
+	SAnimationEngine engine;
+	TestTarget target;
+	EndRecord rec;
+	EXPECT_EQ(INFINITE,engine.GetNextDelay(0));
+
+	UINT uID = engine.Animate(&target,PROP_X,0.0f,100.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	EXPECT_NE(0,uID);
+	EXPECT_TRUE(engine.IsRunning(uID));
+	EXPECT_EQ(1,engine.GetCount());
+	//从第一次Tick开始计时
+	EXPECT_EQ(0,engine.GetNextDelay(500));
+
+	EXPECT_EQ(0,engine.Tick(1000));
+	EXPECT_FLOAT_EQ(0.0f,target.fValues[0]);
+	engine.Tick(1050);
+	EXPECT_FLOAT_EQ(50.0f,target.fValues[0]);
+	EXPECT_EQ(0,rec.nEnded);
+
+	//定时器晚了, 停在结束值
+	EXPECT_EQ(INFINITE,engine.Tick(1130));
+	EXPECT_FLOAT_EQ(100.0f,target.fValues[0]);
+	EXPECT_EQ(1,rec.nEnded);
+	EXPECT_EQ(uID,rec.uLastID);
+	EXPECT_FALSE(engine.IsRunning(uID));
+	EXPECT_EQ(0,engine.GetCount());
+	EXPECT_EQ(3,target.nFrames);
+	EXPECT_EQ(3,engine.GetStats().nFrames);
+}
+
+//一帧内同一个目标的多个属性只刷新一次
+TEST(AnimationEngineTest,MergedUpdates)
+{
+	SAnimationEngine engine;
+	TestTarget target1,target2;
+	engine.Animate(&target1,PROP_X,0.0f,10.0f,100);
+	engine.Animate(&target1,PROP_Y,0.0f,20.0f,100);
+	engine.Animate(&target1,PROP_Z,0.0f,30.0f,100);
+	engine.Animate(&target2,PROP_X,0.0f,40.0f,100);
+
+	for(DWORD dwNow=0;dwNow<=100;dwNow+=10) engine.Tick(dwNow);
+	EXPECT_EQ(11,target1.nFrames);
+	EXPECT_EQ(33,target1.nSets);
+	EXPECT_EQ(11,target2.nFrames);
+	EXPECT_EQ(44,engine.GetStats().nValues);
+	EXPECT_EQ(22,engine.GetStats().nTargetUpdates);
+	EXPECT_FLOAT_EQ(30.0f,target1.fValues[2]);
+	EXPECT_EQ(0,engine.GetCount());
+}
+
+TEST(AnimationEngineTest,InterpolatorAndDelay)
+{
+	SAnimationEngine engine;
+	TestTarget target;
+	CAutoRefPtr<IInterpolator> pInterpolator;
+	pInterpolator.Attach(new SAccelerateInterpolator);
+
+	engine.Animate(&target,PROP_X,0.0f,100.0f,100,pInterpolator,50);
+	//延迟期间不设置属性, 也不需要每帧Tick
+	EXPECT_EQ(50,engine.Tick(0));
+	EXPECT_EQ(0,target.nSets);
+	EXPECT_EQ(20,engine.GetNextDelay(30));
+
+	engine.Tick(50);
+	EXPECT_FLOAT_EQ(0.0f,target.fValues[0]);
+	engine.Tick(100);
+	EXPECT_FLOAT_EQ(25.0f,target.fValues[0]);
+	engine.Tick(150);
+	EXPECT_FLOAT_EQ(100.0f,target.fValues[0]);
+	EXPECT_EQ(0,engine.GetCount());
+}
+
+TEST(AnimationEngineTest,ReplaceAndCancel)
+{
+	SAnimationEngine engine;
+	TestTarget target;
+	EndRecord rec;
+	UINT uFirst = engine.Animate(&target,PROP_X,0.0f,100.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	engine.Tick(0);
+
+	//同一个属性的新动画代替原来的动画
+	UINT uSecond = engine.AnimateTo(&target,PROP_X,50.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	EXPECT_EQ(1,rec.nCanceled);
+	EXPECT_EQ(uFirst,rec.uLastID);
+	EXPECT_EQ(1,engine.GetCount());
+	engine.Tick(10);
+	EXPECT_FLOAT_EQ(0.0f,target.fValues[0]);
+
+	UINT uThird = engine.Animate(&target,PROP_Y,0.0f,100.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	EXPECT_TRUE(engine.Cancel(uSecond));
+	EXPECT_FALSE(engine.Cancel(uSecond));
+	EXPECT_EQ(2,rec.nCanceled);
+	EXPECT_TRUE(engine.IsRunning(uThird));
+
+	engine.Animate(&target,PROP_Z,0.0f,100.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	EXPECT_EQ(2,engine.CancelTarget(&target));
+	EXPECT_EQ(0,engine.CancelTarget(&target));
+	EXPECT_EQ(4,rec.nCanceled);
+	EXPECT_EQ(0,rec.nEnded);
+	EXPECT_EQ(0,engine.GetCount());
+
+	int nSets = target.nSets;
+	EXPECT_EQ(INFINITE,engine.Tick(20));
+	EXPECT_EQ(nSets,target.nSets);
+}
+
+//目标失效时取消它的所有动画, 本帧不再刷新它
+TEST(AnimationEngineTest,InvalidTarget)
+{
+	SAnimationEngine engine;
+	TestTarget target,other;
+	EndRecord rec;
+	engine.Animate(&target,PROP_X,0.0f,100.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	engine.Animate(&target,PROP_Y,0.0f,100.0f,100,NULL,0,OnEnd,(LPARAM)&rec);
+	engine.Animate(&other,PROP_X,0.0f,100.0f,100);
+	engine.Tick(0);
+
+	target.bValid = FALSE;
+	engine.Tick(10);
+	EXPECT_EQ(2,rec.nCanceled);
+	EXPECT_EQ(1,target.nFrames);
+	EXPECT_EQ(2,other.nFrames);
+	EXPECT_EQ(1,engine.GetCount());
+}
+
+//结束回调中启动下一段动画
+struct ChainContext
+{
+	SAnimationEngine *pEngine;
+	TestTarget *pTarget;
+	int nSegments;
+};
+
+static void OnChainEnd(UINT uAniID,BOOL bCanceled,LPARAM lParam)
+{
+	ChainContext *pCtx = (ChainContext*)lParam;
+	if(bCanceled || --pCtx->nSegments == 0) return;
+	pCtx->pEngine->AnimateTo(pCtx->pTarget,PROP_X,pCtx->pTarget->fValues[0]+100.0f,100,NULL,0,OnChainEnd,lParam);
+}
+
+TEST(AnimationEngineTest,ChainFromCallback)
+{
+	SAnimationEngine engine;
+	TestTarget target;
+	ChainContext ctx = {&engine,&target,3};
+	engine.Animate(&target,PROP_X,0.0f,100.0f,100,NULL,0,OnChainEnd,(LPARAM)&ctx);
+
+	DWORD dwNow = 0;
+	DWORD dwDelay = engine.Tick(dwNow);
+	while(dwDelay != INFINITE)
+	{
+		dwNow += smax(dwDelay,(DWORD)KFrameInterval);
+		dwDelay = engine.Tick(dwNow);
+	}
+	EXPECT_EQ(0,ctx.nSegments);
+	EXPECT_FLOAT_EQ(300.0f,target.fValues[0]);
+	//每段动画从结束后的下一帧开始
+	EXPECT_EQ(320,dwNow);
+}
+
+//每个属性一个handler, 各自计算并刷新, 与原来的STabSlider一样
+struct PropertyHandler : public ITimelineHandler
+{
+	IAnimationTarget *pTarget;
+	int nProp;
+	int nFrame;
+	int nFrames;
+
+	virtual void OnNextFrame(){}
+	virtual DWORD OnFrame(DWORD dwElapsed)
+	{
+		if(nFrame > nFrames) return INFINITE;
+		pTarget->SetAnimatedValue(nProp,100.0f*nFrame/nFrames);
+		pTarget->OnAnimationFrame();
+		nFrame++;
+		return 0;
+	}
+};
+
+//2500个目标各4个属性, 共10000个属性动画1秒
+BENCHMARK_TEST(AnimationEngineTest,Benchmark)
+{
+	const int nTargets = 2500;
+	const int nProps = 4;
+	const DWORD dwDuration = 1000;
+
+	TestTarget *pTargets = new TestTarget[nTargets];
+	SAnimationEngine engine;
+	for(int i=0;i<nTargets;i++)
+	{
+		for(int j=0;j<nProps;j++)
+			engine.Animate(pTargets+i,PROP_X+j,0.0f,100.0f,dwDuration);
+	}
+	LARGE_INTEGER t0,t1,t2;
+	QueryPerformanceCounter(&t0);
+	DWORD dwNow = 0;
+	while(engine.Tick(dwNow) != INFINITE) dwNow += KFrameInterval;
+	QueryPerformanceCounter(&t1);
+	ANIMATIONSTATS stats = engine.GetStats();
+	BenchmarkPrintf("animation engine: %u frames %u values %u updates %.1fms\n",
+		stats.nFrames,stats.nValues,stats.nTargetUpdates,ElapsedMs(t0,t1));
+
+	//原来的做法
+	TestTarget *pTargets2 = new TestTarget[nTargets];
+	PropertyHandler *pHandlers = new PropertyHandler[nTargets*nProps];
+	SFrameClock clock;
+	for(int i=0;i<nTargets*nProps;i++)
+	{
+		pHandlers[i].pTarget = pTargets2 + i/nProps;
+		pHandlers[i].nProp = PROP_X + i%nProps;
+		pHandlers[i].nFrame = 0;
+		pHandlers[i].nFrames = dwDuration/KFrameInterval;
+		clock.Add(pHandlers+i,0);
+	}
+	QueryPerformanceCounter(&t1);
+	dwNow = KFrameInterval;
+	while(clock.Tick(dwNow) != INFINITE) dwNow += KFrameInterval;
+	QueryPerformanceCounter(&t2);
+	UINT nUpdates = 0;
+	for(int i=0;i<nTargets;i++) nUpdates += pTargets2[i].nFrames;
+	BenchmarkPrintf("handler per prop: %u ticks %u values %u updates %.1fms\n",
+		clock.GetStats().nTicks,clock.GetStats().nDispatches,nUpdates,ElapsedMs(t1,t2));
+
+	delete []pHandlers;
+	delete []pTargets2;
+	delete []pTargets;
+}
@@ -0,0 +1,365 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <interface/imgdecoder-i.h>
+#include <vector>
+
+using namespace SOUI;
+
+//imgdecoder-png: 大APNG的流式解码(顺序播放, 跳帧, 检查点, 合成帧缓存)与小APNG的一次性解码结果都必须与参考合成一致
+
+struct ApngTestFrame
+{
+	DWORD	x,y,w,h;
+	BYTE	dispose;	//0-NONE 1-BACKGROUND 2-PREVIOUS
+	BYTE	blend;		//0-SOURCE 1-OVER
+	std::vector<BYTE> rgba;
+};
+
+static DWORD ApngCrc(const BYTE *p,size_t n)
+{
+	static DWORD table[256];
+	if(!table[1])
+	{
+		for(DWORD i=0;i<256;i++)
+		{
+			DWORD c = i;
+			for(int k=0;k<8;k++) c = (c&1)?(0xEDB88320^(c>>1)):(c>>1);
+			table[i] = c;
+		}
+	}
+	DWORD crc = 0xFFFFFFFF;
+	for(size_t i=0;i<n;i++) crc = table[(crc^p[i])&0xFF]^(crc>>8);
+	return crc^0xFFFFFFFF;
+}
+
+static void ApngPutU32(std::vector<BYTE> & buf,DWORD v)
+{
+	buf.push_back((BYTE)(v>>24));
+	buf.push_back((BYTE)(v>>16));
+	buf.push_back((BYTE)(v>>8));
+	buf.push_back((BYTE)v);
+}
+
+static void ApngPutChunk(std::vector<BYTE> & buf,const char *pszType,const std::vector<BYTE> & data)
+{
+	ApngPutU32(buf,(DWORD)data.size());
+	size_t nStart = buf.size();
+	buf.insert(buf.end(),pszType,pszType+4);
+	buf.insert(buf.end(),data.begin(),data.end());
+	ApngPutU32(buf,ApngCrc(&buf[nStart],buf.size()-nStart));
+}
+
+//不压缩的zlib流, 不依赖zlib
+static std::vector<BYTE> ApngStoredZlib(const ApngTestFrame & frame)
+{
+	std::vector<BYTE> raw;
+	for(DWORD y=0;y<frame.h;y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(),frame.rgba.begin()+y*frame.w*4,frame.rgba.begin()+(y+1)*frame.w*4);
+	}
+	std::vector<BYTE> out;
+	out.push_back(0x78);
+	out.push_back(0x01);
+	size_t pos = 0;
+	do
+	{
+		size_t n = smin(raw.size()-pos,(size_t)0xFFFF);
+		out.push_back(pos+n==raw.size()?1:0);
+		out.push_back((BYTE)n);
+		out.push_back((BYTE)(n>>8));
+		out.push_back((BYTE)~n);
+		out.push_back((BYTE)(~n>>8));
+		out.insert(out.end(),raw.begin()+pos,raw.begin()+pos+n);
+		pos += n;
+	}while(pos<raw.size());
+	DWORD a = 1,b = 0;
+	for(size_t i=0;i<raw.size();i++)
+	{
+		a = (a+raw[i])%65521;
+		b = (b+a)%65521;
+	}
+	ApngPutU32(out,(b<<16)|a);
+	return out;
+}
+
+//RGBA 8位的APNG, 第一帧即默认图片
+static std::vector<BYTE> WriteApng(DWORD nWid,DWORD nHei,const std::vector<ApngTestFrame> & frames)
+{
+	static const BYTE sig[8]={137,80,78,71,13,10,26,10};
+	std::vector<BYTE> png(sig,sig+8);
+	std::vector<BYTE> data;
+	ApngPutU32(data,nWid);
+	ApngPutU32(data,nHei);
+	const BYTE ihdr[5] = {8,6,0,0,0};
+	data.insert(data.end(),ihdr,ihdr+5);
+	ApngPutChunk(png,"IHDR",data);
+
+	data.clear();
+	ApngPutU32(data,(DWORD)frames.size());
+	ApngPutU32(data,0);
+	ApngPutChunk(png,"acTL",data);
+
+	DWORD nSeq = 0;
+	for(size_t i=0;i<frames.size();i++)
+	{
+		const ApngTestFrame & frame = frames[i];
+		data.clear();
+		ApngPutU32(data,nSeq++);
+		ApngPutU32(data,frame.w);
+		ApngPutU32(data,frame.h);
+		ApngPutU32(data,frame.x);
+		ApngPutU32(data,frame.y);
+		const BYTE delay[4] = {0,(BYTE)(i%10+1),0,100};
+		data.insert(data.end(),delay,delay+4);
+		data.push_back(frame.dispose);
+		data.push_back(frame.blend);
+		ApngPutChunk(png,"fcTL",data);
+
+		std::vector<BYTE> zdata = ApngStoredZlib(frame);
+		if(i == 0)
+		{
+			ApngPutChunk(png,"IDAT",zdata);
+		}else
+		{
+			data.clear();
+			ApngPutU32(data,nSeq++);
+			data.insert(data.end(),zdata.begin(),zdata.end());
+			ApngPutChunk(png,"fdAT",data);
+		}
+	}
+	ApngPutChunk(png,"IEND",std::vector<BYTE>());
+	return png;
+}
+
+static DWORD ApngRand(DWORD & seed)
+{
+	seed = seed*1103515245+12345;
+	return (seed>>8)&0xFFFF;
+}
+
+static void ApngFill(ApngTestFrame & frame,DWORD & seed)
+{
+	static const BYTE alphas[4] = {0,255,128,255};
+	frame.rgba.resize(frame.w*frame.h*4);
+	for(size_t i=0;i<frame.rgba.size();i+=4)
+	{
+		frame.rgba[i] = (BYTE)ApngRand(seed);
+		frame.rgba[i+1] = (BYTE)ApngRand(seed);
+		frame.rgba[i+2] = (BYTE)ApngRand(seed);
+		frame.rgba[i+3] = alphas[ApngRand(seed)&3];
+	}
+}
+
+//随机的局部帧, 各种dispose和blend组合. iKeyFrame为覆盖整个画布的SOURCE帧
+static std::vector<ApngTestFrame> MakeApngFrames(DWORD nWid,DWORD nHei,int nFrames,int iKeyFrame,DWORD seed)
+{
+	std::vector<ApngTestFrame> frames(nFrames);
+	for(int i=0;i<nFrames;i++)
+	{
+		ApngTestFrame & frame = frames[i];
+		if(i == 0 || i == iKeyFrame)
+		{
+			frame.x = frame.y = 0;
+			frame.w = nWid;
+			frame.h = nHei;
+			frame.dispose = 0;
+			frame.blend = 0;
+		}else
+		{
+			frame.w = ApngRand(seed)%smin(nWid,(DWORD)48)+1;
+			frame.h = ApngRand(seed)%smin(nHei,(DWORD)48)+1;
+			frame.x = ApngRand(seed)%(nWid-frame.w+1);
+			frame.y = ApngRand(seed)%(nHei-frame.h+1);
+			frame.dispose = (BYTE)(ApngRand(seed)%3);
+			frame.blend = (BYTE)(ApngRand(seed)%2);
+		}
+		ApngFill(frame,seed);
+	}
+	return frames;
+}
+
+//按APNG规范合成每一帧, 输出与解码器一致的预乘BGRA
+static std::vector<BYTE> ComposeApng(DWORD nWid,DWORD nHei,const std::vector<ApngTestFrame> & frames)
+{
+	size_t nFrameBytes = nWid*nHei*4;
+	std::vector<BYTE> out(nFrameBytes*frames.size());
+	std::vector<BYTE> canvas(nFrameBytes,0),prev;
+	for(size_t i=0;i<frames.size();i++)
+	{
+		const ApngTestFrame & frame = frames[i];
+		BYTE dispose = frame.dispose;
+		if(dispose == 2)
+		{
+			if(i == 0) dispose = 1;
+			else prev = canvas;
+		}
+		for(DWORD y=0;y<frame.h;y++) for(DWORD x=0;x<frame.w;x++)
+		{
+			BYTE *pDst = &canvas[((frame.y+y)*nWid+frame.x+x)*4];
+			const BYTE *pSrc = &frame.rgba[(y*frame.w+x)*4];
+			for(int k=0;k<4;k++)
+			{
+				if(frame.blend == 0) pDst[k] = pSrc[k];
+				else pDst[k] = (BYTE)((pDst[k]*(255-pSrc[3])+pSrc[k]*pSrc[3])>>8);
+			}
+		}
+		BYTE *pOut = &out[nFrameBytes*i];
+		for(size_t k=0;k<nFrameBytes;k+=4)
+		{
+			BYTE a = canvas[k+3];
+			pOut[k] = a?(BYTE)(canvas[k+2]*a/255):0;
+			pOut[k+1] = a?(BYTE)(canvas[k+1]*a/255):0;
+			pOut[k+2] = a?(BYTE)(canvas[k]*a/255):0;
+			pOut[k+3] = a;
+		}
+		if(dispose == 1)
+		{
+			for(DWORD y=0;y<frame.h;y++)
+				memset(&canvas[((frame.y+y)*nWid+frame.x)*4],0,frame.w*4);
+		}else if(dispose == 2)
+		{
+			canvas = prev;
+		}
+	}
+	return out;
+}
+
+class ApngDecoderTest : public testing::Test
+{
+protected:
+	static void SetUpTestCase()
+	{
+		s_pComMgr = new SComMgr(_T("imgdecoder-png"));
+		s_pComMgr->CreateImgDecoder((IObjRef**)&s_pDecoderFactory);
+	}
+
+	static void TearDownTestCase()
+	{
+		if(s_pDecoderFactory)
+		{
+			s_pDecoderFactory->Release();
+			s_pDecoderFactory = NULL;
+		}
+		delete s_pComMgr;
+		s_pComMgr = NULL;
+	}
+
+	//加载帧数据, 返回帧数
+	int Load(DWORD nWid,DWORD nHei,const std::vector<ApngTestFrame> & frames)
+	{
+		m_nWid = nWid;
+		m_nHei = nHei;
+		m_expected = ComposeApng(nWid,nHei,frames);
+		std::vector<BYTE> png = WriteApng(nWid,nHei,frames);
+		m_imgX = NULL;
+		s_pDecoderFactory->CreateImgX(&m_imgX);
+		return m_imgX->LoadFromMemory(&png[0],png.size());
+	}
+
+	//解码第iFrame帧并与参考合成比较
+	::testing::AssertionResult FrameMatches(int iFrame)
+	{
+		size_t nFrameBytes = m_nWid*m_nHei*4;
+		std::vector<BYTE> buf(nFrameBytes);
+		IImgFrame *pFrame = m_imgX->GetFrame(iFrame);
+		if(!pFrame) return ::testing::AssertionFailure() << "no frame " << iFrame;
+		if(!pFrame->CopyPixels(NULL,m_nWid*4,(UINT)nFrameBytes,&buf[0]))
+			return ::testing::AssertionFailure() << "CopyPixels failed at frame " << iFrame;
+		if(memcmp(&buf[0],&m_expected[nFrameBytes*iFrame],nFrameBytes)!=0)
+			return ::testing::AssertionFailure() << "frame " << iFrame << " differs";
+		return ::testing::AssertionSuccess();
+	}
+
+	static SComMgr * s_pComMgr;
+	static IImgDecoderFactory * s_pDecoderFactory;
+	CAutoRefPtr<IImgX> m_imgX;
+	DWORD m_nWid,m_nHei;
+	std::vector<BYTE> m_expected;
+};
+
+SComMgr * ApngDecoderTest::s_pComMgr = NULL;
+IImgDecoderFactory * ApngDecoderTest::s_pDecoderFactory = NULL;
+
+#define SKIP_IF_NO_DECODER() if(!s_pDecoderFactory) {printf("imgdecoder-png not available, skipped\n"); return;}
+
+//256x256x80帧合成后超过16M, 使用流式解码. 第40帧是关键帧
+const DWORD KStreamSize = 256;
+const int KStreamFrames = 80;
+const int KStreamKeyFrame = 40;
+
+TEST_F(ApngDecoderTest,EagerMatchesReference)
+{
+	SKIP_IF_NO_DECODER();
+	ASSERT_EQ(20,Load(40,30,MakeApngFrames(40,30,20,-1,1)));
+	UINT nWid=0,nHei=0;
+	m_imgX->GetFrame(0)->GetSize(&nWid,&nHei);
+	EXPECT_EQ((UINT)40,nWid);
+	EXPECT_EQ((UINT)30,nHei);
+	EXPECT_EQ(2,m_imgX->GetFrame(1)->GetDelay());
+	for(int i=0;i<20;i++) EXPECT_TRUE(FrameMatches(i));
+}
+
+//顺序播放两遍, 第二遍从头开始时画布清空
+TEST_F(ApngDecoderTest,StreamSequential)
+{
+	SKIP_IF_NO_DECODER();
+	ASSERT_EQ(KStreamFrames,Load(KStreamSize,KStreamSize,MakeApngFrames(KStreamSize,KStreamSize,KStreamFrames,KStreamKeyFrame,2)));
+	EXPECT_EQ(2,m_imgX->GetFrame(1)->GetDelay());
+	for(int nLoop=0;nLoop<2;nLoop++)
+	{
+		for(int i=0;i<KStreamFrames;i++) EXPECT_TRUE(FrameMatches(i)) << "loop " << nLoop;
+	}
+}
+
+//任意顺序跳帧: 没有检查点时从头或者关键帧开始, 顺序播放过之后从检查点开始
+TEST_F(ApngDecoderTest,StreamSeek)
+{
+	SKIP_IF_NO_DECODER();
+	ASSERT_EQ(KStreamFrames,Load(KStreamSize,KStreamSize,MakeApngFrames(KStreamSize,KStreamSize,KStreamFrames,KStreamKeyFrame,3)));
+	const int seeks1[] = {79,3,45,39,40,41,20,2,70,0,79};
+	for(int i=0;i<ARRAYSIZE(seeks1);i++) EXPECT_TRUE(FrameMatches(seeks1[i]));
+
+	for(int i=0;i<KStreamFrames;i++) FrameMatches(i);
+	//检查点前后的帧
+	const int seeks2[] = {33,15,16,17,63,64,65,31,32,48,47,5,78,49};
+	for(int i=0;i<ARRAYSIZE(seeks2);i++) EXPECT_TRUE(FrameMatches(seeks2[i]));
+}
+
+//合成帧缓存: 反复请求最近的几帧, 以及被挤出缓存的帧
+TEST_F(ApngDecoderTest,StreamFrameRing)
+{
+	SKIP_IF_NO_DECODER();
+	ASSERT_EQ(KStreamFrames,Load(KStreamSize,KStreamSize,MakeApngFrames(KStreamSize,KStreamSize,KStreamFrames,KStreamKeyFrame,4)));
+	const int requests[] = {10,11,10,12,11,10,13,10,14,15,16,10,12,12,9,10};
+	for(int i=0;i<ARRAYSIZE(requests);i++) EXPECT_TRUE(FrameMatches(requests[i])) << "request " << i;
+}
+
+//fcTL的偏移加宽度溢出或超出画布时拒绝加载, 流式与一次性解码都一样
+TEST_F(ApngDecoderTest,MalformedFcTL)
+{
+	SKIP_IF_NO_DECODER();
+	const DWORD sizes[] = {40,KStreamSize};
+	for(int i=0;i<ARRAYSIZE(sizes);i++)
+	{
+		std::vector<ApngTestFrame> frames = MakeApngFrames(sizes[i],sizes[i],KStreamFrames,-1,5);
+		DWORD seed = 6;
+		ApngTestFrame & frame = frames[1];
+		frame.w = frame.h = 0x20;
+		frame.x = 0xFFFFFFF0;
+		frame.y = 0;
+		ApngFill(frame,seed);
+		std::vector<BYTE> png = WriteApng(sizes[i],sizes[i],frames);
+		CAutoRefPtr<IImgX> imgX;
+		s_pDecoderFactory->CreateImgX(&imgX);
+		EXPECT_EQ(0,imgX->LoadFromMemory(&png[0],png.size())) << "size " << sizes[i];
+
+		frame.x = sizes[i] - 0x10;
+		png = WriteApng(sizes[i],sizes[i],frames);
+		imgX = NULL;
+		s_pDecoderFactory->CreateImgX(&imgX);
+		EXPECT_EQ(0,imgX->LoadFromMemory(&png[0],png.size())) << "size " << sizes[i];
+	}
+}
@@ -0,0 +1,331 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <helper/SFrameClock.h>
+#include <stdio.h>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//帧时钟使用虚拟时钟, 结果与真实时间无关
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=FrameClockTest.DISABLED_*
+
+//只实现OnNextFrame的handler, 每帧调用一次
+struct LegacyHandler : public ITimelineHandler
+{
+	int nFrames;
+	LegacyHandler():nFrames(0){}
+	virtual void OnNextFrame(){nFrames++;}
+};
+
+//与SGifPlayer相同的方式: 按经过的时间倒计时, 返回到下一帧的时间
+struct GifHandler : public ITimelineHandler
+{
+	int nDelay;
+	int nNext;
+	int nFrames;
+	SArray<DWORD> lstElapsed;
+
+	GifHandler(int delay):nDelay(delay),nNext(delay),nFrames(0){}
+
+	virtual void OnNextFrame(){OnFrame(KFrameInterval);}
+	virtual DWORD OnFrame(DWORD dwElapsed)
+	{
+		lstElapsed.Add(dwElapsed);
+		nNext -= (int)dwElapsed;
+		if(nNext <= 0)
+		{
+			nFrames++;
+			nNext = nDelay;
+		}
+		return nNext;
+	}
+};
+
+//调用一次后一直等待唤醒
+struct SleepyHandler : public ITimelineHandler
+{
+	int nCalls;
+	DWORD dwLastElapsed;
+	SleepyHandler():nCalls(0),dwLastElapsed(0){}
+
+	virtual void OnNextFrame(){}
+	virtual DWORD OnFrame(DWORD dwElapsed)
+	{
+		nCalls++;
+		dwLastElapsed = dwElapsed;
+		return INFINITE;
+	}
+};
+
+//模拟宿主的帧定时器: 按帧时钟返回的延时推进虚拟时钟, 系统定时器最短一帧
+static void RunFor(SFrameClock & clock,DWORD dwNow,DWORD dwDuration)
+{
+	DWORD dwEnd = dwNow + dwDuration;
+	DWORD dwDelay = clock.GetNextDelay(dwNow);
+	while(dwDelay != INFINITE)
+	{
+		if(dwDelay < KFrameInterval) dwDelay = KFrameInterval;
+		if((LONG)(dwNow + dwDelay - dwEnd) > 0) break;
+		dwNow += dwDelay;
+		dwDelay = clock.Tick(dwNow);
+	}
+}
+
+TEST(FrameClockTest,LegacyHandlerEveryFrame)
+{
+	SFrameClock clock;
+	LegacyHandler legacy;
+	EXPECT_EQ(INFINITE,clock.GetNextDelay(0));
+	EXPECT_TRUE(clock.Add(&legacy,0));
+	EXPECT_FALSE(clock.Add(&legacy,0));
+	EXPECT_EQ(KFrameInterval,clock.GetNextDelay(0));
+
+	RunFor(clock,0,1000);
+	EXPECT_EQ(100,legacy.nFrames);
+	EXPECT_EQ(100,clock.GetStats().nTicks);
+	EXPECT_EQ(0,clock.GetStats().nIdleTicks);
+
+	EXPECT_TRUE(clock.Remove(&legacy));
+	EXPECT_FALSE(clock.Remove(&legacy));
+	EXPECT_EQ(INFINITE,clock.GetNextDelay(1000));
+}
+
+//等待100ms的gif不会每10ms被调用一次
+TEST(FrameClockTest,GifSkipsIdleFrames)
+{
+	SFrameClock clock;
+	GifHandler gif(100);
+	clock.Add(&gif,0);
+	RunFor(clock,0,1000);
+
+	EXPECT_EQ(10,gif.nFrames);
+	//注册后的第一帧, 之后每100ms一次
+	EXPECT_EQ(11,clock.GetStats().nTicks);
+	EXPECT_EQ(11,clock.GetStats().nDispatches);
+	EXPECT_EQ(0,clock.GetStats().nIdleTicks);
+	ASSERT_EQ(11,gif.lstElapsed.GetCount());
+	EXPECT_EQ(10,gif.lstElapsed[0]);
+	EXPECT_EQ(90,gif.lstElapsed[1]);
+	EXPECT_EQ(100,gif.lstElapsed[10]);
+
+	//和每帧都要调用的handler一起时只在自己到期时调用
+	clock.ResetStats();
+	LegacyHandler legacy;
+	clock.Add(&legacy,1000);
+	RunFor(clock,1000,1000);
+	EXPECT_EQ(100,legacy.nFrames);
+	EXPECT_EQ(20,gif.nFrames);
+	EXPECT_EQ(100,clock.GetStats().nTicks);
+	EXPECT_EQ(110,clock.GetStats().nDispatches);
+}
+
+//定时器延迟时handler收到实际经过的时间
+TEST(FrameClockTest,RealElapsedTime)
+{
+	SFrameClock clock;
+	GifHandler gif(50);
+	clock.Add(&gif,0xFFFFFFF0);//包括GetTickCount回绕
+	EXPECT_EQ(34,clock.Tick(0));
+	EXPECT_EQ(16,gif.lstElapsed[0]);
+	EXPECT_EQ(34,gif.nNext);
+
+	//系统繁忙, 定时器晚了很久
+	EXPECT_EQ(50,clock.Tick(200));
+	EXPECT_EQ(200,gif.lstElapsed[1]);
+	EXPECT_EQ(1,gif.nFrames);
+
+	//没有到期时不调用
+	EXPECT_EQ(30,clock.Tick(220));
+	EXPECT_EQ(2,gif.lstElapsed.GetCount());
+	EXPECT_EQ(1,clock.GetStats().nIdleTicks);
+
+	//半帧以内到期的在本帧调用, 按请求的时间计算
+	EXPECT_EQ(54,clock.Tick(246));
+	EXPECT_EQ(3,gif.lstElapsed.GetCount());
+	EXPECT_EQ(50,gif.lstElapsed[2]);
+	EXPECT_EQ(2,gif.nFrames);
+}
+
+TEST(FrameClockTest,SleepAndWake)
+{
+	SFrameClock clock;
+	SleepyHandler sleepy;
+	clock.Add(&sleepy,0);
+	EXPECT_EQ(INFINITE,clock.Tick(10));
+	EXPECT_EQ(1,sleepy.nCalls);
+
+	//所有handler都在等待, 时钟停止
+	RunFor(clock,10,1000);
+	EXPECT_EQ(1,clock.GetStats().nTicks);
+
+	EXPECT_TRUE(clock.Wake(&sleepy,50,500));
+	EXPECT_EQ(50,clock.GetNextDelay(500));
+	clock.Tick(550);
+	EXPECT_EQ(2,sleepy.nCalls);
+	EXPECT_EQ(540,sleepy.dwLastElapsed);
+
+	//0表示下一帧
+	clock.Wake(&sleepy,0,600);
+	EXPECT_EQ(KFrameInterval,clock.GetNextDelay(600));
+	LegacyHandler legacy;
+	EXPECT_FALSE(clock.Wake(&legacy,0,600));
+}
+
+//在OnFrame中唤醒自己, 与SGifPlayer换skin时调用RequestNextFrame相同
+struct SelfWakingHandler : public ITimelineHandler
+{
+	SFrameClock *pClock;
+	DWORD dwNow;		//虚拟时钟, 与Tick的参数一致
+	DWORD dwWakeDelay;	//INFINITE表示不唤醒
+	DWORD dwReturn;
+	int nCalls;
+
+	SelfWakingHandler(SFrameClock *clock):pClock(clock),dwNow(0),dwWakeDelay(INFINITE),dwReturn(INFINITE),nCalls(0){}
+
+	virtual void OnNextFrame(){}
+	virtual DWORD OnFrame(DWORD dwElapsed)
+	{
+		nCalls++;
+		if(dwWakeDelay != INFINITE) pClock->Wake(this,dwWakeDelay,dwNow);
+		return dwReturn;
+	}
+};
+
+//回调中Wake请求的时间比返回值早时不被返回值覆盖
+TEST(FrameClockTest,WakeDuringFrame)
+{
+	SFrameClock clock;
+	SelfWakingHandler handler(&clock);
+	clock.Add(&handler,0);
+
+	//返回INFINITE, 但回调中请求了下一帧
+	handler.dwNow = 10;
+	handler.dwWakeDelay = 0;
+	EXPECT_EQ(KFrameInterval,clock.Tick(10));
+	EXPECT_EQ(1,handler.nCalls);
+
+	//Wake的时间较早
+	handler.dwNow = 20;
+	handler.dwWakeDelay = 50;
+	handler.dwReturn = 200;
+	EXPECT_EQ(50,clock.Tick(20));
+	EXPECT_EQ(2,handler.nCalls);
+
+	//返回值较早
+	handler.dwNow = 70;
+	handler.dwWakeDelay = 100;
+	handler.dwReturn = 30;
+	EXPECT_EQ(30,clock.Tick(70));
+
+	//没有Wake时按返回值等待
+	handler.dwNow = 100;
+	handler.dwWakeDelay = INFINITE;
+	handler.dwReturn = INFINITE;
+	EXPECT_EQ(INFINITE,clock.Tick(100));
+	EXPECT_EQ(4,handler.nCalls);
+
+	//回调外的Wake不影响下一次回调的返回值
+	clock.Wake(&handler,0,200);
+	handler.dwNow = 210;
+	handler.dwReturn = 40;
+	EXPECT_EQ(40,clock.Tick(210));
+}
+
+//回调中注册和注销handler
+struct MutatingHandler : public ITimelineHandler
+{
+	SFrameClock *pClock;
+	ITimelineHandler *pRemove;
+	LegacyHandler *pAdd;
+	int nCalls;
+
+	MutatingHandler(SFrameClock *clock):pClock(clock),pRemove(NULL),pAdd(NULL),nCalls(0){}
+
+	virtual void OnNextFrame(){}
+	virtual DWORD OnFrame(DWORD dwElapsed)
+	{
+		nCalls++;
+		pClock->Remove(this);
+		if(pRemove) pClock->Remove(pRemove);
+		//新注册的handler较多, 让数组重新分配
+		if(pAdd) for(int i=0;i<100;i++) pClock->Add(pAdd+i,100);
+		return 0;
+	}
+};
+
+TEST(FrameClockTest,ChangesDuringDispatch)
+{
+	SFrameClock clock;
+	MutatingHandler first(&clock);
+	LegacyHandler second;
+	LegacyHandler added[100];
+	first.pRemove = &second;
+	first.pAdd = added;
+	clock.Add(&first,90);
+	clock.Add(&second,90);
+
+	clock.Tick(100);
+	EXPECT_EQ(1,first.nCalls);
+	EXPECT_EQ(0,second.nFrames);
+	//本帧注册的handler从下一帧开始调用
+	EXPECT_EQ(0,added[0].nFrames);
+	EXPECT_EQ(1,clock.GetStats().nDispatches);
+	EXPECT_EQ(100,clock.GetCount());
+	EXPECT_EQ(KFrameInterval,clock.GetNextDelay(100));
+
+	clock.Tick(110);
+	EXPECT_EQ(1,first.nCalls);
+	EXPECT_EQ(1,added[0].nFrames);
+	EXPECT_EQ(1,added[99].nFrames);
+	EXPECT_EQ(101,clock.GetStats().nDispatches);
+}
+
+//200个gif(60~150ms一帧)和4个每帧动画, 模拟60秒, 与原来每10ms复制列表并调用所有handler比较
+BENCHMARK_TEST(FrameClockTest,Benchmark)
+{
+	const int nGifs = 200;
+	const DWORD dwDuration = 60000;
+
+	SArray<GifHandler*> lstGifs;
+	for(int i=0;i<nGifs;i++) lstGifs.Add(new GifHandler(60+(i*37)%91));
+	LegacyHandler legacy[4];
+
+	LARGE_INTEGER t0,t1,t2;
+	SFrameClock clock;
+	for(int i=0;i<nGifs;i++) clock.Add(lstGifs[i],0);
+	QueryPerformanceCounter(&t0);
+	RunFor(clock,0,dwDuration);
+	QueryPerformanceCounter(&t1);
+	FRAMECLOCKSTATS statsGifs = clock.GetStats();
+
+	clock.ResetStats();
+	for(int i=0;i<4;i++) clock.Add(&legacy[i],dwDuration);
+	RunFor(clock,dwDuration,dwDuration);
+	FRAMECLOCKSTATS statsMixed = clock.GetStats();
+
+	BenchmarkPrintf("frame clock: gifs only %u ticks %u dispatches %.1fms; with legacy %u ticks %u dispatches\n",
+		statsGifs.nTicks,statsGifs.nDispatches,ElapsedMs(t0,t1),statsMixed.nTicks,statsMixed.nDispatches);
+
+	//原来的做法
+	SList<ITimelineHandler*> lstHandlers;
+	for(int i=0;i<nGifs;i++) lstHandlers.AddTail(lstGifs[i]);
+	UINT nDispatches = 0;
+	QueryPerformanceCounter(&t1);
+	for(DWORD dwNow=KFrameInterval;dwNow<=dwDuration;dwNow+=KFrameInterval)
+	{
+		SList<ITimelineHandler*> lstCopy;
+		CopyList(lstHandlers,lstCopy);
+		SPOSITION pos=lstCopy.GetHeadPosition();
+		while(pos)
+		{
+			lstCopy.GetNext(pos)->OnNextFrame();
+			nDispatches++;
+		}
+	}
+	QueryPerformanceCounter(&t2);
+	BenchmarkPrintf("copy list:   gifs only %u ticks %u dispatches %.1fms\n",
+		dwDuration/KFrameInterval,nDispatches,ElapsedMs(t1,t2));
+
+	for(int i=0;i<nGifs;i++) delete lstGifs[i];
+}
@@ -0,0 +1,328 @@
+﻿#include <gtest/gtest.h>
+
+#include <windows.h>
+#include <stdlib.h>
+#include <vector>
+#include <pixelkernels.h>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//各个SIMD实现必须与下面的参考实现(原SDIBHelper/SImgX_STB中的算法)逐位一致
+
+static void RefPremultiplyRGBA(BYTE *p,int nPixels)
+{
+	for(int i=0;i<nPixels;i++,p+=4)
+	{
+		BYTE a = p[3];
+		BYTE t = p[0];
+		if(a)
+		{
+			p[0] = (p[2]*a)/255;
+			p[1] = (p[1]*a)/255;
+			p[2] = (t*a)/255;
+		}else
+		{
+			memset(p,0,4);
+		}
+	}
+}
+
+static void RefGray(BYTE *p,int nPixels)
+{
+	for(int i=0;i<nPixels;i++,p+=4)
+	{
+		p[0] = p[1] = p[2] = (BYTE)((p[2]*117 + p[1]*601 + p[0]*306)>>10);
+	}
+}
+
+//原SDIBHelper中的着色算法, 逐像素做RGB->HSL->RGB转换. Colorize的查找表实现必须与它逐位一致
+struct RefColorizeParam
+{
+	BYTE hue;
+	BYTE sat;
+	int  a0;
+	int  a1;
+};
+
+static RGBQUAD RefRGBtoHSL(RGBQUAD lRGBColor)
+{
+	BYTE R = lRGBColor.rgbRed, G = lRGBColor.rgbGreen, B = lRGBColor.rgbBlue;
+	BYTE H,L,S;
+	BYTE cMax = max(max(R,G),B);
+	BYTE cMin = min(min(R,G),B);
+	L = (BYTE)((((cMax+cMin)*255)+255)/(2*255));
+	if(cMax==cMin)
+	{
+		S = 0;
+		H = 255*2/3;
+	}else
+	{
+		if(L <= 255/2)
+			S = (BYTE)((((cMax-cMin)*255)+((cMax+cMin)/2))/(cMax+cMin));
+		else
+			S = (BYTE)((((cMax-cMin)*255)+((2*255-cMax-cMin)/2))/(2*255-cMax-cMin));
+		WORD Rdelta = (WORD)((((cMax-R)*(255/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
+		WORD Gdelta = (WORD)((((cMax-G)*(255/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
+		WORD Bdelta = (WORD)((((cMax-B)*(255/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
+		if(R == cMax)
+			H = (BYTE)(Bdelta - Gdelta);
+		else if(G == cMax)
+			H = (BYTE)((255/3) + Rdelta - Bdelta);
+		else
+			H = (BYTE)(((2*255)/3) + Gdelta - Rdelta);
+		if(H > 255) H -= 255;
+	}
+	RGBQUAD hsl={L,S,H,0};
+	return hsl;
+}
+
+static float RefHueToRGB(float n1,float n2,float hue)
+{
+	if(hue > 360) hue = hue - 360;
+	else if(hue < 0) hue = hue + 360;
+	if(hue < 60) return n1 + (n2-n1)*hue/60.0f;
+	if(hue < 180) return n2;
+	if(hue < 240) return n1+(n2-n1)*(240-hue)/60;
+	return n1;
+}
+
+static RGBQUAD RefHSLtoRGB(RGBQUAD lHSLColor)
+{
+	float h = (float)lHSLColor.rgbRed * 360.0f/255.0f;
+	float s = (float)lHSLColor.rgbGreen/255.0f;
+	float l = (float)lHSLColor.rgbBlue/255.0f;
+	float m2 = (l <= 0.5) ? l * (1+s) : l + s - l*s;
+	float m1 = 2 * l - m2;
+	BYTE r,g,b;
+	if(s == 0)
+	{
+		r=g=b=(BYTE)(l*255.0f);
+	}else
+	{
+		r = (BYTE)(RefHueToRGB(m1,m2,h+120) * 255.0f);
+		g = (BYTE)(RefHueToRGB(m1,m2,h) * 255.0f);
+		b = (BYTE)(RefHueToRGB(m1,m2,h-120) * 255.0f);
+	}
+	RGBQUAD rgb = {b,g,r,0};
+	return rgb;
+}
+
+static void RefColorizeMode(BYTE *pAbgr,const RefColorizeParam & param)
+{
+	BYTE red = pAbgr[0],green=pAbgr[1],blue=pAbgr[2],alpha=pAbgr[3];
+	if(alpha == 0) return;
+	if(alpha!=255)
+	{
+		red = (red * 255)/alpha;
+		green = (green * 255)/alpha;
+		blue = (blue * 255)/alpha;
+	}
+	RGBQUAD pixel = {blue,green,red};
+	if(param.a0 == 256)
+	{
+		RGBQUAD color = RefRGBtoHSL(pixel);
+		color.rgbRed= param.hue;
+		color.rgbGreen=param.sat;
+		pixel = RefHSLtoRGB(color);
+		red = pixel.rgbRed;
+		green = pixel.rgbGreen;
+		blue = pixel.rgbBlue;
+	}else
+	{
+		RGBQUAD color = pixel;
+		RGBQUAD hsl;
+		hsl.rgbRed= param.hue;
+		hsl.rgbGreen=param.sat;
+		hsl.rgbBlue = (BYTE)((color.rgbBlue*117 + color.rgbGreen*601 + color.rgbRed*306)>>10);
+		hsl = RefHSLtoRGB(hsl);
+		red = (BYTE)((hsl.rgbRed * param.a0 + color.rgbRed * param.a1)>>8);
+		green = (BYTE)((hsl.rgbBlue * param.a0 + color.rgbBlue * param.a1)>>8);
+		blue = (BYTE)((hsl.rgbGreen * param.a0 + color.rgbGreen * param.a1)>>8);
+	}
+	if(alpha!=255)
+	{
+		red = (red *alpha)/255;
+		green = (green *alpha)/255;
+		blue = (blue *alpha)/255;
+	}
+	pAbgr[0] = red;
+	pAbgr[1] = green;
+	pAbgr[2] = blue;
+}
+
+static void RefColorize(BYTE *p,int nPixels,COLORREF crRef,float fBlend)
+{
+	RGBQUAD color = {GetBValue(crRef),GetGValue(crRef),GetRValue(crRef),0};
+	RGBQUAD hsl = RefRGBtoHSL(color);
+	RefColorizeParam param = {hsl.rgbRed,hsl.rgbGreen,(int)(fBlend*256),256-(int)(fBlend*256)};
+	for(int i=0;i<nPixels;i++,p+=4) RefColorizeMode(p,param);
+}
+
+static std::vector<BYTE> RandomPixels(int nPixels,bool bPremultiplied)
+{
+	std::vector<BYTE> buf(nPixels*4);
+	srand(nPixels);
+	for(int i=0;i<nPixels;i++)
+	{
+		BYTE *p = &buf[i*4];
+		BYTE a = (BYTE)(i%3==0?255:(i%7==0?0:rand()&0xFF));
+		for(int c=0;c<3;c++)
+		{
+			p[c] = (BYTE)(rand()&0xFF);
+			if(bPremultiplied && p[c]>a) p[c] = a;
+		}
+		p[3] = a;
+	}
+	return buf;
+}
+
+//像素数覆盖各实现的尾部处理
+static const int KPixelCounts[] = {0,1,3,4,5,7,8,9,15,16,17,33,1023,1025};
+
+class PixelKernelsTest : public ::testing::TestWithParam<int>
+{
+protected:
+	virtual void SetUp()
+	{
+		m_oldLevel = SPixelKernels::GetSimdLevel();
+		m_level = SPixelKernels::SetSimdLevel((SPixelKernels::SIMDLEVEL)GetParam());
+	}
+	virtual void TearDown()
+	{
+		SPixelKernels::SetSimdLevel(m_oldLevel);
+	}
+	SPixelKernels::SIMDLEVEL m_oldLevel;
+	SPixelKernels::SIMDLEVEL m_level;
+};
+
+TEST_P(PixelKernelsTest, PremultiplyRGBA)
+{
+	for(int i=0;i<ARRAYSIZE(KPixelCounts);i++)
+	{
+		int n = KPixelCounts[i];
+		std::vector<BYTE> src = RandomPixels(n,false);
+		std::vector<BYTE> ref = src;
+		RefPremultiplyRGBA(n?&ref[0]:NULL,n);
+		SPixelKernels::PremultiplyRGBA(n?&src[0]:NULL,n);
+		EXPECT_TRUE(src == ref)<<"level="<<m_level<<" pixels="<<n;
+	}
+}
+
+TEST_P(PixelKernelsTest, Gray)
+{
+	for(int i=0;i<ARRAYSIZE(KPixelCounts);i++)
+	{
+		int n = KPixelCounts[i];
+		std::vector<BYTE> src = RandomPixels(n,true);
+		std::vector<BYTE> ref = src;
+		RefGray(n?&ref[0]:NULL,n);
+		SPixelKernels::Gray(n?&src[0]:NULL,n);
+		EXPECT_TRUE(src == ref)<<"level="<<m_level<<" pixels="<<n;
+	}
+}
+
+TEST_P(PixelKernelsTest, SumPixels)
+{
+	//超过16位累加器批次的长度
+	const int nLong = 4096+13;
+	std::vector<BYTE> white(nLong*4,0xFF);
+	UINT sumLong[3]={1,2,3};
+	SPixelKernels::SumPixels(&white[0],nLong,sumLong);
+	EXPECT_EQ(sumLong[0],1+nLong*255u);
+	EXPECT_EQ(sumLong[1],2+nLong*255u);
+	EXPECT_EQ(sumLong[2],3+nLong*255u);
+
+	for(int i=0;i<ARRAYSIZE(KPixelCounts);i++)
+	{
+		int n = KPixelCounts[i];
+		std::vector<BYTE> src = RandomPixels(n,false);
+		UINT ref[3]={0},sum[3]={0};
+		for(int j=0;j<n;j++)
+		{
+			ref[0] += src[j*4];
+			ref[1] += src[j*4+1];
+			ref[2] += src[j*4+2];
+		}
+		SPixelKernels::SumPixels(n?&src[0]:NULL,n,sum);
+		EXPECT_TRUE(memcmp(ref,sum,sizeof(sum))==0)<<"level="<<m_level<<" pixels="<<n;
+	}
+}
+
+INSTANTIATE_TEST_CASE_P(SimdLevels, PixelKernelsTest,
+	::testing::Values((int)SPixelKernels::SIMD_NONE,(int)SPixelKernels::SIMD_SSE2,(int)SPixelKernels::SIMD_AVX2));
+
+//Colorize只有一个标量实现(查表需要gather, 各SIMD等级共用), 这里直接与原HSL算法比较
+TEST(PixelKernels, ColorizeMatchesHslAlgorithm)
+{
+	const COLORREF crRefs[] = {RGB(255,0,0),RGB(0,128,255),RGB(30,200,90),RGB(128,128,128),RGB(0,0,0),RGB(255,255,255),RGB(250,180,20)};
+	const float fBlends[] = {0.8f,1.0f,0.0f,0.5f};
+
+	//所有alpha与若干颜色的组合, 以及未预乘的越界数据(原算法截断到BYTE)
+	std::vector<BYTE> src = RandomPixels(4096,true);
+	std::vector<BYTE> raw = RandomPixels(1024,false);
+	src.insert(src.end(),raw.begin(),raw.end());
+	for(int a=0;a<256;a++)
+	{
+		for(int c=0;c<=a;c+=17)
+		{
+			BYTE px[4] = {(BYTE)c,(BYTE)(a-c),(BYTE)(c/2),(BYTE)a};
+			src.insert(src.end(),px,px+4);
+		}
+	}
+	int nPixels = (int)src.size()/4;
+
+	for(int i=0;i<ARRAYSIZE(crRefs);i++)
+	{
+		for(int j=0;j<ARRAYSIZE(fBlends);j++)
+		{
+			std::vector<BYTE> ref = src;
+			RefColorize(&ref[0],nPixels,crRefs[i],fBlends[j]);
+
+			COLORIZELUT lut;
+			SPixelKernels::BuildColorizeLut(lut,crRefs[i],fBlends[j]);
+			std::vector<BYTE> buf = src;
+			SPixelKernels::Colorize(&buf[0],nPixels,lut);
+
+			int iDiff = -1;
+			for(int k=0;k<nPixels && iDiff==-1;k++)
+			{
+				if(memcmp(&ref[k*4],&buf[k*4],4)!=0) iDiff = k;
+			}
+			EXPECT_EQ(-1,iDiff)<<"color="<<std::hex<<crRefs[i]<<std::dec<<" blend="<<fBlends[j]
+				<<" pixel="<<(iDiff==-1?0:*(DWORD*)&src[iDiff*4]);
+		}
+	}
+}
+
+//性能对比, 运行时加上 --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+BENCHMARK_TEST(PixelKernels, Benchmark)
+{
+	const int nPixels = 1920*1080;
+	const int nLoops = 20;
+	std::vector<BYTE> src = RandomPixels(nPixels,true);
+	COLORIZELUT lut;
+	SPixelKernels::BuildColorizeLut(lut,RGB(0,128,255));
+
+	SPixelKernels::SIMDLEVEL oldLevel = SPixelKernels::GetSimdLevel();
+	for(int level = SPixelKernels::SIMD_NONE; level<=SPixelKernels::GetSupportedSimdLevel(); level++)
+	{
+		SPixelKernels::SetSimdLevel((SPixelKernels::SIMDLEVEL)level);
+		std::vector<BYTE> buf = src;
+		UINT sum[3]={0};
+
+		LARGE_INTEGER t0,t1,t2,t3,t4;
+		QueryPerformanceCounter(&t0);
+		for(int i=0;i<nLoops;i++) SPixelKernels::PremultiplyRGBA(&buf[0],nPixels);
+		QueryPerformanceCounter(&t1);
+		for(int i=0;i<nLoops;i++) SPixelKernels::Gray(&buf[0],nPixels);
+		QueryPerformanceCounter(&t2);
+		for(int i=0;i<nLoops;i++) SPixelKernels::SumPixels(&buf[0],nPixels,sum);
+		QueryPerformanceCounter(&t3);
+		for(int i=0;i<nLoops;i++) SPixelKernels::Colorize(&buf[0],nPixels,lut);
+		QueryPerformanceCounter(&t4);
+		BenchmarkPrintf("simd level %d, %d x %d pixels: premultiply=%.1fms gray=%.1fms sum=%.1fms colorize=%.1fms\n",
+			level,nLoops,nPixels,ElapsedMs(t0,t1),ElapsedMs(t1,t2),ElapsedMs(t2,t3),ElapsedMs(t3,t4));
+	}
+	SPixelKernels::SetSimdLevel(oldLevel);
+}
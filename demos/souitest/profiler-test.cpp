@@ -0,0 +1,182 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <sprofiler.h>
+#include <stdio.h>
+#include <process.h>
+
+using namespace SOUI;
+
+//嵌套的计时段, 对象数和字节数累加到外层
+
+static SStringA ReadFileA(LPCTSTR pszFile)
+{
+	SStringA strRet;
+	FILE *f = NULL;
+	if(_tfopen_s(&f,pszFile,_T("rb")) != 0 || !f) return strRet;
+	char szBuf[1024];
+	size_t nRead;
+	while((nRead = fread(szBuf,1,sizeof(szBuf),f)) > 0)
+	{
+		strRet += SStringA(szBuf,(int)nRead);
+	}
+	fclose(f);
+	return strRet;
+}
+
+static const PROFILESUMMARY * FindSummary(const PROFILESUMMARY *pItems,int nItems,LPCSTR pszName)
+{
+	for(int i=0;i<nItems;i++)
+	{
+		if(strcmp(pItems[i].pszName,pszName) == 0) return pItems+i;
+	}
+	return NULL;
+}
+
+static void LoadChildren()
+{
+	SPROFILE_SCOPE_DETAIL("test::child",L"button");
+	SPROFILE_COUNT(2,100);
+	Sleep(2);
+}
+
+static unsigned int __stdcall ProfileThreadProc(void *)
+{
+	SPROFILE_SCOPE("test::worker");
+	SPROFILE_COUNT(1,0);
+	return 0;
+}
+
+TEST(ProfilerTest,DisabledRecordsNothing)
+{
+	SProfiler::Stop();
+	SProfiler::Reset();
+	EXPECT_FALSE(SProfiler::IsEnabled());
+	{
+		SPROFILE_SCOPE("test::disabled");
+		SPROFILE_COUNT(1,1);
+	}
+	EXPECT_EQ(-1,SProfiler::BeginSpan("test::disabled"));
+	EXPECT_EQ(0,SProfiler::GetSummary(NULL,0));
+}
+
+TEST(ProfilerTest,NestedSpansAndCounts)
+{
+	SProfiler::Start(NULL,NULL,FALSE);
+	{
+		SPROFILE_SCOPE("test::parent");
+		SPROFILE_COUNT(1,10);
+		LoadChildren();
+		LoadChildren();
+		SProfiler::AddCount(0,5);//加到最内层, 即parent
+	}
+	SProfiler::Stop();
+
+	PROFILESUMMARY items[8];
+	int nItems = SProfiler::GetSummary(items,8);
+	ASSERT_EQ(2,nItems);
+	EXPECT_STREQ("test::parent",items[0].pszName);//按总耗时排序
+
+	const PROFILESUMMARY *pParent = FindSummary(items,nItems,"test::parent");
+	const PROFILESUMMARY *pChild = FindSummary(items,nItems,"test::child");
+	ASSERT_TRUE(pParent && pChild);
+	EXPECT_EQ(1,pParent->nCalls);
+	EXPECT_EQ(2,pChild->nCalls);
+	EXPECT_EQ(4,pChild->nObjects);
+	EXPECT_EQ(200,pChild->nBytes);
+	EXPECT_EQ(5,pParent->nObjects);
+	EXPECT_EQ(215,pParent->nBytes);
+	EXPECT_GE(pParent->dTotalMs,pChild->dTotalMs);
+	EXPECT_NEAR(pParent->dTotalMs - pChild->dTotalMs,pParent->dSelfMs,0.01);
+	EXPECT_NEAR(pChild->dTotalMs,pChild->dSelfMs,0.01);
+}
+
+//第一帧时自动停止并导出, trace中包含所有线程的计时段
+TEST(ProfilerTest,ExportAtFirstFrame)
+{
+	TCHAR szTmp[MAX_PATH];
+	GetTempPath(MAX_PATH,szTmp);
+	SStringT strTrace,strSummary;
+	strTrace.Format(_T("%ssouitest-profile-%u.json"),szTmp,GetCurrentProcessId());
+	strSummary.Format(_T("%ssouitest-profile-%u.txt"),szTmp,GetCurrentProcessId());
+
+	SProfiler::Start(strTrace,strSummary,TRUE);
+	LoadChildren();
+	HANDLE hThread = (HANDLE)_beginthreadex(NULL,0,ProfileThreadProc,NULL,0,NULL);
+	WaitForSingleObject(hThread,INFINITE);
+	CloseHandle(hThread);
+	SProfiler::OnFirstFrame();
+	EXPECT_FALSE(SProfiler::IsEnabled());
+
+	SStringA strJson = ReadFileA(strTrace);
+	EXPECT_EQ(0,strJson.Find("{\"traceEvents\":["));
+	EXPECT_NE(-1,strJson.Find("\"name\":\"test::child\""));
+	EXPECT_NE(-1,strJson.Find("\"detail\":\"button\""));
+	EXPECT_NE(-1,strJson.Find("\"name\":\"test::worker\""));
+	EXPECT_NE(-1,strJson.Find("\"name\":\"FirstFrame\""));
+
+	SStringA strTable = ReadFileA(strSummary);
+	EXPECT_NE(-1,strTable.Find("test::child"));
+	EXPECT_NE(-1,strTable.Find("test::worker"));
+	EXPECT_EQ(-1,strTable.Find("FirstFrame"));//事件不参与汇总
+
+	//已经停止, 不再导出
+	SProfiler::OnFirstFrame();
+	DeleteFile(strTrace);
+	DeleteFile(strSummary);
+	SProfiler::Reset();
+}
+
+static unsigned int __stdcall BusyProfileThreadProc(void *pParam)
+{
+	int nSpans = *(int*)pParam;
+	for(int i=0;i<nSpans;i++)
+	{
+		SPROFILE_SCOPE("test::busy");
+		SPROFILE_COUNT(1,8);
+		{
+			SPROFILE_SCOPE_DETAIL("test::busy_child",L"detail");
+		}
+	}
+	return 0;
+}
+
+//其它线程记录的同时汇总和导出, 得到的都是已经结束的完整计时段
+TEST(ProfilerTest,ExportWhileRecording)
+{
+	TCHAR szTmp[MAX_PATH];
+	GetTempPath(MAX_PATH,szTmp);
+	SStringT strTrace;
+	strTrace.Format(_T("%ssouitest-profile-busy-%u.json"),szTmp,GetCurrentProcessId());
+
+	const int nThreads = 2;
+	int nSpans = 20000;
+	SProfiler::Start(NULL,NULL,FALSE);
+	HANDLE hThreads[nThreads];
+	for(int i=0;i<nThreads;i++) hThreads[i] = (HANDLE)_beginthreadex(NULL,0,BusyProfileThreadProc,&nSpans,0,NULL);
+
+	PROFILESUMMARY items[8];
+	while(WaitForMultipleObjects(nThreads,hThreads,TRUE,0) == WAIT_TIMEOUT)
+	{
+		int nItems = SProfiler::GetSummary(items,8);
+		const PROFILESUMMARY *pBusy = FindSummary(items,nItems,"test::busy");
+		if(pBusy)
+		{
+			EXPECT_EQ(pBusy->nCalls,pBusy->nObjects);
+			EXPECT_EQ(pBusy->nCalls*8,pBusy->nBytes);
+		}
+		EXPECT_TRUE(SProfiler::ExportTrace(strTrace));
+	}
+	for(int i=0;i<nThreads;i++) CloseHandle(hThreads[i]);
+	SProfiler::Stop();
+
+	int nItems = SProfiler::GetSummary(items,8);
+	const PROFILESUMMARY *pBusy = FindSummary(items,nItems,"test::busy");
+	const PROFILESUMMARY *pChild = FindSummary(items,nItems,"test::busy_child");
+	ASSERT_TRUE(pBusy && pChild);
+	EXPECT_EQ(nThreads*nSpans,pBusy->nCalls);
+	EXPECT_EQ(nThreads*nSpans,pChild->nCalls);
+	EXPECT_EQ(nThreads*nSpans,pBusy->nObjects);
+	DeleteFile(strTrace);
+	SProfiler::Reset();
+}
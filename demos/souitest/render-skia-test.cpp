@@ -0,0 +1,191 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <stdio.h>
+#include "rendertest.h"
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//render-skia的绘制结果必须与逐块调用DrawBitmapEx的结果逐像素一致
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=RenderSkiaTest.DISABLED_*
+
+class RenderSkiaTest : public RenderTest
+{
+protected:
+	virtual void SetUp()
+	{
+		if(!s_pRenderFactory) return;
+		m_pBmp.Attach(CreateTestBitmap(24,24,0));
+	}
+
+	//按原来的实现逐块调用DrawBitmapEx
+	static void Draw9PatchRef(IRenderTarget *pRT,LPCRECT pRcDest,IBitmap *pBmp,LPCRECT pRcSrc,LPCRECT pRcMargin,UINT expendMode)
+	{
+		int xDest[4] = {pRcDest->left,pRcDest->left+pRcMargin->left,pRcDest->right-pRcMargin->right,pRcDest->right};
+		int xSrc[4] = {pRcSrc->left,pRcSrc->left+pRcMargin->left,pRcSrc->right-pRcMargin->right,pRcSrc->right};
+		int yDest[4] = {pRcDest->top,pRcDest->top+pRcMargin->top,pRcDest->bottom-pRcMargin->bottom,pRcDest->bottom};
+		int ySrc[4] = {pRcSrc->top,pRcSrc->top+pRcMargin->top,pRcSrc->bottom-pRcMargin->bottom,pRcSrc->bottom};
+		UINT mode[3][3]={
+			{EM_NULL,expendMode,EM_NULL},
+			{expendMode,expendMode,expendMode},
+			{EM_NULL,expendMode,EM_NULL}
+		};
+		for(int y=0;y<3;y++)
+		{
+			if(ySrc[y] == ySrc[y+1]) continue;
+			for(int x=0;x<3;x++)
+			{
+				if(xSrc[x] == xSrc[x+1]) continue;
+				RECT rcSrc = {xSrc[x],ySrc[y],xSrc[x+1],ySrc[y+1]};
+				RECT rcDest ={xDest[x],yDest[y],xDest[x+1],yDest[y+1]};
+				pRT->DrawBitmapEx(&rcDest,pBmp,&rcSrc,mode[y][x]);
+			}
+		}
+	}
+
+	//按原来的实现裁剪后逐块绘制
+	static void DrawTileRef(IRenderTarget *pRT,LPCRECT pRcDest,IBitmap *pBmp,LPCRECT pRcSrc)
+	{
+		pRT->PushClipRect(pRcDest);
+		int nWid = pRcSrc->right-pRcSrc->left;
+		int nHei = pRcSrc->bottom-pRcSrc->top;
+		for(int y=pRcDest->top;y<pRcDest->bottom;y+=nHei)
+		{
+			for(int x=pRcDest->left;x<pRcDest->right;x+=nWid)
+			{
+				CRect rcTile(x,y,x+nWid,y+nHei);
+				pRT->DrawBitmap(rcTile,pBmp,pRcSrc->left,pRcSrc->top);
+			}
+		}
+		pRT->PopClip();
+	}
+
+	CAutoRefPtr<IBitmap> m_pBmp;
+};
+
+TEST_F(RenderSkiaTest,NinePatchMatchCellByCell)
+{
+	SKIP_IF_NO_RENDER();
+
+	const UINT modes[] = {EM_STRETCH,EM_TILE,MAKELONG(EM_STRETCH,kLow_FilterLevel)};
+	const CRect rcDests[] = {CRect(3,5,150,97),CRect(0,0,24,24),CRect(10,10,17,70)};
+	CRect rcSrc(0,0,24,24);
+	CRect rcMargin(5,6,7,4);
+
+	for(int i=0;i<ARRAYSIZE(modes);i++)
+	{
+		for(int j=0;j<ARRAYSIZE(rcDests);j++)
+		{
+			CAutoRefPtr<IRenderTarget> pRT1,pRT2;
+			pRT1.Attach(CreateRT(160,100));
+			pRT2.Attach(CreateRT(160,100));
+			pRT1->DrawBitmap9Patch(rcDests[j],m_pBmp,rcSrc,rcMargin,modes[i]);
+			Draw9PatchRef(pRT2,rcDests[j],m_pBmp,rcSrc,rcMargin,modes[i]);
+			EXPECT_TRUE(SamePixels(pRT1,pRT2)) << "mode=" << modes[i] << " dest=" << j;
+		}
+	}
+}
+
+TEST_F(RenderSkiaTest,TileMatchLoop)
+{
+	SKIP_IF_NO_RENDER();
+
+	const CRect rcSrcs[] = {CRect(0,0,24,24),CRect(0,0,16,16),CRect(3,4,10,19)};
+	//对齐, 不对齐及小于一块的目标
+	const CRect rcDests[] = {CRect(0,0,144,96),CRect(7,3,153,91),CRect(20,30,25,33)};
+
+	for(int i=0;i<ARRAYSIZE(rcSrcs);i++)
+	{
+		for(int j=0;j<ARRAYSIZE(rcDests);j++)
+		{
+			CAutoRefPtr<IRenderTarget> pRT1,pRT2;
+			pRT1.Attach(CreateRT(160,100));
+			pRT2.Attach(CreateRT(160,100));
+			pRT1->DrawBitmapEx(rcDests[j],m_pBmp,rcSrcs[i],EM_TILE);
+			DrawTileRef(pRT2,rcDests[j],m_pBmp,rcSrcs[i]);
+			EXPECT_TRUE(SamePixels(pRT1,pRT2)) << "src=" << i << " dest=" << j;
+		}
+	}
+}
+
+//缓存池只在同一尺寸级别内复用, 0x0等小尺寸请求不能占用池中的大画布
+TEST_F(RenderSkiaTest,RenderTargetPoolSizeClass)
+{
+	SKIP_IF_NO_RENDER();
+
+	RTPOOLSTAT stat0,stat1,stat2;
+	CAutoRefPtr<IRenderTarget> pRT;
+	s_pRenderFactory->CreateRenderTarget(&pRT,512,512);
+	pRT = NULL;
+	s_pRenderFactory->GetRenderTargetPoolStat(&stat0);
+
+	s_pRenderFactory->CreateRenderTarget(&pRT,0,0);
+	s_pRenderFactory->GetRenderTargetPoolStat(&stat1);
+	EXPECT_EQ(stat0.nCreated+1,stat1.nCreated);
+	EXPECT_EQ(stat0.nReused,stat1.nReused);
+	pRT = NULL;
+
+	//同一级别内允许调整大小后复用
+	s_pRenderFactory->CreateRenderTarget(&pRT,500,400);
+	s_pRenderFactory->GetRenderTargetPoolStat(&stat2);
+	EXPECT_EQ(stat1.nCreated,stat2.nCreated);
+	EXPECT_EQ(stat1.nReused+1,stat2.nReused);
+	EXPECT_EQ(stat1.nResized+1,stat2.nResized);
+	CAutoRefPtr<IBitmap> pBmp = (IBitmap*)pRT->GetCurrentObject(OT_BITMAP);
+	EXPECT_EQ(500,pBmp->Width());
+	EXPECT_EQ(400,pBmp->Height());
+}
+
+BENCHMARK_TEST_F(RenderSkiaTest,TileBenchmark)
+{
+	SKIP_IF_NO_RENDER();
+
+	const int nLoop = 20;
+	//16x16的花纹平铺到4K背景
+	CRect rcSrc(0,0,16,16);
+	CRect rcDest(0,0,3840,2160);
+	CAutoRefPtr<IRenderTarget> pRT;
+	pRT.Attach(CreateRT(rcDest.Width(),rcDest.Height()));
+
+	LARGE_INTEGER t1,t2,t3;
+	QueryPerformanceCounter(&t1);
+	for(int k=0;k<nLoop;k++) DrawTileRef(pRT,rcDest,m_pBmp,rcSrc);
+	QueryPerformanceCounter(&t2);
+	for(int k=0;k<nLoop;k++) pRT->DrawBitmapEx(rcDest,m_pBmp,rcSrc,EM_TILE);
+	QueryPerformanceCounter(&t3);
+
+	BenchmarkPrintf("tile 16x16 to %dx%d: loop %.1fms, shader %.1fms\n",rcDest.Width(),rcDest.Height(),ElapsedMs(t1,t2),ElapsedMs(t2,t3));
+}
+
+BENCHMARK_TEST_F(RenderSkiaTest,NinePatchBenchmark)
+{
+	SKIP_IF_NO_RENDER();
+
+	const int nLoop = 2000;
+	const UINT modes[] = {EM_STRETCH,EM_TILE};
+	//按钮, 面板, 窗口边框三种常见大小
+	const CRect rcDests[] = {CRect(0,0,80,28),CRect(0,0,300,200),CRect(0,0,800,600)};
+	CRect rcSrc(0,0,24,24);
+	CRect rcMargin(5,5,5,5);
+
+	for(int i=0;i<ARRAYSIZE(modes);i++)
+	{
+		for(int j=0;j<ARRAYSIZE(rcDests);j++)
+		{
+			CAutoRefPtr<IRenderTarget> pRT;
+			pRT.Attach(CreateRT(rcDests[j].Width(),rcDests[j].Height()));
+
+			LARGE_INTEGER t1,t2,t3;
+			QueryPerformanceCounter(&t1);
+			for(int k=0;k<nLoop;k++) Draw9PatchRef(pRT,rcDests[j],m_pBmp,rcSrc,rcMargin,modes[i]);
+			QueryPerformanceCounter(&t2);
+			for(int k=0;k<nLoop;k++) pRT->DrawBitmap9Patch(rcDests[j],m_pBmp,rcSrc,rcMargin,modes[i]);
+			QueryPerformanceCounter(&t3);
+
+			BenchmarkPrintf("9patch %s %dx%d: cell by cell %.1fms, DrawBitmap9Patch %.1fms\n",
+				modes[i]==EM_TILE?"tile":"stretch",rcDests[j].Width(),rcDests[j].Height(),ElapsedMs(t1,t2),ElapsedMs(t2,t3));
+		}
+	}
+}
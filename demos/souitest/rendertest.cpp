@@ -0,0 +1,75 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <stdio.h>
+#include "rendertest.h"
+
+using namespace SOUI;
+
+SComMgr * RenderTest::s_pComMgr = NULL;
+IRenderFactory * RenderTest::s_pRenderFactory = NULL;
+
+void RenderTest::SetUpTestCase()
+{
+	s_pComMgr = new SComMgr;
+	s_pComMgr->CreateRender_Skia((IObjRef**)&s_pRenderFactory);
+}
+
+void RenderTest::TearDownTestCase()
+{
+	if(s_pRenderFactory)
+	{
+		s_pRenderFactory->Release();
+		s_pRenderFactory = NULL;
+	}
+	delete s_pComMgr;
+	s_pComMgr = NULL;
+}
+
+IBitmap * RenderTest::CreateTestBitmap(int nWid,int nHei,int nSeed)
+{
+	DWORD *pBits = new DWORD[nWid*nHei];
+	for(int y=0;y<nHei;y++) for(int x=0;x<nWid;x++)
+	{
+		pBits[y*nWid+x] = 0xFF000000 | (((x*10+nSeed)&0xFF)<<16) | (((y*10)&0xFF)<<8) | ((x*y+nSeed*7)&0xFF);
+	}
+	IBitmap *pBmp = NULL;
+	s_pRenderFactory->CreateBitmap(&pBmp);
+	pBmp->Init(nWid,nHei,pBits);
+	delete []pBits;
+	return pBmp;
+}
+
+IRenderTarget * RenderTest::CreateRT(int nWid,int nHei)
+{
+	IRenderTarget *pRT = NULL;
+	s_pRenderFactory->CreateRenderTarget(&pRT,nWid,nHei);
+	CRect rc(0,0,nWid,nHei);
+	pRT->ClearRect(&rc,0);
+	return pRT;
+}
+
+DWORD RenderTest::PixelAt(IBitmap *pBmp,int x,int y)
+{
+	return ((const DWORD*)pBmp->GetPixelBits())[y*pBmp->Width()+x];
+}
+
+bool RenderTest::SamePixels(IBitmap *pBmp1,IBitmap *pBmp2,int nTolerance)
+{
+	if(pBmp1->Width()!=pBmp2->Width() || pBmp1->Height()!=pBmp2->Height()) return false;
+	const BYTE *p1 = (const BYTE*)pBmp1->GetPixelBits();
+	const BYTE *p2 = (const BYTE*)pBmp2->GetPixelBits();
+	int nBytes = pBmp1->Width()*pBmp1->Height()*4;
+	if(nTolerance == 0) return memcmp(p1,p2,nBytes) == 0;
+	for(int i=0;i<nBytes;i++)
+	{
+		if(abs((int)p1[i]-(int)p2[i]) > nTolerance) return false;
+	}
+	return true;
+}
+
+bool RenderTest::SamePixels(IRenderTarget *pRT1,IRenderTarget *pRT2,int nTolerance)
+{
+	return SamePixels((IBitmap*)pRT1->GetCurrentObject(OT_BITMAP),(IBitmap*)pRT2->GetCurrentObject(OT_BITMAP),nTolerance);
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+//使用render-skia的测试共用的fixture, render-skia-test.cpp, skinatlas-test.cpp和skindiskcache-test.cpp共用
+//包含前先包含gtest, souistd.h和com-cfg.h
+
+class RenderTest : public testing::Test
+{
+protected:
+	static void SetUpTestCase();
+	static void TearDownTestCase();
+
+	//每个像素都不同的图片, 方便发现采样位置的偏差. nSeed不同时内容不同
+	static IBitmap * CreateTestBitmap(int nWid,int nHei,int nSeed);
+
+	//清空为透明的RenderTarget
+	static IRenderTarget * CreateRT(int nWid,int nHei);
+
+	static DWORD PixelAt(IBitmap *pBmp,int x,int y);
+
+	//逐通道比较, 允许nTolerance的误差
+	static bool SamePixels(IBitmap *pBmp1,IBitmap *pBmp2,int nTolerance = 0);
+	static bool SamePixels(IRenderTarget *pRT1,IRenderTarget *pRT2,int nTolerance = 0);
+
+	static SOUI::SComMgr * s_pComMgr;
+	static SOUI::IRenderFactory * s_pRenderFactory;
+};
+
+#define SKIP_IF_NO_RENDER() if(!s_pRenderFactory) {printf("render-skia not available, skipped\n"); return;}
@@ -0,0 +1,390 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <resprovider-7zip/zip7resprovider-param.h>
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//7z资源包按需解压: 只有访问过的文件及其所在的solid数据块才会被解压
+//性能测试: souitest --gtest_also_run_disabled_tests --gtest_filter=ResProvider7ZipTest.DISABLED_*
+
+struct Zip7TestEntry
+{
+	std::string		name;
+	std::vector<BYTE>	data;
+};
+
+static DWORD Crc32(const BYTE *p,size_t nLen)
+{
+	static DWORD s_table[256] = {0};
+	if(!s_table[1])
+	{
+		for(DWORD i=0;i<256;i++)
+		{
+			DWORD c = i;
+			for(int k=0;k<8;k++) c = (c&1)?(0xEDB88320^(c>>1)):(c>>1);
+			s_table[i] = c;
+		}
+	}
+	DWORD crc = 0xFFFFFFFF;
+	for(size_t i=0;i<nLen;i++) crc = s_table[(crc^p[i])&0xFF]^(crc>>8);
+	return crc^0xFFFFFFFF;
+}
+
+static void PutU64(std::vector<BYTE> & buf,UINT64 v)
+{
+	for(int i=0;i<8;i++) buf.push_back((BYTE)(v>>(i*8)));
+}
+
+//7z头中的变长整数
+static void Put7zNumber(std::vector<BYTE> & buf,UINT64 v)
+{
+	BYTE firstByte = 0;
+	BYTE mask = 0x80;
+	int i;
+	for(i=0;i<8;i++)
+	{
+		if(v < ((UINT64)1<<(7*(i+1))))
+		{
+			firstByte |= (BYTE)(v>>(8*i));
+			break;
+		}
+		firstByte |= mask;
+		mask >>= 1;
+	}
+	buf.push_back(firstByte);
+	for(;i>0;i--)
+	{
+		buf.push_back((BYTE)v);
+		v >>= 8;
+	}
+}
+
+//生成使用Copy方法的7z文件, blocks[i]为第i个solid数据块中的文件数, 文件按顺序分配到数据块
+static bool WriteCopy7z(LPCTSTR pszFile,const std::vector<Zip7TestEntry> & entries,const std::vector<int> & blocks)
+{
+	std::vector<BYTE> packed;
+	std::vector<UINT64> blockSizes;
+	size_t iEntry = 0;
+	for(size_t b=0;b<blocks.size();b++)
+	{
+		UINT64 szBlock = 0;
+		for(int i=0;i<blocks[b];i++,iEntry++)
+		{
+			const std::vector<BYTE> & data = entries[iEntry].data;
+			packed.insert(packed.end(),data.begin(),data.end());
+			szBlock += data.size();
+		}
+		blockSizes.push_back(szBlock);
+	}
+	if(iEntry != entries.size()) return false;
+
+	std::vector<BYTE> hdr;
+	hdr.push_back(0x01);	//kHeader
+	hdr.push_back(0x04);	//kMainStreamsInfo
+	hdr.push_back(0x06);	//kPackInfo
+	Put7zNumber(hdr,0);
+	Put7zNumber(hdr,blocks.size());
+	hdr.push_back(0x09);	//kSize
+	for(size_t b=0;b<blocks.size();b++) Put7zNumber(hdr,blockSizes[b]);
+	hdr.push_back(0x00);
+	hdr.push_back(0x07);	//kUnpackInfo
+	hdr.push_back(0x0B);	//kFolder
+	Put7zNumber(hdr,blocks.size());
+	hdr.push_back(0x00);	//External
+	for(size_t b=0;b<blocks.size();b++)
+	{
+		hdr.push_back(1);		//NumCoders
+		hdr.push_back(0x01);	//1字节的方法ID, 1进1出
+		hdr.push_back(0x00);	//Copy
+	}
+	hdr.push_back(0x0C);	//kCodersUnpackSize
+	for(size_t b=0;b<blocks.size();b++) Put7zNumber(hdr,blockSizes[b]);
+	hdr.push_back(0x00);
+	hdr.push_back(0x08);	//kSubStreamsInfo
+	hdr.push_back(0x0D);	//kNumUnpackStream
+	for(size_t b=0;b<blocks.size();b++) Put7zNumber(hdr,blocks[b]);
+	hdr.push_back(0x09);	//kSize, 每个数据块中除最后一个文件外的大小
+	iEntry = 0;
+	for(size_t b=0;b<blocks.size();b++)
+	{
+		for(int i=0;i<blocks[b];i++,iEntry++)
+		{
+			if(i<blocks[b]-1) Put7zNumber(hdr,entries[iEntry].data.size());
+		}
+	}
+	hdr.push_back(0x00);
+	hdr.push_back(0x00);
+
+	hdr.push_back(0x05);	//kFilesInfo
+	Put7zNumber(hdr,entries.size());
+	std::vector<BYTE> names;
+	names.push_back(0);		//External
+	for(size_t i=0;i<entries.size();i++)
+	{
+		const std::string & name = entries[i].name;
+		for(size_t j=0;j<name.size();j++)
+		{
+			names.push_back(name[j]);
+			names.push_back(0);
+		}
+		names.push_back(0);
+		names.push_back(0);
+	}
+	hdr.push_back(0x11);	//kName
+	Put7zNumber(hdr,names.size());
+	hdr.insert(hdr.end(),names.begin(),names.end());
+	hdr.push_back(0x00);
+	hdr.push_back(0x00);
+
+	std::vector<BYTE> sig;
+	const BYTE kSignature[] = {'7','z',0xBC,0xAF,0x27,0x1C,0,4};
+	sig.assign(kSignature,kSignature+sizeof(kSignature));
+	sig.resize(12);
+	PutU64(sig,packed.size());
+	PutU64(sig,hdr.size());
+	DWORD dwHdrCrc = Crc32(&hdr[0],hdr.size());
+	for(int i=0;i<4;i++) sig.push_back((BYTE)(dwHdrCrc>>(i*8)));
+	DWORD dwStartCrc = Crc32(&sig[12],20);
+	for(int i=0;i<4;i++) sig[8+i] = (BYTE)(dwStartCrc>>(i*8));
+
+	FILE *f = _tfopen(pszFile,_T("wb"));
+	if(!f) return false;
+	bool bRet = fwrite(&sig[0],1,sig.size(),f) == sig.size()
+		&& fwrite(&packed[0],1,packed.size(),f) == packed.size()
+		&& fwrite(&hdr[0],1,hdr.size(),f) == hdr.size();
+	fclose(f);
+	return bRet;
+}
+
+//生成nFiles个raw类型的资源, 每nPerBlock个文件一个数据块, 最后的uires.idx单独一个数据块
+static void MakeEntries(std::vector<Zip7TestEntry> & entries,std::vector<int> & blocks,int nFiles,int nPerBlock,int nMinSize,int nMaxSize)
+{
+	std::string strIdx = "<resource><raw>";
+	srand(1);
+	for(int i=0;i<nFiles;i++)
+	{
+		char szName[64];
+		sprintf(szName,"raw/f%d.bin",i);
+		Zip7TestEntry e;
+		e.name = szName;
+		e.data.resize(nMinSize + rand()%(nMaxSize-nMinSize+1));
+		for(size_t j=0;j<e.data.size();j++) e.data[j] = (BYTE)(rand()+j);
+		entries.push_back(e);
+
+		sprintf(szName,"<file name=\"f%d\" path=\"raw\\f%d.bin\"/>",i,i);
+		strIdx += szName;
+	}
+	strIdx += "</raw></resource>";
+	Zip7TestEntry idx;
+	idx.name = "uires.idx";
+	idx.data.assign(strIdx.begin(),strIdx.end());
+	entries.push_back(idx);
+
+	for(int i=0;i<nFiles;i+=nPerBlock)
+		blocks.push_back(min(nPerBlock,nFiles-i));
+	blocks.push_back(1);
+}
+
+class ResProvider7ZipTest : public testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		TCHAR szTmp[MAX_PATH];
+		GetTempPath(MAX_PATH,szTmp);
+		m_str7z.Format(_T("%ssouitest-%u.7z"),szTmp,GetCurrentProcessId());
+		memset(&m_stats,0,sizeof(m_stats));
+	}
+
+	virtual void TearDown()
+	{
+		DeleteFile(m_str7z);
+	}
+
+	IResProvider * CreateProvider(DWORD dwCacheBudget)
+	{
+		IResProvider *pResProvider = NULL;
+		if(!m_comMgr.CreateResProvider_7ZIP((IObjRef**)&pResProvider)) return NULL;
+		ZIP7RES_PARAM param;
+		param.ZipFile(NULL,m_str7z);
+		param.dwCacheBudget = dwCacheBudget;
+		param.pStats = &m_stats;
+		if(!pResProvider->Init((WPARAM)&param,0))
+		{
+			pResProvider->Release();
+			return NULL;
+		}
+		return pResProvider;
+	}
+
+	static bool ReadEqual(IResProvider *pResProvider,int iFile,const std::vector<BYTE> & data)
+	{
+		SStringT strName = SStringT().Format(_T("f%d"),iFile);
+		size_t szBuf = pResProvider->GetRawBufferSize(_T("raw"),strName);
+		if(szBuf != data.size()) return false;
+		std::vector<BYTE> buf(szBuf);
+		if(!pResProvider->GetRawBuffer(_T("raw"),strName,&buf[0],szBuf)) return false;
+		return memcmp(&buf[0],&data[0],szBuf)==0;
+	}
+
+	SComMgr  m_comMgr;
+	SStringT m_str7z;
+	ZIP7RES_STATS m_stats;	//必须在provider之后释放
+};
+
+#define SKIP_IF_NO_PROVIDER(p) if(!p) {printf("resprovider-7zip not available, skipped\n"); return;}
+
+//非solid压缩包: 打开和查询大小都不解压, 只有读取过的文件被解压
+TEST_F(ResProvider7ZipTest,OnlyRequestedEntriesMaterialized)
+{
+	const int nFiles = 2000;
+	std::vector<Zip7TestEntry> entries;
+	std::vector<int> blocks;
+	MakeEntries(entries,blocks,nFiles,1,1,4000);
+	ASSERT_TRUE(WriteCopy7z(m_str7z,entries,blocks));
+
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(0));
+	SKIP_IF_NO_PROVIDER(pResProvider);
+
+	//只解压了uires.idx
+	EXPECT_EQ(nFiles+1,m_stats.nItems);
+	EXPECT_EQ(1,m_stats.nMaterialized);
+	EXPECT_EQ(1,m_stats.nBlockDecodes);
+
+	for(int i=0;i<nFiles;i++)
+	{
+		SStringT strName = SStringT().Format(_T("f%d"),i);
+		EXPECT_TRUE(pResProvider->HasResource(_T("raw"),strName));
+		EXPECT_EQ(entries[i].data.size(),pResProvider->GetRawBufferSize(_T("raw"),strName));
+	}
+	EXPECT_EQ(1,m_stats.nMaterialized);
+
+	const int reads[] = {7,500,1999,7,1234,500};
+	for(int i=0;i<ARRAYSIZE(reads);i++)
+	{
+		EXPECT_TRUE(ReadEqual(pResProvider,reads[i],entries[reads[i]].data)) << "file=" << reads[i];
+	}
+	//重复读取的文件来自缓存
+	EXPECT_EQ(1+4,m_stats.nMaterialized);
+	EXPECT_EQ(1+4,m_stats.nBlockDecodes);
+}
+
+//solid数据块只解码一次, 块中其它文件直接从缓存读取
+TEST_F(ResProvider7ZipTest,SolidBlockDecodedOnce)
+{
+	const int nFiles = 1000;
+	const int nPerBlock = 50;
+	std::vector<Zip7TestEntry> entries;
+	std::vector<int> blocks;
+	MakeEntries(entries,blocks,nFiles,nPerBlock,1,2000);
+	ASSERT_TRUE(WriteCopy7z(m_str7z,entries,blocks));
+
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(0));
+	SKIP_IF_NO_PROVIDER(pResProvider);
+
+	EXPECT_TRUE(ReadEqual(pResProvider,120,entries[120].data));
+	EXPECT_EQ(1+nPerBlock,m_stats.nMaterialized);
+	EXPECT_EQ(2,m_stats.nBlockDecodes);
+
+	for(int i=100;i<150;i++)
+	{
+		EXPECT_TRUE(ReadEqual(pResProvider,i,entries[i].data)) << "file=" << i;
+	}
+	EXPECT_EQ(1+nPerBlock,m_stats.nMaterialized);
+	EXPECT_EQ(2,m_stats.nBlockDecodes);
+
+	EXPECT_TRUE(ReadEqual(pResProvider,nFiles-1,entries[nFiles-1].data));
+	EXPECT_EQ(1+nPerBlock*2,m_stats.nMaterialized);
+	EXPECT_EQ(3,m_stats.nBlockDecodes);
+}
+
+//缓存超过预算时淘汰最久没有使用的数据块
+TEST_F(ResProvider7ZipTest,LruEviction)
+{
+	const int nFiles = 100;
+	const int nPerBlock = 10;
+	const int nFileSize = 1000;
+	std::vector<Zip7TestEntry> entries;
+	std::vector<int> blocks;
+	MakeEntries(entries,blocks,nFiles,nPerBlock,nFileSize,nFileSize);
+	ASSERT_TRUE(WriteCopy7z(m_str7z,entries,blocks));
+	ASSERT_LT(entries[nFiles].data.size(),(size_t)5000);
+
+	//可以容纳两个数据块
+	const DWORD dwBudget = nPerBlock*nFileSize*5/2;
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(dwBudget));
+	SKIP_IF_NO_PROVIDER(pResProvider);
+
+	//按块访问: 0,1,0,2(淘汰uires.idx和1),0,1
+	const int reads[] = {0,1,0,2,0,1};
+	const int decodes[] = {2,3,3,4,4,5};
+	for(int i=0;i<ARRAYSIZE(reads);i++)
+	{
+		int iFile = reads[i]*nPerBlock + 3;
+		EXPECT_TRUE(ReadEqual(pResProvider,iFile,entries[iFile].data)) << "step=" << i;
+		EXPECT_EQ(decodes[i],m_stats.nBlockDecodes) << "step=" << i;
+		EXPECT_LE(m_stats.dwCachedBytes,dwBudget) << "step=" << i;
+	}
+	EXPECT_EQ(2,m_stats.nCachedBlocks);
+	EXPECT_EQ(1+nPerBlock*3,m_stats.nMaterialized);
+}
+
+//超过缓存预算的数据块不缓存, 只解压需要的文件
+TEST_F(ResProvider7ZipTest,OversizedBlockNotCached)
+{
+	const int nFiles = 20;
+	const int nPerBlock = 10;
+	const int nFileSize = 1000;
+	std::vector<Zip7TestEntry> entries;
+	std::vector<int> blocks;
+	MakeEntries(entries,blocks,nFiles,nPerBlock,nFileSize,nFileSize);
+	ASSERT_TRUE(WriteCopy7z(m_str7z,entries,blocks));
+
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(nPerBlock*nFileSize/2));
+	SKIP_IF_NO_PROVIDER(pResProvider);
+
+	int nCachedBlocks = m_stats.nCachedBlocks;
+	EXPECT_TRUE(ReadEqual(pResProvider,13,entries[13].data));
+	EXPECT_TRUE(ReadEqual(pResProvider,13,entries[13].data));
+	EXPECT_EQ(1+1,m_stats.nMaterialized);
+	EXPECT_EQ(1+2,m_stats.nBlockDecodes);
+	EXPECT_EQ(nCachedBlocks,m_stats.nCachedBlocks);
+}
+
+BENCHMARK_TEST_F(ResProvider7ZipTest,Benchmark)
+{
+	const int nFiles = 20000;
+	const int nReads = 100;
+	std::vector<Zip7TestEntry> entries;
+	std::vector<int> blocks;
+	MakeEntries(entries,blocks,nFiles,64,256,8192);
+	ASSERT_TRUE(WriteCopy7z(m_str7z,entries,blocks));
+
+	LARGE_INTEGER t0,t1,t2;
+	QueryPerformanceCounter(&t0);
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(0));
+	SKIP_IF_NO_PROVIDER(pResProvider);
+	QueryPerformanceCounter(&t1);
+	std::vector<BYTE> buf(8192);
+	for(int i=0;i<nReads;i++)
+	{
+		SStringT strName = SStringT().Format(_T("f%d"),i*(nFiles/nReads));
+		pResProvider->GetRawBuffer(_T("raw"),strName,&buf[0],buf.size());
+	}
+	QueryPerformanceCounter(&t2);
+
+	BenchmarkPrintf("7z %d files: open %.1fms, read %d files %.1fms, materialized %d, decodes %d, cached %uKB\n",
+		nFiles,ElapsedMs(t0,t1),nReads,ElapsedMs(t1,t2),
+		m_stats.nMaterialized,m_stats.nBlockDecodes,m_stats.dwCachedBytes/1024);
+}
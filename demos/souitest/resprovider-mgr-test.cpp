@@ -0,0 +1,379 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <res.mgr/SResProviderMgr.h>
+#include <helper/SplitString.h>
+#include <stdio.h>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//SResProviderMgr的查找索引必须与从后向前遍历资源包的结果一致
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=ResProviderMgrTest.DISABLED_*
+
+//只实现HasResource的资源包, 记录被查询的次数
+class STestResProvider : public TObjRefImpl<IResProvider>
+{
+public:
+	STestResProvider():m_nQueries(0){}
+
+	void AddRes(LPCTSTR pszType,LPCTSTR pszResName)
+	{
+		m_mapRes[SResID(pszType,pszResName)] = TRUE;
+	}
+
+	virtual BOOL Init(WPARAM wParam,LPARAM lParam){return TRUE;}
+
+	virtual BOOL HasResource(LPCTSTR pszType,LPCTSTR pszResName)
+	{
+		m_nQueries++;
+		return m_mapRes.Lookup(SResID(pszType,pszResName)) != NULL;
+	}
+
+	virtual HICON LoadIcon(LPCTSTR pszResName,int cx=0,int cy=0){return NULL;}
+	virtual HBITMAP LoadBitmap(LPCTSTR pszResName){return NULL;}
+	virtual HCURSOR LoadCursor(LPCTSTR pszResName){return NULL;}
+	virtual IBitmap * LoadImage(LPCTSTR pszType,LPCTSTR pszResName){return NULL;}
+	virtual IImgX   * LoadImgX(LPCTSTR pszType,LPCTSTR pszResName){return NULL;}
+	virtual size_t GetRawBufferSize(LPCTSTR pszType,LPCTSTR pszResName){return 0;}
+	virtual BOOL GetRawBuffer(LPCTSTR pszType,LPCTSTR pszResName,LPVOID pBuf,size_t size){return FALSE;}
+
+	int m_nQueries;
+protected:
+	SMap<SResID,BOOL> m_mapRes;
+};
+
+static IResProvider * MakeProvider(LPCTSTR pszNames)
+{
+	STestResProvider *p = new STestResProvider;
+	SStringTList lstNames;
+	SplitString(SStringT(pszNames),_T(','),lstNames);
+	for(UINT i=0;i<lstNames.GetCount();i++) p->AddRes(_T("raw"),lstNames[i]);
+	return p;
+}
+
+static int Queries(IResProvider *p)
+{
+	return static_cast<STestResProvider*>(p)->m_nQueries;
+}
+
+TEST(ResProviderMgrTest,IndexFollowsProviderList)
+{
+	SResProviderMgr mgr;
+	CAutoRefPtr<IResProvider> p0,p1,p2,p3;
+	p0.Attach(MakeProvider(_T("a,b")));
+	p1.Attach(MakeProvider(_T("b,c")));
+	p2.Attach(MakeProvider(_T("c,d")));
+	p3.Attach(MakeProvider(_T("a,x")));
+	//不设置uidef, 不需要SApp
+	mgr.AddResProvider(p0,NULL);
+	mgr.AddResProvider(p1,NULL);
+	mgr.AddResProvider(p2,NULL);
+
+	EXPECT_EQ((IResProvider*)p0,mgr.GetMatchResProvider(_T("raw"),_T("a")));
+	EXPECT_EQ((IResProvider*)p1,mgr.GetMatchResProvider(_T("raw"),_T("b")));
+	EXPECT_EQ((IResProvider*)p2,mgr.GetMatchResProvider(_T("raw"),_T("c")));
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),_T("x")));
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("xml"),_T("a")));
+	EXPECT_EQ((IResProvider*)p1,mgr.GetMatchResProvider(_T("RAW"),_T("B")));
+
+	//命中索引后不再查询资源包
+	int nQueries = Queries(p0)+Queries(p1)+Queries(p2);
+	for(int i=0;i<10;i++)
+	{
+		mgr.GetMatchResProvider(_T("raw"),_T("a"));
+		mgr.GetMatchResProvider(_T("raw"),_T("x"));
+		EXPECT_TRUE(mgr.HasResource(_T("raw"),_T("c")));
+	}
+	EXPECT_EQ(nQueries,Queries(p0)+Queries(p1)+Queries(p2));
+
+	//新资源包覆盖已有资源, 之前找不到的资源也要更新
+	mgr.AddResProvider(p3,NULL);
+	EXPECT_EQ((IResProvider*)p3,mgr.GetMatchResProvider(_T("raw"),_T("a")));
+	EXPECT_EQ((IResProvider*)p3,mgr.GetMatchResProvider(_T("raw"),_T("x")));
+	EXPECT_EQ((IResProvider*)p2,mgr.GetMatchResProvider(_T("raw"),_T("c")));
+
+	//删除后回退到下一个资源包
+	mgr.RemoveResProvider(p3);
+	EXPECT_EQ((IResProvider*)p0,mgr.GetMatchResProvider(_T("raw"),_T("a")));
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),_T("x")));
+	mgr.RemoveResProvider(p1);
+	EXPECT_EQ((IResProvider*)p0,mgr.GetMatchResProvider(_T("raw"),_T("b")));
+	EXPECT_EQ((IResProvider*)p2,mgr.GetMatchResProvider(_T("raw"),_T("c")));
+	mgr.RemoveResProvider(p2);
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),_T("c")));
+	EXPECT_FALSE(mgr.HasResource(_T("raw"),_T("d")));
+}
+
+//超过初始容量后扩容, 所有资源仍然能找到
+TEST(ResProviderMgrTest,IndexGrow)
+{
+	const int nRes = 5000;
+	SResProviderMgr mgr;
+	CAutoRefPtr<IResProvider> p0,p1;
+	p0.Attach(new STestResProvider);
+	p1.Attach(new STestResProvider);
+	for(int i=0;i<nRes;i++)
+	{
+		SStringT strName = SStringT().Format(_T("r%d"),i);
+		static_cast<STestResProvider*>((IResProvider*)(i%2?p1:p0))->AddRes(_T("raw"),strName);
+	}
+	mgr.AddResProvider(p0,NULL);
+	mgr.AddResProvider(p1,NULL);
+	for(int k=0;k<2;k++) for(int i=0;i<nRes;i++)
+	{
+		SStringT strName = SStringT().Format(_T("r%d"),i);
+		EXPECT_EQ((IResProvider*)(i%2?p1:p0),mgr.GetMatchResProvider(_T("raw"),strName)) << strName;
+	}
+}
+
+//找不到的资源最多索引KResIndexMaxMisses个, 超出后每次都查询资源包, 找到的资源不受影响
+TEST(ResProviderMgrTest,IndexMissesCapped)
+{
+	const int nMisses = 10000;
+	SResProviderMgr mgr;
+	CAutoRefPtr<IResProvider> p0;
+	p0.Attach(MakeProvider(_T("a")));
+	mgr.AddResProvider(p0,NULL);
+
+	for(int i=0;i<nMisses;i++)
+	{
+		EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),SStringT().Format(_T("miss%d"),i)));
+	}
+	//先找不到的资源已经索引
+	int nQueries = Queries(p0);
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),_T("miss0")));
+	EXPECT_EQ(nQueries,Queries(p0));
+	//超出上限的没有索引
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),SStringT().Format(_T("miss%d"),nMisses-1)));
+	EXPECT_EQ(nQueries+1,Queries(p0));
+
+	//找到的资源仍然加入索引
+	EXPECT_EQ((IResProvider*)p0,mgr.GetMatchResProvider(_T("raw"),_T("a")));
+	nQueries = Queries(p0);
+	EXPECT_EQ((IResProvider*)p0,mgr.GetMatchResProvider(_T("raw"),_T("a")));
+	EXPECT_EQ(nQueries,Queries(p0));
+
+	//新资源包提供了之前找不到的资源, 空出的名额可以再索引新的找不到的资源
+	CAutoRefPtr<IResProvider> p1;
+	p1.Attach(MakeProvider(_T("miss0,miss1")));
+	mgr.AddResProvider(p1,NULL);
+	EXPECT_EQ((IResProvider*)p1,mgr.GetMatchResProvider(_T("raw"),_T("miss1")));
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),_T("other")));
+	nQueries = Queries(p0)+Queries(p1);
+	EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("raw"),_T("other")));
+	EXPECT_EQ(nQueries,Queries(p0)+Queries(p1));
+}
+
+static BOOL CALLBACK FindIntResNameProc(HMODULE hModule,LPCTSTR lpszType,LPTSTR lpszName,LONG_PTR lParam)
+{
+	if(!IS_INTRESOURCE(lpszName)) return TRUE;
+	*(LPCTSTR*)lParam = lpszName;
+	return FALSE;
+}
+
+//PE资源包使用整数ID的资源: 不进索引, 按名字查找时不能把ID当成字符串
+TEST(ResProviderMgrTest,PEIntegerID)
+{
+	HMODULE hModule = LoadLibrary(_T("comctl32.dll"));
+	LPCTSTR pszID = NULL;
+	if(hModule) EnumResourceNames(hModule,RT_BITMAP,FindIntResNameProc,(LONG_PTR)&pszID);
+	if(!pszID)
+	{
+		printf("no integer bitmap in comctl32.dll, skipped\n");
+		if(hModule) FreeLibrary(hModule);
+		return;
+	}
+
+	{
+		SResProviderMgr mgr;
+		CAutoRefPtr<IResProvider> pNamed,pPE;
+		pNamed.Attach(MakeProvider(_T("a")));
+		CreateResProvider(RES_PE,(IObjRef**)&pPE);
+		ASSERT_TRUE(pPE != NULL);
+		pPE->Init((WPARAM)hModule,0);
+		mgr.AddResProvider(pNamed,NULL);
+		mgr.AddResProvider(pPE,NULL);
+
+		for(int i=0;i<2;i++)
+		{
+			EXPECT_EQ((IResProvider*)pPE,mgr.GetMatchResProvider(_T("bitmap"),pszID));
+			EXPECT_TRUE(mgr.HasResource(_T("bitmap"),pszID));
+		}
+		size_t szBuf = mgr.GetRawBufferSize(_T("bitmap"),pszID);
+		ASSERT_GT(szBuf,0u);
+		BYTE *pBuf = new BYTE[szBuf];
+		EXPECT_TRUE(mgr.GetRawBuffer(_T("bitmap"),pszID,pBuf,szBuf));
+		delete []pBuf;
+
+		HBITMAP hBmp = mgr.LoadBitmap(pszID);
+		EXPECT_TRUE(hBmp != NULL);
+		if(hBmp) DeleteObject(hBmp);
+
+		//不存在的ID
+		EXPECT_EQ((IResProvider*)NULL,mgr.GetMatchResProvider(_T("bitmap"),MAKEINTRESOURCE(0xFFF0)));
+		EXPECT_TRUE(mgr.LoadBitmap(MAKEINTRESOURCE(0xFFF0)) == NULL);
+		EXPECT_TRUE(mgr.FindCachedImage(_T("bitmap"),pszID,100) == NULL);
+		//字符串名字仍然走索引
+		EXPECT_EQ((IResProvider*)pNamed,mgr.GetMatchResProvider(_T("raw"),_T("a")));
+	}
+	FreeLibrary(hModule);
+}
+
+//每个资源都在第一个资源包中, 原来的实现需要遍历全部资源包
+BENCHMARK_TEST(ResProviderMgrTest,LookupBenchmark)
+{
+	const int nRes = 500;
+	const int nLoop = 200;
+	const int nProviders[] = {1,4,16,64};
+
+	SStringT *pNames = new SStringT[nRes];
+	for(int i=0;i<nRes;i++) pNames[i].Format(_T("img_%d"),i);
+
+	for(int n=0;n<ARRAYSIZE(nProviders);n++)
+	{
+		SResProviderMgr mgr;
+		SList<IResProvider*> lstProviders;
+		for(int i=0;i<nProviders[n];i++)
+		{
+			STestResProvider *p = new STestResProvider;
+			for(int j=0;j<nRes;j++)
+			{
+				if(i==0) p->AddRes(_T("img"),pNames[j]);
+				else p->AddRes(_T("img"),SStringT().Format(_T("other%d_%d"),i,j));
+			}
+			mgr.AddResProvider(p,NULL);
+			lstProviders.AddTail(p);
+			p->Release();
+		}
+
+		LARGE_INTEGER t1,t2,t3;
+		QueryPerformanceCounter(&t1);
+		for(int k=0;k<nLoop;k++) for(int j=0;j<nRes;j++)
+		{//从后向前遍历
+			SPOSITION pos = lstProviders.GetTailPosition();
+			while(pos && !lstProviders.GetPrev(pos)->HasResource(_T("img"),pNames[j]));
+		}
+		QueryPerformanceCounter(&t2);
+		for(int k=0;k<nLoop;k++) for(int j=0;j<nRes;j++)
+			mgr.GetMatchResProvider(_T("img"),pNames[j]);
+		QueryPerformanceCounter(&t3);
+
+		BenchmarkPrintf("%2d providers: linear scan %.0fns/lookup, index %.0fns/lookup\n",nProviders[n],
+			ElapsedMs(t1,t2)*1000000.0/(nLoop*nRes),ElapsedMs(t2,t3)*1000000.0/(nLoop*nRes));
+	}
+	delete []pNames;
+}
+
+//每次加载都生成一张新图片, 相当于资源包解码图片
+class SImageTestProvider : public STestResProvider
+{
+public:
+	SImageTestProvider(IRenderFactory *pRenderFactory,int nSize):m_pRenderFactory(pRenderFactory),m_nSize(nSize){}
+
+	virtual BOOL HasResource(LPCTSTR pszType,LPCTSTR pszResName){return TRUE;}
+
+	virtual IBitmap * LoadImage(LPCTSTR pszType,LPCTSTR pszResName)
+	{
+		DWORD *pBits = new DWORD[m_nSize*m_nSize];
+		DWORD dwSeed = (DWORD)_tcslen(pszResName);
+		for(int i=0;i<m_nSize*m_nSize;i++) pBits[i] = 0xFF000000 | (i*dwSeed);
+		IBitmap *pBmp = NULL;
+		m_pRenderFactory->CreateBitmap(&pBmp);
+		pBmp->Init(m_nSize,m_nSize,pBits);
+		delete []pBits;
+		return pBmp;
+	}
+
+protected:
+	IRenderFactory * m_pRenderFactory;
+	int m_nSize;
+};
+
+struct LoadImageThreadParam
+{
+	SResProviderMgr *pMgr;
+	CRITICAL_SECTION *pcsBaseline;	//不为NULL时整个加载过程加锁, 与原来的实现一样
+	int iThread;
+	int nLoads;
+};
+
+static DWORD WINAPI LoadImageThread(LPVOID lpParam)
+{
+	LoadImageThreadParam *pParam = (LoadImageThreadParam*)lpParam;
+	for(int i=0;i<pParam->nLoads;i++)
+	{
+		SStringT strName = SStringT().Format(_T("img_%d_%d"),pParam->iThread,i);
+		if(pParam->pcsBaseline) EnterCriticalSection(pParam->pcsBaseline);
+		IBitmap *pImg = pParam->pMgr->LoadImage(_T("img"),strName);
+		if(pParam->pcsBaseline) LeaveCriticalSection(pParam->pcsBaseline);
+		if(pImg) pImg->Release();
+	}
+	return 0;
+}
+
+//多个线程通过SResProviderMgr::LoadImage加载图片. 缓存预算为0, 每次都从资源包加载
+BENCHMARK_TEST(ResProviderMgrTest,LoadImageBenchmark)
+{
+	const int nLoads = 400;
+	const int nThreadCounts[] = {1,2,4};
+
+	SComMgr comMgr;
+	CAutoRefPtr<IRenderFactory> pRenderFactory;
+	comMgr.CreateRender_Skia((IObjRef**)&pRenderFactory);
+	if(!pRenderFactory)
+	{
+		printf("render-skia not available, skipped\n");
+		return;
+	}
+
+	SResProviderMgr mgr;
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(new SImageTestProvider(pRenderFactory,128));
+	mgr.AddResProvider(pResProvider,NULL);
+	mgr.SetImageCacheBudget(0);
+
+	CRITICAL_SECTION csBaseline;
+	InitializeCriticalSection(&csBaseline);
+	for(int n=0;n<ARRAYSIZE(nThreadCounts);n++)
+	{
+		double fMs[2];
+		for(int iMode=0;iMode<2;iMode++)
+		{
+			LoadImageThreadParam params[4];
+			HANDLE hThreads[4];
+			LARGE_INTEGER t1,t2;
+			QueryPerformanceCounter(&t1);
+			for(int i=0;i<nThreadCounts[n];i++)
+			{
+				params[i].pMgr = &mgr;
+				params[i].pcsBaseline = iMode==0?&csBaseline:NULL;
+				params[i].iThread = i;
+				params[i].nLoads = nLoads;
+				hThreads[i] = CreateThread(NULL,0,LoadImageThread,params+i,0,NULL);
+			}
+			WaitForMultipleObjects(nThreadCounts[n],hThreads,TRUE,INFINITE);
+			QueryPerformanceCounter(&t2);
+			for(int i=0;i<nThreadCounts[n];i++) CloseHandle(hThreads[i]);
+			fMs[iMode] = ElapsedMs(t1,t2);
+		}
+		BenchmarkPrintf("%d threads x %d loads: locked load %.1fms, unlocked load %.1fms\n",
+			nThreadCounts[n],nLoads,fMs[0],fMs[1]);
+	}
+	DeleteCriticalSection(&csBaseline);
+
+	//命中缓存时的开销
+	mgr.SetImageCacheBudget(64*1024*1024);
+	IBitmap *pImg = mgr.LoadImage(_T("img"),_T("hit"));
+	if(pImg) pImg->Release();
+	LARGE_INTEGER t1,t2;
+	QueryPerformanceCounter(&t1);
+	for(int i=0;i<nLoads*100;i++)
+	{
+		pImg = mgr.LoadImage(_T("img"),_T("hit"));
+		if(pImg) pImg->Release();
+	}
+	QueryPerformanceCounter(&t2);
+	BenchmarkPrintf("cache hit: %.0fns/load\n",ElapsedMs(t1,t2)*1000000.0/(nLoads*100));
+}
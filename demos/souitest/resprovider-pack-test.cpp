@@ -0,0 +1,257 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <resprovider-pack/packresprovider-param.h>
+#include <resprovider-pack/respack-writer.h>
+#include <resprovider-zip/zipresprovider-param.h>
+#include "testzip.h"
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//资源包按uiresbuilder -k相同的方式生成, 读取的结果必须与源数据一致
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=ResProviderPackTest.DISABLED_*
+
+enum {DATA_TEXT,DATA_RANDOM,DATA_EMPTY};
+
+//文本数据可以压缩, 随机数据压缩后不会变小
+static void MakeData(std::vector<BYTE> & data,int nType,int nSize)
+{
+	static const char szXml[] = "<window pos=\"10,10,-10,-10\" colorBkgnd=\"#ffffff\" skin=\"_skin.sys.btn.normal\">";
+	data.resize(nType==DATA_EMPTY?0:nSize);
+	for(size_t j=0;j<data.size();j++)
+	{
+		if(nType == DATA_TEXT) data[j] = (rand()%16)?szXml[j%(ARRAYSIZE(szXml)-1)]:(BYTE)('0'+rand()%10);
+		else data[j] = (BYTE)rand();
+	}
+}
+
+static bool WriteBuffer(LPCTSTR pszFile,const std::vector<BYTE> & buf)
+{
+	FILE *f = _tfopen(pszFile,_T("wb"));
+	if(!f) return false;
+	bool bRet = fwrite(&buf[0],1,buf.size(),f) == buf.size();
+	fclose(f);
+	return bRet;
+}
+
+static SStringT ResName(int i)
+{
+	return SStringT().Format(_T("f%d"),i);
+}
+
+class ResProviderPackTest : public testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		TCHAR szTmp[MAX_PATH];
+		GetTempPath(MAX_PATH,szTmp);
+		m_strPack.Format(_T("%ssouitest-%u.spk"),szTmp,GetCurrentProcessId());
+		m_strZip.Format(_T("%ssouitest-pack-%u.zip"),szTmp,GetCurrentProcessId());
+	}
+
+	virtual void TearDown()
+	{
+		DeleteFile(m_strPack);
+		DeleteFile(m_strZip);
+	}
+
+	//生成nFiles个raw类型的资源, 每3个中一个是随机数据, 每5个中一个直接保存
+	void MakePack(std::vector<std::vector<BYTE> > & lstData,int nFiles,int nMinSize,int nMaxSize)
+	{
+		CRespackWriter writer;
+		srand(1);
+		lstData.resize(nFiles);
+		for(int i=0;i<nFiles;i++)
+		{
+			MakeData(lstData[i],i==7?DATA_EMPTY:(i%3==1?DATA_RANDOM:DATA_TEXT),nMinSize + rand()%(nMaxSize-nMinSize+1));
+			writer.AddEntry(L"raw",S_CT2W(ResName(i)),lstData[i].empty()?NULL:&lstData[i][0],(DWORD)lstData[i].size(),i%5==0);
+		}
+		std::vector<BYTE> buf;
+		EXPECT_EQ(0,writer.Build(buf));
+		m_nPackSize = buf.size();
+		ASSERT_TRUE(WriteBuffer(m_strPack,buf));
+	}
+
+	IResProvider * CreateProvider(BOOL bVerifyCrc)
+	{
+		IResProvider *pResProvider = NULL;
+		if(!m_comMgr.CreateResProvider_PACK((IObjRef**)&pResProvider)) return NULL;
+		PACKRES_PARAM param;
+		param.PackFile(NULL,m_strPack,bVerifyCrc);
+		if(!pResProvider->Init((WPARAM)&param,0))
+		{
+			pResProvider->Release();
+			return NULL;
+		}
+		return pResProvider;
+	}
+
+	static bool ReadEqual(IResProvider *pResProvider,LPCTSTR pszName,const std::vector<BYTE> & data)
+	{
+		if(!pResProvider->HasResource(_T("raw"),pszName)) return false;
+		size_t szBuf = pResProvider->GetRawBufferSize(_T("raw"),pszName);
+		if(szBuf != data.size()) return false;
+		std::vector<BYTE> buf(szBuf+1);
+		if(!pResProvider->GetRawBuffer(_T("raw"),pszName,&buf[0],szBuf)) return false;
+		return szBuf==0 || memcmp(&buf[0],&data[0],szBuf)==0;
+	}
+
+	SComMgr  m_comMgr;
+	SStringT m_strPack;
+	SStringT m_strZip;
+	size_t   m_nPackSize;
+};
+
+#define SKIP_IF_NO_PROVIDER(p) if(!p) {printf("resprovider-pack not available, skipped\n"); return;}
+
+TEST_F(ResProviderPackTest,RoundTrip)
+{
+	const int nFiles = 60;
+	std::vector<std::vector<BYTE> > lstData;
+	//超过64K的资源分成多个块
+	MakePack(lstData,nFiles,1,200000);
+
+	size_t szTotal = 0;
+	for(int i=0;i<nFiles;i++) szTotal += lstData[i].size();
+	EXPECT_LT(m_nPackSize,szTotal);
+
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(TRUE));
+	SKIP_IF_NO_PROVIDER(pResProvider);
+
+	for(int i=0;i<nFiles;i++)
+	{
+		EXPECT_TRUE(ReadEqual(pResProvider,ResName(i),lstData[i])) << "file=" << i;
+	}
+	//查找不区分大小写
+	EXPECT_TRUE(ReadEqual(pResProvider,_T("F12"),lstData[12]));
+	EXPECT_TRUE(pResProvider->HasResource(_T("RAW"),_T("f3")));
+	EXPECT_FALSE(pResProvider->HasResource(_T("raw"),ResName(nFiles)));
+	EXPECT_FALSE(pResProvider->HasResource(_T("xml"),_T("f1")));
+	EXPECT_EQ((size_t)0,pResProvider->GetRawBufferSize(_T("raw"),ResName(nFiles)));
+
+	//缓冲区不够
+	std::vector<BYTE> buf(lstData[1].size());
+	EXPECT_FALSE(pResProvider->GetRawBuffer(_T("raw"),_T("f1"),&buf[0],buf.size()-1));
+}
+
+//数据损坏时读取失败, 目录损坏时打开失败
+TEST_F(ResProviderPackTest,CorruptionDetected)
+{
+	std::vector<std::vector<BYTE> > lstData;
+	MakePack(lstData,10,1000,3000);
+
+	FILE *f = _tfopen(m_strPack,_T("rb"));
+	ASSERT_TRUE(f != NULL);
+	std::vector<BYTE> buf(m_nPackSize);
+	ASSERT_EQ(buf.size(),fread(&buf[0],1,buf.size(),f));
+	fclose(f);
+
+	const PACKHEADER *pHeader = (const PACKHEADER*)&buf[0];
+	const PACKENTRY *pEntries = (const PACKENTRY*)(&buf[0] + pHeader->dwTocOffset);
+	std::vector<int> lstCorrupt;
+	for(DWORD i=0;i<pHeader->nEntries;i++)
+	{
+		LPCWSTR pszName = (LPCWSTR)(&buf[0] + pHeader->dwNameOffset + pEntries[i].dwNameOffset) + pEntries[i].wTypeLen + 1;
+		if(wcscmp(pszName,L"f1")==0 || wcscmp(pszName,L"f2")==0)
+		{//f1未压缩, f2压缩
+			buf[pEntries[i].dwOffset + pEntries[i].dwPackedSize/2] ^= 0x5A;
+		}
+	}
+	ASSERT_TRUE(WriteBuffer(m_strPack,buf));
+	{
+		CAutoRefPtr<IResProvider> pResProvider;
+		pResProvider.Attach(CreateProvider(TRUE));
+		SKIP_IF_NO_PROVIDER(pResProvider);
+		std::vector<BYTE> out(3000);
+		EXPECT_FALSE(pResProvider->GetRawBuffer(_T("raw"),_T("f1"),&out[0],out.size()));
+		EXPECT_FALSE(pResProvider->GetRawBuffer(_T("raw"),_T("f2"),&out[0],out.size()));
+		EXPECT_TRUE(ReadEqual(pResProvider,_T("f3"),lstData[3]));
+	}
+
+	buf[pHeader->dwNameOffset] ^= 0x01;
+	ASSERT_TRUE(WriteBuffer(m_strPack,buf));
+	CAutoRefPtr<IResProvider> pResProvider;
+	pResProvider.Attach(CreateProvider(FALSE));
+	EXPECT_TRUE(pResProvider == NULL);
+	//打开失败后不能再占用文件
+	EXPECT_TRUE(DeleteFile(m_strPack));
+}
+
+//同样的数据分别放在zip(未压缩, 测试中没有zlib)和资源包中, 比较随机读取的速度
+BENCHMARK_TEST_F(ResProviderPackTest,ReadBenchmark)
+{
+	const int nFiles = 5000;
+	const int nLoop = 3;
+	std::vector<std::vector<BYTE> > lstData;
+	MakePack(lstData,nFiles,256,16384);
+
+	std::vector<ZipTestEntry> entries(nFiles+1);
+	std::string strIdx = "<resource><raw>";
+	size_t szTotal = 0;
+	for(int i=0;i<nFiles;i++)
+	{
+		char szName[64];
+		sprintf(szName,"raw/f%d.bin",i);
+		entries[i].name = szName;
+		entries[i].data = lstData[i];
+		szTotal += lstData[i].size();
+		sprintf(szName,"<file name=\"f%d\" path=\"raw\\f%d.bin\"/>",i,i);
+		strIdx += szName;
+	}
+	strIdx += "</raw></resource>";
+	entries[nFiles].name = "uires.idx";
+	entries[nFiles].data.assign(strIdx.begin(),strIdx.end());
+	ASSERT_TRUE(WriteTestZip(m_strZip,entries));
+
+	//随机顺序
+	std::vector<int> lstOrder(nFiles);
+	for(int i=0;i<nFiles;i++) lstOrder[i] = i;
+	for(int i=nFiles-1;i>0;i--) std::swap(lstOrder[i],lstOrder[rand()%(i+1)]);
+	SStringT *pNames = new SStringT[nFiles];
+	for(int i=0;i<nFiles;i++) pNames[i] = ResName(i);
+	std::vector<BYTE> buf(16384);
+
+	for(int iProvider=0;iProvider<2;iProvider++)
+	{
+		LARGE_INTEGER t0,t1,t2;
+		QueryPerformanceCounter(&t0);
+		CAutoRefPtr<IResProvider> pResProvider;
+		if(iProvider == 0)
+		{
+			IResProvider *pZip = NULL;
+			if(m_comMgr.CreateResProvider_ZIP((IObjRef**)&pZip))
+			{
+				pResProvider.Attach(pZip);
+				ZIPRES_PARAM param;
+				param.ZipFile(NULL,m_strZip,NULL,NULL,TRUE);
+				if(!pResProvider->Init((WPARAM)&param,0)) pResProvider = NULL;
+			}
+		}else
+		{
+			pResProvider.Attach(CreateProvider(FALSE));
+		}
+		if(!pResProvider) continue;
+		QueryPerformanceCounter(&t1);
+		for(int k=0;k<nLoop;k++) for(int i=0;i<nFiles;i++)
+		{
+			const SStringT & strName = pNames[lstOrder[i]];
+			size_t szBuf = pResProvider->GetRawBufferSize(_T("raw"),strName);
+			pResProvider->GetRawBuffer(_T("raw"),strName,&buf[0],szBuf);
+		}
+		QueryPerformanceCounter(&t2);
+
+		double fRead = ElapsedMs(t1,t2)/nLoop;
+		BenchmarkPrintf("%s: file %.1fMB, open %.1fms, read %.1fms (%.0fMB/s)\n",
+			iProvider==0?"zip (stored)":"pack        ",
+			(iProvider==0?szTotal:m_nPackSize)/1024.0/1024.0,ElapsedMs(t0,t1),
+			fRead,szTotal/1024.0/1024.0/(fRead/1000.0));
+	}
+	delete []pNames;
+}
@@ -0,0 +1,379 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <resprovider-zip/zipresprovider-param.h>
+#include "testzip.h"
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//文件句柄与内存映射两种方式读取的结果必须一致
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=ResProviderZipTest.DISABLED_*
+
+//生成nFiles个raw类型的资源及uires.idx
+static void MakeEntries(std::vector<ZipTestEntry> & entries,int nFiles,int nMinSize,int nMaxSize)
+{
+	std::string strIdx = "<resource><raw>";
+	srand(1);
+	for(int i=0;i<nFiles;i++)
+	{
+		char szName[64];
+		sprintf(szName,"raw/f%d.bin",i);
+		ZipTestEntry e;
+		e.name = szName;
+		e.data.resize(nMinSize + rand()%(nMaxSize-nMinSize+1));
+		for(size_t j=0;j<e.data.size();j++) e.data[j] = (BYTE)(rand()+j);
+		entries.push_back(e);
+
+		sprintf(szName,"<file name=\"f%d\" path=\"raw\\f%d.bin\"/>",i,i);
+		strIdx += szName;
+	}
+	strIdx += "</raw></resource>";
+	ZipTestEntry idx;
+	idx.name = "uires.idx";
+	idx.data.assign(strIdx.begin(),strIdx.end());
+	entries.push_back(idx);
+}
+
+class ResProviderZipTest : public testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		TCHAR szTmp[MAX_PATH];
+		GetTempPath(MAX_PATH,szTmp);
+		m_strZip.Format(_T("%ssouitest-%u.zip"),szTmp,GetCurrentProcessId());
+	}
+
+	virtual void TearDown()
+	{
+		DeleteFile(m_strZip);
+	}
+
+	IResProvider * CreateProvider(BOOL bMapFile)
+	{
+		IResProvider *pResProvider = NULL;
+		if(!m_comMgr.CreateResProvider_ZIP((IObjRef**)&pResProvider)) return NULL;
+		ZIPRES_PARAM param;
+		param.ZipFile(NULL,m_strZip,NULL,NULL,bMapFile);
+		if(!pResProvider->Init((WPARAM)&param,0))
+		{
+			pResProvider->Release();
+			return NULL;
+		}
+		return pResProvider;
+	}
+
+	static bool ReadEqual(IResProvider *pResProvider,int iFile,const std::vector<BYTE> & data)
+	{
+		SStringT strName = SStringT().Format(_T("f%d"),iFile);
+		size_t szBuf = pResProvider->GetRawBufferSize(_T("raw"),strName);
+		if(szBuf != data.size()) return false;
+		std::vector<BYTE> buf(szBuf+1);
+		if(!pResProvider->GetRawBuffer(_T("raw"),strName,&buf[0],szBuf)) return false;
+		return memcmp(&buf[0],&data[0],szBuf)==0;
+	}
+
+	SComMgr  m_comMgr;
+	SStringT m_strZip;
+};
+
+TEST_F(ResProviderZipTest,ReadMatchesSource)
+{
+	std::vector<ZipTestEntry> entries;
+	MakeEntries(entries,50,1,20000);
+	ASSERT_TRUE(WriteTestZip(m_strZip,entries));
+
+	for(int iMode=0;iMode<2;iMode++)
+	{
+		CAutoRefPtr<IResProvider> pResProvider;
+		pResProvider.Attach(CreateProvider(iMode==1));
+		if(!pResProvider)
+		{
+			printf("resprovider-zip not available, skipped\n");
+			return;
+		}
+		for(int i=0;i<50;i++)
+		{
+			EXPECT_TRUE(ReadEqual(pResProvider,i,entries[i].data)) << "mode=" << iMode << " file=" << i;
+		}
+		EXPECT_FALSE(pResProvider->HasResource(_T("raw"),_T("f50")));
+		EXPECT_EQ((size_t)0,pResProvider->GetRawBufferSize(_T("raw"),_T("f50")));
+	}
+}
+
+static void AddEntry(std::vector<ZipTestEntry> & entries,const char *pszName,int nSize,bool bDeflate)
+{
+	ZipTestEntry e;
+	e.name = pszName;
+	e.data.resize(nSize);
+	for(int i=0;i<nSize;i++) e.data[i] = (BYTE)(rand()+i);
+	e.bDeflate = bDeflate;
+	entries.push_back(e);
+}
+
+//文件名不区分大小写, '/'与'\\'等价, 同名文件使用第一个; deflate文件解压后与源数据一致
+TEST_F(ResProviderZipTest,LookupAndDeflate)
+{
+	std::vector<ZipTestEntry> entries;
+	srand(2);
+	AddEntry(entries,"Raw/Upper.BIN",100,false);
+	AddEntry(entries,"raw\\back.bin",200,false);
+	AddEntry(entries,"raw/dup.bin",300,false);
+	AddEntry(entries,"RAW/DUP.bin",400,false);
+	AddEntry(entries,"raw/deflate.bin",150000,true);
+	AddEntry(entries,"raw/empty.bin",0,true);
+	std::string strIdx = "<resource><raw>"
+		"<file name=\"upper\" path=\"raw\\upper.bin\"/>"
+		"<file name=\"back\" path=\"raw/back.bin\"/>"
+		"<file name=\"dup\" path=\"raw\\dup.bin\"/>"
+		"<file name=\"dup2\" path=\"Raw/Dup.Bin\"/>"
+		"<file name=\"deflate\" path=\"RAW\\Deflate.bin\"/>"
+		"<file name=\"empty\" path=\"raw/empty.bin\"/>"
+		"<file name=\"missing\" path=\"raw/missing.bin\"/>"
+		"</raw></resource>";
+	ZipTestEntry idx;
+	idx.name = "uires.idx";
+	idx.data.assign(strIdx.begin(),strIdx.end());
+	entries.push_back(idx);
+	ASSERT_TRUE(WriteTestZip(m_strZip,entries));
+
+	//内存映射时deflate文件直接从映射的数据解压
+	for(int iMode=0;iMode<2;iMode++)
+	{
+		CAutoRefPtr<IResProvider> pResProvider;
+		pResProvider.Attach(CreateProvider(iMode==1));
+		if(!pResProvider)
+		{
+			printf("resprovider-zip not available, skipped\n");
+			return;
+		}
+		const struct {LPCTSTR pszName;int iEntry;} lookups[] = {
+			{_T("upper"),0},{_T("back"),1},{_T("dup"),2},{_T("dup2"),2},{_T("deflate"),4},
+		};
+		for(int i=0;i<ARRAYSIZE(lookups);i++)
+		{
+			const std::vector<BYTE> & data = entries[lookups[i].iEntry].data;
+			size_t szBuf = pResProvider->GetRawBufferSize(_T("raw"),lookups[i].pszName);
+			EXPECT_EQ(data.size(),szBuf) << "mode=" << iMode << " " << lookups[i].pszName;
+			std::vector<BYTE> buf(szBuf+1);
+			EXPECT_TRUE(pResProvider->GetRawBuffer(_T("raw"),lookups[i].pszName,&buf[0],szBuf)) << "mode=" << iMode << " " << lookups[i].pszName;
+			EXPECT_TRUE(szBuf == data.size() && memcmp(&buf[0],&data[0],szBuf)==0) << "mode=" << iMode << " " << lookups[i].pszName;
+		}
+		EXPECT_EQ((size_t)0,pResProvider->GetRawBufferSize(_T("raw"),_T("empty")));
+		EXPECT_EQ((size_t)0,pResProvider->GetRawBufferSize(_T("raw"),_T("missing")));
+		BYTE byBuf[4];
+		EXPECT_FALSE(pResProvider->GetRawBuffer(_T("raw"),_T("missing"),byBuf,sizeof(byBuf)));
+		//缓冲区不够时不解压
+		std::vector<BYTE> buf(entries[4].data.size()-1);
+		EXPECT_FALSE(pResProvider->GetRawBuffer(_T("raw"),_T("deflate"),&buf[0],buf.size()));
+	}
+}
+
+struct ZipReadThreadParam
+{
+	IResProvider * pResProvider;
+	const std::vector<ZipTestEntry> * pEntries;
+	int		nFiles;
+	int		iStart;
+	LONG	nErrors;
+};
+
+static DWORD WINAPI ZipReadThread(LPVOID pParam)
+{
+	ZipReadThreadParam *p = (ZipReadThreadParam*)pParam;
+	for(int k=0;k<p->nFiles;k++)
+	{
+		SStringT strName = SStringT().Format(_T("f%d"),(p->iStart+k)%p->nFiles);
+		const std::vector<BYTE> & data = (*p->pEntries)[(p->iStart+k)%p->nFiles].data;
+		std::vector<BYTE> buf(data.size());
+		if(!p->pResProvider->GetRawBuffer(_T("raw"),strName,&buf[0],buf.size())
+			|| memcmp(&buf[0],&data[0],buf.size())!=0)
+			p->nErrors++;
+	}
+	return 0;
+}
+
+//多个线程同时从同一个provider读取
+TEST_F(ResProviderZipTest,ConcurrentRead)
+{
+	const int nFiles = 200;
+	const int nThreads = 4;
+	std::vector<ZipTestEntry> entries;
+	MakeEntries(entries,nFiles,1,8000);
+	ASSERT_TRUE(WriteTestZip(m_strZip,entries));
+
+	for(int iMode=0;iMode<2;iMode++)
+	{
+		CAutoRefPtr<IResProvider> pResProvider;
+		pResProvider.Attach(CreateProvider(iMode==1));
+		if(!pResProvider) return;
+
+		ZipReadThreadParam params[nThreads];
+		HANDLE hThreads[nThreads];
+		for(int i=0;i<nThreads;i++)
+		{
+			params[i].pResProvider = pResProvider;
+			params[i].pEntries = &entries;
+			params[i].nFiles = nFiles;
+			params[i].iStart = i*nFiles/nThreads;
+			params[i].nErrors = 0;
+			hThreads[i] = CreateThread(NULL,0,ZipReadThread,params+i,0,NULL);
+		}
+		WaitForMultipleObjects(nThreads,hThreads,TRUE,INFINITE);
+		for(int i=0;i<nThreads;i++)
+		{
+			CloseHandle(hThreads[i]);
+			EXPECT_EQ(0,params[i].nErrors) << "mode=" << iMode << " thread=" << i;
+		}
+	}
+}
+
+//按优化前的方式读取: 顺序比较中心目录中的文件名, 移动文件指针读取本地文件头和数据到临时缓冲区, 再复制给调用者
+class BaselineZipReader
+{
+public:
+	BaselineZipReader(LPCTSTR pszZip)
+	{
+		InitializeCriticalSection(&m_cs);
+		m_hFile = CreateFile(pszZip,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		if(m_hFile == INVALID_HANDLE_VALUE) return;
+		DWORD dwSize = ::GetFileSize(m_hFile,NULL);
+		std::vector<BYTE> eocd(22);
+		SetFilePointer(m_hFile,dwSize-22,NULL,FILE_BEGIN);
+		ReadFile(m_hFile,&eocd[0],22,&dwSize,NULL);
+		WORD nEntries = *(WORD*)&eocd[10];
+		DWORD dwDirSize = *(DWORD*)&eocd[12];
+		m_dir.resize(dwDirSize);
+		SetFilePointer(m_hFile,*(DWORD*)&eocd[16],NULL,FILE_BEGIN);
+		ReadFile(m_hFile,&m_dir[0],dwDirSize,&dwSize,NULL);
+		for(DWORD pos=0;m_entries.size()<nEntries;)
+		{
+			const BYTE *p = &m_dir[pos];
+			DIRENTRY entry;
+			entry.strName = std::string((const char*)p+46,*(WORD*)(p+28));
+			for(size_t i=0;i<entry.strName.size();i++) if(entry.strName[i]=='/') entry.strName[i]='\\';
+			entry.dwOffset = *(DWORD*)(p+42);
+			m_entries.push_back(entry);
+			pos += 46 + *(WORD*)(p+28) + *(WORD*)(p+30) + *(WORD*)(p+32);
+		}
+	}
+
+	~BaselineZipReader()
+	{
+		if(m_hFile != INVALID_HANDLE_VALUE) CloseHandle(m_hFile);
+		DeleteCriticalSection(&m_cs);
+	}
+
+	BOOL GetRawBuffer(LPCSTR pszPath,LPVOID pBuf,size_t size)
+	{
+		EnterCriticalSection(&m_cs);
+		BOOL bRet = FALSE;
+		for(size_t i=0;i<m_entries.size();i++)
+		{
+			if(_stricmp(m_entries[i].strName.c_str(),pszPath)!=0) continue;
+			BYTE hdr[30];
+			DWORD dwRead = 0;
+			SetFilePointer(m_hFile,m_entries[i].dwOffset,NULL,FILE_BEGIN);
+			ReadFile(m_hFile,hdr,30,&dwRead,NULL);
+			DWORD dwDataSize = *(DWORD*)(hdr+18);
+			SetFilePointer(m_hFile,*(WORD*)(hdr+26) + *(WORD*)(hdr+28),NULL,FILE_CURRENT);
+			LPBYTE pData = new BYTE[dwDataSize];
+			ReadFile(m_hFile,pData,dwDataSize,&dwRead,NULL);
+			if(size >= dwDataSize)
+			{
+				memcpy(pBuf,pData,dwDataSize);
+				bRet = TRUE;
+			}
+			delete []pData;
+			break;
+		}
+		LeaveCriticalSection(&m_cs);
+		return bRet;
+	}
+
+protected:
+	struct DIRENTRY
+	{
+		std::string strName;
+		DWORD		dwOffset;
+	};
+	HANDLE m_hFile;
+	std::vector<BYTE> m_dir;
+	std::vector<DIRENTRY> m_entries;
+	CRITICAL_SECTION m_cs;
+};
+
+BENCHMARK_TEST_F(ResProviderZipTest,Benchmark)
+{
+	const int nFiles = 10000;
+	const int nWarmLoop = 3;
+	const int nLookupLoop = 10;
+	std::vector<ZipTestEntry> entries;
+	MakeEntries(entries,nFiles,256,8192);
+	ASSERT_TRUE(WriteTestZip(m_strZip,entries));
+
+	size_t szTotal = 0;
+	for(int i=0;i<nFiles;i++) szTotal += entries[i].data.size();
+	std::vector<BYTE> buf(8192);
+	SStringT *pNames = new SStringT[nFiles];
+	for(int i=0;i<nFiles;i++) pNames[i].Format(_T("f%d"),i);
+
+	//优化前的实现: 每次读取都顺序查找文件名
+	{
+		std::vector<std::string> paths(nFiles);
+		char szPath[64];
+		for(int i=0;i<nFiles;i++)
+		{
+			sprintf(szPath,"raw\\f%d.bin",i);
+			paths[i] = szPath;
+		}
+		LARGE_INTEGER t0,t1,t2,t3;
+		QueryPerformanceCounter(&t0);
+		BaselineZipReader reader(m_strZip);
+		QueryPerformanceCounter(&t1);
+		for(int i=0;i<nFiles;i++)
+			reader.GetRawBuffer(paths[i].c_str(),&buf[0],buf.size());
+		QueryPerformanceCounter(&t2);
+		for(int k=0;k<nWarmLoop;k++) for(int i=0;i<nFiles;i++)
+			reader.GetRawBuffer(paths[i].c_str(),&buf[0],buf.size());
+		QueryPerformanceCounter(&t3);
+		double fCold = ElapsedMs(t1,t2), fWarm = ElapsedMs(t2,t3)/nWarmLoop;
+		BenchmarkPrintf("baseline: open %.1fms, cold read %.1fms (%.0fMB/s), warm read %.1fms (%.0fMB/s)\n",
+			ElapsedMs(t0,t1),
+			fCold,szTotal/1024.0/1024.0/(fCold/1000.0),
+			fWarm,szTotal/1024.0/1024.0/(fWarm/1000.0));
+	}
+
+	for(int iMode=0;iMode<2;iMode++)
+	{
+		LARGE_INTEGER t0,t1,t2,t3,t4;
+		QueryPerformanceCounter(&t0);
+		CAutoRefPtr<IResProvider> pResProvider;
+		pResProvider.Attach(CreateProvider(iMode==1));
+		if(!pResProvider) break;
+		QueryPerformanceCounter(&t1);
+		//冷: 打开后第一次读取每个文件(刚写入的文件通常还在系统缓存中)
+		for(int i=0;i<nFiles;i++)
+			pResProvider->GetRawBuffer(_T("raw"),pNames[i],&buf[0],buf.size());
+		QueryPerformanceCounter(&t2);
+		for(int k=0;k<nWarmLoop;k++) for(int i=0;i<nFiles;i++)
+			pResProvider->GetRawBuffer(_T("raw"),pNames[i],&buf[0],buf.size());
+		QueryPerformanceCounter(&t3);
+		for(int k=0;k<nLookupLoop;k++) for(int i=0;i<nFiles;i++)
+			pResProvider->GetRawBufferSize(_T("raw"),pNames[i]);
+		QueryPerformanceCounter(&t4);
+
+		double fCold = ElapsedMs(t1,t2), fWarm = ElapsedMs(t2,t3)/nWarmLoop;
+		BenchmarkPrintf("%s: open %.1fms, cold read %.1fms (%.0fMB/s), warm read %.1fms (%.0fMB/s), lookup %.0fns/op\n",
+			iMode==1?"mmap    ":"handle  ",ElapsedMs(t0,t1),
+			fCold,szTotal/1024.0/1024.0/(fCold/1000.0),
+			fWarm,szTotal/1024.0/1024.0/(fWarm/1000.0),
+			ElapsedMs(t3,t4)*1000000.0/(nLookupLoop*nFiles));
+	}
+	delete []pNames;
+}
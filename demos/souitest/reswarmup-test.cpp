@@ -0,0 +1,258 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <res.mgr/SResProviderMgr.h>
+#include <res.mgr/SResWarmup.h>
+#include <stdio.h>
+
+using namespace SOUI;
+
+//录制清单, 回放后UI线程读取的资源必须来自预加载结果
+
+//内存中的资源包, 记录UI线程读取的次数; hBlock不为NULL时工作线程读取前等待该事件
+class SMemResProvider : public TObjRefImpl<IResProvider>
+{
+public:
+	SMemResProvider():m_dwUiThread(GetCurrentThreadId()),m_nUiReads(0),m_nWorkerReads(0),m_hBlock(NULL){}
+
+	void AddRes(LPCTSTR pszType,LPCTSTR pszResName,const SStringA & strData)
+	{
+		m_mapRes[SResID(pszType,pszResName)] = strData;
+	}
+
+	virtual BOOL Init(WPARAM wParam,LPARAM lParam){return TRUE;}
+
+	virtual BOOL HasResource(LPCTSTR pszType,LPCTSTR pszResName)
+	{
+		return m_mapRes.Lookup(SResID(pszType,pszResName)) != NULL;
+	}
+
+	virtual HICON LoadIcon(LPCTSTR pszResName,int cx=0,int cy=0){return NULL;}
+	virtual HBITMAP LoadBitmap(LPCTSTR pszResName){return NULL;}
+	virtual HCURSOR LoadCursor(LPCTSTR pszResName){return NULL;}
+	virtual IBitmap * LoadImage(LPCTSTR pszType,LPCTSTR pszResName){return NULL;}
+	virtual IImgX   * LoadImgX(LPCTSTR pszType,LPCTSTR pszResName){return NULL;}
+
+	virtual size_t GetRawBufferSize(LPCTSTR pszType,LPCTSTR pszResName)
+	{
+		const SMap<SResID,SStringA>::CPair *p = m_mapRes.Lookup(SResID(pszType,pszResName));
+		return p?p->m_value.GetLength():0;
+	}
+
+	virtual BOOL GetRawBuffer(LPCTSTR pszType,LPCTSTR pszResName,LPVOID pBuf,size_t size)
+	{
+		if(GetCurrentThreadId() == m_dwUiThread)
+		{
+			m_nUiReads++;
+		}else
+		{
+			if(m_hBlock) WaitForSingleObject(m_hBlock,INFINITE);
+			InterlockedIncrement(&m_nWorkerReads);
+		}
+		const SMap<SResID,SStringA>::CPair *p = m_mapRes.Lookup(SResID(pszType,pszResName));
+		if(!p || size < (size_t)p->m_value.GetLength()) return FALSE;
+		memcpy(pBuf,(LPCSTR)p->m_value,p->m_value.GetLength());
+		return TRUE;
+	}
+
+	DWORD m_dwUiThread;
+	int   m_nUiReads;
+	volatile LONG m_nWorkerReads;
+	HANDLE m_hBlock;
+protected:
+	SMap<SResID,SStringA> m_mapRes;
+};
+
+static SStringA ReadRaw(SResProviderMgr & mgr,LPCTSTR pszType,LPCTSTR pszResName)
+{
+	size_t szBuf = mgr.GetRawBufferSize(pszType,pszResName);
+	if(szBuf == 0) return "";
+	SStringA strRet;
+	char *pBuf = strRet.GetBufferSetLength((int)szBuf);
+	BOOL bOK = mgr.GetRawBuffer(pszType,pszResName,pBuf,szBuf);
+	strRet.ReleaseBuffer((int)szBuf);
+	return bOK?strRet:"";
+}
+
+class ResWarmupTest : public testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		TCHAR szTmp[MAX_PATH];
+		GetTempPath(MAX_PATH,szTmp);
+		m_strManifest.Format(_T("%ssouitest-warmup-%u.xml"),szTmp,GetCurrentProcessId());
+
+		m_pProvider = new SMemResProvider;
+		m_pProvider->AddRes(_T("layout"),_T("main"),"<SOUI><root/></SOUI>");
+		m_pProvider->AddRes(_T("layout"),_T("dlg"),"<SOUI><root width=\"100\"/></SOUI>");
+		m_pProvider->AddRes(_T("values"),_T("string"),"<string/>");
+	}
+
+	virtual void TearDown()
+	{
+		m_pProvider->Release();
+		DeleteFile(m_strManifest);
+	}
+
+	//模拟第一帧: 读取两个布局, 其中一个读两次
+	void Record()
+	{
+		SResProviderMgr mgr;
+		mgr.AddResProvider(m_pProvider,NULL);
+		SResWarmup warmup(&mgr);
+		ASSERT_TRUE(warmup.StartRecord(m_strManifest));
+		ReadRaw(mgr,_T("layout"),_T("main"));
+		ReadRaw(mgr,_T("LAYOUT"),_T("Main"));
+		ReadRaw(mgr,_T("layout"),_T("dlg"));
+		ReadRaw(mgr,_T("layout"),_T("none"));
+		ASSERT_TRUE(warmup.StopRecord());
+
+		WARMUPSTATS stats;
+		warmup.GetStats(&stats);
+		EXPECT_EQ(3,stats.nRecorded);
+		//停止后不再录制
+		ReadRaw(mgr,_T("values"),_T("string"));
+		warmup.GetStats(&stats);
+		EXPECT_EQ(3,stats.nRecorded);
+	}
+
+	SStringT m_strManifest;
+	SMemResProvider * m_pProvider;
+};
+
+TEST_F(ResWarmupTest,ReplayServesWarmedData)
+{
+	Record();
+
+	SResProviderMgr mgr;
+	mgr.AddResProvider(m_pProvider,NULL);
+	SResWarmup warmup(&mgr);
+	m_pProvider->m_nUiReads = 0;
+	m_pProvider->m_nWorkerReads = 0;
+	EXPECT_EQ(3,warmup.Replay(m_strManifest,NULL,2));
+	EXPECT_TRUE(warmup.Wait(5000));
+
+	WARMUPSTATS stats;
+	warmup.GetStats(&stats);
+	EXPECT_EQ(3,stats.nEntries);
+	EXPECT_EQ(2,stats.nReady);//layout:none不存在
+	EXPECT_EQ(2,m_pProvider->m_nWorkerReads);
+
+	EXPECT_EQ(SStringA("<SOUI><root/></SOUI>"),ReadRaw(mgr,_T("layout"),_T("main")));
+	EXPECT_EQ(SStringA("<SOUI><root width=\"100\"/></SOUI>"),ReadRaw(mgr,_T("Layout"),_T("DLG")));
+	EXPECT_EQ(0,m_pProvider->m_nUiReads);
+	warmup.GetStats(&stats);
+	EXPECT_EQ(2,stats.nHits);
+	EXPECT_EQ(0,stats.nMisses);
+
+	//取走后再读从资源包读取
+	EXPECT_EQ(SStringA("<SOUI><root/></SOUI>"),ReadRaw(mgr,_T("layout"),_T("main")));
+	EXPECT_EQ(1,m_pProvider->m_nUiReads);
+	//不在清单中的资源
+	EXPECT_EQ(SStringA("<string/>"),ReadRaw(mgr,_T("values"),_T("string")));
+	EXPECT_EQ(2,m_pProvider->m_nUiReads);
+	warmup.GetStats(&stats);
+	EXPECT_EQ(2,stats.nHits);
+}
+
+//预加载还没有完成时UI线程不等待, 自己从资源包读取
+TEST_F(ResWarmupTest,PendingEntryIsNotAwaited)
+{
+	Record();
+
+	SResProviderMgr mgr;
+	mgr.AddResProvider(m_pProvider,NULL);
+	SResWarmup warmup(&mgr);
+	m_pProvider->m_nUiReads = 0;
+	m_pProvider->m_hBlock = CreateEvent(NULL,TRUE,FALSE,NULL);
+	EXPECT_EQ(3,warmup.Replay(m_strManifest,NULL,1));
+
+	EXPECT_EQ(SStringA("<SOUI><root/></SOUI>"),ReadRaw(mgr,_T("layout"),_T("main")));
+	EXPECT_EQ(SStringA("<SOUI><root width=\"100\"/></SOUI>"),ReadRaw(mgr,_T("layout"),_T("dlg")));
+	EXPECT_EQ(2,m_pProvider->m_nUiReads);
+
+	SetEvent(m_pProvider->m_hBlock);
+	EXPECT_TRUE(warmup.Wait(5000));
+	CloseHandle(m_pProvider->m_hBlock);
+	m_pProvider->m_hBlock = NULL;
+
+	WARMUPSTATS stats;
+	warmup.GetStats(&stats);
+	EXPECT_EQ(0,stats.nHits);
+	EXPECT_EQ(2,stats.nMisses);
+	EXPECT_EQ(0,stats.nReady);
+}
+
+//2x2的PNG: 红, 绿 / 蓝, 白, 不透明
+static const BYTE KTestPng[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,
+	0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x02,0x08,0x06,0x00,0x00,0x00,0x72,0xB6,0x0D,
+	0x24,0x00,0x00,0x00,0x12,0x49,0x44,0x41,0x54,0x78,0xDA,0x63,0xF8,0xCF,0xC0,0xF0,
+	0x1F,0x0C,0x81,0x34,0x18,0x00,0x00,0x49,0xC8,0x09,0xF7,0x03,0xD9,0x64,0xF1,0x00,
+	0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82
+};
+
+//回放时用真实的解码器在工作线程中解码图片, UI线程的LoadImage取走解码结果
+TEST_F(ResWarmupTest,ReplayDecodesImages)
+{
+	SComMgr comMgr(_T("imgdecoder-png"));
+	CAutoRefPtr<IRenderFactory> pRenderFactory;
+	CAutoRefPtr<IImgDecoderFactory> pDecoderFactory;
+	comMgr.CreateRender_Skia((IObjRef**)&pRenderFactory);
+	comMgr.CreateImgDecoder((IObjRef**)&pDecoderFactory);
+	if(!pRenderFactory || !pDecoderFactory)
+	{
+		printf("render-skia or imgdecoder-png not available, skipped\n");
+		return;
+	}
+	pRenderFactory->SetImgDecoderFactory(pDecoderFactory);
+
+	m_pProvider->AddRes(_T("png"),_T("logo"),SStringA((const char*)KTestPng,sizeof(KTestPng)));
+	m_pProvider->AddRes(_T("png"),_T("broken"),"not a png");
+	{
+		SResProviderMgr mgr;
+		mgr.AddResProvider(m_pProvider,NULL);
+		SResWarmup warmup(&mgr);
+		ASSERT_TRUE(warmup.StartRecord(m_strManifest));
+		//测试资源包的LoadImage总是返回NULL
+		EXPECT_TRUE(mgr.LoadImage(_T("png"),_T("logo")) == NULL);
+		EXPECT_TRUE(mgr.LoadImage(_T("png"),_T("broken")) == NULL);
+		ReadRaw(mgr,_T("layout"),_T("main"));
+		ASSERT_TRUE(warmup.StopRecord());
+	}
+
+	SResProviderMgr mgr;
+	mgr.AddResProvider(m_pProvider,NULL);
+	SResWarmup warmup(&mgr);
+	EXPECT_EQ(3,warmup.Replay(m_strManifest,pRenderFactory,2));
+	EXPECT_TRUE(warmup.Wait(5000));
+
+	WARMUPSTATS stats;
+	warmup.GetStats(&stats);
+	EXPECT_EQ(2,stats.nReady);//无法解码的图片不算完成
+
+	//资源包不能加载图片, 返回的图片只能来自预解码的结果
+	CAutoRefPtr<IBitmap> pImg;
+	pImg.Attach(mgr.LoadImage(_T("PNG"),_T("Logo")));
+	ASSERT_TRUE(pImg != NULL);
+	ASSERT_EQ(2,pImg->Width());
+	ASSERT_EQ(2,pImg->Height());
+	const DWORD *pBits = (const DWORD*)pImg->GetPixelBits();
+	EXPECT_EQ(0xFFFF0000,pBits[0]);
+	EXPECT_EQ(0xFF00FF00,pBits[1]);
+	EXPECT_EQ(0xFF0000FF,pBits[2]);
+	EXPECT_EQ(0xFFFFFFFF,pBits[3]);
+	EXPECT_TRUE(mgr.LoadImage(_T("png"),_T("broken")) == NULL);
+
+	warmup.GetStats(&stats);
+	EXPECT_EQ(1,stats.nHits);
+
+	//取走后加入图片缓存, 不再经过预加载
+	CAutoRefPtr<IBitmap> pCached;
+	pCached.Attach(mgr.LoadImage(_T("png"),_T("logo")));
+	EXPECT_TRUE(pCached == pImg);
+	warmup.GetStats(&stats);
+	EXPECT_EQ(1,stats.nHits);
+}
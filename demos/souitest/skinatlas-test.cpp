@@ -0,0 +1,177 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <res.mgr/SSkinAtlas.h>
+#include <res.mgr/SResProviderMgr.h>
+#include "rendertest.h"
+
+using namespace SOUI;
+
+//小图片合并: 大图中的位置, 边缘复制, 合并后的绘制结果与合并前一致
+
+class SkinAtlasTest : public RenderTest
+{
+};
+
+//图片放在大图中互不重叠, 像素与源图片一致
+TEST_F(SkinAtlasTest,PackedRect)
+{
+	SKIP_IF_NO_RENDER();
+	SSkinAtlas atlas(64,32);
+	const SIZE sizes[] = {{16,16},{20,8},{8,20},{30,30},{5,3},{16,16}};
+	const int nImages = ARRAYSIZE(sizes);
+	CAutoRefPtr<IBitmap> pImgs[nImages];
+	CAutoRefPtr<IBitmap> pPages[nImages];
+	CRect rcImgs[nImages];
+	for(int i=0;i<nImages;i++)
+	{
+		pImgs[i].Attach(CreateTestBitmap(sizes[i].cx,sizes[i].cy,i));
+		ASSERT_TRUE(atlas.Add(pImgs[i],&pPages[i],&rcImgs[i]));
+		EXPECT_EQ(sizes[i].cx,rcImgs[i].Width());
+		EXPECT_EQ(sizes[i].cy,rcImgs[i].Height());
+		//四周留出边缘
+		EXPECT_GE(rcImgs[i].left,1);
+		EXPECT_GE(rcImgs[i].top,1);
+		EXPECT_LE(rcImgs[i].right,63);
+		EXPECT_LE(rcImgs[i].bottom,63);
+	}
+
+	for(int i=0;i<nImages;i++)
+	{
+		for(int j=i+1;j<nImages;j++)
+		{
+			if(pPages[i] != pPages[j]) continue;
+			CRect rc1 = rcImgs[i],rc2 = rcImgs[j],rcInter;
+			rc1.InflateRect(1,1);
+			rc2.InflateRect(1,1);
+			EXPECT_FALSE(rcInter.IntersectRect(rc1,rc2)) << i << " overlaps " << j;
+		}
+		for(int y=0;y<sizes[i].cy;y++) for(int x=0;x<sizes[i].cx;x++)
+		{
+			ASSERT_EQ(PixelAt(pImgs[i],x,y),PixelAt(pPages[i],rcImgs[i].left+x,rcImgs[i].top+y));
+		}
+	}
+
+	SKINATLASSTATS stats;
+	atlas.GetStats(&stats);
+	EXPECT_EQ(nImages,stats.nImages);
+	EXPECT_EQ(nImages-stats.nPages,stats.nBitmapsSaved);
+	EXPECT_GT(stats.fFillRatio,0.0f);
+	EXPECT_LE(stats.fFillRatio,1.0f);
+
+	//太大的图片不合并
+	CAutoRefPtr<IBitmap> pBig,pPage;
+	pBig.Attach(CreateTestBitmap(33,8,0));
+	CRect rc;
+	EXPECT_FALSE(atlas.Add(pBig,&pPage,&rc));
+}
+
+//边缘复制图片最外圈的像素, 包括四个角
+TEST_F(SkinAtlasTest,BorderBleed)
+{
+	SKIP_IF_NO_RENDER();
+	SSkinAtlas atlas(64,32);
+	CAutoRefPtr<IBitmap> pImg,pPage;
+	pImg.Attach(CreateTestBitmap(10,7,3));
+	CRect rc;
+	ASSERT_TRUE(atlas.Add(pImg,&pPage,&rc));
+
+	for(int x=-1;x<=10;x++)
+	{
+		int xSrc = smin(smax(x,0),9);
+		EXPECT_EQ(PixelAt(pImg,xSrc,0),PixelAt(pPage,rc.left+x,rc.top-1)) << "x=" << x;
+		EXPECT_EQ(PixelAt(pImg,xSrc,6),PixelAt(pPage,rc.left+x,rc.bottom)) << "x=" << x;
+	}
+	for(int y=0;y<7;y++)
+	{
+		EXPECT_EQ(PixelAt(pImg,0,y),PixelAt(pPage,rc.left-1,rc.top+y)) << "y=" << y;
+		EXPECT_EQ(PixelAt(pImg,9,y),PixelAt(pPage,rc.right,rc.top+y)) << "y=" << y;
+	}
+}
+
+//合并前后skin的绘制结果一致, 包括拉伸和多状态
+TEST_F(SkinAtlasTest,SameAsUnpackedDraw)
+{
+	SKIP_IF_NO_RENDER();
+	SSkinAtlas atlas(128,64);
+	//先放一张图片, 让被测的skin不在大图的原点
+	CAutoRefPtr<IBitmap> pOther,pOtherPage;
+	pOther.Attach(CreateTestBitmap(12,12,9));
+	CRect rcOther;
+	ASSERT_TRUE(atlas.Add(pOther,&pOtherPage,&rcOther));
+
+	CAutoRefPtr<IBitmap> pImg;
+	pImg.Attach(CreateTestBitmap(32,16,5));
+	SSkinImgList *pSkin = new SSkinImgList;
+	pSkin->SetImage(pImg);
+	pSkin->SetAttribute(SStringW(L"states"),SStringW(L"2"),FALSE);
+	pSkin->SetAttribute(SStringW(L"filterLevel"),SStringW(L"low"),FALSE);
+
+	const CRect rcDraws[] = {CRect(0,0,16,16),CRect(3,5,43,37),CRect(0,0,9,6)};
+	const int nDraws = ARRAYSIZE(rcDraws);
+	CAutoRefPtr<IRenderTarget> pRTRef[nDraws][2];
+	for(int i=0;i<nDraws;i++) for(int iState=0;iState<2;iState++)
+	{
+		pRTRef[i][iState].Attach(CreateRT(48,48));
+		pSkin->Draw(pRTRef[i][iState],rcDraws[i],iState,0xFF);
+	}
+
+	ASSERT_TRUE(pSkin->PackToAtlas(&atlas));
+	EXPECT_TRUE(pSkin->GetImage() == pOtherPage);
+	EXPECT_EQ(CSize(16,16),CSize(pSkin->GetSkinSize()));
+
+	for(int i=0;i<nDraws;i++) for(int iState=0;iState<2;iState++)
+	{
+		CAutoRefPtr<IRenderTarget> pRT;
+		pRT.Attach(CreateRT(48,48));
+		pSkin->Draw(pRT,rcDraws[i],iState,0xFF);
+		//原大小时逐像素一致, 拉伸时边缘复制保证不会采样到相邻的图片
+		EXPECT_TRUE(SamePixels(pRTRef[i][iState],pRT,1)) << "draw " << i << " state " << iState;
+	}
+	pSkin->Release();
+}
+
+//合并后从图片缓存中删除源图片, 只统计实际释放的字节数
+TEST_F(SkinAtlasTest,ReleasesCachedSource)
+{
+	SKIP_IF_NO_RENDER();
+	SSkinAtlas atlas(64,32);
+	SResProviderMgr mgr;
+	IBitmap *pImg = CreateTestBitmap(16,8,2);
+	mgr.AddCachedImage(_T("img"),_T("src"),100,pImg);
+	mgr.AddCachedImage(_T("img"),_T("src"),150,pImg);
+	SSkinImgList *pSkin = new SSkinImgList;
+	pSkin->SetImage(pImg);
+	pImg->Release();
+
+	ASSERT_TRUE(pSkin->PackToAtlas(&atlas,&mgr));
+	IBitmap *pCached = mgr.FindCachedImage(_T("img"),_T("src"),100);
+	EXPECT_TRUE(pCached == NULL);
+	if(pCached) pCached->Release();
+	pCached = mgr.FindCachedImage(_T("img"),_T("src"),150);
+	EXPECT_TRUE(pCached == NULL);
+	if(pCached) pCached->Release();
+	IMAGECACHESTATS cacheStats;
+	mgr.GetImageCacheStats(&cacheStats);
+	EXPECT_EQ(0,cacheStats.nCount);
+	EXPECT_EQ(0u,cacheStats.szBytes);
+
+	SKINATLASSTATS stats;
+	atlas.GetStats(&stats);
+	EXPECT_EQ(16u*8*4,stats.szReleasedBytes);
+	EXPECT_EQ((INT64)stats.szReleasedBytes-(INT64)stats.szPageBytes,stats.nBytesSaved);
+
+	//源图片还有其它引用时不计入
+	CAutoRefPtr<IBitmap> pShared;
+	pShared.Attach(CreateTestBitmap(16,8,3));
+	SSkinImgList *pSkin2 = new SSkinImgList;
+	pSkin2->SetImage(pShared);
+	ASSERT_TRUE(pSkin2->PackToAtlas(&atlas,&mgr));
+	atlas.GetStats(&stats);
+	EXPECT_EQ(16u*8*4,stats.szReleasedBytes);
+	EXPECT_EQ(2,stats.nImages);
+
+	pSkin2->Release();
+	pSkin->Release();
+}
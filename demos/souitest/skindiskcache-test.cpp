@@ -0,0 +1,151 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <com-cfg.h>
+#include <res.mgr/SSkinDiskCache.h>
+#include "rendertest.h"
+
+using namespace SOUI;
+
+//缩放后的skin图片的磁盘缓存: 命中, 源图片变化后失效, 拒绝截断或损坏的缓存文件
+
+class SkinDiskCacheTest : public RenderTest
+{
+protected:
+	virtual void SetUp()
+	{
+		TCHAR szTemp[MAX_PATH];
+		GetTempPath(MAX_PATH,szTemp);
+		m_strDir = SStringT(szTemp) + _T("souitest_skincache");
+		m_pCache = new SSkinDiskCache;
+		m_pCache->SetCacheDir(m_strDir);
+		m_pCache->Clear();
+		if(!s_pRenderFactory) return;
+
+		m_pSrc.Attach(CreateTestBitmap(16,16,1));
+		m_pDest.Attach(CreateTestBitmap(24,24,7));
+	}
+
+	virtual void TearDown()
+	{
+		m_pCache->Clear();
+		delete m_pCache;
+		RemoveDirectory(m_strDir);
+	}
+
+	//缓存目录中唯一的缓存文件
+	SStringT FindCacheFile()
+	{
+		WIN32_FIND_DATA wfd;
+		HANDLE hFind = FindFirstFile(m_strDir + _T("\\*.sks"),&wfd);
+		if(hFind == INVALID_HANDLE_VALUE) return SStringT();
+		FindClose(hFind);
+		return m_strDir + _T("\\") + wfd.cFileName;
+	}
+
+	//修改缓存文件: 从dwOffset开始写入数据, 或者截断到dwOffset
+	static void PatchFile(const SStringT & strFile,DWORD dwOffset,const void *pData,DWORD cbData)
+	{
+		HANDLE hFile = CreateFile(strFile,GENERIC_WRITE,0,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		ASSERT_NE(INVALID_HANDLE_VALUE,hFile);
+		SetFilePointer(hFile,dwOffset,NULL,FILE_BEGIN);
+		if(pData)
+		{
+			DWORD dwWrite = 0;
+			WriteFile(hFile,pData,cbData,&dwWrite,NULL);
+		}else
+		{
+			SetEndOfFile(hFile);
+		}
+		CloseHandle(hFile);
+	}
+
+	SSkinDiskCache * m_pCache;
+	SStringT m_strDir;
+	CAutoRefPtr<IBitmap> m_pSrc;
+	CAutoRefPtr<IBitmap> m_pDest;
+};
+
+TEST_F(SkinDiskCacheTest,HitAndMiss)
+{
+	SKIP_IF_NO_RENDER();
+	ASSERT_TRUE(m_pCache->IsEnabled());
+
+	CSize szDest(24,24);
+	CAutoRefPtr<IBitmap> pLoad;
+	EXPECT_FALSE(m_pCache->LoadScaledImage(m_pSrc,szDest,kHigh_FilterLevel,&pLoad));
+
+	EXPECT_TRUE(m_pCache->SaveScaledImage(m_pSrc,kHigh_FilterLevel,m_pDest));
+	ASSERT_TRUE(m_pCache->LoadScaledImage(m_pSrc,szDest,kHigh_FilterLevel,&pLoad));
+	EXPECT_TRUE(SamePixels(pLoad,m_pDest));
+
+	//大小和过滤等级都是key的一部分
+	CAutoRefPtr<IBitmap> pOther;
+	EXPECT_FALSE(m_pCache->LoadScaledImage(m_pSrc,CSize(24,23),kHigh_FilterLevel,&pOther));
+	EXPECT_FALSE(m_pCache->LoadScaledImage(m_pSrc,szDest,kLow_FilterLevel,&pOther));
+
+	//禁用后不读也不写
+	m_pCache->SetCacheDir(NULL);
+	EXPECT_FALSE(m_pCache->IsEnabled());
+	EXPECT_FALSE(m_pCache->LoadScaledImage(m_pSrc,szDest,kHigh_FilterLevel,&pOther));
+	EXPECT_FALSE(m_pCache->SaveScaledImage(m_pSrc,kHigh_FilterLevel,m_pDest));
+	m_pCache->SetCacheDir(m_strDir);
+}
+
+//源图片内容变化后旧的缓存不再命中
+TEST_F(SkinDiskCacheTest,SourceChanged)
+{
+	SKIP_IF_NO_RENDER();
+
+	CSize szDest(24,24);
+	EXPECT_TRUE(m_pCache->SaveScaledImage(m_pSrc,kHigh_FilterLevel,m_pDest));
+
+	CAutoRefPtr<IBitmap> pChanged;
+	pChanged.Attach(CreateTestBitmap(16,16,1));
+	DWORD *pBits = (DWORD*)pChanged->LockPixelBits();
+	pBits[100] ^= 0x00010000;
+	pChanged->UnlockPixelBits(pBits);
+
+	CAutoRefPtr<IBitmap> pLoad;
+	EXPECT_FALSE(m_pCache->LoadScaledImage(pChanged,szDest,kHigh_FilterLevel,&pLoad));
+	EXPECT_TRUE(m_pCache->LoadScaledImage(m_pSrc,szDest,kHigh_FilterLevel,&pLoad));
+}
+
+TEST_F(SkinDiskCacheTest,RejectTruncatedFile)
+{
+	SKIP_IF_NO_RENDER();
+
+	CSize szDest(24,24);
+	EXPECT_TRUE(m_pCache->SaveScaledImage(m_pSrc,kHigh_FilterLevel,m_pDest));
+	SStringT strFile = FindCacheFile();
+	ASSERT_FALSE(strFile.IsEmpty());
+
+	//只剩文件头和一半的像素
+	PatchFile(strFile,24*12*4+40,NULL,0);
+	CAutoRefPtr<IBitmap> pLoad;
+	EXPECT_FALSE(m_pCache->LoadScaledImage(m_pSrc,szDest,kHigh_FilterLevel,&pLoad));
+	EXPECT_TRUE(pLoad == NULL);
+	//无效的文件被删除
+	EXPECT_EQ(INVALID_FILE_ATTRIBUTES,GetFileAttributes(strFile));
+}
+
+TEST_F(SkinDiskCacheTest,RejectCorruptHeader)
+{
+	SKIP_IF_NO_RENDER();
+
+	CSize szDest(24,24);
+	//依次破坏magic, 版本, 源图片hash及源图片大小
+	const DWORD offsets[] = {0,4,8,16};
+	for(int i=0;i<ARRAYSIZE(offsets);i++)
+	{
+		EXPECT_TRUE(m_pCache->SaveScaledImage(m_pSrc,kHigh_FilterLevel,m_pDest));
+		SStringT strFile = FindCacheFile();
+		ASSERT_FALSE(strFile.IsEmpty());
+
+		DWORD dwBad = 0xDEADBEEF;
+		PatchFile(strFile,offsets[i],&dwBad,sizeof(dwBad));
+		CAutoRefPtr<IBitmap> pLoad;
+		EXPECT_FALSE(m_pCache->LoadScaledImage(m_pSrc,szDest,kHigh_FilterLevel,&pLoad)) << "offset=" << offsets[i];
+		EXPECT_EQ(INVALID_FILE_ATTRIBUTES,GetFileAttributes(strFile)) << "offset=" << offsets[i];
+	}
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <stdarg.h>
+
+//性能对比测试以DISABLED_开头, 默认不运行, 运行方法:
+//souitest --gtest_also_run_disabled_tests --gtest_filter=<测试名>.DISABLED_*
+#define BENCHMARK_TEST(test_case_name,test_name)	TEST(test_case_name,DISABLED_##test_name)
+#define BENCHMARK_TEST_F(test_fixture,test_name)	TEST_F(test_fixture,DISABLED_##test_name)
+
+//两次QueryPerformanceCounter之间的毫秒数
+inline double ElapsedMs(LARGE_INTEGER t1,LARGE_INTEGER t2)
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (t2.QuadPart-t1.QuadPart)*1000.0/freq.QuadPart;
+}
+
+//输出一行对比结果, 加上与gtest输出对齐的前缀
+inline void BenchmarkPrintf(const char *pszFormat,...)
+{
+	va_list args;
+	va_start(args,pszFormat);
+	printf("[ BENCH    ] ");
+	vprintf(pszFormat,args);
+	va_end(args);
+	fflush(stdout);
+}
@@ -32,7 +32,27 @@ DEFINES += _VARIADIC_MAX=10
 
 # Input
 SOURCES += souitest.cpp \
-           slog-test.cpp
+           slog-test.cpp \
+           pixelkernels-test.cpp \
+           render-skia-test.cpp \
+           resprovider-zip-test.cpp \
+           resprovider-7zip-test.cpp \
+           resprovider-mgr-test.cpp \
+           reswarmup-test.cpp \
+           resprovider-pack-test.cpp \
+           profiler-test.cpp \
+           timerwheel-test.cpp \
+           frameclock-test.cpp \
+           animation-test.cpp \
+           skindiskcache-test.cpp \
+           skinatlas-test.cpp \
+           apng-test.cpp \
+           testzip.cpp \
+           rendertest.cpp
+
+HEADERS += testzip.h \
+           souitest-bench.h \
+           rendertest.h
 
 
 
@@ -0,0 +1,75 @@
+﻿#include <souistd.h>
+#include <stdio.h>
+#include "testzip.h"
+
+using namespace SOUI;
+
+static void PutU16(std::vector<BYTE> & buf,WORD v)
+{
+	buf.push_back((BYTE)v);
+	buf.push_back((BYTE)(v>>8));
+}
+
+static void PutU32(std::vector<BYTE> & buf,DWORD v)
+{
+	PutU16(buf,(WORD)v);
+	PutU16(buf,(WORD)(v>>16));
+}
+
+//用不压缩的块组成的deflate流, 不依赖zlib也能走解压的路径
+static void DeflateStored(const std::vector<BYTE> & data,std::vector<BYTE> & out)
+{
+	size_t pos = 0;
+	do
+	{
+		WORD n = (WORD)smin(data.size()-pos,(size_t)0xFFFF);
+		out.push_back(pos+n==data.size()?1:0);
+		PutU16(out,n);
+		PutU16(out,(WORD)~n);
+		if(n) out.insert(out.end(),data.begin()+pos,data.begin()+pos+n);
+		pos += n;
+	}while(pos<data.size());
+}
+
+bool WriteTestZip(LPCTSTR pszFile,const std::vector<ZipTestEntry> & entries)
+{
+	std::vector<BYTE> buf,dir;
+	for(size_t i=0;i<entries.size();i++)
+	{
+		const ZipTestEntry & e = entries[i];
+		std::vector<BYTE> deflated;
+		if(e.bDeflate) DeflateStored(e.data,deflated);
+		const std::vector<BYTE> & body = e.bDeflate?deflated:e.data;
+		WORD wMethod = e.bDeflate?8:0;
+		DWORD dwOffset = (DWORD)buf.size();
+		PutU32(buf,0x04034b50);
+		PutU16(buf,20);PutU16(buf,0);PutU16(buf,wMethod);
+		PutU16(buf,0);PutU16(buf,0x21);
+		PutU32(buf,0);PutU32(buf,(DWORD)body.size());PutU32(buf,(DWORD)e.data.size());
+		PutU16(buf,(WORD)e.name.size());PutU16(buf,0);
+		buf.insert(buf.end(),e.name.begin(),e.name.end());
+		buf.insert(buf.end(),body.begin(),body.end());
+
+		PutU32(dir,0x02014b50);
+		PutU16(dir,20);PutU16(dir,20);PutU16(dir,0);PutU16(dir,wMethod);
+		PutU16(dir,0);PutU16(dir,0x21);
+		PutU32(dir,0);PutU32(dir,(DWORD)body.size());PutU32(dir,(DWORD)e.data.size());
+		PutU16(dir,(WORD)e.name.size());PutU16(dir,0);PutU16(dir,0);
+		PutU16(dir,0);PutU16(dir,0);PutU32(dir,0);
+		PutU32(dir,dwOffset);
+		dir.insert(dir.end(),e.name.begin(),e.name.end());
+	}
+	DWORD dwDirOffset = (DWORD)buf.size();
+	buf.insert(buf.end(),dir.begin(),dir.end());
+	PutU32(buf,0x06054b50);
+	PutU16(buf,0);PutU16(buf,0);
+	PutU16(buf,(WORD)entries.size());PutU16(buf,(WORD)entries.size());
+	PutU32(buf,(DWORD)dir.size());PutU32(buf,dwDirOffset);
+	PutU16(buf,0);
+
+	FILE *f = _tfopen(pszFile,_T("wb"));
+	if(!f) return false;
+	bool bRet = fwrite(&buf[0],1,buf.size(),f) == buf.size();
+	fclose(f);
+	return bRet;
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+
+//测试用的zip文件, resprovider-zip-test.cpp和resprovider-pack-test.cpp共用
+
+struct ZipTestEntry
+{
+	std::string		name;
+	std::vector<BYTE>	data;
+	bool			bDeflate;	//使用deflate方法保存
+	ZipTestEntry():bDeflate(false){}
+};
+
+//生成zip, 读取时不校验crc, crc直接写0
+bool WriteTestZip(LPCTSTR pszFile,const std::vector<ZipTestEntry> & entries);
@@ -0,0 +1,351 @@
+﻿#include <gtest/gtest.h>
+
+#include <souistd.h>
+#include <helper/STimerWheel.h>
+#include <helper/STimerEx.h>
+#include <stdio.h>
+#include "souitest-bench.h"
+
+using namespace SOUI;
+
+//时间轮使用虚拟时钟, 结果与真实时间无关. Timer2Test使用真实的线程定时器检查STimer2与时间轮的衔接
+//性能对比: souitest --gtest_also_run_disabled_tests --gtest_filter=TimerWheelTest.DISABLED_*
+
+//用GetNextDelay模拟系统定时器, 一直推进到有定时器到期, 返回到期的时间
+static DWORD RunUntilFired(STimerWheel & wheel,DWORD dwNow,SArray<TIMERINFO> & lstFired,int *pWakes = NULL)
+{
+	int nWakes = 0;
+	for(;;)
+	{
+		DWORD dwDelay = wheel.GetNextDelay(dwNow);
+		if(dwDelay == INFINITE) break;
+		dwNow += dwDelay;
+		nWakes++;
+		if(wheel.Advance(dwNow,lstFired)) break;
+	}
+	if(pWakes) *pWakes = nWakes;
+	return dwNow;
+}
+
+TEST(TimerWheelTest,PeriodicTimer)
+{
+	STimerWheel wheel(0,10);
+	SArray<TIMERINFO> lstFired;
+	EXPECT_EQ(INFINITE,wheel.GetNextDelay(0));
+
+	wheel.SetTimer(1,100,30,0);
+	EXPECT_EQ(30,wheel.GetNextDelay(0));
+	EXPECT_EQ(0,wheel.Advance(29,lstFired));
+	EXPECT_EQ(1,wheel.Advance(30,lstFired));
+	ASSERT_EQ(1,lstFired.GetCount());
+	EXPECT_EQ(1,lstFired[0].Swnd);
+	EXPECT_EQ(100,lstFired[0].uTimerID);
+
+	//从到期时重新计时
+	EXPECT_EQ(30,wheel.GetNextDelay(30));
+	EXPECT_EQ(1,wheel.Advance(60,lstFired));
+	//错过的周期不补发
+	EXPECT_EQ(1,wheel.Advance(200,lstFired));
+	EXPECT_EQ(3,lstFired.GetCount());
+	EXPECT_EQ(30,wheel.GetNextDelay(200));
+
+	//重新设置时重新计时
+	wheel.SetTimer(1,100,50,210);
+	EXPECT_EQ(0,wheel.Advance(230,lstFired));
+	EXPECT_EQ(1,wheel.Advance(260,lstFired));
+	EXPECT_EQ(1,wheel.GetCount());
+}
+
+//同一个tick内到期的定时器一起触发
+TEST(TimerWheelTest,CoalesceWithinTick)
+{
+	STimerWheel wheel(0,10);
+	SArray<TIMERINFO> lstFired;
+	wheel.SetTimer(1,1,11,0);
+	wheel.SetTimer(1,2,13,0);
+	wheel.SetTimer(2,1,19,0);
+	wheel.SetTimer(3,1,21,0);
+	EXPECT_EQ(20,wheel.GetNextDelay(0));
+	EXPECT_EQ(0,wheel.Advance(19,lstFired));
+	EXPECT_EQ(3,wheel.Advance(20,lstFired));
+	EXPECT_EQ(10,wheel.GetNextDelay(20));
+	EXPECT_EQ(1,wheel.Advance(30,lstFired));
+}
+
+TEST(TimerWheelTest,KillTimers)
+{
+	STimerWheel wheel(0,10);
+	SArray<TIMERINFO> lstFired;
+	for(UINT_PTR i=0;i<5;i++) wheel.SetTimer(7,i,50,0);
+	wheel.SetTimer(8,0,50,0);
+	wheel.SetTimer(9,0,5000,0);
+	EXPECT_EQ(7,wheel.GetCount());
+
+	EXPECT_TRUE(wheel.KillTimer(7,2));
+	EXPECT_FALSE(wheel.KillTimer(7,2));
+	EXPECT_FALSE(wheel.HasTimer(7,2));
+	EXPECT_TRUE(wheel.HasTimer(7,3));
+	EXPECT_EQ(4,wheel.KillTimer(7));
+	EXPECT_EQ(0,wheel.KillTimer(7));
+	EXPECT_EQ(2,wheel.GetCount());
+
+	EXPECT_EQ(1,wheel.Advance(50,lstFired));
+	EXPECT_EQ(8,lstFired[0].Swnd);
+	EXPECT_TRUE(wheel.KillTimer(9,0));
+	EXPECT_EQ(1,wheel.KillTimer(8));
+	EXPECT_EQ(INFINITE,wheel.GetNextDelay(60));
+}
+
+//长周期定时器放在高层, 下放后准时触发, 期间只唤醒几次
+TEST(TimerWheelTest,LongTimersCascade)
+{
+	const UINT nElapses[] = {2555,2560,2570,100000,163840,5000000,700000000};
+	const DWORD dwStarts[] = {0,3,0xFFFFFF00};//包括GetTickCount回绕
+	for(int i=0;i<ARRAYSIZE(nElapses);i++) for(int j=0;j<ARRAYSIZE(dwStarts);j++)
+	{
+		STimerWheel wheel(dwStarts[j],10);
+		SArray<TIMERINFO> lstFired;
+		wheel.SetTimer(1,1,nElapses[i],dwStarts[j]);
+		int nWakes = 0;
+		DWORD dwFired = RunUntilFired(wheel,dwStarts[j],lstFired,&nWakes);
+		ASSERT_EQ(1,lstFired.GetCount());
+
+		//到期时间向上取整到tick
+		ULONGLONG llDue = ((ULONGLONG)dwStarts[j] + nElapses[i] + 9)/10*10;
+		EXPECT_EQ((DWORD)llDue,dwFired) << "elapse " << nElapses[i] << " start " << dwStarts[j];
+		EXPECT_LE(nWakes,6);
+	}
+}
+
+//定时器消息中设置和删除定时器, 派发前用HasTimer检查
+TEST(TimerWheelTest,ChangesDuringDispatch)
+{
+	STimerWheel wheel(0,10);
+	SArray<TIMERINFO> lstFired;
+	wheel.SetTimer(1,1,10,0);
+	wheel.SetTimer(2,1,10,0);
+	wheel.SetTimer(3,1,10,0);
+	EXPECT_EQ(3,wheel.Advance(10,lstFired));
+
+	int nDispatched = 0;
+	for(size_t i=0;i<lstFired.GetCount();i++)
+	{
+		if(!wheel.HasTimer(lstFired[i].Swnd,lstFired[i].uTimerID)) continue;
+		nDispatched++;
+		if(nDispatched == 1)
+		{//第一个消息中销毁其它窗口, 并设置一个新的定时器
+			for(SWND swnd=1;swnd<=3;swnd++)
+			{
+				if(swnd != lstFired[i].Swnd) wheel.KillTimer(swnd);
+			}
+			wheel.SetTimer(4,1,5,10);
+		}
+	}
+	EXPECT_EQ(1,nDispatched);
+	EXPECT_EQ(2,wheel.GetCount());
+
+	lstFired.RemoveAll();
+	EXPECT_EQ(2,wheel.Advance(20,lstFired));
+	EXPECT_TRUE(lstFired[0].Swnd == 4 || lstFired[1].Swnd == 4);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//STimer2: 线程定时器驱动时间轮, 需要在设置定时器的线程中派发消息
+
+struct Timer2Record
+{
+	SWND swnd;
+	UINT_PTR uTimerID;
+	DWORD dwThreadId;
+	DWORD dwTime;
+};
+
+//记录派发的定时器, 不经过SWindowMgr
+class STestTimer2 : public STimer2
+{
+public:
+	STestTimer2():m_swndKillTo(0){}
+
+	BOOL Set(SWND swnd,UINT_PTR uTimerID,UINT nElapse){return _SetTimer(swnd,uTimerID,nElapse);}
+	void Kill(SWND swnd,UINT_PTR uTimerID){_KillTimer(swnd,uTimerID);}
+	void Kill(SWND swnd){_KillTimer(swnd);}
+
+	//swnd为0时返回所有窗口的派发次数
+	int CountFired(SWND swnd)
+	{
+		SAutoLock lock(m_csRecord);
+		int nRet = 0;
+		for(size_t i=0;i<m_lstRecords.GetCount();i++)
+		{
+			if(swnd == 0 || m_lstRecords[i].swnd == swnd) nRet++;
+		}
+		return nRet;
+	}
+
+	Timer2Record GetRecord(int i)
+	{
+		SAutoLock lock(m_csRecord);
+		return m_lstRecords[i];
+	}
+
+	SWND m_swndKillTo;	//不为0时, 派发一个定时器后删除1到m_swndKillTo中其它窗口的定时器, 模拟在定时器消息中销毁窗口
+
+protected:
+	virtual void _OnTimer(SWND swnd,UINT_PTR uTimerID)
+	{
+		Timer2Record rec = {swnd,uTimerID,GetCurrentThreadId(),GetTickCount()};
+		{
+			SAutoLock lock(m_csRecord);
+			m_lstRecords.Add(rec);
+		}
+		for(SWND swndKill=1;swndKill<=m_swndKillTo;swndKill++)
+		{
+			if(swndKill != swnd) _KillTimer(swndKill);
+		}
+	}
+
+	SCriticalSection m_csRecord;
+	SArray<Timer2Record> m_lstRecords;
+};
+
+//派发本线程的消息, 直到swnd的定时器派发了nFired次或者超时
+static BOOL PumpUntilFired(STestTimer2 & timer,SWND swnd,int nFired,DWORD dwTimeout)
+{
+	DWORD dwStart = GetTickCount();
+	for(;;)
+	{
+		MSG msg;
+		while(PeekMessage(&msg,NULL,0,0,PM_REMOVE)) DispatchMessage(&msg);
+		if(timer.CountFired(swnd) >= nFired) return TRUE;
+		DWORD dwElapsed = GetTickCount() - dwStart;
+		if(dwElapsed >= dwTimeout) return FALSE;
+		MsgWaitForMultipleObjects(0,NULL,FALSE,dwTimeout - dwElapsed,QS_ALLINPUT);
+	}
+}
+
+//新的定时器更早到期时提前系统定时器, 删除后按剩下的定时器重新设置
+TEST(Timer2Test,ReArmHostTimer)
+{
+	STestTimer2 timer;
+	DWORD dwStart = GetTickCount();
+	ASSERT_TRUE(timer.Set(1,1,400));
+	ASSERT_TRUE(timer.Set(2,1,30));
+	ASSERT_TRUE(PumpUntilFired(timer,0,1,300));
+	EXPECT_EQ(2,timer.GetRecord(0).swnd);
+	EXPECT_LT(timer.GetRecord(0).dwTime - dwStart,300u);
+
+	timer.Kill(2,1);
+	ASSERT_TRUE(PumpUntilFired(timer,1,1,1000));
+	EXPECT_EQ(1,timer.CountFired(2));
+	//到期时间按tick向上取整, 不会提前
+	EXPECT_GE(timer.GetRecord(1).dwTime - dwStart,400u - KTimerTickMs);
+
+	//周期定时器到期后重新设置系统定时器
+	ASSERT_TRUE(PumpUntilFired(timer,1,2,1000));
+	EXPECT_EQ(1,timer.CountFired(2));
+	timer.Kill(1);
+}
+
+//同一批到期的定时器, 前面的消息中删除的不再派发
+TEST(Timer2Test,SkipKilledBeforeDispatch)
+{
+	STestTimer2 timer;
+	timer.m_swndKillTo = 3;
+	for(SWND swnd=1;swnd<=3;swnd++) ASSERT_TRUE(timer.Set(swnd,1,50));
+	ASSERT_TRUE(PumpUntilFired(timer,0,1,500));
+	SWND swndFirst = timer.GetRecord(0).swnd;
+	//第一个窗口的定时器继续触发
+	ASSERT_TRUE(PumpUntilFired(timer,swndFirst,3,1000));
+	EXPECT_EQ(timer.CountFired(0),timer.CountFired(swndFirst));
+	timer.Kill(swndFirst);
+}
+
+struct Timer2ThreadParam
+{
+	STestTimer2 *pTimer;
+	BOOL bFired;
+};
+
+static DWORD WINAPI Timer2Thread(LPVOID lpParam)
+{
+	Timer2ThreadParam *pParam = (Timer2ThreadParam*)lpParam;
+	pParam->bFired = pParam->pTimer->Set(10,1,20) && PumpUntilFired(*pParam->pTimer,10,3,1000);
+	pParam->pTimer->Kill(10);
+	return 0;
+}
+
+//每个线程的定时器在自己的线程中派发, 另一个线程设置定时器不影响本线程
+TEST(Timer2Test,TimersStayOnTheirThread)
+{
+	STestTimer2 timer;
+	ASSERT_TRUE(timer.Set(20,1,20));
+	Timer2ThreadParam param = {&timer,FALSE};
+	HANDLE hThread = CreateThread(NULL,0,Timer2Thread,&param,0,NULL);
+	EXPECT_TRUE(PumpUntilFired(timer,20,3,1000));
+	WaitForSingleObject(hThread,INFINITE);
+	CloseHandle(hThread);
+	EXPECT_TRUE(param.bFired);
+	//工作线程设置定时器之后本线程的定时器仍然触发
+	int nFired = timer.CountFired(20);
+	EXPECT_TRUE(PumpUntilFired(timer,20,nFired+2,1000));
+	timer.Kill(20);
+
+	DWORD dwThreadId = GetCurrentThreadId();
+	for(int i=0;i<timer.CountFired(0);i++)
+	{
+		Timer2Record rec = timer.GetRecord(i);
+		if(rec.swnd == 20) EXPECT_EQ(dwThreadId,rec.dwThreadId);
+		else EXPECT_NE(dwThreadId,rec.dwThreadId);
+	}
+}
+
+//10万个定时器分属1万个窗口, 与原来按事件ID保存并在销毁窗口时遍历全部定时器的做法比较
+BENCHMARK_TEST(TimerWheelTest,Benchmark)
+{
+	const int nTimers = 100000;
+	const int nPerWnd = 10;
+	const int nWnds = nTimers/nPerWnd;
+
+	LARGE_INTEGER t0,t1,t2,t3;
+	QueryPerformanceCounter(&t0);
+	STimerWheel wheel(0,10);
+	for(int i=0;i<nTimers;i++)
+	{
+		wheel.SetTimer(i/nPerWnd,i%nPerWnd,10+(i*7919)%60000,0);
+	}
+	QueryPerformanceCounter(&t1);
+	SArray<TIMERINFO> lstFired;
+	size_t nFired = 0;
+	for(DWORD dwNow=0;dwNow<=60000;dwNow+=16)
+	{
+		lstFired.RemoveAll();
+		wheel.Advance(dwNow,lstFired);
+		nFired += lstFired.GetCount();
+	}
+	QueryPerformanceCounter(&t2);
+	for(int i=0;i<nWnds;i++) wheel.KillTimer(i);
+	QueryPerformanceCounter(&t3);
+	EXPECT_EQ(0,wheel.GetCount());
+	BenchmarkPrintf("timer wheel: set %.1fms, 60s of ticks %.1fms (%u fired), destroy %d windows %.1fms\n",
+		ElapsedMs(t0,t1),ElapsedMs(t1,t2),(UINT)nFired,nWnds,ElapsedMs(t2,t3));
+
+	//原来的做法
+	SMap<UINT_PTR,TIMERINFO> mapTimers;
+	for(int i=0;i<nTimers;i++)
+	{
+		TIMERINFO ti = {i/nPerWnd,i%nPerWnd};
+		mapTimers[i+1] = ti;
+	}
+	QueryPerformanceCounter(&t1);
+	for(int i=0;i<nWnds;i++)
+	{
+		SPOSITION pos = mapTimers.GetStartPosition();
+		while(pos)
+		{
+			SMap<UINT_PTR,TIMERINFO>::CPair *p = mapTimers.GetNext(pos);
+			if(p->m_value.Swnd == (SWND)i) mapTimers.RemoveAtPos((SPOSITION)p);
+		}
+	}
+	QueryPerformanceCounter(&t2);
+	BenchmarkPrintf("map scan:    destroy %d windows %.1fms\n",nWnds,ElapsedMs(t1,t2));
+}
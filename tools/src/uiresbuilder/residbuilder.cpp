@@ -3,6 +3,7 @@
 
 #include "stdafx.h"
 #include "tinyxml/tinyxml.h"
+#include "../../../components/resprovider-pack/respack-writer.h"
 
 const wchar_t  RB_HEADER_RC[]=
 L"/*<------------------------------------------------------------------------------------------------->*/\n"\
@@ -527,6 +528,68 @@ __int64 ParseUIDefFile(map<string,string> &mapFiles, const wchar_t * pszFileName
     return tmStamp;
 }
 
+//Ѿѹļֱӱ, ԴӳԴֱӽ
+const wchar_t * KPackStoredExt[] = {L".png",L".jpg",L".jpeg",L".gif",L".webp",L".zip",L".7z"};
+
+BOOL IsStoredFile(const wchar_t *pszPath)
+{
+    const wchar_t *pszExt = wcsrchr(pszPath,L'.');
+    if(!pszExt) return FALSE;
+    for(int i=0;i<ARRAYSIZE(KPackStoredExt);i++)
+    {
+        if(wcsicmp(pszExt,KPackStoredExt[i])==0) return TRUE;
+    }
+    return FALSE;
+}
+
+BOOL ReadWholeFile(const wchar_t *pszPath,vector<BYTE> &buf)
+{
+    FILE *f = _wfopen(pszPath,L"rb");
+    if(!f) return FALSE;
+    fseek(f,0,SEEK_END);
+    long nSize = ftell(f);
+    fseek(f,0,SEEK_SET);
+    buf.resize(nSize);
+    BOOL bOK = nSize == 0 || fread(&buf[0],1,nSize,f) == (size_t)nSize;
+    fclose(f);
+    return bOK;
+}
+
+//resprovider-packʹõԴ, ʽrespack-format.h
+BOOL BuildResPack(const vector<IDMAPRECORD> &vecIdMapRecord,const string &strPack)
+{
+    SOUI::CRespackWriter writer;
+    DWORD dwRawSize = 0;
+    vector<IDMAPRECORD>::const_iterator it=vecIdMapRecord.begin();
+    while(it!=vecIdMapRecord.end())
+    {
+        vector<BYTE> data;
+        if(!ReadWholeFile(it->szPath,data))
+        {
+            wprintf(L"!!!err: read file failed! file name: %s\n",it->szPath);
+            return FALSE;
+        }
+        writer.AddEntry(it->szType,it->szName,data.empty()?NULL:&data[0],(DWORD)data.size(),IsStoredFile(it->szPath));
+        dwRawSize += (DWORD)data.size();
+        it++;
+    }
+
+    vector<BYTE> out;
+    int nDup = writer.Build(out);
+    if(nDup) printf("warning: %d duplicated resources ignored\n",nDup);
+
+    FILE *f = fopen(strPack.c_str(),"wb");
+    if(!f)
+    {
+        printf("!!!err: create pack file failed! file name: %s\n",strPack.c_str());
+        return FALSE;
+    }
+    BOOL bOK = fwrite(&out[0],1,out.size(),f) == out.size();
+    fclose(f);
+    if(bOK) printf("build %s succeed! %u bytes -> %u bytes\n",strPack.c_str(),dwRawSize,(DWORD)out.size());
+    return bOK;
+}
+
 //uiresbuilder -p uires -i uires\uires.idx -r .\uires\winres.rc2 -h .\uires\resource.h idtable
 int _tmain(int argc, _TCHAR* argv[])
 {
@@ -534,11 +597,12 @@ int _tmain(int argc, _TCHAR* argv[])
 	string strIndexFile;
 	string strRes;		//rc2ļ
 	string strHeadFile; // head file
+	string strPackFile; //Դļ
     BOOL bBuildIDMap=FALSE;  //Build ID map
 	int c;
 
 	printf("%s\n",GetCommandLineA());
-	while ((c = getopt(argc, argv, _T("i:r:p:h:"))) != EOF || optarg!=NULL)
+	while ((c = getopt(argc, argv, _T("i:r:p:h:k:"))) != EOF || optarg!=NULL)
 	{
 		switch (c)
 		{
@@ -546,6 +610,7 @@ int _tmain(int argc, _TCHAR* argv[])
 		case 'r':strRes=optarg;break;
 		case 'p':strSkinPath=optarg;break;
 		case 'h':strHeadFile=optarg;break;
+		case 'k':strPackFile=optarg;break;
         case EOF:
             if(_tcscmp(optarg ,_T("idtable"))==0) bBuildIDMap = TRUE;
             optind ++;
@@ -561,6 +626,7 @@ int _tmain(int argc, _TCHAR* argv[])
         printf("\tparam -p : define path of uires folder\n");
         printf("\tparam -r : define path of output .rc2 file\n");
         printf("\tparam -h : define path of output resource.h file\n");
+        printf("\tparam -k : define path of output resource pack file for resprovider-pack\n");
         printf("\tparam idtable : define idtable is needed for resource.h. no id table for default.\n");
 		return 1;
 	}
@@ -654,6 +720,11 @@ int _tmain(int argc, _TCHAR* argv[])
 		WriteFile(tmIdx, strRes, strOut, TRUE);
 	}
 
+	if(!strPackFile.empty())
+	{//Դ
+		if(!BuildResPack(vecIdMapRecord,strPackFile)) return 3;
+	}
+
     //name,id,ֻԴlayoutԴXMLԴ
 	if (!strHeadFile.empty())
 	{
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "utilities-def.h"
+#include <windows.h>
+
+namespace SOUI
+{
+
+//Colorize使用的查找表
+//亮度L(0-255)对应的目标颜色已经乘上了目标色权重a0,
+//输出通道k = (wClr[L][k] + 原色通道 * a1)>>8
+typedef struct tagCOLORIZELUT
+{
+    WORD wClr[256][3];  //亮度 -> 目标颜色*a0
+    int  a1;            //原色权重[0-256], a0+a1==256
+    BOOL bHslLum;       //TRUE:亮度按HSL的(max+min)/2计算; FALSE:按灰度计算
+} COLORIZELUT;
+
+//32位像素处理核心, 运行时根据CPU选择SSE2/AVX2实现, 不支持时使用标量实现
+//所有实现的结果逐位一致
+class UTILITIES_API SPixelKernels
+{
+public:
+    enum SIMDLEVEL
+    {
+        SIMD_NONE = 0,
+        SIMD_SSE2,
+        SIMD_AVX2,
+    };
+
+    //CPU及编译器支持的最高等级
+    static SIMDLEVEL GetSupportedSimdLevel();
+
+    static SIMDLEVEL GetSimdLevel();
+
+    //限制使用的最高等级, 主要用于测试及性能对比, 返回实际生效的等级
+    static SIMDLEVEL SetSimdLevel(SIMDLEVEL level);
+
+    //RGBA转换为预乘的BGRA
+    static void PremultiplyRGBA(BYTE *pBits,int nPixels);
+
+    //预乘的BGRA转换为灰度, alpha不变
+    static void Gray(BYTE *pBits,int nPixels);
+
+    //将连续nPixels个像素的前三个通道累加到sum中
+    static void SumPixels(const BYTE *pBits,int nPixels,UINT sum[3]);
+
+    //生成以crRef为目标颜色的着色查找表, fBlend为目标色的权重[0-1]
+    static void BuildColorizeLut(COLORIZELUT & lut,COLORREF crRef,float fBlend=0.8f);
+
+    //使用查找表对预乘的BGRA着色, alpha为0的像素不处理
+    static void Colorize(BYTE *pBits,int nPixels,const COLORIZELUT & lut);
+};
+
+}//namespace SOUI
@@ -0,0 +1,142 @@
+﻿/**
+* Copyright (C) 2014-2050 SOUI团队
+* All rights reserved.
+*
+* @file       sprofiler.h
+* @brief      启动过程分段计时
+* @version    v1.0
+* @author     soui
+* @date       2026-10-19
+*
+* Describe    在SApplication构造到主窗口第一帧之间的关键阶段插入SPROFILE_SCOPE, 每个线程记录嵌套的计时段,
+*             可以附带对象数和字节数. 导出chrome://tracing格式的trace文件和按名字汇总的文本表格.
+*             没有启用时每个计时段只有一次标志检查; 定义SOUI_DISABLE_PROFILER后宏不产生任何代码
+*/
+
+#pragma once
+
+#include "utilities-def.h"
+#include <windows.h>
+
+namespace SOUI
+{
+    struct PROFILESUMMARY
+    {
+        LPCSTR   pszName;       //计时段名字
+        int      nCalls;        //次数
+        double   dTotalMs;      //总耗时, 包含子段
+        double   dSelfMs;       //去掉直接子段后的耗时
+        LONGLONG nObjects;      //对象数, 包含子段
+        LONGLONG nBytes;        //字节数, 包含子段
+    };
+
+    /**
+    * @class      SProfiler
+    * @brief      分段计时器
+    *
+    * Describe    全部为静态方法, 可以在任意线程中使用. 计时段名字必须是常量字符串, 只保存指针
+    */
+    class UTILITIES_API SProfiler
+    {
+    public:
+        /**
+         * Start
+         * @brief    清除已有记录并开始计时
+         * @param    LPCTSTR pszTraceFile --  自动导出的trace文件, 可以为NULL
+         * @param    LPCTSTR pszSummaryFile --  自动导出的汇总文件, 可以为NULL
+         * @param    BOOL bStopAtFirstFrame --  主窗口完成第一帧后自动停止并导出
+         * @return   void
+         * Describe  必须在其它线程开始计时前调用, 通常放在创建SApplication之前
+         */
+        static void Start(LPCTSTR pszTraceFile = NULL,LPCTSTR pszSummaryFile = NULL,BOOL bStopAtFirstFrame = TRUE);
+
+        /**
+         * Stop
+         * @brief    停止计时, 指定了导出文件时导出
+         * @return   void
+         * Describe  已经开始的计时段仍然可以结束
+         */
+        static void Stop();
+
+        static BOOL IsEnabled() {return s_bEnabled;}
+
+        //由主窗口(SApplication::GetMainWnd, Run之前为没有owner的顶层SHostWnd)在完成一帧后调用
+        static void OnFirstFrame();
+
+        //开始一个计时段, 返回在本线程中的序号, 没有启用时返回-1
+        static int BeginSpan(LPCSTR pszName,LPCWSTR pszDetail = NULL);
+
+        //结束计时段, 对象数和字节数累加到该段和所有外层段
+        static void EndSpan(int iSpan,LONGLONG nObjects = 0,LONGLONG nBytes = 0);
+
+        //累加到本线程最内层的计时段
+        static void AddCount(LONGLONG nObjects,LONGLONG nBytes);
+
+        //记录一个没有时长的事件
+        static void Mark(LPCSTR pszName);
+
+        //清除所有记录, 调用时不能有正在进行的计时段
+        static void Reset();
+
+        /**
+         * GetSummary
+         * @brief    按名字汇总已经结束的计时段
+         * @param    PROFILESUMMARY * pItems --  输出缓冲区, 可以为NULL
+         * @param    int nMax --  缓冲区大小
+         * @return   int -- 汇总项数, 按总耗时从大到小排序
+         */
+        static int GetSummary(PROFILESUMMARY *pItems,int nMax);
+
+        //导出chrome trace event格式的json文件
+        static BOOL ExportTrace(LPCTSTR pszFile);
+
+        //导出汇总表格
+        static BOOL ExportSummary(LPCTSTR pszFile);
+
+    protected:
+        static volatile BOOL s_bEnabled;
+    };
+
+    /**
+    * @class      SProfileScope
+    * @brief      自动结束的计时段
+    */
+    class SProfileScope
+    {
+    public:
+        SProfileScope(LPCSTR pszName,LPCWSTR pszDetail = NULL)
+            :m_iSpan(SProfiler::IsEnabled()?SProfiler::BeginSpan(pszName,pszDetail):-1)
+            ,m_nObjects(0),m_nBytes(0)
+        {
+        }
+
+        ~SProfileScope()
+        {
+            if(m_iSpan >= 0) SProfiler::EndSpan(m_iSpan,m_nObjects,m_nBytes);
+        }
+
+        void AddCount(LONGLONG nObjects,LONGLONG nBytes)
+        {
+            m_nObjects += nObjects;
+            m_nBytes += nBytes;
+        }
+
+    protected:
+        int      m_iSpan;
+        LONGLONG m_nObjects;
+        LONGLONG m_nBytes;
+    };
+}//end of namespace SOUI
+
+#ifndef SOUI_DISABLE_PROFILER
+#define SPROFILE_SCOPE(name)                SOUI::SProfileScope _sprofile_scope(name)
+//detail只在启用时求值
+#define SPROFILE_SCOPE_DETAIL(name,detail)  SOUI::SProfileScope _sprofile_scope(name,SOUI::SProfiler::IsEnabled()?(LPCWSTR)(detail):NULL)
+#define SPROFILE_COUNT(objs,bytes)          _sprofile_scope.AddCount(objs,bytes)
+#define SPROFILE_MARK(name)                 do{if(SOUI::SProfiler::IsEnabled()) SOUI::SProfiler::Mark(name);}while(0)
+#else
+#define SPROFILE_SCOPE(name)
+#define SPROFILE_SCOPE_DETAIL(name,detail)
+#define SPROFILE_COUNT(objs,bytes)
+#define SPROFILE_MARK(name)
+#endif
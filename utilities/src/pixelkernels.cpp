@@ -0,0 +1,561 @@
+﻿#include "pixelkernels.h"
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define PIXELKERNELS_SSE2
+#include <intrin.h>
+#include <emmintrin.h>
+#if _MSC_VER >= 1700
+#define PIXELKERNELS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+//对0-65025范围内的x, 结果与x/255精确相等
+#define DIV255(x)   (((x) + 1 + ((x)>>8))>>8)
+
+//与SDIBHelper中的RGB2GRAY一致
+#define GRAY(c0,c1,c2) (((c0)*306 + (c1)*601 + (c2)*117)>>10)
+
+//SSE2累加器每个16位通道每次最多增加510, 128次后需要转换到32位
+#define SUM_BATCH   128
+
+namespace SOUI
+{
+    typedef void (*FunPremultiplyRGBA)(BYTE *pBits,int nPixels);
+    typedef void (*FunGray)(BYTE *pBits,int nPixels);
+    typedef void (*FunSumPixels)(const BYTE *pBits,int nPixels,UINT sum[3]);
+
+    struct PIXELKERNELS
+    {
+        FunPremultiplyRGBA  pfnPremultiplyRGBA;
+        FunGray             pfnGray;
+        FunSumPixels        pfnSumPixels;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    //  标量实现
+
+    static void PremultiplyRGBA_C(BYTE *p,int nPixels)
+    {
+        for(int i=0;i<nPixels;i++,p+=4)
+        {
+            BYTE a = p[3];
+            if(a)
+            {
+                BYTE t = p[0];
+                p[0] = (BYTE)DIV255(p[2]*a);
+                p[1] = (BYTE)DIV255(p[1]*a);
+                p[2] = (BYTE)DIV255(t*a);
+            }else
+            {
+                *(DWORD*)p = 0;
+            }
+        }
+    }
+
+    static void Gray_C(BYTE *p,int nPixels)
+    {
+        for(int i=0;i<nPixels;i++,p+=4)
+        {
+            p[0] = p[1] = p[2] = (BYTE)GRAY(p[0],p[1],p[2]);
+        }
+    }
+
+    static void SumPixels_C(const BYTE *p,int nPixels,UINT sum[3])
+    {
+        UINT c0=0,c1=0,c2=0;
+        for(int i=0;i<nPixels;i++,p+=4)
+        {
+            c0 += p[0];
+            c1 += p[1];
+            c2 += p[2];
+        }
+        sum[0] += c0;
+        sum[1] += c1;
+        sum[2] += c2;
+    }
+
+#ifdef PIXELKERNELS_SSE2
+    //////////////////////////////////////////////////////////////////////////
+    //  SSE2实现, 每次处理4个像素
+
+    static inline __m128i Premultiply4_SSE2(__m128i src)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i maskAlpha = _mm_set1_epi32(0xFF000000);
+
+        __m128i lo = _mm_unpacklo_epi8(src,zero);
+        __m128i hi = _mm_unpackhi_epi8(src,zero);
+        __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo,_MM_SHUFFLE(3,3,3,3)),_MM_SHUFFLE(3,3,3,3));
+        __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi,_MM_SHUFFLE(3,3,3,3)),_MM_SHUFFLE(3,3,3,3));
+        lo = _mm_mullo_epi16(lo,alo);
+        hi = _mm_mullo_epi16(hi,ahi);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo,one),_mm_srli_epi16(lo,8)),8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi,one),_mm_srli_epi16(hi,8)),8);
+        //交换R,B
+        lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo,_MM_SHUFFLE(3,0,1,2)),_MM_SHUFFLE(3,0,1,2));
+        hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi,_MM_SHUFFLE(3,0,1,2)),_MM_SHUFFLE(3,0,1,2));
+        __m128i dst = _mm_packus_epi16(lo,hi);
+        return _mm_or_si128(_mm_andnot_si128(maskAlpha,dst),_mm_and_si128(maskAlpha,src));
+    }
+
+    static void PremultiplyRGBA_SSE2(BYTE *p,int nPixels)
+    {
+        int i=0;
+        for(;i+4<=nPixels;i+=4,p+=16)
+        {
+            __m128i src = _mm_loadu_si128((const __m128i*)p);
+            _mm_storeu_si128((__m128i*)p,Premultiply4_SSE2(src));
+        }
+        PremultiplyRGBA_C(p,nPixels-i);
+    }
+
+    static inline __m128i Gray4_SSE2(__m128i src)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i coef = _mm_setr_epi16(306,601,117,0,306,601,117,0);
+        const __m128i maskAlpha = _mm_set1_epi32(0xFF000000);
+
+        //每个像素得到两个32位的部分和: c0*306+c1*601, c2*117
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(src,zero),coef);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(src,zero),coef);
+        lo = _mm_add_epi32(lo,_mm_srli_epi64(lo,32));
+        hi = _mm_add_epi32(hi,_mm_srli_epi64(hi,32));
+        lo = _mm_shuffle_epi32(lo,_MM_SHUFFLE(3,1,2,0));
+        hi = _mm_shuffle_epi32(hi,_MM_SHUFFLE(3,1,2,0));
+        __m128i gray = _mm_srli_epi32(_mm_unpacklo_epi64(lo,hi),10);
+        gray = _mm_or_si128(gray,_mm_or_si128(_mm_slli_epi32(gray,8),_mm_slli_epi32(gray,16)));
+        return _mm_or_si128(gray,_mm_and_si128(src,maskAlpha));
+    }
+
+    static void Gray_SSE2(BYTE *p,int nPixels)
+    {
+        int i=0;
+        for(;i+4<=nPixels;i+=4,p+=16)
+        {
+            __m128i src = _mm_loadu_si128((const __m128i*)p);
+            _mm_storeu_si128((__m128i*)p,Gray4_SSE2(src));
+        }
+        Gray_C(p,nPixels-i);
+    }
+
+    static void SumPixels_SSE2(const BYTE *p,int nPixels,UINT sum[3])
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc32 = zero;
+        int i=0;
+        while(i+4<=nPixels)
+        {
+            __m128i acc16 = zero;
+            int nBatch = (nPixels-i)/4;
+            if(nBatch > SUM_BATCH) nBatch = SUM_BATCH;
+            for(int j=0;j<nBatch;j++,i+=4,p+=16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)p);
+                acc16 = _mm_add_epi16(acc16,_mm_add_epi16(_mm_unpacklo_epi8(v,zero),_mm_unpackhi_epi8(v,zero)));
+            }
+            acc32 = _mm_add_epi32(acc32,_mm_unpacklo_epi16(acc16,zero));
+            acc32 = _mm_add_epi32(acc32,_mm_unpackhi_epi16(acc16,zero));
+        }
+        UINT acc[4];
+        _mm_storeu_si128((__m128i*)acc,acc32);
+        sum[0] += acc[0];
+        sum[1] += acc[1];
+        sum[2] += acc[2];
+        SumPixels_C(p,nPixels-i,sum);
+    }
+#endif//PIXELKERNELS_SSE2
+
+#ifdef PIXELKERNELS_AVX2
+    //////////////////////////////////////////////////////////////////////////
+    //  AVX2实现, 每次处理8个像素. 所用指令都在128位通道内进行, 算法与SSE2版本相同
+
+    static void PremultiplyRGBA_AVX2(BYTE *p,int nPixels)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi16(1);
+        const __m256i maskAlpha = _mm256_set1_epi32(0xFF000000);
+        int i=0;
+        for(;i+8<=nPixels;i+=8,p+=32)
+        {
+            __m256i src = _mm256_loadu_si256((const __m256i*)p);
+            __m256i lo = _mm256_unpacklo_epi8(src,zero);
+            __m256i hi = _mm256_unpackhi_epi8(src,zero);
+            __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo,_MM_SHUFFLE(3,3,3,3)),_MM_SHUFFLE(3,3,3,3));
+            __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi,_MM_SHUFFLE(3,3,3,3)),_MM_SHUFFLE(3,3,3,3));
+            lo = _mm256_mullo_epi16(lo,alo);
+            hi = _mm256_mullo_epi16(hi,ahi);
+            lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo,one),_mm256_srli_epi16(lo,8)),8);
+            hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi,one),_mm256_srli_epi16(hi,8)),8);
+            lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo,_MM_SHUFFLE(3,0,1,2)),_MM_SHUFFLE(3,0,1,2));
+            hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi,_MM_SHUFFLE(3,0,1,2)),_MM_SHUFFLE(3,0,1,2));
+            __m256i dst = _mm256_packus_epi16(lo,hi);
+            dst = _mm256_or_si256(_mm256_andnot_si256(maskAlpha,dst),_mm256_and_si256(maskAlpha,src));
+            _mm256_storeu_si256((__m256i*)p,dst);
+        }
+        PremultiplyRGBA_SSE2(p,nPixels-i);
+    }
+
+    static void Gray_AVX2(BYTE *p,int nPixels)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i coef = _mm256_setr_epi16(306,601,117,0,306,601,117,0,306,601,117,0,306,601,117,0);
+        const __m256i maskAlpha = _mm256_set1_epi32(0xFF000000);
+        int i=0;
+        for(;i+8<=nPixels;i+=8,p+=32)
+        {
+            __m256i src = _mm256_loadu_si256((const __m256i*)p);
+            __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(src,zero),coef);
+            __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(src,zero),coef);
+            lo = _mm256_add_epi32(lo,_mm256_srli_epi64(lo,32));
+            hi = _mm256_add_epi32(hi,_mm256_srli_epi64(hi,32));
+            lo = _mm256_shuffle_epi32(lo,_MM_SHUFFLE(3,1,2,0));
+            hi = _mm256_shuffle_epi32(hi,_MM_SHUFFLE(3,1,2,0));
+            __m256i gray = _mm256_srli_epi32(_mm256_unpacklo_epi64(lo,hi),10);
+            gray = _mm256_or_si256(gray,_mm256_or_si256(_mm256_slli_epi32(gray,8),_mm256_slli_epi32(gray,16)));
+            _mm256_storeu_si256((__m256i*)p,_mm256_or_si256(gray,_mm256_and_si256(src,maskAlpha)));
+        }
+        Gray_SSE2(p,nPixels-i);
+    }
+
+    static void SumPixels_AVX2(const BYTE *p,int nPixels,UINT sum[3])
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc32 = zero;
+        int i=0;
+        while(i+8<=nPixels)
+        {
+            __m256i acc16 = zero;
+            int nBatch = (nPixels-i)/8;
+            if(nBatch > SUM_BATCH) nBatch = SUM_BATCH;
+            for(int j=0;j<nBatch;j++,i+=8,p+=32)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i*)p);
+                acc16 = _mm256_add_epi16(acc16,_mm256_add_epi16(_mm256_unpacklo_epi8(v,zero),_mm256_unpackhi_epi8(v,zero)));
+            }
+            acc32 = _mm256_add_epi32(acc32,_mm256_unpacklo_epi16(acc16,zero));
+            acc32 = _mm256_add_epi32(acc32,_mm256_unpackhi_epi16(acc16,zero));
+        }
+        __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc32),_mm256_extracti128_si256(acc32,1));
+        UINT acc[4];
+        _mm_storeu_si128((__m128i*)acc,acc128);
+        _mm256_zeroupper();
+        sum[0] += acc[0];
+        sum[1] += acc[1];
+        sum[2] += acc[2];
+        SumPixels_SSE2(p,nPixels-i,sum);
+    }
+#endif//PIXELKERNELS_AVX2
+
+    static const PIXELKERNELS s_kernels[] =
+    {
+        {PremultiplyRGBA_C,Gray_C,SumPixels_C},
+#ifdef PIXELKERNELS_SSE2
+        {PremultiplyRGBA_SSE2,Gray_SSE2,SumPixels_SSE2},
+#endif
+#ifdef PIXELKERNELS_AVX2
+        {PremultiplyRGBA_AVX2,Gray_AVX2,SumPixels_AVX2},
+#endif
+    };
+
+    static SPixelKernels::SIMDLEVEL DetectSimdLevel()
+    {
+        SPixelKernels::SIMDLEVEL level = SPixelKernels::SIMD_NONE;
+#ifdef PIXELKERNELS_SSE2
+        int info[4];
+        __cpuid(info,0);
+        int nIds = info[0];
+        __cpuid(info,1);
+        if(!(info[3] & (1<<26))) return level;
+        level = SPixelKernels::SIMD_SSE2;
+#ifdef PIXELKERNELS_AVX2
+        //AVX2需要操作系统支持保存YMM寄存器
+        BOOL bOsXSave = (info[2] & (1<<27)) && (info[2] & (1<<28));
+        if(bOsXSave && nIds >= 7 && (_xgetbv(0) & 6) == 6)
+        {
+            __cpuidex(info,7,0);
+            if(info[1] & (1<<5)) level = SPixelKernels::SIMD_AVX2;
+        }
+#endif
+#endif
+        return level;
+    }
+
+    //预乘颜色还原表, 与原算法一致, 结果截断为BYTE
+    static BYTE s_byUnpremultiply[256][256];
+    //HSL亮度表, 下标为max+min
+    static BYTE s_byHslLum[511];
+
+    static SPixelKernels::SIMDLEVEL s_simdSupported = SPixelKernels::SIMD_NONE;
+    static SPixelKernels::SIMDLEVEL s_simdLevel = SPixelKernels::SIMD_NONE;
+    static const PIXELKERNELS * s_pKernels = &s_kernels[0];
+
+    static struct PixelKernelsInit
+    {
+        PixelKernelsInit()
+        {
+            for(int a=1;a<256;a++)
+            {
+                for(int x=0;x<256;x++)
+                {
+                    s_byUnpremultiply[a][x] = (BYTE)((x*255)/a);
+                }
+            }
+            for(int i=0;i<511;i++)
+            {
+                s_byHslLum[i] = (BYTE)((i*255+255)/510);
+            }
+            s_simdSupported = s_simdLevel = DetectSimdLevel();
+            s_pKernels = &s_kernels[s_simdLevel];
+        }
+    } s_init;
+
+    //////////////////////////////////////////////////////////////////////////
+    //  SPixelKernels
+
+    SPixelKernels::SIMDLEVEL SPixelKernels::GetSupportedSimdLevel()
+    {
+        return s_simdSupported;
+    }
+
+    SPixelKernels::SIMDLEVEL SPixelKernels::GetSimdLevel()
+    {
+        return s_simdLevel;
+    }
+
+    SPixelKernels::SIMDLEVEL SPixelKernels::SetSimdLevel(SIMDLEVEL level)
+    {
+        if(level > s_simdSupported) level = s_simdSupported;
+        if(level < SIMD_NONE) level = SIMD_NONE;
+        s_simdLevel = level;
+        s_pKernels = &s_kernels[level];
+        return level;
+    }
+
+    void SPixelKernels::PremultiplyRGBA(BYTE *pBits,int nPixels)
+    {
+        s_pKernels->pfnPremultiplyRGBA(pBits,nPixels);
+    }
+
+    void SPixelKernels::Gray(BYTE *pBits,int nPixels)
+    {
+        s_pKernels->pfnGray(pBits,nPixels);
+    }
+
+    void SPixelKernels::SumPixels(const BYTE *pBits,int nPixels,UINT sum[3])
+    {
+        s_pKernels->pfnSumPixels(pBits,nPixels,sum);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    //  着色查找表, 原SDIBHelper中的HSL算法
+
+    struct COLORIZEPARAM{
+        BYTE hue;
+        BYTE sat;
+        int  a0;//[0-256]
+        int  a1;//[0-256]
+    };
+
+    static void FillColorizeParam(COLORIZEPARAM &param ,BYTE hue,BYTE sat,float fBlend)
+    {
+        param.hue = hue;
+        param.sat = sat;
+        SASSERT(fBlend>=0.0f && fBlend <=1.0f);
+        param.a0 = (int)(fBlend*256);
+        param.a1 = 256 - param.a0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    #define  HSLMAX   255	/* H,L, and S vary over 0-HSLMAX */
+    #define  RGBMAX   255   /* R,G, and B vary over 0-RGBMAX */
+        /* HSLMAX BEST IF DIVISIBLE BY 6 */
+        /* RGBMAX, HSLMAX must each fit in a BYTE. */
+        /* Hue is undefined if Saturation is 0 (grey-scale) */
+        /* This value determines where the Hue scrollbar is */
+        /* initially set for achromatic colors */
+    #define HSLUNDEFINED (HSLMAX*2/3)
+    ////////////////////////////////////////////////////////////////////////////////
+    static RGBQUAD RGBtoHSL(RGBQUAD lRGBColor)
+    {
+        BYTE R,G,B;					/* input RGB values */
+        BYTE H,L,S;					/* output HSL values */
+        BYTE cMax,cMin;				/* max and min RGB values */
+        WORD Rdelta,Gdelta,Bdelta;	/* intermediate value: % of spread from max*/
+
+        R = lRGBColor.rgbRed;	/* get R, G, and B out of DWORD */
+        G = lRGBColor.rgbGreen;
+        B = lRGBColor.rgbBlue;
+
+        cMax = (std::max)( (std::max)(R,G), B);	/* calculate lightness */
+        cMin = (std::min)( (std::min)(R,G), B);
+        L = (BYTE)((((cMax+cMin)*HSLMAX)+RGBMAX)/(2*RGBMAX));
+
+        if (cMax==cMin){			/* r=g=b --> achromatic case */
+            S = 0;					/* saturation */
+            H = HSLUNDEFINED;		/* hue */
+        } else {					/* chromatic case */
+            if (L <= (HSLMAX/2))	/* saturation */
+                S = (BYTE)((((cMax-cMin)*HSLMAX)+((cMax+cMin)/2))/(cMax+cMin));
+            else
+                S = (BYTE)((((cMax-cMin)*HSLMAX)+((2*RGBMAX-cMax-cMin)/2))/(2*RGBMAX-cMax-cMin));
+            /* hue */
+            Rdelta = (WORD)((((cMax-R)*(HSLMAX/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
+            Gdelta = (WORD)((((cMax-G)*(HSLMAX/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
+            Bdelta = (WORD)((((cMax-B)*(HSLMAX/6)) + ((cMax-cMin)/2) ) / (cMax-cMin));
+
+            if (R == cMax)
+                H = (BYTE)(Bdelta - Gdelta);
+            else if (G == cMax)
+                H = (BYTE)((HSLMAX/3) + Rdelta - Bdelta);
+            else /* B == cMax */
+                H = (BYTE)(((2*HSLMAX)/3) + Gdelta - Rdelta);
+
+            //		if (H < 0) H += HSLMAX;     //always false
+            if (H > HSLMAX) H -= HSLMAX;
+        }
+        RGBQUAD hsl={L,S,H,0};
+        return hsl;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    static RGBQUAD RGBtoRGBQUAD(COLORREF cr)
+    {
+        RGBQUAD c;
+        c.rgbRed = GetRValue(cr);	/* get R, G, and B out of DWORD */
+        c.rgbGreen = GetGValue(cr);
+        c.rgbBlue = GetBValue(cr);
+        c.rgbReserved=0;
+        return c;
+    }
+    ////////////////////////////////////////////////////////////////////////////////
+    static float HueToRGB(float n1,float n2, float hue)
+    {
+        //<F. Livraghi> fixed implementation for HSL2RGB routine
+        float rValue;
+
+        if (hue > 360)
+            hue = hue - 360;
+        else if (hue < 0)
+            hue = hue + 360;
+
+        if (hue < 60)
+            rValue = n1 + (n2-n1)*hue/60.0f;
+        else if (hue < 180)
+            rValue = n2;
+        else if (hue < 240)
+            rValue = n1+(n2-n1)*(240-hue)/60;
+        else
+            rValue = n1;
+
+        return rValue;
+    }
+    ////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////////
+    static RGBQUAD HSLtoRGB(RGBQUAD lHSLColor)
+    { 
+        //<F. Livraghi> fixed implementation for HSL2RGB routine
+        float h,s,l;
+        float m1,m2;
+        BYTE r,g,b;
+
+        h = (float)lHSLColor.rgbRed * 360.0f/255.0f;
+        s = (float)lHSLColor.rgbGreen/255.0f;
+        l = (float)lHSLColor.rgbBlue/255.0f;
+
+        if (l <= 0.5)	m2 = l * (1+s);
+        else			m2 = l + s - l*s;
+
+        m1 = 2 * l - m2;
+
+        if (s == 0) {
+            r=g=b=(BYTE)(l*255.0f);
+        } else {
+            r = (BYTE)(HueToRGB(m1,m2,h+120) * 255.0f);
+            g = (BYTE)(HueToRGB(m1,m2,h) * 255.0f);
+            b = (BYTE)(HueToRGB(m1,m2,h-120) * 255.0f);
+        }
+
+        RGBQUAD rgb = {b,g,r,0};
+        return rgb;
+    }
+
+    //亮度L只依赖于像素本身, 目标色调和饱和度固定, 所以HSL到RGB的转换可以预先计算成查找表
+    static void FillColorizeLut(COLORIZELUT & lut, const COLORIZEPARAM & param)
+    {
+        lut.bHslLum = param.a0 == 256;
+        lut.a1 = lut.bHslLum ? 0 : param.a1;
+        for(int L=0;L<256;L++)
+        {
+            RGBQUAD hsl={(BYTE)L,param.sat,param.hue,0};
+            RGBQUAD rgb = HSLtoRGB(hsl);
+            if(lut.bHslLum)
+            {
+                lut.wClr[L][0] = (WORD)(rgb.rgbRed<<8);
+                lut.wClr[L][1] = (WORD)(rgb.rgbGreen<<8);
+                lut.wClr[L][2] = (WORD)(rgb.rgbBlue<<8);
+            }else
+            {
+                lut.wClr[L][0] = (WORD)(rgb.rgbRed * param.a0);
+                lut.wClr[L][1] = (WORD)(rgb.rgbBlue * param.a0);
+                lut.wClr[L][2] = (WORD)(rgb.rgbGreen * param.a0);
+            }
+        }
+    }
+
+    void SPixelKernels::BuildColorizeLut(COLORIZELUT & lut,COLORREF crRef,float fBlend)
+    {
+        RGBQUAD hsl = RGBtoHSL(RGBtoRGBQUAD(crRef));
+        COLORIZEPARAM param;
+        FillColorizeParam(param,hsl.rgbRed,hsl.rgbGreen,fBlend);
+        FillColorizeLut(lut,param);
+    }
+
+    //查表实现: 每个像素只需要几次查表和整数运算.
+    //原色还原及亮度都依赖查表, 向量化需要gather指令, 收益不大, 所有等级共用此实现
+    void SPixelKernels::Colorize(BYTE *p,int nPixels,const COLORIZELUT & lut)
+    {
+        const int a1 = lut.a1;
+        for(int i=0;i<nPixels;i++,p+=4)
+        {
+            BYTE a = p[3];
+            if(a == 0) continue;
+            BYTE c0 = p[0], c1 = p[1], c2 = p[2];
+            if(a != 255)
+            {
+                const BYTE *pTab = s_byUnpremultiply[a];
+                c0 = pTab[c0];
+                c1 = pTab[c1];
+                c2 = pTab[c2];
+            }
+            int L;
+            if(lut.bHslLum)
+            {
+                BYTE cMax = (c0>c1?c0:c1), cMin = (c0<c1?c0:c1);
+                if(c2>cMax) cMax = c2;
+                if(c2<cMin) cMin = c2;
+                L = s_byHslLum[cMax+cMin];
+            }else
+            {
+                L = GRAY(c0,c1,c2);
+            }
+            const WORD *pClr = lut.wClr[L];
+            //与原算法一致, 原色的1,2通道交叉混合
+            int r0 = (pClr[0] + c0*a1)>>8;
+            int r1 = (pClr[1] + c2*a1)>>8;
+            int r2 = (pClr[2] + c1*a1)>>8;
+            if(a != 255)
+            {
+                r0 = DIV255(r0*a);
+                r1 = DIV255(r1*a);
+                r2 = DIV255(r2*a);
+            }
+            p[0] = (BYTE)r0;
+            p[1] = (BYTE)r1;
+            p[2] = (BYTE)r2;
+        }
+    }
+
+}//namespace SOUI
@@ -0,0 +1,415 @@
+﻿#include "sprofiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <tchar.h>
+
+namespace SOUI
+{
+    const int KMaxSpans     = 1<<20;    //每个线程最多记录的计时段
+    const int KDetailLen    = 48;       //保存的说明文字长度
+    const int KMaxNames     = 256;      //汇总时的最大名字数
+
+    enum
+    {
+        SPAN_MARK = 1,  //没有时长的事件
+    };
+
+    struct ProfileSpan
+    {
+        LPCSTR   pszName;
+        LONGLONG llBegin;
+        LONGLONG llEnd;         //0表示还没有结束
+        LONGLONG nObjects;      //包含子段
+        LONGLONG nBytes;        //包含子段
+        int      iParent;
+        int      nFlags;
+        WCHAR    szDetail[KDetailLen];
+    };
+
+    //记录只由所属线程写入. 写入和导出时的复制都锁定cs, 只有导出时才会有竞争
+    struct ProfileThread
+    {
+        CRITICAL_SECTION cs;
+        DWORD           dwThreadId;
+        ProfileSpan *   pSpans;
+        int             nSpans;
+        int             nCap;
+        int             iCurrent;   //最内层正在进行的计时段
+        ProfileThread * pNext;
+    };
+
+    //全局状态, 线程链表只增加, 直到进程退出
+    class CProfilerState
+    {
+    public:
+        CProfilerState():m_pThreads(NULL),m_llOrigin(0),m_bStopAtFirstFrame(FALSE)
+        {
+            InitializeCriticalSection(&m_cs);
+            m_dwTls = TlsAlloc();
+            LARGE_INTEGER li;
+            QueryPerformanceFrequency(&li);
+            m_llFreq = li.QuadPart;
+            m_szTraceFile[0] = m_szSummaryFile[0] = 0;
+        }
+
+        ~CProfilerState()
+        {
+            while(m_pThreads)
+            {
+                ProfileThread *pNext = m_pThreads->pNext;
+                DeleteCriticalSection(&m_pThreads->cs);
+                free(m_pThreads->pSpans);
+                delete m_pThreads;
+                m_pThreads = pNext;
+            }
+            TlsFree(m_dwTls);
+            DeleteCriticalSection(&m_cs);
+        }
+
+        ProfileThread * GetThread()
+        {
+            ProfileThread *pThread = (ProfileThread*)TlsGetValue(m_dwTls);
+            if(pThread) return pThread;
+            pThread = new ProfileThread;
+            InitializeCriticalSection(&pThread->cs);
+            pThread->dwThreadId = GetCurrentThreadId();
+            pThread->pSpans = NULL;
+            pThread->nSpans = pThread->nCap = 0;
+            pThread->iCurrent = -1;
+            EnterCriticalSection(&m_cs);
+            pThread->pNext = m_pThreads;
+            m_pThreads = pThread;
+            LeaveCriticalSection(&m_cs);
+            TlsSetValue(m_dwTls,pThread);
+            return pThread;
+        }
+
+        double ToMs(LONGLONG llTicks) const
+        {
+            return llTicks*1000.0/m_llFreq;
+        }
+
+        double ToUs(LONGLONG llTicks) const
+        {
+            return llTicks*1000000.0/m_llFreq;
+        }
+
+        CRITICAL_SECTION m_cs;
+        DWORD            m_dwTls;
+        ProfileThread *  m_pThreads;
+        LONGLONG         m_llFreq;
+        LONGLONG         m_llOrigin;
+        BOOL             m_bStopAtFirstFrame;
+        TCHAR            m_szTraceFile[MAX_PATH];
+        TCHAR            m_szSummaryFile[MAX_PATH];
+    };
+
+    static CProfilerState s_state;
+
+    static LONGLONG ProfilerNow()
+    {
+        LARGE_INTEGER li;
+        QueryPerformanceCounter(&li);
+        return li.QuadPart;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    volatile BOOL SProfiler::s_bEnabled = FALSE;
+
+    void SProfiler::Start(LPCTSTR pszTraceFile,LPCTSTR pszSummaryFile,BOOL bStopAtFirstFrame)
+    {
+        Reset();
+        EnterCriticalSection(&s_state.m_cs);
+        _tcscpy_s(s_state.m_szTraceFile,MAX_PATH,pszTraceFile?pszTraceFile:_T(""));
+        _tcscpy_s(s_state.m_szSummaryFile,MAX_PATH,pszSummaryFile?pszSummaryFile:_T(""));
+        s_state.m_bStopAtFirstFrame = bStopAtFirstFrame;
+        s_state.m_llOrigin = ProfilerNow();
+        LeaveCriticalSection(&s_state.m_cs);
+        s_bEnabled = TRUE;
+    }
+
+    void SProfiler::Stop()
+    {
+        if(!s_bEnabled) return;
+        s_bEnabled = FALSE;
+        if(s_state.m_szTraceFile[0]) ExportTrace(s_state.m_szTraceFile);
+        if(s_state.m_szSummaryFile[0]) ExportSummary(s_state.m_szSummaryFile);
+    }
+
+    void SProfiler::OnFirstFrame()
+    {
+        if(!s_bEnabled || !s_state.m_bStopAtFirstFrame) return;
+        Mark("FirstFrame");
+        Stop();
+    }
+
+    //在pThread->cs内调用
+    static int BeginSpanLocked(ProfileThread *pThread,LPCSTR pszName,LPCWSTR pszDetail)
+    {
+        if(pThread->nSpans == pThread->nCap)
+        {
+            if(pThread->nCap >= KMaxSpans) return -1;
+            int nCap = pThread->nCap?pThread->nCap*2:256;
+            ProfileSpan *pSpans = (ProfileSpan*)realloc(pThread->pSpans,nCap*sizeof(ProfileSpan));
+            if(!pSpans) return -1;
+            pThread->pSpans = pSpans;
+            pThread->nCap = nCap;
+        }
+        int iSpan = pThread->nSpans;
+        ProfileSpan & span = pThread->pSpans[iSpan];
+        span.pszName = pszName;
+        span.llEnd = 0;
+        span.nObjects = span.nBytes = 0;
+        span.iParent = pThread->iCurrent;
+        span.nFlags = 0;
+        span.szDetail[0] = 0;
+        if(pszDetail) wcsncpy_s(span.szDetail,KDetailLen,pszDetail,_TRUNCATE);
+        pThread->iCurrent = iSpan;
+        pThread->nSpans++;
+        span.llBegin = ProfilerNow();
+        return iSpan;
+    }
+
+    int SProfiler::BeginSpan(LPCSTR pszName,LPCWSTR pszDetail)
+    {
+        if(!s_bEnabled) return -1;
+        ProfileThread *pThread = s_state.GetThread();
+        EnterCriticalSection(&pThread->cs);
+        int iSpan = BeginSpanLocked(pThread,pszName,pszDetail);
+        LeaveCriticalSection(&pThread->cs);
+        return iSpan;
+    }
+
+    void SProfiler::EndSpan(int iSpan,LONGLONG nObjects,LONGLONG nBytes)
+    {
+        LONGLONG llEnd = ProfilerNow();
+        ProfileThread *pThread = (ProfileThread*)TlsGetValue(s_state.m_dwTls);
+        if(!pThread || iSpan < 0) return;
+        EnterCriticalSection(&pThread->cs);
+        //Reset后记录已经清除
+        if(iSpan < pThread->nSpans && !pThread->pSpans[iSpan].llEnd)
+        {
+            ProfileSpan & span = pThread->pSpans[iSpan];
+            span.llEnd = llEnd;
+            span.nObjects += nObjects;
+            span.nBytes += nBytes;
+            if(span.iParent >= 0)
+            {
+                ProfileSpan & parent = pThread->pSpans[span.iParent];
+                parent.nObjects += span.nObjects;
+                parent.nBytes += span.nBytes;
+            }
+            pThread->iCurrent = span.iParent;
+        }
+        LeaveCriticalSection(&pThread->cs);
+    }
+
+    void SProfiler::AddCount(LONGLONG nObjects,LONGLONG nBytes)
+    {
+        if(!s_bEnabled) return;
+        ProfileThread *pThread = (ProfileThread*)TlsGetValue(s_state.m_dwTls);
+        if(!pThread) return;
+        EnterCriticalSection(&pThread->cs);
+        if(pThread->iCurrent >= 0)
+        {
+            ProfileSpan & span = pThread->pSpans[pThread->iCurrent];
+            span.nObjects += nObjects;
+            span.nBytes += nBytes;
+        }
+        LeaveCriticalSection(&pThread->cs);
+    }
+
+    void SProfiler::Mark(LPCSTR pszName)
+    {
+        if(!s_bEnabled) return;
+        ProfileThread *pThread = s_state.GetThread();
+        EnterCriticalSection(&pThread->cs);
+        int iSpan = BeginSpanLocked(pThread,pszName,NULL);
+        if(iSpan >= 0)
+        {
+            ProfileSpan & span = pThread->pSpans[iSpan];
+            span.llEnd = span.llBegin;
+            span.nFlags = SPAN_MARK;
+            pThread->iCurrent = span.iParent;
+        }
+        LeaveCriticalSection(&pThread->cs);
+    }
+
+    void SProfiler::Reset()
+    {
+        EnterCriticalSection(&s_state.m_cs);
+        for(ProfileThread *pThread = s_state.m_pThreads; pThread; pThread = pThread->pNext)
+        {
+            EnterCriticalSection(&pThread->cs);
+            pThread->nSpans = 0;
+            pThread->iCurrent = -1;
+            LeaveCriticalSection(&pThread->cs);
+        }
+        LeaveCriticalSection(&s_state.m_cs);
+    }
+
+    //复制一个线程的记录, 之后不需要再锁定该线程. 返回的记录由调用者free
+    static ProfileSpan * SnapshotSpans(ProfileThread *pThread,int & nSpans)
+    {
+        EnterCriticalSection(&pThread->cs);
+        nSpans = pThread->nSpans;
+        ProfileSpan *pSpans = nSpans?(ProfileSpan*)malloc(nSpans*sizeof(ProfileSpan)):NULL;
+        if(pSpans) memcpy(pSpans,pThread->pSpans,nSpans*sizeof(ProfileSpan));
+        else nSpans = 0;
+        LeaveCriticalSection(&pThread->cs);
+        return pSpans;
+    }
+
+    static int CompareSummary(const void *p1,const void *p2)
+    {
+        const PROFILESUMMARY *pItem1 = (const PROFILESUMMARY*)p1;
+        const PROFILESUMMARY *pItem2 = (const PROFILESUMMARY*)p2;
+        if(pItem1->dTotalMs > pItem2->dTotalMs) return -1;
+        if(pItem1->dTotalMs < pItem2->dTotalMs) return 1;
+        return strcmp(pItem1->pszName,pItem2->pszName);
+    }
+
+    int SProfiler::GetSummary(PROFILESUMMARY *pItems,int nMax)
+    {
+        PROFILESUMMARY *pSummary = (PROFILESUMMARY*)malloc(KMaxNames*sizeof(PROFILESUMMARY));
+        if(!pSummary) return 0;
+        int nNames = 0;
+
+        EnterCriticalSection(&s_state.m_cs);
+        for(ProfileThread *pThread = s_state.m_pThreads; pThread; pThread = pThread->pNext)
+        {
+            int nSpans = 0;
+            ProfileSpan *pSpans = SnapshotSpans(pThread,nSpans);
+            if(nSpans == 0) continue;
+            //直接子段的耗时, 用来计算self
+            LONGLONG *pChildTicks = (LONGLONG*)calloc(nSpans,sizeof(LONGLONG));
+            if(!pChildTicks)
+            {
+                free(pSpans);
+                continue;
+            }
+            for(int i=0;i<nSpans;i++)
+            {
+                const ProfileSpan & span = pSpans[i];
+                if(span.llEnd && span.iParent >= 0) pChildTicks[span.iParent] += span.llEnd - span.llBegin;
+            }
+            for(int i=0;i<nSpans;i++)
+            {
+                const ProfileSpan & span = pSpans[i];
+                if(!span.llEnd || (span.nFlags & SPAN_MARK)) continue;
+                int iName = 0;
+                while(iName < nNames && strcmp(pSummary[iName].pszName,span.pszName) != 0) iName++;
+                if(iName == nNames)
+                {
+                    if(nNames == KMaxNames) continue;
+                    PROFILESUMMARY & item = pSummary[nNames++];
+                    memset(&item,0,sizeof(item));
+                    item.pszName = span.pszName;
+                }
+                PROFILESUMMARY & item = pSummary[iName];
+                item.nCalls++;
+                item.dTotalMs += s_state.ToMs(span.llEnd - span.llBegin);
+                item.dSelfMs += s_state.ToMs(span.llEnd - span.llBegin - pChildTicks[i]);
+                item.nObjects += span.nObjects;
+                item.nBytes += span.nBytes;
+            }
+            free(pChildTicks);
+            free(pSpans);
+        }
+        LeaveCriticalSection(&s_state.m_cs);
+
+        qsort(pSummary,nNames,sizeof(PROFILESUMMARY),CompareSummary);
+        if(pItems)
+        {
+            int nCopy = nNames<nMax?nNames:nMax;
+            memcpy(pItems,pSummary,nCopy*sizeof(PROFILESUMMARY));
+        }
+        free(pSummary);
+        return nNames;
+    }
+
+    //输出json字符串, 说明文字转换为utf8
+    static void WriteJsonString(FILE *f,LPCSTR pszUtf8)
+    {
+        fputc('"',f);
+        for(const unsigned char *p = (const unsigned char*)pszUtf8; *p; p++)
+        {
+            if(*p == '"' || *p == '\\') fprintf(f,"\\%c",*p);
+            else if(*p < 0x20) fprintf(f,"\\u%04x",*p);
+            else fputc(*p,f);
+        }
+        fputc('"',f);
+    }
+
+    BOOL SProfiler::ExportTrace(LPCTSTR pszFile)
+    {
+        FILE *f = NULL;
+        if(_tfopen_s(&f,pszFile,_T("wb")) != 0 || !f) return FALSE;
+
+        DWORD dwPid = GetCurrentProcessId();
+        BOOL bFirst = TRUE;
+        fputs("{\"traceEvents\":[\n",f);
+        EnterCriticalSection(&s_state.m_cs);
+        for(ProfileThread *pThread = s_state.m_pThreads; pThread; pThread = pThread->pNext)
+        {
+            int nSpans = 0;
+            ProfileSpan *pSpans = SnapshotSpans(pThread,nSpans);
+            for(int i=0;i<nSpans;i++)
+            {
+                const ProfileSpan & span = pSpans[i];
+                if(!span.llEnd) continue;
+                if(!bFirst) fputs(",\n",f);
+                bFirst = FALSE;
+
+                fputs("{\"name\":",f);
+                WriteJsonString(f,span.pszName);
+                fprintf(f,",\"cat\":\"soui\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u",
+                    s_state.ToUs(span.llBegin - s_state.m_llOrigin),dwPid,pThread->dwThreadId);
+                if(span.nFlags & SPAN_MARK)
+                {
+                    fputs(",\"ph\":\"i\",\"s\":\"g\"}",f);
+                    continue;
+                }
+                fprintf(f,",\"ph\":\"X\",\"dur\":%.3f,\"args\":{\"objects\":%I64d,\"bytes\":%I64d",
+                    s_state.ToUs(span.llEnd - span.llBegin),span.nObjects,span.nBytes);
+                if(span.szDetail[0])
+                {
+                    char szDetail[KDetailLen*3];
+                    WideCharToMultiByte(CP_UTF8,0,span.szDetail,-1,szDetail,sizeof(szDetail),NULL,NULL);
+                    fputs(",\"detail\":",f);
+                    WriteJsonString(f,szDetail);
+                }
+                fputs("}}",f);
+            }
+            free(pSpans);
+        }
+        LeaveCriticalSection(&s_state.m_cs);
+        fputs("\n],\"displayTimeUnit\":\"ms\"}\n",f);
+        fclose(f);
+        return TRUE;
+    }
+
+    BOOL SProfiler::ExportSummary(LPCTSTR pszFile)
+    {
+        PROFILESUMMARY *pItems = (PROFILESUMMARY*)malloc(KMaxNames*sizeof(PROFILESUMMARY));
+        if(!pItems) return FALSE;
+        int nItems = GetSummary(pItems,KMaxNames);
+
+        FILE *f = NULL;
+        if(_tfopen_s(&f,pszFile,_T("wb")) != 0 || !f)
+        {
+            free(pItems);
+            return FALSE;
+        }
+        fprintf(f,"%-40s %8s %12s %12s %10s %12s\r\n","name","calls","total(ms)","self(ms)","objects","bytes");
+        for(int i=0;i<nItems;i++)
+        {
+            const PROFILESUMMARY & item = pItems[i];
+            fprintf(f,"%-40s %8d %12.3f %12.3f %10I64d %12I64d\r\n",
+                item.pszName,item.nCalls,item.dTotalMs,item.dSelfMs,item.nObjects,item.nBytes);
+        }
+        fclose(f);
+        free(pItems);
+        return TRUE;
+    }
+}
@@ -25,8 +25,10 @@ else{
 
 # Input
 HEADERS += include/gdialpha.h \
+           include/pixelkernels.h \
            include/souicoll.h \
            include/trace.h \
+           include/sprofiler.h \
            include/snew.h \
            include/utilities-def.h \
            include/utilities.h \
@@ -49,7 +51,9 @@ HEADERS += include/gdialpha.h \
            include/sobject/sobject-state-impl.hpp \
            
 SOURCES += src/gdialpha.cpp \
+           src/pixelkernels.cpp \
            src/trace.cpp \
+           src/sprofiler.cpp \
            src/utilities.cpp \
            src/soui_mem_wrapper.cpp\
            src/pugixml/pugixml.cpp \